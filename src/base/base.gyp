@@ -42,10 +42,13 @@
         'crash_report_handler.cc',
         'crash_report_util.cc',
         'iconv.cc',
+        'latency_histogram.cc',
         'process.cc',
         'process_mutex.cc',
         'run_level.cc',
         'scheduler.cc',
+        'shared_string.cc',
+        'stage_tracer.cc',
         'stopwatch.cc',
         'svm.cc',
         'timer.cc',
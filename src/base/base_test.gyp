@@ -41,8 +41,11 @@
         'codegen_bytearray_stream_test.cc',
         'cpu_stats_test.cc',
         'crash_report_util_test.cc',
+        'latency_histogram_test.cc',
         'process_mutex_test.cc',
         'scheduler_test.cc',
+        'shared_string_test.cc',
+        'stage_tracer_test.cc',
         'stopwatch_test.cc',
         'svm_test.cc',
         'timer_test.cc',
@@ -35,6 +35,7 @@
 //   CodeGenByteArrayOutputStream codegen_stream(&ofs,
 //                                               codegenstream::NOT_OWN_STREAM);
 //   codegen_stream.OpenVarDef("MyVar");
+//   // Or OpenVarDef("MyVar", 64) to align the array to 64 bytes.
 //   codegen_stream.put(single_byte_data);
 //   codegen_stream.write(large_data, large_data_size);
 //   codegen_stream.CloseVarDef();
@@ -123,15 +124,33 @@ class BasicCodeGenByteArrayStreamBuf
 
   // Writes the beginning of a variable definition.
   bool OpenVarDef(const string &var_name_base) {
-    if (is_open_ || var_name_base.empty()) {
+    return OpenVarDef(var_name_base, 0);
+  }
+
+  // Writes the beginning of a variable definition whose data is aligned
+  // to |alignment| bytes.  |alignment| must be 0 (no alignment) or a
+  // power of two.
+  bool OpenVarDef(const string &var_name_base, size_t alignment) {
+    if (is_open_ || var_name_base.empty() ||
+        (alignment & (alignment - 1)) != 0) {
       return false;
     }
     var_name_base_ = var_name_base;
 #ifdef MOZC_CODEGEN_BYTEARRAY_STREAM_USES_WORD_ARRAY
+#ifdef _MSC_VER
+    if (alignment > 0) {
+      *output_stream_ << "__declspec(align(" << alignment << ")) ";
+    }
+#endif  // _MSC_VER
     *output_stream_ << "const "
                     << AS_STRING(MOZC_CODEGEN_BYTEARRAY_STREAM_WORD_TYPE)
-                    << " k" << var_name_base_
-                    << "_data_wordtype[] = {\n";
+                    << " k" << var_name_base_ << "_data_wordtype[]";
+#ifndef _MSC_VER
+    if (alignment > 0) {
+      *output_stream_ << " __attribute__((aligned(" << alignment << ")))";
+    }
+#endif  // _MSC_VER
+    *output_stream_ << " = {\n";
     output_stream_format_flags_ = output_stream_->flags();
     // Set the output format in the form of "0x000012340000ABCD".
     output_stream_->setf(ios_base::hex, ios_base::basefield);
@@ -142,7 +161,11 @@ class BasicCodeGenByteArrayStreamBuf
     output_stream_->unsetf(ios_base::showbase);
     word_buffer_ = 0;
 #else
-    *output_stream_ << "const char k" << var_name_base_ << "_data[] =\n";
+    *output_stream_ << "const char k" << var_name_base_ << "_data[]";
+    if (alignment > 0) {
+      *output_stream_ << " __attribute__((aligned(" << alignment << ")))";
+    }
+    *output_stream_ << " =\n";
 #endif
     output_count_ = 0;
     return is_open_ = *output_stream_;
@@ -331,6 +354,13 @@ class BasicCodeGenByteArrayOutputStream
     }
   }
 
+  // Same as above, but the data is aligned to |alignment| bytes.
+  void OpenVarDef(const string &var_name_base, size_t alignment) {
+    if (!streambuf_.OpenVarDef(var_name_base, alignment)) {
+      this->setstate(ios_base::failbit);
+    }
+  }
+
   // Writes the end of a variable definition.
   // An output to the instance after a call to |CloseVarDef| is not allowed
   // unless |OpenVarDef| is called with a different variable name.
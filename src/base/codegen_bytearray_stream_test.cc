@@ -158,6 +158,41 @@ TEST_F(CodeGenByteArrayStreamTest, SingleWord) {
   EXPECT_TRUE(*codegen_stream_);
 }
 
+TEST_F(CodeGenByteArrayStreamTest, Aligned) {
+  codegen_stream_->OpenVarDef("Test", 64);
+  *codegen_stream_ << "12345678";
+  codegen_stream_->CloseVarDef();
+
+#ifdef MOZC_CODEGEN_BYTEARRAY_STREAM_USES_WORD_ARRAY
+  const string expected =
+#ifdef _MSC_VER
+      "__declspec(align(64)) const "
+      AS_STRING(MOZC_CODEGEN_BYTEARRAY_STREAM_WORD_TYPE)
+      " kTest_data_wordtype[] = {\n"
+#else
+      "const " AS_STRING(MOZC_CODEGEN_BYTEARRAY_STREAM_WORD_TYPE)
+      " kTest_data_wordtype[] __attribute__((aligned(64))) = {\n"
+#endif  // _MSC_VER
+      "0x3837363534333231, };\n"
+      "const char * const kTest_data = "
+      "reinterpret_cast<const char *>(kTest_data_wordtype);\n"
+      "const size_t kTest_size = 8;\n";
+#else
+  const string expected =
+      "const char kTest_data[] __attribute__((aligned(64))) =\n"
+      "\"\\x31\\x32\\x33\\x34\\x35\\x36\\x37\\x38\"\n"
+      ";\n"
+      "const size_t kTest_size = 8;\n";
+#endif
+  EXPECT_EQ(expected, ResultOutput());
+  EXPECT_TRUE(*codegen_stream_);
+}
+
+TEST_F(CodeGenByteArrayStreamTest, BadAlignment) {
+  codegen_stream_->OpenVarDef("Test", 48);
+  EXPECT_FALSE(*codegen_stream_);
+}
+
 TEST_F(CodeGenByteArrayStreamTest, SingleLine) {
   codegen_stream_->OpenVarDef("Test");
 #ifdef MOZC_CODEGEN_BYTEARRAY_STREAM_USES_WORD_ARRAY
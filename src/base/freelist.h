@@ -52,6 +52,22 @@ template <class T> class FreeList {
     chunk_index_ = 0;
   }
 
+  // Rewinds the list like Reset() but keeps at most |max_chunks| chunks
+  // for later use.  Objects in the kept chunks are not destructed, so
+  // members such as strings retain their capacity.
+  void Shrink(size_t max_chunks) {
+    if (max_chunks == 0) {
+      max_chunks = 1;
+    }
+    for (size_t i = max_chunks; i < pool_.size(); ++i) {
+      delete [] pool_[i];
+    }
+    if (pool_.size() > max_chunks) {
+      pool_.resize(max_chunks);
+    }
+    Reset();
+  }
+
   T* Alloc() {
     return Alloc(static_cast<size_t>(1));
   }
@@ -64,6 +80,7 @@ template <class T> class FreeList {
 
     if (chunk_index_ == pool_.size()) {
       pool_.push_back(new T[size_]);
+      ++num_allocated_chunks_;
     }
 
     T* r = pool_[chunk_index_] + current_index_;
@@ -75,8 +92,23 @@ template <class T> class FreeList {
     size_ = size;
   }
 
+  size_t size() const {
+    return size_;
+  }
+
+  // Returns the number of objects held by the allocated chunks.
+  size_t capacity() const {
+    return pool_.size() * size_;
+  }
+
+  // Returns the total number of chunks allocated since construction.
+  size_t num_allocated_chunks() const {
+    return num_allocated_chunks_;
+  }
+
   explicit FreeList(size_t size):
-      current_index_(0), chunk_index_(0), size_(size) {}
+      current_index_(0), chunk_index_(0), size_(size),
+      num_allocated_chunks_(0) {}
 
   virtual ~FreeList() {
     for (size_t i = 0; i < pool_.size(); ++i) {
@@ -90,6 +122,7 @@ template <class T> class FreeList {
   size_t current_index_;
   size_t chunk_index_;
   size_t size_;
+  size_t num_allocated_chunks_;
 };
 
 template <class T> class ObjectPool {
@@ -99,6 +132,15 @@ template <class T> class ObjectPool {
     freelist_.Free();
   }
 
+  // Makes all the objects available again without deleting them.  The
+  // chunks needed to hold |max_size| objects are kept and the rest are
+  // deleted.  Callers must reinitialize the objects returned by Alloc().
+  void Recycle(size_t max_size) {
+    released_.clear();
+    const size_t chunk_size = freelist_.size();
+    freelist_.Shrink((max_size + chunk_size - 1) / chunk_size);
+  }
+
   T* Alloc() {
     if (!released_.empty()) {
       T *result = released_.back();
@@ -116,6 +158,14 @@ template <class T> class ObjectPool {
     freelist_.set_size(size);
   }
 
+  size_t capacity() const {
+    return freelist_.capacity();
+  }
+
+  size_t num_allocated_chunks() const {
+    return freelist_.num_allocated_chunks();
+  }
+
   explicit ObjectPool(int size): freelist_(size) {}
   virtual ~ObjectPool() {}
 
@@ -28,6 +28,7 @@
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
 #include <string.h>
+#include <algorithm>
 #include <string>
 #include "base/util.h"
 #include "base/base.h"
@@ -51,6 +52,49 @@ namespace mozc {
   c -= a; c -= b; c ^= (b >> 15); \
 }
 
+namespace {
+inline void MixBlock(const char *str, uint32 *pa, uint32 *pb, uint32 *pc) {
+  uint32 a = *pa, b = *pb, c = *pc;
+  a += (str[0] + ((uint32)str[1] << 8) + ((uint32)str[2] << 16)
+        + ((uint32)str[3] << 24));
+  b += (str[4] + ((uint32)str[5] << 8) + ((uint32)str[6] << 16)
+        + ((uint32)str[7] << 24));
+  c += (str[8] + ((uint32)str[9] << 8) + ((uint32)str[10] << 16)
+        + ((uint32)str[11] << 24));
+  mix(a, b, c);
+  *pa = a; *pb = b; *pc = c;
+}
+
+// |len| must be less than 12.
+inline void MixTail(const char *str, uint32 len,
+                    uint32 *pa, uint32 *pb, uint32 *pc) {
+  uint32 a = *pa, b = *pb, c = *pc;
+  switch (len) {
+    case 11: c += ((uint32)str[10] << 24);
+    case 10: c += ((uint32)str[9] << 16);
+    case 9 : c += ((uint32)str[8] << 8);
+    case 8 : b += ((uint32)str[7] << 24);
+    case 7 : b += ((uint32)str[6] << 16);
+    case 6 : b += ((uint32)str[5] << 8);
+    case 5 : b += str[4];
+    case 4 : a += ((uint32)str[3] << 24);
+    case 3 : a += ((uint32)str[2] << 16);
+    case 2 : a += ((uint32)str[1] << 8);
+    case 1 : a += str[0];
+  }
+  mix(a, b, c);
+  *pa = a; *pb = b; *pc = c;
+}
+
+uint64 MakeFingerprint(uint32 hi, uint32 lo) {
+  uint64 result = static_cast<uint64>(hi) << 32 | static_cast<uint64>(lo);
+  if ((hi == 0) && (lo < 2)) {
+    result ^= GG_ULONGLONG(0x130f9bef94a0a928);
+  }
+  return result;
+}
+}  // namespace
+
 uint32 Util::Fingerprint32(const string &key) {
   return Fingerprint32WithSeed(key.data(), key.size(),
                                kFingerPrint32Seed);
@@ -81,32 +125,13 @@ uint32 Util::Fingerprint32WithSeed(const char *str,
   uint32 c = seed;
 
   while (len >= 12) {
-    a += (str[0] + ((uint32)str[1] << 8) + ((uint32)str[2] << 16)
-          + ((uint32)str[3] << 24));
-    b += (str[4] + ((uint32)str[5] << 8) + ((uint32)str[6] << 16)
-          + ((uint32)str[7] << 24));
-    c += (str[8] + ((uint32)str[9] << 8) + ((uint32)str[10] << 16)
-          + ((uint32)str[11] << 24));
-    mix(a, b, c);
+    MixBlock(str, &a, &b, &c);
     str += 12;
     len -= 12;
   }
 
   c += static_cast<uint32>(length);
-  switch (len) {
-    case 11: c += ((uint32)str[10] << 24);
-    case 10: c += ((uint32)str[9] << 16);
-    case 9 : c += ((uint32)str[8] << 8);
-    case 8 : b += ((uint32)str[7] << 24);
-    case 7 : b += ((uint32)str[6] << 16);
-    case 6 : b += ((uint32)str[5] << 8);
-    case 5 : b += str[4];
-    case 4 : a += ((uint32)str[3] << 24);
-    case 3 : a += ((uint32)str[2] << 16);
-    case 2 : a += ((uint32)str[1] << 8);
-    case 1 : a += str[0];
-  }
-  mix(a, b, c);
+  MixTail(str, len, &a, &b, &c);
 
   return c;
 }
@@ -136,10 +161,58 @@ uint64 Util::FingerprintWithSeed(const string &str, uint32 seed) {
 uint64 Util::FingerprintWithSeed(const char *str, size_t length, uint32 seed) {
   const uint32 hi = Fingerprint32WithSeed(str, length, seed);
   const uint32 lo = Fingerprint32WithSeed(str, length, kFingerPrintSeed1);
-  uint64 result = static_cast<uint64>(hi) << 32 | static_cast<uint64>(lo);
-  if ((hi == 0) && (lo < 2)) {
-    result ^= GG_ULONGLONG(0x130f9bef94a0a928);
+  return MakeFingerprint(hi, lo);
+}
+
+FingerprintBuilder::FingerprintBuilder() : seed_(kFingerPrintSeed0) {
+  Reset();
+}
+
+FingerprintBuilder::FingerprintBuilder(uint32 seed) : seed_(seed) {
+  Reset();
+}
+
+void FingerprintBuilder::Reset() {
+  a_[0] = b_[0] = a_[1] = b_[1] = 0x9e3779b9;
+  c_[0] = seed_;
+  c_[1] = kFingerPrintSeed1;
+  buf_size_ = 0;
+  length_ = 0;
+}
+
+void FingerprintBuilder::Append(const char *str, size_t length) {
+  length_ += length;
+  if (buf_size_ > 0) {
+    const size_t n = min(length, sizeof(buf_) - buf_size_);
+    memcpy(buf_ + buf_size_, str, n);
+    buf_size_ += n;
+    str += n;
+    length -= n;
+    if (buf_size_ < sizeof(buf_)) {
+      return;
+    }
+    MixBlock(buf_, &a_[0], &b_[0], &c_[0]);
+    MixBlock(buf_, &a_[1], &b_[1], &c_[1]);
+    buf_size_ = 0;
   }
-  return result;
+  while (length >= sizeof(buf_)) {
+    MixBlock(str, &a_[0], &b_[0], &c_[0]);
+    MixBlock(str, &a_[1], &b_[1], &c_[1]);
+    str += sizeof(buf_);
+    length -= sizeof(buf_);
+  }
+  memcpy(buf_, str, length);
+  buf_size_ = length;
+}
+
+uint64 FingerprintBuilder::Get() const {
+  uint32 a[2] = { a_[0], a_[1] };
+  uint32 b[2] = { b_[0], b_[1] };
+  uint32 c[2] = { c_[0], c_[1] };
+  for (int i = 0; i < 2; ++i) {
+    c[i] += static_cast<uint32>(length_);
+    MixTail(buf_, static_cast<uint32>(buf_size_), &a[i], &b[i], &c[i]);
+  }
+  return MakeFingerprint(c[0], c[1]);
 }
 }  // namespace mozc
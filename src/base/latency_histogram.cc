@@ -0,0 +1,284 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/latency_histogram.h"
+
+#include <algorithm>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+
+namespace mozc {
+namespace {
+
+// Each power of two range is divided into 2^kSubBucketBits buckets.
+const int kSubBucketBits = 4;
+const uint64 kSubBucketCount = 1 << kSubBucketBits;
+// Values up to 2^32 - 1 microseconds are distinguished.
+const uint64 kMaxValue = 0xFFFFFFFFULL;
+const size_t kNumBuckets =
+    (32 - kSubBucketBits) * kSubBucketCount + 2 * kSubBucketCount;
+
+// Returns the position of the most significant bit.  |value| must not be 0.
+int GetMostSignificantBit(uint64 value) {
+  int result = 0;
+  while (value >>= 1) {
+    ++result;
+  }
+  return result;
+}
+
+class HistogramRegistry {
+ public:
+  HistogramRegistry() {}
+
+  ~HistogramRegistry() {
+    for (map<string, LatencyHistogram *>::iterator it = histograms_.begin();
+         it != histograms_.end(); ++it) {
+      delete it->second;
+    }
+  }
+
+  LatencyHistogram *Get(const string &name) {
+    scoped_lock l(&mutex_);
+    map<string, LatencyHistogram *>::iterator it = histograms_.find(name);
+    if (it != histograms_.end()) {
+      return it->second;
+    }
+    LatencyHistogram *histogram = new LatencyHistogram(name);
+    histograms_.insert(make_pair(name, histogram));
+    return histogram;
+  }
+
+  void GetAll(vector<const LatencyHistogram *> *histograms) {
+    scoped_lock l(&mutex_);
+    for (map<string, LatencyHistogram *>::const_iterator it =
+             histograms_.begin();
+         it != histograms_.end(); ++it) {
+      histograms->push_back(it->second);
+    }
+  }
+
+  void ClearAll() {
+    scoped_lock l(&mutex_);
+    for (map<string, LatencyHistogram *>::iterator it = histograms_.begin();
+         it != histograms_.end(); ++it) {
+      it->second->Clear();
+    }
+  }
+
+ private:
+  Mutex mutex_;
+  map<string, LatencyHistogram *> histograms_;
+
+  DISALLOW_COPY_AND_ASSIGN(HistogramRegistry);
+};
+
+}  // namespace
+
+LatencyHistogram::LatencyHistogram(const string &name)
+    : name_(name),
+      count_(0),
+      total_(0),
+      min_(0),
+      max_(0),
+      counts_(kNumBuckets, 0) {}
+
+LatencyHistogram::~LatencyHistogram() {}
+
+// static
+size_t LatencyHistogram::GetBucketIndex(uint64 usec) {
+  const uint64 value = min(usec, kMaxValue);
+  if (value < 2 * kSubBucketCount) {
+    return static_cast<size_t>(value);
+  }
+  const int shift = GetMostSignificantBit(value) - kSubBucketBits;
+  return static_cast<size_t>(shift * kSubBucketCount + (value >> shift));
+}
+
+// static
+void LatencyHistogram::GetBucketRange(size_t index, uint64 *lower_bound,
+                                      uint64 *upper_bound) {
+  DCHECK(lower_bound);
+  DCHECK(upper_bound);
+  DCHECK_LT(index, kNumBuckets);
+  if (index < 2 * kSubBucketCount) {
+    *lower_bound = *upper_bound = index;
+    return;
+  }
+  const int shift = static_cast<int>(index / kSubBucketCount) - 1;
+  const uint64 sub_bucket = index - shift * kSubBucketCount;
+  *lower_bound = sub_bucket << shift;
+  *upper_bound = ((sub_bucket + 1) << shift) - 1;
+}
+
+void LatencyHistogram::Record(uint64 usec) {
+  const size_t index = GetBucketIndex(usec);
+  scoped_lock l(&mutex_);
+  if (count_ == 0 || usec < min_) {
+    min_ = usec;
+  }
+  if (usec > max_) {
+    max_ = usec;
+  }
+  ++count_;
+  total_ += usec;
+  ++counts_[index];
+}
+
+void LatencyHistogram::Clear() {
+  scoped_lock l(&mutex_);
+  count_ = 0;
+  total_ = 0;
+  min_ = 0;
+  max_ = 0;
+  fill(counts_.begin(), counts_.end(), 0);
+}
+
+uint64 LatencyHistogram::count() const {
+  scoped_lock l(&mutex_);
+  return count_;
+}
+
+uint64 LatencyHistogram::total_usec() const {
+  scoped_lock l(&mutex_);
+  return total_;
+}
+
+uint64 LatencyHistogram::min_usec() const {
+  scoped_lock l(&mutex_);
+  return min_;
+}
+
+uint64 LatencyHistogram::max_usec() const {
+  scoped_lock l(&mutex_);
+  return max_;
+}
+
+uint64 LatencyHistogram::GetPercentile(double percentile) const {
+  scoped_lock l(&mutex_);
+  return GetPercentileInternal(percentile);
+}
+
+uint64 LatencyHistogram::GetPercentileInternal(double percentile) const {
+  if (count_ == 0) {
+    return 0;
+  }
+  percentile = max(0.0, min(100.0, percentile));
+  uint64 rank = static_cast<uint64>(percentile / 100.0 * count_ + 0.999999);
+  rank = max(static_cast<uint64>(1), min(rank, count_));
+  uint64 seen = 0;
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    seen += counts_[i];
+    if (seen >= rank) {
+      uint64 lower_bound = 0;
+      uint64 upper_bound = 0;
+      GetBucketRange(i, &lower_bound, &upper_bound);
+      return min(upper_bound, max_);
+    }
+  }
+  return max_;
+}
+
+void LatencyHistogram::GetBuckets(vector<Bucket> *buckets) const {
+  DCHECK(buckets);
+  scoped_lock l(&mutex_);
+  for (size_t i = 0; i < counts_.size(); ++i) {
+    if (counts_[i] == 0) {
+      continue;
+    }
+    Bucket bucket;
+    GetBucketRange(i, &bucket.lower_bound, &bucket.upper_bound);
+    bucket.count = counts_[i];
+    buckets->push_back(bucket);
+  }
+}
+
+string LatencyHistogram::GetSummary() const {
+  scoped_lock l(&mutex_);
+  ostringstream os;
+  os << name_
+     << " count=" << count_
+     << " mean=" << (count_ == 0 ? 0 : total_ / count_)
+     << " p50=" << GetPercentileInternal(50)
+     << " p95=" << GetPercentileInternal(95)
+     << " p99=" << GetPercentileInternal(99)
+     << " max=" << max_;
+  return os.str();
+}
+
+// static
+LatencyHistogram *LatencyStats::GetHistogram(const string &name) {
+  return Singleton<HistogramRegistry>::get()->Get(name);
+}
+
+// static
+void LatencyStats::GetAllHistograms(
+    vector<const LatencyHistogram *> *histograms) {
+  DCHECK(histograms);
+  Singleton<HistogramRegistry>::get()->GetAll(histograms);
+}
+
+// static
+void LatencyStats::ClearAll() {
+  Singleton<HistogramRegistry>::get()->ClearAll();
+}
+
+// static
+string LatencyStats::DumpToString() {
+  vector<const LatencyHistogram *> histograms;
+  GetAllHistograms(&histograms);
+
+  ostringstream os;
+  os << "# Latencies in microseconds" << endl;
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    os << histograms[i]->GetSummary() << endl;
+  }
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    vector<LatencyHistogram::Bucket> buckets;
+    histograms[i]->GetBuckets(&buckets);
+    if (buckets.empty()) {
+      continue;
+    }
+    os << endl << "# " << histograms[i]->name() << endl;
+    for (size_t j = 0; j < buckets.size(); ++j) {
+      os << buckets[j].lower_bound << "\t" << buckets[j].upper_bound
+         << "\t" << buckets[j].count << endl;
+    }
+  }
+  return os.str();
+}
+
+}  // namespace mozc
@@ -0,0 +1,158 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Latency histograms for watching the processing time of the server
+// without a profiler.
+
+#ifndef MOZC_BASE_LATENCY_HISTOGRAM_H_
+#define MOZC_BASE_LATENCY_HISTOGRAM_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/mutex.h"
+#include "base/stopwatch.h"
+
+namespace mozc {
+
+// Histogram of latencies in microseconds.  Buckets are log-linear like
+// HdrHistogram: each power of two range is divided into 16 buckets, so
+// that the relative error of a recorded value is at most 1/16.  Values
+// larger than about 71 minutes go to the last bucket.
+//
+// This class is thread-safe.
+class LatencyHistogram {
+ public:
+  struct Bucket {
+    // The range of the bucket is [lower_bound, upper_bound].
+    uint64 lower_bound;
+    uint64 upper_bound;
+    uint64 count;
+  };
+
+  explicit LatencyHistogram(const string &name);
+  ~LatencyHistogram();
+
+  const string &name() const { return name_; }
+
+  void Record(uint64 usec);
+
+  void Clear();
+
+  uint64 count() const;
+  uint64 total_usec() const;
+  uint64 min_usec() const;
+  uint64 max_usec() const;
+
+  // Returns the upper bound of the bucket having the |percentile|-th
+  // value by the nearest rank method.  The value is clamped to max_usec().
+  // Returns 0 if nothing is recorded.
+  uint64 GetPercentile(double percentile) const;
+
+  // Appends the non-empty buckets in ascending order.
+  void GetBuckets(vector<Bucket> *buckets) const;
+
+  // Returns a one-line summary like
+  // "name count=10 mean=12 p50=11 p95=20 p99=20 max=20".
+  string GetSummary() const;
+
+  // Exposed for unittest.
+  static size_t GetBucketIndex(uint64 usec);
+  static void GetBucketRange(size_t index, uint64 *lower_bound,
+                             uint64 *upper_bound);
+
+ private:
+  uint64 GetPercentileInternal(double percentile) const;
+
+  const string name_;
+  mutable Mutex mutex_;
+  uint64 count_;
+  uint64 total_;
+  uint64 min_;
+  uint64 max_;
+  vector<uint32> counts_;
+
+  DISALLOW_COPY_AND_ASSIGN(LatencyHistogram);
+};
+
+// Process-wide registry of the histograms.  Histograms are created on
+// demand and live until the process exits, so the returned pointers can
+// be cached.
+class LatencyStats {
+ public:
+  // Returns the histogram of |name|.  The histogram is created if it does
+  // not exist.  |name| is like "command/SEND_KEY" or "converter/viterbi".
+  static LatencyHistogram *GetHistogram(const string &name);
+
+  // Appends all the histograms in the order of their names.
+  static void GetAllHistograms(vector<const LatencyHistogram *> *histograms);
+
+  // Clears the records of all the histograms.
+  static void ClearAll();
+
+  // Returns the summaries of all the histograms followed by their
+  // buckets.  Used for dumping the histograms to a file.
+  static string DumpToString();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(LatencyStats);
+};
+
+// Records the lifetime of this object to |histogram|.  Nothing is recorded
+// if |histogram| is NULL.
+// Usage:
+//   {
+//     ScopedLatencyRecorder recorder(histogram);
+//     DoSomething();
+//   }
+class ScopedLatencyRecorder {
+ public:
+  explicit ScopedLatencyRecorder(LatencyHistogram *histogram)
+      : histogram_(histogram), stopwatch_(Stopwatch::StartNew()) {}
+
+  ~ScopedLatencyRecorder() {
+    if (histogram_ == NULL) {
+      return;
+    }
+    histogram_->Record(
+        static_cast<uint64>(stopwatch_.GetElapsedMicroseconds()));
+  }
+
+ private:
+  LatencyHistogram *histogram_;
+  Stopwatch stopwatch_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedLatencyRecorder);
+};
+
+}  // namespace mozc
+#endif  // MOZC_BASE_LATENCY_HISTOGRAM_H_
@@ -0,0 +1,157 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/latency_histogram.h"
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(LatencyHistogramTest, BucketIndex) {
+  // Small values have their own buckets.
+  for (uint64 i = 0; i < 32; ++i) {
+    EXPECT_EQ(i, LatencyHistogram::GetBucketIndex(i));
+  }
+  EXPECT_EQ(32, LatencyHistogram::GetBucketIndex(32));
+  EXPECT_EQ(32, LatencyHistogram::GetBucketIndex(33));
+  EXPECT_EQ(33, LatencyHistogram::GetBucketIndex(34));
+  EXPECT_EQ(47, LatencyHistogram::GetBucketIndex(63));
+  EXPECT_EQ(48, LatencyHistogram::GetBucketIndex(64));
+
+  // Huge values go to the last bucket.
+  EXPECT_EQ(LatencyHistogram::GetBucketIndex(0xFFFFFFFFULL),
+            LatencyHistogram::GetBucketIndex(0xFFFFFFFFFFULL));
+}
+
+TEST(LatencyHistogramTest, BucketRange) {
+  uint64 lower_bound = 0;
+  uint64 upper_bound = 0;
+  LatencyHistogram::GetBucketRange(5, &lower_bound, &upper_bound);
+  EXPECT_EQ(5, lower_bound);
+  EXPECT_EQ(5, upper_bound);
+  LatencyHistogram::GetBucketRange(32, &lower_bound, &upper_bound);
+  EXPECT_EQ(32, lower_bound);
+  EXPECT_EQ(33, upper_bound);
+  LatencyHistogram::GetBucketRange(48, &lower_bound, &upper_bound);
+  EXPECT_EQ(64, lower_bound);
+  EXPECT_EQ(67, upper_bound);
+
+  // Every value is in the range of its bucket, and the relative width of
+  // the bucket is at most 1/16.
+  const uint64 kValues[] = { 0, 1, 31, 32, 100, 1000, 12345, 1000000,
+                             123456789, 0xFFFFFFFFULL };
+  for (size_t i = 0; i < arraysize(kValues); ++i) {
+    const size_t index = LatencyHistogram::GetBucketIndex(kValues[i]);
+    LatencyHistogram::GetBucketRange(index, &lower_bound, &upper_bound);
+    EXPECT_LE(lower_bound, kValues[i]);
+    EXPECT_GE(upper_bound, kValues[i]);
+    EXPECT_LE((upper_bound - lower_bound) * 16, lower_bound + 1);
+  }
+}
+
+TEST(LatencyHistogramTest, Record) {
+  LatencyHistogram histogram("test");
+  EXPECT_EQ("test", histogram.name());
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ(0, histogram.GetPercentile(50));
+
+  for (uint64 i = 1; i <= 100; ++i) {
+    histogram.Record(i);
+  }
+  EXPECT_EQ(100, histogram.count());
+  EXPECT_EQ(5050, histogram.total_usec());
+  EXPECT_EQ(1, histogram.min_usec());
+  EXPECT_EQ(100, histogram.max_usec());
+
+  // Percentiles are the upper bounds of the buckets.
+  EXPECT_EQ(1, histogram.GetPercentile(0));
+  EXPECT_EQ(51, histogram.GetPercentile(50));
+  EXPECT_EQ(95, histogram.GetPercentile(95));
+  EXPECT_EQ(100, histogram.GetPercentile(100));
+
+  vector<LatencyHistogram::Bucket> buckets;
+  histogram.GetBuckets(&buckets);
+  uint64 total_count = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    total_count += buckets[i].count;
+    if (i > 0) {
+      EXPECT_LT(buckets[i - 1].upper_bound, buckets[i].lower_bound);
+    }
+  }
+  EXPECT_EQ(100, total_count);
+
+  EXPECT_EQ("test count=100 mean=50 p50=51 p95=95 p99=99 max=100",
+            histogram.GetSummary());
+
+  histogram.Clear();
+  EXPECT_EQ(0, histogram.count());
+  EXPECT_EQ(0, histogram.max_usec());
+  buckets.clear();
+  histogram.GetBuckets(&buckets);
+  EXPECT_TRUE(buckets.empty());
+}
+
+TEST(LatencyStatsTest, Registry) {
+  LatencyHistogram *histogram1 =
+      LatencyStats::GetHistogram("LatencyStatsTest/1");
+  LatencyHistogram *histogram2 =
+      LatencyStats::GetHistogram("LatencyStatsTest/2");
+  EXPECT_NE(histogram1, histogram2);
+  EXPECT_EQ(histogram1, LatencyStats::GetHistogram("LatencyStatsTest/1"));
+
+  {
+    ScopedLatencyRecorder recorder(histogram1);
+  }
+  EXPECT_EQ(1, histogram1->count());
+  histogram2->Record(10);
+
+  vector<const LatencyHistogram *> histograms;
+  LatencyStats::GetAllHistograms(&histograms);
+  ASSERT_LE(2, histograms.size());
+  for (size_t i = 1; i < histograms.size(); ++i) {
+    EXPECT_LT(histograms[i - 1]->name(), histograms[i]->name());
+  }
+
+  const string dump = LatencyStats::DumpToString();
+  EXPECT_NE(string::npos, dump.find(histogram2->GetSummary()));
+  EXPECT_NE(string::npos, dump.find("# LatencyStatsTest/2\n10\t10\t1\n"));
+
+  LatencyStats::ClearAll();
+  EXPECT_EQ(0, histogram1->count());
+  EXPECT_EQ(0, histogram2->count());
+}
+
+}  // namespace
+}  // namespace mozc
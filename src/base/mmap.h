@@ -116,6 +116,15 @@ template <class T> class Mmap {
     return true;
   }
 
+  // Writes the modified pages back to the file.
+  bool Flush() {
+    if (text_ == NULL) {
+      return false;
+    }
+    return (::FlushViewOfFile(text_, 0) &&
+            ::FlushFileBuffers(handle_));
+  }
+
   void Close() {
     if (text_ != NULL) {
       ::UnmapViewOfFile(text_);
@@ -189,6 +198,18 @@ template <class T> class Mmap {
     return true;
   }
 
+  // Writes the modified pages back to the file.
+  bool Flush() {
+    if (text_ == NULL) {
+      return false;
+    }
+#ifdef HAVE_MMAP
+    return msync(reinterpret_cast<char *>(text_), length_, MS_SYNC) == 0;
+#else  // HAVE_MMAP
+    return true;
+#endif  // HAVE_MMAP
+  }
+
   void Close() {
     if (fd_ >= 0) {
       ::close(fd_);
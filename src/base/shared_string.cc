@@ -0,0 +1,144 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/shared_string.h"
+
+#ifdef OS_WINDOWS
+#include <windows.h>
+#endif
+
+#ifdef OS_MACOSX
+#include <libkern/OSAtomic.h>
+#endif
+
+#include <string>
+#include "base/base.h"
+#include "base/singleton.h"
+
+namespace mozc {
+namespace {
+// Returns the new value.
+inline int AtomicIncrement(volatile int *value) {
+#if defined(OS_WINDOWS)
+  return ::InterlockedIncrement(reinterpret_cast<volatile LONG *>(value));
+#elif defined(OS_MACOSX)
+  return OSAtomicIncrement32Barrier(value);
+#else
+  return __sync_add_and_fetch(value, 1);
+#endif
+}
+
+// Returns the new value.
+inline int AtomicDecrement(volatile int *value) {
+#if defined(OS_WINDOWS)
+  return ::InterlockedDecrement(reinterpret_cast<volatile LONG *>(value));
+#elif defined(OS_MACOSX)
+  return OSAtomicDecrement32Barrier(value);
+#else
+  return __sync_sub_and_fetch(value, 1);
+#endif
+}
+
+struct EmptyString {
+  string str;
+};
+}  // namespace
+
+SharedString::SharedString(const string &str) : rep_(NULL) {
+  Assign(str);
+}
+
+SharedString::SharedString(const char *str) : rep_(NULL) {
+  Assign(str);
+}
+
+SharedString::SharedString(const SharedString &other) : rep_(other.rep_) {
+  if (rep_ != NULL) {
+    AtomicIncrement(&rep_->ref_count);
+  }
+}
+
+SharedString::~SharedString() {
+  Release();
+}
+
+SharedString &SharedString::operator=(const SharedString &other) {
+  if (rep_ == other.rep_) {
+    return *this;
+  }
+  if (other.rep_ != NULL) {
+    AtomicIncrement(&other.rep_->ref_count);
+  }
+  Release();
+  rep_ = other.rep_;
+  return *this;
+}
+
+SharedString &SharedString::operator=(const string &str) {
+  Assign(str);
+  return *this;
+}
+
+SharedString &SharedString::operator=(const char *str) {
+  Assign(str);
+  return *this;
+}
+
+const string &SharedString::str() const {
+  if (rep_ == NULL) {
+    return Singleton<EmptyString>::get()->str;
+  }
+  return rep_->str;
+}
+
+void SharedString::clear() {
+  Release();
+}
+
+void SharedString::swap(SharedString *other) {
+  Rep *tmp = rep_;
+  rep_ = other->rep_;
+  other->rep_ = tmp;
+}
+
+void SharedString::Assign(const string &str) {
+  // |str| may be a reference to the string of this object.
+  Rep *rep = str.empty() ? NULL : new Rep(str);
+  Release();
+  rep_ = rep;
+}
+
+void SharedString::Release() {
+  if (rep_ != NULL && AtomicDecrement(&rep_->ref_count) == 0) {
+    delete rep_;
+  }
+  rep_ = NULL;
+}
+}  // namespace mozc
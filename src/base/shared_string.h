@@ -0,0 +1,143 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// SharedString is an immutable string whose buffer is shared among its
+// copies with a reference count, so copying it does not allocate nor copy
+// the characters. It is used for the keys of Segment::Candidate, since
+// the rewriters copy the candidates of a segment, which have the same
+// keys, many times. The reference count is updated atomically, so copies of the
+// same string can be used from different threads.
+//
+// Usage:
+//   SharedString s1 = "long text";
+//   SharedString s2 = s1;  // no allocation
+//   s2 = "other text";     // s1 is not changed
+//   cout << s1.str();
+
+#ifndef MOZC_BASE_SHARED_STRING_H_
+#define MOZC_BASE_SHARED_STRING_H_
+
+#include <ostream>
+#include <string>
+#include "base/base.h"
+
+namespace mozc {
+
+class SharedString {
+ public:
+  SharedString() : rep_(NULL) {}
+  // Implicit like std::string, so that the fields of string type can be
+  // replaced with SharedString.
+  SharedString(const string &str);
+  SharedString(const char *str);
+  SharedString(const SharedString &other);
+  ~SharedString();
+
+  SharedString &operator=(const SharedString &other);
+  SharedString &operator=(const string &str);
+  SharedString &operator=(const char *str);
+
+  // Returns the string. The reference is valid until this object is
+  // modified or destroyed.
+  const string &str() const;
+
+  // Implicit so that a SharedString field can be passed to the functions
+  // taking const string &.
+  operator const string &() const {
+    return str();
+  }
+
+  const char *c_str() const {
+    return str().c_str();
+  }
+  size_t size() const {
+    return rep_ == NULL ? 0 : rep_->str.size();
+  }
+  bool empty() const {
+    return size() == 0;
+  }
+  void clear();
+  void swap(SharedString *other);
+
+  // Returns true if this and |other| share the same buffer. For testing.
+  bool SharesWith(const SharedString &other) const {
+    return rep_ != NULL && rep_ == other.rep_;
+  }
+
+ private:
+  struct Rep {
+    explicit Rep(const string &s) : str(s), ref_count(1) {}
+    const string str;
+    volatile int ref_count;
+  };
+
+  void Assign(const string &str);
+  void Release();
+
+  Rep *rep_;
+};
+
+inline bool operator==(const SharedString &lhs, const SharedString &rhs) {
+  return lhs.str() == rhs.str();
+}
+inline bool operator==(const SharedString &lhs, const string &rhs) {
+  return lhs.str() == rhs;
+}
+inline bool operator==(const string &lhs, const SharedString &rhs) {
+  return lhs == rhs.str();
+}
+inline bool operator==(const SharedString &lhs, const char *rhs) {
+  return lhs.str() == rhs;
+}
+inline bool operator==(const char *lhs, const SharedString &rhs) {
+  return lhs == rhs.str();
+}
+inline bool operator!=(const SharedString &lhs, const SharedString &rhs) {
+  return !(lhs == rhs);
+}
+inline bool operator!=(const SharedString &lhs, const string &rhs) {
+  return !(lhs == rhs);
+}
+inline bool operator!=(const string &lhs, const SharedString &rhs) {
+  return !(lhs == rhs);
+}
+inline bool operator!=(const SharedString &lhs, const char *rhs) {
+  return !(lhs == rhs);
+}
+inline bool operator!=(const char *lhs, const SharedString &rhs) {
+  return !(lhs == rhs);
+}
+
+inline ostream &operator<<(ostream &os, const SharedString &str) {
+  return os << str.str();
+}
+}  // namespace mozc
+
+#endif  // MOZC_BASE_SHARED_STRING_H_
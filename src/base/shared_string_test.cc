@@ -0,0 +1,138 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <sstream>
+#include <string>
+#include <vector>
+#include "base/base.h"
+#include "base/shared_string.h"
+#include "base/thread.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(SharedStringTest, Basic) {
+  SharedString empty;
+  EXPECT_TRUE(empty.empty());
+  EXPECT_EQ(0, empty.size());
+  EXPECT_EQ("", empty);
+  EXPECT_EQ("", empty.str());
+
+  SharedString s1 = "test";
+  EXPECT_FALSE(s1.empty());
+  EXPECT_EQ(4, s1.size());
+  EXPECT_EQ("test", s1);
+  EXPECT_EQ(string("test"), s1);
+  EXPECT_NE("other", s1);
+  EXPECT_STREQ("test", s1.c_str());
+  const string &ref = s1;
+  EXPECT_EQ(&s1.str(), &ref);
+
+  ostringstream os;
+  os << s1;
+  EXPECT_EQ("test", os.str());
+
+  s1.clear();
+  EXPECT_TRUE(s1.empty());
+  EXPECT_EQ("", s1);
+}
+
+TEST(SharedStringTest, Share) {
+  SharedString s1 = string("shared");
+  SharedString s2 = s1;
+  EXPECT_TRUE(s1.SharesWith(s2));
+  EXPECT_EQ(&s1.str(), &s2.str());
+
+  SharedString s3;
+  s3 = s2;
+  EXPECT_TRUE(s3.SharesWith(s1));
+
+  // Assignment does not change the other copies.
+  s2 = "changed";
+  EXPECT_FALSE(s2.SharesWith(s1));
+  EXPECT_EQ("shared", s1);
+  EXPECT_EQ("shared", s3);
+  EXPECT_EQ("changed", s2);
+
+  // Self assignment.
+  s1 = s1;
+  EXPECT_EQ("shared", s1);
+  s1 = s1.str();
+  EXPECT_EQ("shared", s1);
+  EXPECT_FALSE(s1.SharesWith(s3));
+
+  s1.swap(&s2);
+  EXPECT_EQ("changed", s1);
+  EXPECT_EQ("shared", s2);
+
+  // Empty strings do not share a buffer.
+  SharedString e1, e2;
+  EXPECT_FALSE(e1.SharesWith(e2));
+  EXPECT_TRUE(e1 == e2);
+}
+
+class CopyThread : public Thread {
+ public:
+  explicit CopyThread(const SharedString &str) : str_(str) {}
+
+  virtual void Run() {
+    for (int i = 0; i < 10000; ++i) {
+      SharedString copy = str_;
+      copies_.push_back(copy);
+      if (copies_.size() > 10) {
+        copies_.clear();
+      }
+    }
+    copies_.clear();
+  }
+
+ private:
+  const SharedString &str_;
+  vector<SharedString> copies_;
+};
+
+TEST(SharedStringTest, CopyFromThreads) {
+  SharedString str = "thread";
+  {
+    CopyThread thread1(str);
+    CopyThread thread2(str);
+    thread1.Start();
+    thread2.Start();
+    thread1.Join();
+    thread2.Join();
+  }
+  SharedString copy = str;
+  EXPECT_EQ("thread", copy);
+  EXPECT_TRUE(copy.SharesWith(str));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -0,0 +1,196 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/stage_tracer.h"
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/thread.h"
+#include "base/util.h"
+
+namespace mozc {
+namespace {
+
+// Spans more than this are dropped so that a runaway loop does not eat
+// up the memory.
+const size_t kMaxSpansSize = 4096;
+
+#ifdef HAVE_TLS
+TLS_KEYWORD StageTracer *g_current_tracer = NULL;
+#endif  // HAVE_TLS
+
+void AppendJSONString(const string &str, string *output) {
+  output->append(1, '"');
+  for (size_t i = 0; i < str.size(); ++i) {
+    const char c = str[i];
+    if (c == '"' || c == '\\') {
+      output->append(1, '\\');
+      output->append(1, c);
+    } else if (static_cast<unsigned char>(c) < 0x20) {
+      // Names and counters are ASCII identifiers.  Control characters
+      // are not expected.
+      output->append(1, ' ');
+    } else {
+      output->append(1, c);
+    }
+  }
+  output->append(1, '"');
+}
+
+}  // namespace
+
+StageTracer::StageTracer()
+    : begin_ticks_(Util::GetTicks()), dropped_spans_size_(0) {}
+
+StageTracer::~StageTracer() {}
+
+void StageTracer::BeginSpan(const string &name) {
+  if (spans_.size() >= kMaxSpansSize) {
+    ++dropped_spans_size_;
+    open_spans_.push_back(-1);
+    return;
+  }
+  spans_.push_back(Span());
+  Span *span = &spans_.back();
+  span->name = name;
+  span->depth = static_cast<int>(open_spans_.size());
+  span->begin_ticks = Util::GetTicks();
+  span->end_ticks = 0;
+  open_spans_.push_back(static_cast<int>(spans_.size() - 1));
+}
+
+void StageTracer::EndSpan() {
+  if (open_spans_.empty()) {
+    LOG(ERROR) << "No open span";
+    return;
+  }
+  const int index = open_spans_.back();
+  open_spans_.pop_back();
+  if (index >= 0) {
+    spans_[index].end_ticks = Util::GetTicks();
+  }
+}
+
+void StageTracer::AddCounter(const string &name, int64 value) {
+  if (open_spans_.empty() || open_spans_.back() < 0) {
+    return;
+  }
+  vector<pair<string, int64> > *counters =
+      &spans_[open_spans_.back()].counters;
+  for (size_t i = 0; i < counters->size(); ++i) {
+    if ((*counters)[i].first == name) {
+      (*counters)[i].second += value;
+      return;
+    }
+  }
+  counters->push_back(make_pair(name, value));
+}
+
+uint64 StageTracer::GetRelativeMicroseconds(uint64 ticks) const {
+  if (ticks <= begin_ticks_) {
+    return 0;
+  }
+  const uint64 frequency = Util::GetFrequency();
+  if (frequency == 0) {
+    return 0;
+  }
+  const uint64 elapsed = ticks - begin_ticks_;
+  // Avoid the overflow of |elapsed| * 1000000.
+  return (elapsed / frequency) * 1000000 +
+      (elapsed % frequency) * 1000000 / frequency;
+}
+
+void StageTracer::AppendChromeTraceEvents(uint32 pid, uint32 tid,
+                                          string *output) const {
+  DCHECK(output);
+  // The timestamps of Chrome trace are in microseconds.  They are made
+  // absolute so that the events of the requests are placed in order.
+  const uint64 base_usec = Util::GetTime() * 1000000ULL -
+      GetRelativeMicroseconds(Util::GetTicks());
+  for (size_t i = 0; i < spans_.size(); ++i) {
+    const Span &span = spans_[i];
+    const uint64 begin = GetRelativeMicroseconds(span.begin_ticks);
+    // An unclosed span is treated as an empty one.
+    const uint64 end = span.end_ticks == 0 ?
+        begin : GetRelativeMicroseconds(span.end_ticks);
+    output->append("{\"name\":");
+    AppendJSONString(span.name, output);
+    output->append(",\"ph\":\"X\"");
+    output->append(",\"pid\":");
+    output->append(Util::StringPrintf("%u", pid));
+    output->append(",\"tid\":");
+    output->append(Util::StringPrintf("%u", tid));
+    output->append(",\"ts\":");
+    output->append(Util::StringPrintf("%llu", base_usec + begin));
+    output->append(",\"dur\":");
+    output->append(Util::StringPrintf("%llu", end - begin));
+    if (!span.counters.empty()) {
+      output->append(",\"args\":{");
+      for (size_t j = 0; j < span.counters.size(); ++j) {
+        if (j > 0) {
+          output->append(",");
+        }
+        AppendJSONString(span.counters[j].first, output);
+        output->append(":");
+        output->append(Util::StringPrintf("%lld", span.counters[j].second));
+      }
+      output->append("}");
+    }
+    output->append("},\n");
+  }
+}
+
+// static
+StageTracer *StageTracer::GetCurrent() {
+#ifdef HAVE_TLS
+  return g_current_tracer;
+#else
+  return NULL;
+#endif  // HAVE_TLS
+}
+
+// static
+void StageTracer::SetCurrent(StageTracer *tracer) {
+#ifdef HAVE_TLS
+  g_current_tracer = tracer;
+#endif  // HAVE_TLS
+}
+
+// static
+void StageTracer::AddCounterToCurrent(const string &name, int64 value) {
+  StageTracer *tracer = GetCurrent();
+  if (tracer != NULL) {
+    tracer->AddCounter(name, value);
+  }
+}
+
+}  // namespace mozc
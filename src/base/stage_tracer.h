@@ -0,0 +1,157 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Opt-in tracing of the stages of a single request.  Nested spans with
+// their start and end ticks are recorded to a buffer owned by the caller,
+// so that we can see where the time of a slow conversion went.
+
+#ifndef MOZC_BASE_STAGE_TRACER_H_
+#define MOZC_BASE_STAGE_TRACER_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/base.h"
+
+namespace mozc {
+
+// Records the spans of one request.  A tracer is used by one thread at a
+// time.  Install it with SetCurrent() so that ScopedTraceSpan in the
+// converter can find it; nothing is recorded when no tracer is installed.
+class StageTracer {
+ public:
+  struct Span {
+    string name;
+    // Number of the enclosing spans.
+    int depth;
+    // Util::GetTicks() at the beginning and the end.  |end_ticks| is 0
+    // while the span is open.
+    uint64 begin_ticks;
+    uint64 end_ticks;
+    // Counters like the number of lattice nodes, in the order added.
+    vector<pair<string, int64> > counters;
+  };
+
+  StageTracer();
+  ~StageTracer();
+
+  // Opens a span nested in the current open span.
+  void BeginSpan(const string &name);
+
+  // Closes the innermost open span.
+  void EndSpan();
+
+  // Adds |value| to the counter |name| of the innermost open span.
+  void AddCounter(const string &name, int64 value);
+
+  const vector<Span> &spans() const { return spans_; }
+
+  // Number of the spans not recorded because of the size limit.
+  size_t dropped_spans_size() const { return dropped_spans_size_; }
+
+  // Converts ticks of the spans to microseconds from the beginning of
+  // the trace.
+  uint64 GetRelativeMicroseconds(uint64 ticks) const;
+
+  // Appends the spans as complete events ("ph":"X") of the Chrome trace
+  // event format.  Each event is followed by ",\n" so that the output
+  // can be appended to a JSON array file, which chrome://tracing accepts
+  // without the closing bracket.
+  void AppendChromeTraceEvents(uint32 pid, uint32 tid, string *output) const;
+
+  // Returns the tracer installed to the current thread, or NULL.
+  static StageTracer *GetCurrent();
+
+  // Installs |tracer| to the current thread.  NULL uninstalls it.
+  // Does nothing on the platforms without thread local storage.
+  static void SetCurrent(StageTracer *tracer);
+
+  // Shorthand of GetCurrent()->AddCounter() which does nothing when
+  // tracing is off.
+  static void AddCounterToCurrent(const string &name, int64 value);
+
+ private:
+  const uint64 begin_ticks_;
+  vector<Span> spans_;
+  // Indices of the open spans in |spans_|.  -1 for a dropped span.
+  vector<int> open_spans_;
+  size_t dropped_spans_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(StageTracer);
+};
+
+// Records a span for the lifetime of this object if a tracer is installed
+// to the current thread.
+// Usage:
+//   {
+//     ScopedTraceSpan span("converter/viterbi");
+//     Viterbi();
+//   }
+class ScopedTraceSpan {
+ public:
+  explicit ScopedTraceSpan(const char *name)
+      : tracer_(StageTracer::GetCurrent()) {
+    if (tracer_ != NULL) {
+      tracer_->BeginSpan(name);
+    }
+  }
+
+  explicit ScopedTraceSpan(const string &name)
+      : tracer_(StageTracer::GetCurrent()) {
+    if (tracer_ != NULL) {
+      tracer_->BeginSpan(name);
+    }
+  }
+
+  ~ScopedTraceSpan() {
+    if (tracer_ != NULL) {
+      tracer_->EndSpan();
+    }
+  }
+
+  // Returns true if the span is being recorded.  Use this to skip the
+  // computation only needed for counters.
+  bool enabled() const { return tracer_ != NULL; }
+
+  void AddCounter(const string &name, int64 value) {
+    if (tracer_ != NULL) {
+      tracer_->AddCounter(name, value);
+    }
+  }
+
+ private:
+  StageTracer *tracer_;
+
+  DISALLOW_COPY_AND_ASSIGN(ScopedTraceSpan);
+};
+
+}  // namespace mozc
+#endif  // MOZC_BASE_STAGE_TRACER_H_
@@ -0,0 +1,164 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "base/stage_tracer.h"
+
+#include <string>
+
+#include "base/base.h"
+#include "base/clock_mock.h"
+#include "base/util.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class StageTracerTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    clock_mock_.reset(new ClockMock(1000, 0));
+    clock_mock_->SetFrequency(1000000);
+    clock_mock_->SetTicks(5000);
+    Util::SetClockHandler(clock_mock_.get());
+  }
+
+  virtual void TearDown() {
+    StageTracer::SetCurrent(NULL);
+    Util::SetClockHandler(NULL);
+  }
+
+  scoped_ptr<ClockMock> clock_mock_;
+};
+
+TEST_F(StageTracerTest, NestedSpans) {
+  StageTracer tracer;
+  tracer.BeginSpan("convert");
+  clock_mock_->PutClockForwardByTicks(10);
+  tracer.BeginSpan("lattice");
+  tracer.AddCounter("nodes", 3);
+  tracer.AddCounter("nodes", 4);
+  tracer.AddCounter("lookups", 1);
+  clock_mock_->PutClockForwardByTicks(20);
+  tracer.EndSpan();
+  tracer.BeginSpan("viterbi");
+  clock_mock_->PutClockForwardByTicks(30);
+  tracer.EndSpan();
+  tracer.EndSpan();
+
+  ASSERT_EQ(3, tracer.spans().size());
+  const StageTracer::Span &convert = tracer.spans()[0];
+  EXPECT_EQ("convert", convert.name);
+  EXPECT_EQ(0, convert.depth);
+  EXPECT_EQ(0, tracer.GetRelativeMicroseconds(convert.begin_ticks));
+  EXPECT_EQ(60, tracer.GetRelativeMicroseconds(convert.end_ticks));
+
+  const StageTracer::Span &lattice = tracer.spans()[1];
+  EXPECT_EQ("lattice", lattice.name);
+  EXPECT_EQ(1, lattice.depth);
+  EXPECT_EQ(10, tracer.GetRelativeMicroseconds(lattice.begin_ticks));
+  EXPECT_EQ(30, tracer.GetRelativeMicroseconds(lattice.end_ticks));
+  ASSERT_EQ(2, lattice.counters.size());
+  EXPECT_EQ("nodes", lattice.counters[0].first);
+  EXPECT_EQ(7, lattice.counters[0].second);
+  EXPECT_EQ("lookups", lattice.counters[1].first);
+  EXPECT_EQ(1, lattice.counters[1].second);
+
+  const StageTracer::Span &viterbi = tracer.spans()[2];
+  EXPECT_EQ(1, viterbi.depth);
+  EXPECT_TRUE(viterbi.counters.empty());
+}
+
+TEST_F(StageTracerTest, ScopedTraceSpan) {
+  {
+    // Nothing happens without a tracer.
+    ScopedTraceSpan span("ignored");
+    EXPECT_FALSE(span.enabled());
+    StageTracer::AddCounterToCurrent("ignored", 1);
+  }
+
+  StageTracer tracer;
+  StageTracer::SetCurrent(&tracer);
+  {
+    ScopedTraceSpan span("outer");
+    EXPECT_TRUE(span.enabled());
+    {
+      ScopedTraceSpan inner("inner");
+      StageTracer::AddCounterToCurrent("lookups", 2);
+    }
+    span.AddCounter("candidates", 5);
+  }
+  StageTracer::SetCurrent(NULL);
+  EXPECT_TRUE(StageTracer::GetCurrent() == NULL);
+
+  ASSERT_EQ(2, tracer.spans().size());
+  EXPECT_EQ("outer", tracer.spans()[0].name);
+  ASSERT_EQ(1, tracer.spans()[0].counters.size());
+  EXPECT_EQ("candidates", tracer.spans()[0].counters[0].first);
+  EXPECT_EQ("inner", tracer.spans()[1].name);
+  ASSERT_EQ(1, tracer.spans()[1].counters.size());
+  EXPECT_EQ(2, tracer.spans()[1].counters[0].second);
+}
+
+TEST_F(StageTracerTest, ChromeTraceEvents) {
+  StageTracer tracer;
+  tracer.BeginSpan("convert");
+  tracer.BeginSpan("rewriter/\"quoted\"");
+  tracer.AddCounter("candidates", 12);
+  clock_mock_->PutClockForwardByTicks(25);
+  tracer.EndSpan();
+  tracer.EndSpan();
+
+  string output;
+  tracer.AppendChromeTraceEvents(1, 2, &output);
+  // The clock is 1000 sec at the tick 5025.
+  EXPECT_EQ("{\"name\":\"convert\",\"ph\":\"X\",\"pid\":1,\"tid\":2,"
+            "\"ts\":999999975,\"dur\":25},\n"
+            "{\"name\":\"rewriter/\\\"quoted\\\"\",\"ph\":\"X\","
+            "\"pid\":1,\"tid\":2,\"ts\":999999975,\"dur\":25,"
+            "\"args\":{\"candidates\":12}},\n",
+            output);
+}
+
+TEST_F(StageTracerTest, TooManySpans) {
+  StageTracer tracer;
+  tracer.BeginSpan("root");
+  for (int i = 0; i < 5000; ++i) {
+    tracer.BeginSpan("child");
+    tracer.AddCounter("count", 1);
+    tracer.EndSpan();
+  }
+  tracer.EndSpan();
+  EXPECT_EQ(4096, tracer.spans().size());
+  EXPECT_EQ(5001 - 4096, tracer.dropped_spans_size());
+  EXPECT_NE(0, tracer.spans()[0].end_ticks);
+}
+
+}  // namespace
+}  // namespace mozc
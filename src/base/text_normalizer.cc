@@ -29,6 +29,7 @@
 
 #include "base/text_normalizer.h"
 
+#include <string.h>
 #include <string>
 
 #include "base/base.h"
@@ -88,33 +89,99 @@ inline char32 ConvertVenderSpecificCharacter(char32 c) {
 }
 #endif
 
-void ConvertVenderSpecificString(const string &input, string *output) {
-  const char *begin = input.data();
-  const char *end = begin + input.size();
-  output->clear();
+#ifdef OS_WINDOWS
+const bool kHasVenderSpecificCharacters = true;
+#else
+const bool kHasVenderSpecificCharacters = false;
+#endif
+
+inline char32 NormalizeCharacter(char32 c, bool replace_vu) {
+  // This is a workaround for hiragana v'
+  if (replace_vu && c == 0x3094) {  // "ゔ"
+    return 0x30F4;  // "ヴ"
+  }
+  return ConvertVenderSpecificCharacter(c);
+}
+
+// Returns true if all the 8 bytes from |p| are ASCII.
+inline bool IsAsciiWord(const char *p) {
+  uint64 word = 0;
+  memcpy(&word, p, sizeof(word));
+  return (word & 0x8080808080808080ULL) == 0;
+}
+
+// Returns the first character in [begin, end) changed by the
+// normalization, or |end| if nothing is changed.  As none of the
+// normalized characters is ASCII, ASCII runs are skipped a word at a time.
+const char *FindCharacterToNormalize(const char *begin, const char *end,
+                                     bool replace_vu) {
+  if (!replace_vu && !kHasVenderSpecificCharacters) {
+    return end;
+  }
   while (begin < end) {
+    if (end - begin >= 8 && IsAsciiWord(begin)) {
+      begin += 8;
+      continue;
+    }
+    if (static_cast<uint8>(*begin) < 0x80) {
+      ++begin;
+      continue;
+    }
     size_t mblen = 0;
     const char32 ucs4 = Util::UTF8ToUCS4(begin, end, &mblen);
-    const char32 new_ucs4 = ConvertVenderSpecificCharacter(ucs4);
-    if (new_ucs4 == ucs4) {  // the same code point
-      output->append(begin, mblen);
-    } else {
-      Util::UCS4ToUTF8Append(new_ucs4, output);
+    if (NormalizeCharacter(ucs4, replace_vu) != ucs4) {
+      return begin;
     }
     begin += mblen;
   }
+  return end;
+}
+
+void AppendNormalizedString(const char *begin, const char *end,
+                            bool replace_vu, string *output) {
+  while (begin < end) {
+    const char *next = FindCharacterToNormalize(begin, end, replace_vu);
+    output->append(begin, next - begin);
+    if (next == end) {
+      break;
+    }
+    size_t mblen = 0;
+    const char32 ucs4 = Util::UTF8ToUCS4(next, end, &mblen);
+    Util::UCS4ToUTF8Append(NormalizeCharacter(ucs4, replace_vu), output);
+    begin = next + mblen;
+  }
+}
+
+bool NormalizeStringInPlace(bool replace_vu, string *text) {
+  const char *begin = text->data();
+  const char *end = begin + text->size();
+  const char *first = FindCharacterToNormalize(begin, end, replace_vu);
+  if (first == end) {
+    return false;
+  }
+  string output;
+  output.reserve(text->size() + 1);
+  output.assign(begin, first);
+  AppendNormalizedString(first, end, replace_vu, &output);
+  text->swap(output);
+  return true;
+}
+
+void NormalizeString(const string &input, bool replace_vu, string *output) {
+  if (&input == output) {
+    NormalizeStringInPlace(replace_vu, output);
+    return;
+  }
+  output->clear();
+  AppendNormalizedString(input.data(), input.data() + input.size(),
+                         replace_vu, output);
 }
 
 }  // namespace
 
 void TextNormalizer::NormalizePreeditText(const string &input,
                                           string *output) {
-  string tmp;
-  // This is a workaround for hiragana v'
-  //  Util::StringReplace(input, "ゔ", "ヴ", true, &tmp);
-  Util::StringReplace(input, "\xE3\x82\x94", "\xE3\x83\xB4", true, &tmp);
-
-  ConvertVenderSpecificString(tmp, output);
+  NormalizeString(input, true, output);
 }
 
 void TextNormalizer::NormalizeTransliterationText(const string &input,
@@ -125,13 +192,22 @@ void TextNormalizer::NormalizeTransliterationText(const string &input,
 
 void TextNormalizer::NormalizeConversionText(const string &input,
                                              string *output) {
-  ConvertVenderSpecificString(input, output);
+  NormalizeString(input, false, output);
 }
 
 void TextNormalizer::NormalizeCandidateText(const string &input,
                                             string *output) {
-  ConvertVenderSpecificString(input, output);
+  NormalizeString(input, false, output);
+}
+
+bool TextNormalizer::NormalizeTransliterationTextInPlace(string *text) {
+  DCHECK(text);
+  return NormalizeStringInPlace(true, text);
 }
 
+bool TextNormalizer::NormalizeCandidateTextInPlace(string *text) {
+  DCHECK(text);
+  return NormalizeStringInPlace(false, text);
+}
 
 }  // namespace mozc
@@ -52,6 +52,12 @@ class TextNormalizer {
   static void NormalizeCandidateText(const string &input,
                                      string *output);
 
+  // Same as above but normalize |text| in place.  Return true if |text|
+  // is modified.  |text| is not copied when nothing is normalized, which
+  // is the common case.
+  static bool NormalizeTransliterationTextInPlace(string *text);
+  static bool NormalizeCandidateTextInPlace(string *text);
+
  private:
   TextNormalizer() {}
   virtual ~TextNormalizer() {}
@@ -94,6 +94,39 @@ TEST(TextNormalizerTest, NormalizeTransliterationText) {
 #endif
 }
 
+TEST(TextNormalizerTest, NormalizeTextInPlace) {
+  // "abcdefghijklmnopゔぁ" (the ASCII part is longer than a word)
+  string text = "abcdefghijklmnop\xe3\x82\x94\xe3\x81\x81";
+  EXPECT_TRUE(TextNormalizer::NormalizeTransliterationTextInPlace(&text));
+  // "abcdefghijklmnopヴぁ"
+  EXPECT_EQ("abcdefghijklmnop\xe3\x83\xb4\xe3\x81\x81", text);
+  EXPECT_FALSE(TextNormalizer::NormalizeTransliterationTextInPlace(&text));
+  EXPECT_EQ("abcdefghijklmnop\xe3\x83\xb4\xe3\x81\x81", text);
+
+  // "ゔ" is not normalized in candidates.
+  text = "\xe3\x82\x94";
+  EXPECT_FALSE(TextNormalizer::NormalizeCandidateTextInPlace(&text));
+  EXPECT_EQ("\xe3\x82\x94", text);
+
+  text.clear();
+  EXPECT_FALSE(TextNormalizer::NormalizeCandidateTextInPlace(&text));
+
+  // "ぐ〜ぐるabcdefgh〜"
+  const string kInput = "\xe3\x81\x90\xe3\x80\x9c\xe3\x81\x90\xe3\x82\x8b"
+      "abcdefgh\xe3\x80\x9c";
+  string expected;
+  TextNormalizer::NormalizeCandidateText(kInput, &expected);
+  text = kInput;
+  EXPECT_EQ(expected != kInput,
+            TextNormalizer::NormalizeCandidateTextInPlace(&text));
+  EXPECT_EQ(expected, text);
+
+  // Output can be the same as input.
+  text = "\xe3\x82\x94";
+  TextNormalizer::NormalizePreeditText(text, &text);
+  EXPECT_EQ("\xe3\x83\xb4", text);
+}
+
 TEST(TextNormalizerTest, NormalizeCandidateText) {
 #ifdef OS_WINDOWS
   string output;
@@ -804,6 +804,39 @@ class Util {
   virtual ~Util() {}
 };
 
+// Computes Util::FingerprintWithSeed() of the concatenation of the
+// appended strings without building the concatenated string.
+// The builder is copyable, so that a common prefix can be hashed once
+// and continued with several suffixes.
+class FingerprintBuilder {
+ public:
+  // Computes Util::Fingerprint().
+  FingerprintBuilder();
+  explicit FingerprintBuilder(uint32 seed);
+
+  void Reset();
+  void Append(const char *str, size_t length);
+  void Append(const string &str) {
+    Append(str.data(), str.size());
+  }
+  void Append(char c) {
+    Append(&c, 1);
+  }
+
+  // Returns the fingerprint of the strings appended so far.
+  uint64 Get() const;
+
+ private:
+  uint32 seed_;
+  // Hash states for the upper and lower 32 bits.
+  uint32 a_[2];
+  uint32 b_[2];
+  uint32 c_[2];
+  char buf_[12];
+  size_t buf_size_;
+  size_t length_;
+};
+
 // Const iterator implementation to traverse on a (utf8) string as a char32
 // string.
 //
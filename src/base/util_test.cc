@@ -3210,6 +3210,53 @@ TEST(UtilTest, Fingerprint32WithSeed_uint32) {
   EXPECT_EQ(num_hash, str_hash) << num_hash << " != " << str_hash;
 }
 
+TEST(UtilTest, FingerprintBuilder) {
+  const uint32 seed = 0xf28defe3;
+  // Covers all the tail lengths and the block boundaries.
+  string str;
+  for (int i = 0; i < 40; ++i) {
+    str.push_back(static_cast<char>(0x80 + i * 7));
+  }
+  for (size_t size = 0; size <= str.size(); ++size) {
+    const string target = str.substr(0, size);
+    const uint64 expected = Util::FingerprintWithSeed(target, seed);
+    for (size_t split = 0; split <= size; ++split) {
+      FingerprintBuilder builder(seed);
+      builder.Append(target.substr(0, split));
+      for (size_t i = split; i < size; ++i) {
+        builder.Append(target[i]);
+      }
+      EXPECT_EQ(expected, builder.Get()) << size << " " << split;
+    }
+  }
+
+  FingerprintBuilder builder(seed);
+  builder.Append("LR");
+  builder.Append('\t');
+  builder.Append("\xE3\x81\x82");
+  EXPECT_EQ(Util::FingerprintWithSeed("LR\t\xE3\x81\x82", seed),
+            builder.Get());
+  builder.Reset();
+  EXPECT_EQ(Util::FingerprintWithSeed("", seed), builder.Get());
+}
+
+TEST(UtilTest, FingerprintBuilderDefaultSeed) {
+  FingerprintBuilder builder;
+  EXPECT_EQ(Util::Fingerprint(""), builder.Get());
+  builder.Append("\xE6\x9C\xAC");  // "本"
+
+  // The copies continue from the common prefix independently.
+  FingerprintBuilder builder1(builder);
+  builder1.Append("\xE3\x82\x92\xE8\xAA\xAD\xE3\x82\x80");  // "を読む"
+  FingerprintBuilder builder2(builder);
+  builder2.Append("\xE5\xB1\x8B");  // "屋"
+  EXPECT_EQ(Util::Fingerprint("\xE6\x9C\xAC\xE3\x82\x92\xE8\xAA\xAD"
+                              "\xE3\x82\x80"),
+            builder1.Get());
+  EXPECT_EQ(Util::Fingerprint("\xE6\x9C\xAC\xE5\xB1\x8B"), builder2.Get());
+  EXPECT_EQ(Util::Fingerprint("\xE6\x9C\xAC"), builder.Get());
+}
+
   // ArabicToWideArabic TEST
 TEST(UtilTest, ArabicToWideArabicTest) {
   string arabic;
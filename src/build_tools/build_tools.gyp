@@ -56,6 +56,7 @@
         '../converter/converter_base.gyp:install_gen_segmenter_bitarray_main',
         '../converter/converter_base.gyp:install_gen_test_segmenter_bitarray_main',
         '../dictionary/dictionary.gyp:install_gen_system_dictionary_data_main',
+        '../prediction/prediction.gyp:install_gen_bigram_index_main',
         '../rewriter/rewriter_base.gyp:install_gen_collocation_data_main',
         '../rewriter/rewriter_base.gyp:'
         'install_gen_single_kanji_rewriter_dictionary_main',
@@ -61,7 +61,7 @@ namespace client {
 
 namespace {
 const char kServerAddress[]    = "session";  // name for the IPC connection.
-const int    kResultBufferSize = 8192 * 32;   // size of IPC buffer
+const int    kResultBufferSize = IPC_MAX_RESPONSESIZE;  // size of IPC buffer
 const size_t kMaxPlayBackSize  = 512;   // size of maximum history
 
 #ifdef _DEBUG
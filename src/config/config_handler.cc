@@ -57,7 +57,7 @@ void AddCharacterFormRule(config::Config *config,
 
 class ConfigHandlerImpl {
  public:
-  ConfigHandlerImpl() {
+  ConfigHandlerImpl() : generation_(0) {
     // <user_profile>/config1.db
     filename_ = kFileNamePrefix;
     filename_ += Util::SimpleItoa(CONFIG_VERSION);
@@ -74,6 +74,7 @@ class ConfigHandlerImpl {
   bool Reload();
   void SetConfigFileName(const string &filename);
   string GetConfigFileName();
+  uint64 GetConfigGeneration() const { return generation_; }
 
  private:
   // copy config to config_ and do some
@@ -86,6 +87,8 @@ class ConfigHandlerImpl {
   mozc::config::Config imposed_config_;
   // equals to config_.MergeFrom(imposed_config_)
   mozc::config::Config merged_config_;
+  // incremented whenever merged_config_ is updated
+  uint64 generation_;
 };
 
 ConfigHandlerImpl *GetConfigHandlerImpl() {
@@ -145,6 +148,7 @@ bool ConfigHandlerImpl::SetConfigInternal(const Config &config) {
 void ConfigHandlerImpl::UpdateMergedConfig() {
   merged_config_.CopyFrom(stored_config_);
   merged_config_.MergeFrom(imposed_config_);
+  ++generation_;
 }
 
 bool ConfigHandlerImpl::SetConfig(const Config &config) {
@@ -282,6 +286,10 @@ void ConfigHandler::GetDefaultConfig(Config *config) {
 
 }
 
+uint64 ConfigHandler::GetConfigGeneration() {
+  return GetConfigHandlerImpl()->GetConfigGeneration();
+}
+
 // Reload from file
 bool ConfigHandler::Reload() {
   return GetConfigHandlerImpl()->Reload();
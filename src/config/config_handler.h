@@ -33,6 +33,7 @@
 #define MOZC_CONFIG_CONFIG_HANDLER_H_
 
 #include <string>
+#include "base/port.h"
 
 namespace mozc {
 namespace config {
@@ -78,6 +79,11 @@ class ConfigHandler {
   // In other words, the imposed config is neither reloaded nor reset.
   static void SetImposedConfig(const Config &config);
 
+  // Returns a number incremented whenever the current config is updated
+  // by SetConfig(), SetImposedConfig() or Reload().  Caches of the
+  // values depending on the config can use it to detect updates.
+  static uint64 GetConfigGeneration();
+
   // Gets default config value.
   //
   // Using this function is safer than
@@ -63,8 +63,8 @@ int CachedConnector::GetTransitionCost(uint16 rid, uint16 lid) const {
 
   // We should mutex lock if HAVE_TLS is false. Mac OS doesn't support TLS.
   // However, we don't call it at this moment with the following reason.
-  // 1) On desktop, we can assume that converter is executed on
-  // single thread environment
+  // 1) The converter is not executed on two threads at the same time.
+  // AsyncSuggester runs it on its worker only while no command runs.
   // 2) Can see about 20% performance drop with Mutex lock.
 
   const uint32 index = SparseConnector::EncodeKey(rid, lid);
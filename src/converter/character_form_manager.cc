@@ -48,6 +48,12 @@ const uint32 kLRUSize    = 128;  // enough?
 const uint32 kSeedValue  = 0x7fe1fed1;  // random seed value for storage
 const char   kFileName[] = "user://cform.db";
 
+// The rules and forms are looked up by a UCS2 character.
+const size_t kTableSize = 0x10000;
+
+// Value of the rule table for the characters without rules.
+const uint8 kNoRule = 0xFF;
+
 REGISTER_MODULE_RELOADER(
     character_form,
     { CharacterFormManager::GetCharacterFormManager()->Reload(); } )
@@ -84,8 +90,20 @@ class CharacterFormManagerImpl {
 
   void set_storage(LRUStorage *storage) {
     storage_ = storage;
+    LoadLearnedForms();
+  }
+
+  // Reloads the learned forms after the storage is updated by another
+  // instance sharing it.
+  void ReloadLearnedForms() {
+    LoadLearnedForms();
   }
 
+  // Returns true if the storage is updated.
+  bool SetCharacterFormAndCheckUpdate(const string &key,
+                                      config::Config::CharacterForm form);
+  bool GuessAndSetCharacterFormAndCheckUpdate(const string &key);
+
   void set_require_consistent_conversion(bool val) {
     require_consistent_conversion_ = val;
   }
@@ -94,9 +112,14 @@ class CharacterFormManagerImpl {
   config::Config::CharacterForm
   GetCharacterFormFromStorage(uint16 ucs2) const;
 
-  void SaveCharacterFormToStorage(uint16 ucs2,
+  // Returns true if the storage is updated.
+  bool SaveCharacterFormToStorage(uint16 ucs2,
                                   config::Config::CharacterForm);
 
+  // Copies the forms in the storage to |form_table_| for the characters
+  // having LAST_FORM rule.
+  void LoadLearnedForms();
+
   // return true if input string will be consistent character form after
   // conversion.
   // for example:
@@ -111,9 +134,23 @@ class CharacterFormManagerImpl {
 
   LRUStorage *storage_;
 
-  // store the setting of a character
-  map<uint16, config::Config::CharacterForm> conversion_table_;
+  // store the setting of a character, indexed by the normalized UCS2
+  // character.  kNoRule is stored for the characters without settings.
+  scoped_array<uint8> rule_table_;
+  size_t rule_table_size_;
+
+  // Same as |rule_table_| but LAST_FORM is resolved with the form in
+  // |storage_|, and NO_CONVERSION is stored for the characters without
+  // settings.  Conversions only read this table so that they never look
+  // up the storage.
+  scoped_array<uint8> form_table_;
 
+  // Characters which have had LAST_FORM rule, so that the learned forms
+  // are reloaded without scanning the whole |rule_table_|.  Bounded by
+  // the size limit of the rules.
+  vector<uint16> last_form_chars_;
+
+  // Used only when the storage is updated.
   map<uint16, vector<uint16> > group_table_;
 
   // When this flag is true,
@@ -241,7 +278,13 @@ void ConvertToAlternative(const string &input, string *output,
 }
 
 CharacterFormManagerImpl::CharacterFormManagerImpl()
-    : storage_(NULL), require_consistent_conversion_(false) {
+    : storage_(NULL),
+      rule_table_(new uint8[kTableSize]),
+      rule_table_size_(0),
+      form_table_(new uint8[kTableSize]),
+      require_consistent_conversion_(false) {
+  memset(rule_table_.get(), kNoRule, kTableSize);
+  memset(form_table_.get(), config::Config::NO_CONVERSION, kTableSize);
 }
 
 CharacterFormManagerImpl::~CharacterFormManagerImpl() {}
@@ -252,57 +295,58 @@ config::Config::CharacterForm CharacterFormManagerImpl::GetCharacterForm(
   if (ucs2 == 0x0000) {
     return config::Config::NO_CONVERSION;
   }
-
-  map<uint16, config::Config::CharacterForm>::const_iterator it =
-      conversion_table_.find(ucs2);
-  if (it == conversion_table_.end()) {
-    return config::Config::NO_CONVERSION;
-  }
-
-  if (it->second == config::Config::LAST_FORM) {
-    return GetCharacterFormFromStorage(ucs2);
-  }
-
-  return it->second;
+  return static_cast<config::Config::CharacterForm>(form_table_[ucs2]);
 }
 
 void CharacterFormManagerImpl::ClearHistory() {
   if (storage_ != NULL) {
     storage_->Clear();
   }
+  LoadLearnedForms();
 }
 
-// TODO(taku): need to chunk str
 void CharacterFormManagerImpl::GuessAndSetCharacterForm(const string &str) {
+  GuessAndSetCharacterFormAndCheckUpdate(str);
+}
+
+// TODO(taku): need to chunk str
+bool CharacterFormManagerImpl::GuessAndSetCharacterFormAndCheckUpdate(
+    const string &str) {
   const Util::FormType form = Util::GetFormType(str);
   if (form == Util::FULL_WIDTH) {
-    SetCharacterForm(str, config::Config::FULL_WIDTH);
-    return;
+    return SetCharacterFormAndCheckUpdate(str, config::Config::FULL_WIDTH);
   }
 
   if (form == Util::HALF_WIDTH) {
-    SetCharacterForm(str, config::Config::HALF_WIDTH);
-    return;
+    return SetCharacterFormAndCheckUpdate(str, config::Config::HALF_WIDTH);
   }
+
+  return false;
 }
 
 void CharacterFormManagerImpl::SetCharacterForm(
     const string &str, config::Config::CharacterForm form) {
+  SetCharacterFormAndCheckUpdate(str, form);
+}
+
+bool CharacterFormManagerImpl::SetCharacterFormAndCheckUpdate(
+    const string &str, config::Config::CharacterForm form) {
   const uint16 ucs2 = GetNormalizedCharacter(str);
   if (ucs2 == 0x0000) {
-    return;
+    return false;
   }
 
-  map<uint16, config::Config::CharacterForm>::const_iterator it =
-      conversion_table_.find(ucs2);
-  if (it == conversion_table_.end()) {
-    return;
+  if (rule_table_[ucs2] != config::Config::LAST_FORM) {
+    return false;
   }
 
-  if (it->second == config::Config::LAST_FORM) {
-    SaveCharacterFormToStorage(ucs2, form);
-    return;
+  if (!SaveCharacterFormToStorage(ucs2, form)) {
+    return false;
   }
+
+  // Reload all the forms since inserting may evict other entries.
+  LoadLearnedForms();
+  return true;
 }
 
 config::Config::CharacterForm
@@ -320,27 +364,34 @@ CharacterFormManagerImpl::GetCharacterFormFromStorage(
   return static_cast<config::Config::CharacterForm>(ivalue);
 }
 
-void CharacterFormManagerImpl::SaveCharacterFormToStorage(
+void CharacterFormManagerImpl::LoadLearnedForms() {
+  for (size_t i = 0; i < last_form_chars_.size(); ++i) {
+    const uint16 ucs2 = last_form_chars_[i];
+    if (rule_table_[ucs2] == config::Config::LAST_FORM) {
+      form_table_[ucs2] = GetCharacterFormFromStorage(ucs2);
+    }
+  }
+}
+
+bool CharacterFormManagerImpl::SaveCharacterFormToStorage(
     uint16 ucs2,
     config::Config::CharacterForm form) {
   if (form != config::Config::FULL_WIDTH &&
       form != config::Config::HALF_WIDTH) {
-    return;
+    return false;
   }
 
   if (storage_ == NULL) {
-    return;
+    return false;
   }
 
-  const string key(reinterpret_cast<const char *>(&ucs2), sizeof(ucs2));
-
-  const char *value = storage_->Lookup(key);
-
-  if (value != NULL &&
-      static_cast<config::Config::CharacterForm>(*value) == form) {
-    return;
+  // |form_table_| mirrors the storage.
+  if (form_table_[ucs2] == form) {
+    return false;
   }
 
+  const string key(reinterpret_cast<const char *>(&ucs2), sizeof(ucs2));
+
   // Do cast since CharacterForm may not be 32 bit
   const uint32 iform = static_cast<uint32>(form);
   map<uint16, vector<uint16> >::const_iterator it = group_table_.find(ucs2);
@@ -356,6 +407,7 @@ void CharacterFormManagerImpl::SaveCharacterFormToStorage(
     }
   }
   VLOG(2) << ucs2 << " is stored to " << kFileName << " as " << form;
+  return true;
 }
 
 void CharacterFormManagerImpl::ConvertString(const string &str,
@@ -488,7 +540,10 @@ bool CharacterFormManagerImpl::ConvertStringWithAlternative(
 }
 
 void CharacterFormManagerImpl::Clear() {
-  conversion_table_.clear();
+  memset(rule_table_.get(), kNoRule, kTableSize);
+  memset(form_table_.get(), config::Config::NO_CONVERSION, kTableSize);
+  rule_table_size_ = 0;
+  last_form_chars_.clear();
   group_table_.clear();
 }
 
@@ -520,7 +575,7 @@ void CharacterFormManagerImpl::AddRule(
   }
 
   const size_t kMaxTableSize = 256;
-  if (conversion_table_.size() + group.size() > kMaxTableSize ||
+  if (rule_table_size_ + group.size() > kMaxTableSize ||
       group_table_.size() + group.size() > kMaxTableSize) {
     LOG(WARNING) << "conversion_table becomes too big. skipped";
     return;
@@ -538,7 +593,17 @@ void CharacterFormManagerImpl::AddRule(
 
   for (size_t i = 0; i < group.size(); ++i) {
     const uint16 ucs2 = group[i];
-    conversion_table_[ucs2] = form;  // overwrite
+    if (rule_table_[ucs2] == kNoRule) {
+      ++rule_table_size_;
+    }
+    if (form == config::Config::LAST_FORM &&
+        find(last_form_chars_.begin(), last_form_chars_.end(), ucs2) ==
+        last_form_chars_.end()) {
+      last_form_chars_.push_back(ucs2);
+    }
+    rule_table_[ucs2] = form;  // overwrite
+    form_table_[ucs2] = (form == config::Config::LAST_FORM) ?
+        GetCharacterFormFromStorage(ucs2) : form;
     if (group.size() > 1) {
       // add to group table
       // the key "UCS2" and other UCS2 in group are treated as the same way.
@@ -667,6 +732,7 @@ void CharacterFormManager::ClearHistory() {
   // GetPreeditManager()->ClearHistory();
   VLOG(1) << "CharacterFormManager::ClearHistory() is called";
   data_->GetConversionManager()->ClearHistory();
+  data_->GetPreeditManager()->ReloadLearnedForms();
 }
 
 void CharacterFormManager::Clear() {
@@ -680,13 +746,19 @@ void CharacterFormManager::SetCharacterForm(
     config::Config::CharacterForm form) {
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
-  data_->GetConversionManager()->SetCharacterForm(input, form);
+  if (data_->GetConversionManager()->SetCharacterFormAndCheckUpdate(
+          input, form)) {
+    data_->GetPreeditManager()->ReloadLearnedForms();
+  }
 }
 
 void CharacterFormManager::GuessAndSetCharacterForm(const string &input) {
   // no need to call Preedit, as storage is shared
   // GetPreeditManager()->SetCharacterForm(input, form);
-  data_->GetConversionManager()->GuessAndSetCharacterForm(input);
+  if (data_->GetConversionManager()->GuessAndSetCharacterFormAndCheckUpdate(
+          input)) {
+    data_->GetPreeditManager()->ReloadLearnedForms();
+  }
 }
 
 void CharacterFormManager::AddPreeditRule(
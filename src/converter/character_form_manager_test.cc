@@ -1005,6 +1005,44 @@ TEST_F(CharacterFormManagerTest, GroupTest) {
   }
 }
 
+TEST_F(CharacterFormManagerTest, LearnedFormIsSharedByPreeditAndConversion) {
+  Util::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  CharacterFormManager *manager =
+      CharacterFormManager::GetCharacterFormManager();
+  manager->ClearHistory();
+  manager->Clear();
+  manager->AddPreeditRule("0", config::Config::LAST_FORM);
+  manager->AddConversionRule("0", config::Config::LAST_FORM);
+
+  // Default form of LAST_FORM is FULL_WIDTH.
+  EXPECT_EQ(config::Config::FULL_WIDTH,
+            manager->GetPreeditCharacterForm("0"));
+  EXPECT_EQ(config::Config::FULL_WIDTH,
+            manager->GetConversionCharacterForm("0"));
+
+  // The learned form is visible from both of them.
+  manager->SetCharacterForm("0", config::Config::HALF_WIDTH);
+  EXPECT_EQ(config::Config::HALF_WIDTH,
+            manager->GetPreeditCharacterForm("0"));
+  EXPECT_EQ(config::Config::HALF_WIDTH,
+            manager->GetConversionCharacterForm("0"));
+  string output;
+  // "０１２"
+  manager->ConvertConversionString("\xef\xbc\x90\xef\xbc\x91\xef\xbc\x92",
+                                   &output);
+  EXPECT_EQ("012", output);
+
+  // A rule added later also uses the learned form.
+  manager->Clear();
+  manager->AddConversionRule("0", config::Config::LAST_FORM);
+  EXPECT_EQ(config::Config::HALF_WIDTH,
+            manager->GetConversionCharacterForm("0"));
+
+  manager->ClearHistory();
+  EXPECT_EQ(config::Config::FULL_WIDTH,
+            manager->GetConversionCharacterForm("0"));
+}
+
 TEST_F(CharacterFormManagerTest, GetFormTypesFromStringPair) {
   CharacterFormManager::FormType f1, f2;
 
@@ -152,8 +152,12 @@ bool ConverterImpl::SetupHistorySegmentsFromPrecedingText(
     // (usual key for conversion) to value.
     for (int j = 0; j < segment->candidates_size(); ++j) {
       Segment::Candidate *candidate = segment->mutable_candidate(j);
-      swap(candidate->key, candidate->value);
-      swap(candidate->content_key, candidate->content_value);
+      const string key = candidate->key;
+      candidate->key = candidate->value;
+      candidate->value = key;
+      const string content_key = candidate->content_key;
+      candidate->content_key = candidate->content_value;
+      candidate->content_value = content_key;
     }
     segment->set_segment_type(Segment::HISTORY);
     segment->set_key(segment->candidate(0).key);
@@ -185,7 +189,10 @@ bool ConverterImpl::StartConversionForRequest(const ConversionRequest &request,
   if (!immutable_converter_->Convert(segments)) {
     return false;
   }
-  RewriterFactory::GetRewriter()->RewriteForRequest(request, segments);
+  // Only the first segment is shown with its candidates.  The rest are
+  // completed in FocusSegmentValue().
+  RewriterFactory::GetRewriter()->RewriteForRequestWithFocus(
+      request, segments->history_segments_size(), segments);
   return IsValidSegments(*segments);
 }
 
@@ -471,8 +478,11 @@ bool ConverterImpl::FocusSegmentValue(Segments *segments,
     return false;
   }
 
-  return RewriterFactory::GetRewriter()->Focus(segments,
-                                               segment_index, candidate_index);
+  RewriterInterface *rewriter = RewriterFactory::GetRewriter();
+  if (segments->segment(segment_index).rewrite_pending()) {
+    rewriter->RewriteSegment(segment_index, segments);
+  }
+  return rewriter->Focus(segments, segment_index, candidate_index);
 }
 
 bool ConverterImpl::FreeSegmentValue(Segments *segments,
@@ -607,7 +617,8 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
     return false;
   }
 
-  RewriterFactory::GetRewriter()->RewriteForRequest(request, segments);
+  RewriterFactory::GetRewriter()->RewriteForRequestWithFocus(
+      request, segment_index, segments);
 
   return true;
 }
@@ -670,7 +681,8 @@ bool ConverterImpl::ResizeSegment(Segments *segments,
     return false;
   }
 
-  RewriterFactory::GetRewriter()->RewriteForRequest(request, segments);
+  RewriterFactory::GetRewriter()->RewriteForRequestWithFocus(
+      request, start_segment_index, segments);
 
   return true;
 }
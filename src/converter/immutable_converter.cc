@@ -37,7 +37,9 @@
 #include <vector>
 
 #include "base/base.h"
+#include "base/latency_histogram.h"
 #include "base/singleton.h"
+#include "base/stage_tracer.h"
 #include "base/util.h"
 #include "config/config.pb.h"
 #include "config/config_handler.h"
@@ -126,6 +128,18 @@ void InsertCorrectedNodes(size_t pos, const string &key,
   }
 }
 
+// Returns the number of the nodes in |lattice| including BOS and EOS.
+size_t GetLatticeNodesSize(const Lattice &lattice) {
+  size_t size = 0;
+  for (size_t pos = 0; pos <= lattice.key().size(); ++pos) {
+    for (const Node *node = lattice.begin_nodes(pos); node != NULL;
+         node = node->bnext) {
+      ++size;
+    }
+  }
+  return size + 1;  // BOS
+}
+
 void MakeGroup(const Segments *segments, vector<uint16> *group) {
   group->clear();
   for (size_t i = 0; i < segments->segments_size(); ++i) {
@@ -189,7 +203,10 @@ void NormalizeHistorySegments(Segments *segments) {
     Util::FullWidthAsciiToHalfWidthAscii(segment->key(), &key);
     Util::FullWidthAsciiToHalfWidthAscii(value, &c->value);
     Util::FullWidthAsciiToHalfWidthAscii(content_value, &c->content_value);
-    Util::FullWidthAsciiToHalfWidthAscii(content_key, &c->content_key);
+    string half_width_content_key;
+    Util::FullWidthAsciiToHalfWidthAscii(content_key,
+                                         &half_width_content_key);
+    c->content_key = half_width_content_key;
     c->key = key;
     segment->set_key(key);
 
@@ -243,7 +260,10 @@ ImmutableConverterImpl::ImmutableConverterImpl()
     : connector_(ConnectorFactory::GetConnector()),
       dictionary_(DictionaryFactory::GetDictionary()),
       segmenter_(Singleton<Segmenter>::get()),
-      last_to_first_name_transition_cost_(0) {
+      last_to_first_name_transition_cost_(0),
+      lattice_latency_(LatencyStats::GetHistogram("converter/lattice")),
+      viterbi_latency_(LatencyStats::GetHistogram("converter/viterbi")),
+      nbest_latency_(LatencyStats::GetHistogram("converter/nbest")) {
   last_to_first_name_transition_cost_
       = connector_->GetTransitionCost(
           POSMatcher::GetLastNameId(), POSMatcher::GetFirstNameId());
@@ -254,7 +274,10 @@ ImmutableConverterImpl::ImmutableConverterImpl(
     : connector_(ConnectorFactory::GetConnector()),
       dictionary_(DictionaryFactory::GetDictionary()),
       segmenter_(segmenter),
-      last_to_first_name_transition_cost_(0) {
+      last_to_first_name_transition_cost_(0),
+      lattice_latency_(LatencyStats::GetHistogram("converter/lattice")),
+      viterbi_latency_(LatencyStats::GetHistogram("converter/viterbi")),
+      nbest_latency_(LatencyStats::GetHistogram("converter/nbest")) {
   last_to_first_name_transition_cost_
       = connector_->GetTransitionCost(
           POSMatcher::GetLastNameId(), POSMatcher::GetFirstNameId());
@@ -332,7 +355,7 @@ void ImmutableConverterImpl::InsertDummyCandidates(Segment *segment,
     }
     new_candidate->key = segment->key();
     new_candidate->value = segment->key();
-    new_candidate->content_key = segment->key();
+    new_candidate->content_key = new_candidate->key;
     new_candidate->content_value = segment->key();
     if (last_candidate != NULL) {
       new_candidate->cost = last_candidate->cost + 1;
@@ -360,7 +383,7 @@ void ImmutableConverterImpl::InsertDummyCandidates(Segment *segment,
     new_candidate->Init();
     new_candidate->key = segment->key();
     new_candidate->value = katakana_value;
-    new_candidate->content_key = segment->key();
+    new_candidate->content_key = new_candidate->key;
     new_candidate->content_value = katakana_value;
     new_candidate->cost = last_candidate->cost + 1;
     new_candidate->wcost = last_candidate->wcost + 1;
@@ -694,6 +717,7 @@ Node *ImmutableConverterImpl::Lookup(const int begin_pos,
   const size_t len = end_pos - begin_pos;
 
   lattice->node_allocator()->set_max_nodes_size(8192);
+  StageTracer::AddCounterToCurrent("dictionary_lookups", 1);
   Node *result_node = NULL;
   if (is_reverse) {
     result_node = dictionary_->LookupReverse(
@@ -1606,31 +1630,55 @@ bool ImmutableConverterImpl::Convert(Segments *segments) const {
 
   Lattice *lattice = GetLattice(segments, is_prediction);
 
-  if (!MakeLattice(lattice, segments)) {
-    LOG(WARNING) << "could not make lattice";
-    return false;
+  {
+    ScopedLatencyRecorder recorder(lattice_latency_);
+    ScopedTraceSpan span("converter/lattice");
+    if (!MakeLattice(lattice, segments)) {
+      LOG(WARNING) << "could not make lattice";
+      return false;
+    }
+    if (span.enabled()) {
+      span.AddCounter("nodes", GetLatticeNodesSize(*lattice));
+    }
   }
 
   vector<uint16> group;
   MakeGroup(segments, &group);
 
-  if (is_prediction) {
-    if (!PredictionViterbi(segments, *lattice)) {
-      LOG(WARNING) << "prediction_viterbi failed";
-      return false;
-    }
-  } else {
-    if (!Viterbi(segments, *lattice, group)) {
-      LOG(WARNING) << "viterbi failed";
-      return false;
+  {
+    ScopedLatencyRecorder recorder(viterbi_latency_);
+    ScopedTraceSpan span("converter/viterbi");
+    if (is_prediction) {
+      if (!PredictionViterbi(segments, *lattice)) {
+        LOG(WARNING) << "prediction_viterbi failed";
+        return false;
+      }
+    } else {
+      if (!Viterbi(segments, *lattice, group)) {
+        LOG(WARNING) << "viterbi failed";
+        return false;
+      }
     }
   }
 
   VLOG(2) << lattice->DebugString();
 
-  if (!MakeSegments(segments, *lattice, group)) {
-    LOG(WARNING) << "make segments failed";
-    return false;
+  {
+    // MakeSegments expands the candidates with NBestGenerator.
+    ScopedLatencyRecorder recorder(nbest_latency_);
+    ScopedTraceSpan span("converter/nbest");
+    if (!MakeSegments(segments, *lattice, group)) {
+      LOG(WARNING) << "make segments failed";
+      return false;
+    }
+    if (span.enabled()) {
+      size_t candidates_size = 0;
+      for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+        candidates_size +=
+            segments->conversion_segment(i).candidates_size();
+      }
+      span.AddCounter("candidates", candidates_size);
+    }
   }
 
   return true;
@@ -47,6 +47,7 @@ namespace mozc {
 
 class DictionaryInterface;
 class ImmutableConverterInterface;
+class LatencyHistogram;
 class SegmenterInterface;
 
 class ImmutableConverterImpl: public ImmutableConverterInterface {
@@ -137,6 +138,11 @@ class ImmutableConverterImpl: public ImmutableConverterInterface {
   const SegmenterInterface *segmenter_;
 
   int32 last_to_first_name_transition_cost_;
+
+  // Histograms of the processing time of each stage of Convert().
+  LatencyHistogram *lattice_latency_;
+  LatencyHistogram *viterbi_latency_;
+  LatencyHistogram *nbest_latency_;
   DISALLOW_COPY_AND_ASSIGN(ImmutableConverterImpl);
 };
 
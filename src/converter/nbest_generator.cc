@@ -116,6 +116,9 @@ void NBestGenerator::MakeCandidate(Segment::Candidate *candidate,
 
   bool has_constrained_node = false;
   bool is_functional = false;
+  // The keys are shared strings, which are built here and set at once.
+  string key;
+  string content_key;
 
   candidate->Init();
   candidate->lid = nodes.front()->lid;
@@ -134,12 +137,12 @@ void NBestGenerator::MakeCandidate(Segment::Candidate *candidate,
     }
     if (!is_functional && !POSMatcher::IsFunctional(node->lid)) {
       candidate->content_value += node->value;
-      candidate->content_key += node->key;
+      content_key += node->key;
     } else {
       is_functional = true;
     }
 
-    candidate->key += node->key;
+    key += node->key;
     candidate->value += node->value;
     if (node->attributes & Node::SPELLING_CORRECTION) {
       candidate->attributes |= Segment::Candidate::SPELLING_CORRECTION;
@@ -152,6 +155,8 @@ void NBestGenerator::MakeCandidate(Segment::Candidate *candidate,
     }
   }
 
+  candidate->key = key;
+  candidate->content_key = content_key;
   if (candidate->content_value.empty() ||
       candidate->content_key.empty()) {
     candidate->content_value = candidate->value;
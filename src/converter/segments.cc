@@ -45,14 +45,20 @@ namespace mozc {
 namespace {
 const size_t kMaxHistorySize = 32;
 const size_t kMaxConversionCandidatesSize = 200;
+
+// Upper bounds of the objects kept in the pools across Clear().  The
+// candidate bound covers a full conversion or prediction list of one
+// segment.
+const size_t kMaxRecycledCandidatesSize = 256;
+const size_t kMaxRecycledSegmentsSize = 64;
 }
 
 string Segment::Candidate::functional_key() const {
   if (key.size() <= content_key.size()) {
     return "";
   }
-  return key.substr(content_key.size(),
-                    key.size() - content_key.size());
+  return key.str().substr(content_key.size(),
+                          key.size() - content_key.size());
 }
 
 string Segment::Candidate::functional_value() const {
@@ -92,6 +98,7 @@ void Segment::Candidate::CopyFrom(const Candidate &src) {
 
 Segment::Segment()
     : segment_type_(FREE),
+      rewrite_pending_(false),
       pool_(new ObjectPool<Candidate>(16)) {}
 
 Segment::~Segment() {}
@@ -117,6 +124,14 @@ void Segment::set_key(const string &key) {
   key_ = key;
 }
 
+bool Segment::rewrite_pending() const {
+  return rewrite_pending_;
+}
+
+void Segment::set_rewrite_pending(bool rewrite_pending) {
+  rewrite_pending_ = rewrite_pending;
+}
+
 const Segment::Candidate &Segment::candidate(int i) const {
   if (i < 0) {
     return meta_candidate(-i-1);
@@ -159,10 +174,18 @@ size_t Segment::candidates_size() const {
 }
 
 void Segment::clear_candidates() {
-  pool_->Free();
+  pool_->Recycle(kMaxRecycledCandidatesSize);
   candidates_.clear();
 }
 
+size_t Segment::candidate_pool_capacity() const {
+  return pool_->capacity();
+}
+
+size_t Segment::num_allocated_candidate_chunks() const {
+  return pool_->num_allocated_chunks();
+}
+
 Segment::Candidate *Segment::push_back_candidate() {
   Candidate *candidate = pool_->Alloc();
   candidate->Init();
@@ -307,6 +330,7 @@ void Segment::Clear() {
   key_.clear();
   meta_candidates_.clear();
   segment_type_ = FREE;
+  rewrite_pending_ = false;
 }
 
 void Segment::CopyFrom(const Segment &src) {
@@ -314,6 +338,7 @@ void Segment::CopyFrom(const Segment &src) {
 
   key_ = src.key();
   segment_type_ = src.segment_type();
+  rewrite_pending_ = src.rewrite_pending();
 
   for (size_t i = 0; i < src.candidates_size(); ++i) {
     Candidate *candidate = add_candidate();
@@ -520,8 +545,21 @@ void Segments::CopyFrom(const Segments &src) {
   }
 }
 
+void Segments::GetPoolStats(PoolStats *stats) const {
+  DCHECK(stats);
+  stats->segment_capacity = pool_->capacity();
+  stats->num_allocated_segment_chunks = pool_->num_allocated_chunks();
+  stats->candidate_capacity = 0;
+  stats->num_allocated_candidate_chunks = 0;
+  for (size_t i = 0; i < segments_.size(); ++i) {
+    stats->candidate_capacity += segments_[i]->candidate_pool_capacity();
+    stats->num_allocated_candidate_chunks +=
+        segments_[i]->num_allocated_candidate_chunks();
+  }
+}
+
 void Segments::clear_segments() {
-  pool_->Free();
+  pool_->Recycle(kMaxRecycledSegmentsSize);
   resized_ = false;
   segments_.clear();
 }
@@ -34,6 +34,7 @@
 #include <vector>
 #include <string>
 #include "base/base.h"
+#include "base/shared_string.h"
 #include "base/util.h"
 #include "converter/lattice.h"
 
@@ -83,9 +84,11 @@ class Segment {
       DISABLE_PRESENTATION_MODE,  // disables "presentation mode".
     };
 
-    string key;         // reading
+    // The keys are shared among the copies of the candidate, as the
+    // rewriters copy the candidates with the same reading many times.
+    SharedString key;   // reading
     string value;       // surface form
-    string content_key;
+    SharedString content_key;
     string content_value;
 
     // Meta information
@@ -175,6 +178,11 @@ class Segment {
   const string& key() const;
   void set_key(const string &key);
 
+  // True if the deferrable rewriters have not been applied to this
+  // segment yet.  See RewriterInterface::deferrable().
+  bool rewrite_pending() const;
+  void set_rewrite_pending(bool rewrite_pending);
+
   // Candidate manupluations
   // getter
   const Candidate &candidate(int i) const;
@@ -203,8 +211,15 @@ class Segment {
 
   // erase all candidates
   // do not erase meta candidates
+  // The candidate objects are kept in the pool and reused, so that
+  // their strings keep the allocated capacity.
   void clear_candidates();
 
+  // Returns the number of candidates the pool can hold without
+  // allocation, and the number of chunks allocated so far.
+  size_t candidate_pool_capacity() const;
+  size_t num_allocated_candidate_chunks() const;
+
   // meta candidates
   // TODO(toshiyuki): Integrate meta candidates to candidate and delete these
   size_t meta_candidates_size() const;
@@ -237,6 +252,7 @@ class Segment {
   // for partial suggestion or not.
   // You should detect that by using both Composer and Segments.
   string key_;
+  bool rewrite_pending_;
   deque<Candidate *> candidates_;
   vector<Candidate>  meta_candidates_;
   scoped_ptr<ObjectPool<Candidate> > pool_;
@@ -354,8 +370,20 @@ class Segments {
   void RemoveTailOfHistorySegments(size_t num_of_characters);
 
   // clear segments
+  // Segment and candidate objects are recycled for the next request.
   void Clear();
 
+  // Statistics of the object pools, mainly for testing that the steady
+  // state conversion does not allocate.  The candidate values are summed
+  // up over the segments currently in use.
+  struct PoolStats {
+    size_t segment_capacity;
+    size_t num_allocated_segment_chunks;
+    size_t candidate_capacity;
+    size_t num_allocated_candidate_chunks;
+  };
+  void GetPoolStats(PoolStats *stats) const;
+
   // Copy segments from src
   void CopyFrom(const Segments &src);
 
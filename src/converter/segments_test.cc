@@ -291,6 +291,9 @@ TEST_F(CandidateTest, CopyFrom) {
   EXPECT_EQ(src.key, dest.key);
   EXPECT_EQ(src.value, dest.value);
   EXPECT_EQ(src.content_key, dest.content_key);
+  // The keys are not copied but shared.
+  EXPECT_TRUE(dest.key.SharesWith(src.key));
+  EXPECT_TRUE(dest.content_key.SharesWith(src.content_key));
   EXPECT_EQ(src.content_value, dest.content_value);
   EXPECT_EQ(src.prefix, dest.prefix);
   EXPECT_EQ(src.suffix, dest.suffix);
@@ -436,6 +439,67 @@ TEST_F(SegmentsTest, CopyFromTest) {
   }
 }
 
+TEST_F(SegmentsTest, RecycleObjectsOnClear) {
+  Segments segments;
+  const size_t kSegmentsSize = 40;
+  const size_t kCandidatesSize = 100;
+  const string kValue(64, 'a');
+
+  Segments::PoolStats warm_stats;
+  const Segment::Candidate *first_candidate = NULL;
+  for (int trial = 0; trial < 3; ++trial) {
+    segments.Clear();
+    for (size_t i = 0; i < kSegmentsSize; ++i) {
+      Segment *segment = segments.add_segment();
+      for (size_t j = 0; j < kCandidatesSize; ++j) {
+        Segment::Candidate *candidate = segment->add_candidate();
+        EXPECT_TRUE(candidate->value.empty());
+        candidate->value = kValue;
+      }
+    }
+
+    Segments::PoolStats stats;
+    segments.GetPoolStats(&stats);
+    if (trial == 0) {
+      warm_stats = stats;
+      first_candidate = &segments.segment(0).candidate(0);
+      continue;
+    }
+    // No new chunk is allocated once the pools are warmed up.
+    EXPECT_EQ(warm_stats.num_allocated_segment_chunks,
+              stats.num_allocated_segment_chunks);
+    EXPECT_EQ(warm_stats.num_allocated_candidate_chunks,
+              stats.num_allocated_candidate_chunks);
+    EXPECT_EQ(warm_stats.segment_capacity, stats.segment_capacity);
+    EXPECT_EQ(warm_stats.candidate_capacity, stats.candidate_capacity);
+    // The same candidate object is reused and keeps its buffer.
+    EXPECT_EQ(first_candidate, &segments.segment(0).candidate(0));
+    EXPECT_LE(kValue.size(), segments.segment(0).candidate(0).value.capacity());
+  }
+
+  // Erased segments are also reused.
+  segments.pop_back_segment();
+  Segment *segment = segments.add_segment();
+  EXPECT_EQ(0, segment->candidates_size());
+  EXPECT_TRUE(segment->key().empty());
+}
+
+TEST_F(SegmentsTest, RecycleIsBounded) {
+  Segments segments;
+  Segment *segment = segments.add_segment();
+  for (size_t i = 0; i < 2000; ++i) {
+    segment->add_candidate();
+  }
+  Segments::PoolStats stats;
+  segments.GetPoolStats(&stats);
+  EXPECT_LE(2000, stats.candidate_capacity);
+
+  segment->clear_candidates();
+  segments.GetPoolStats(&stats);
+  EXPECT_GT(2000, stats.candidate_capacity);
+  EXPECT_LT(0, stats.candidate_capacity);
+}
+
 TEST_F(CandidateTest, functional_key) {
   Segment::Candidate candidate;
   candidate.Init();
@@ -503,6 +567,7 @@ TEST_F(SegmentTest, CopyFrom) {
 
   src.set_key("key");
   src.set_segment_type(Segment::FIXED_VALUE);
+  src.set_rewrite_pending(true);
   Segment::Candidate *candidate1 = src.add_candidate();
   candidate1->key = "candidate1->key";
   Segment::Candidate *candidate2 = src.add_candidate();
@@ -514,9 +579,13 @@ TEST_F(SegmentTest, CopyFrom) {
 
   EXPECT_EQ(src.key(), dest.key());
   EXPECT_EQ(src.segment_type(), dest.segment_type());
+  EXPECT_TRUE(dest.rewrite_pending());
   EXPECT_EQ(src.candidate(0).key, dest.candidate(0).key);
   EXPECT_EQ(src.candidate(1).key, dest.candidate(1).key);
   EXPECT_EQ(src.meta_candidate(0).key, dest.meta_candidate(0).key);
+
+  dest.Clear();
+  EXPECT_FALSE(dest.rewrite_pending());
 }
 
 TEST_F(SegmentTest, MetaCandidateTest) {
@@ -38,6 +38,7 @@
 #endif
 
 #include <stdlib.h>
+#include <algorithm>
 #include "base/base.h"
 #include "base/file_stream.h"
 #include "base/mmap.h"
@@ -49,6 +50,29 @@
 
 namespace mozc {
 
+IPCResponseBuffer::IPCResponseBuffer() : capacity_(0) {}
+
+IPCResponseBuffer::~IPCResponseBuffer() {}
+
+char *IPCResponseBuffer::Reserve(size_t size) {
+  if (size > capacity_) {
+    // Grows geometrically to avoid repeated allocations.
+    const size_t new_capacity = max(size, capacity_ * 2);
+    data_.reset(new char[new_capacity]);
+    capacity_ = new_capacity;
+  }
+  return data_.get();
+}
+
+bool IPCServer::ProcessWithBuffer(const char *request,
+                                  size_t request_size,
+                                  IPCResponseBuffer *response,
+                                  size_t *response_size) {
+  *response_size = IPC_RESPONSESIZE;
+  return Process(request, request_size,
+                 response->Reserve(IPC_RESPONSESIZE), response_size);
+}
+
 void IPCServer::LoopAndReturn() {
   if (server_thread_.get() == NULL) {
     server_thread_.reset(new IPCServerThread(this));
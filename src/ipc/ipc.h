@@ -39,6 +39,7 @@
 #endif  // OS_OS_MACOSX
 
 #include <string>
+#include <vector>
 #include "base/scoped_handle.h"
 #include "base/thread.h"
 #include "base/base.h"
@@ -48,6 +49,9 @@ namespace mozc {
 enum {
   IPC_REQUESTSIZE = 16 * 8192,
   IPC_RESPONSESIZE = 16 * 8192,
+  // Upper bound of a response written to IPCResponseBuffer.  It must not
+  // exceed the response buffer of the clients.
+  IPC_MAX_RESPONSESIZE = 32 * 8192,
 };
 
 // increment this value if protocol has changed.
@@ -55,6 +59,21 @@ enum {
   IPC_PROTOCOL_VERSION = 3,
 };
 
+// Transport version advertised through the IPC key file together with
+// IPC_PROTOCOL_VERSION.  Unlike the protocol version, a client and a server
+// with different transport versions can still talk to each other: a client
+// uses the newest transport both sides understand.
+//  IPC_TRANSPORT_LEGACY: one request per connection.  The client
+//    half-closes the socket to mark the end of the request.
+//  IPC_TRANSPORT_FRAMED: requests and responses are prefixed with a frame
+//    header carrying the magic, the request id and the payload size, and the
+//    connection is kept open for subsequent requests.
+enum IPCTransportVersion {
+  IPC_TRANSPORT_LEGACY = 0,
+  IPC_TRANSPORT_FRAMED = 1,
+  IPC_TRANSPORT_VERSION = IPC_TRANSPORT_FRAMED,
+};
+
 enum IPCErrorType {
   IPC_NO_ERROR,
   IPC_NO_CONNECTION,
@@ -67,6 +86,32 @@ enum IPCErrorType {
 };
 
 class IPCServerThread;
+// Response buffer growing on demand.  The memory is reused for the
+// following responses, so that the server doesn't allocate memory for
+// each request.
+class IPCResponseBuffer {
+ public:
+  IPCResponseBuffer();
+  ~IPCResponseBuffer();
+
+  // Returns a buffer of at least |size| bytes.  The contents are not kept
+  // when the buffer grows.
+  char *Reserve(size_t size);
+
+  char *data() const {
+    return data_.get();
+  }
+
+  size_t capacity() const {
+    return capacity_;
+  }
+
+ private:
+  scoped_array<char> data_;
+  size_t capacity_;
+
+  DISALLOW_COPY_AND_ASSIGN(IPCResponseBuffer);
+};
 
 class IPCClientInterface {
  public:
@@ -148,8 +193,11 @@ class IPCClient : public IPCClientInterface {
   // Return true when IPC finishes successfully.
   // When Server doesn't send response within timeout, 'Call' returns false.
   // When timeout (in msec) is set -1, 'Call' waits forever.
-  // Note that on Linux, Call() closes the socket_. This means you cannot call
-  // the Call() function more than once.
+  // Note that on Linux, Call() closes the socket_ unless the server supports
+  // IPC_TRANSPORT_FRAMED. This means you cannot call the Call() function
+  // more than once on the legacy transport.  A connection on the framed
+  // transport is returned to a per-process pool when IPCClient is destructed
+  // and reused by the next IPCClient connecting to the same server.
   bool Call(const char *request,
             size_t request_size,
             char *response,
@@ -180,7 +228,20 @@ class IPCClient : public IPCClientInterface {
   string name_;
   MachPortManagerInterface *mach_port_manager_;
 #else
+  // Connects to the server.  Returns false on failure.
+  bool Connect();
+  void CloseSocket();
+  bool CallFramed(const char *request, size_t request_size,
+                  char *response, size_t *response_size, int32 timeout);
+
   int socket_;
+  string name_;
+  string server_path_;
+  // true if the connection uses IPC_TRANSPORT_FRAMED.
+  bool framed_;
+  // true if the connection was taken from the connection pool.
+  bool reused_;
+  uint32 request_id_;
 #endif
   bool connected_;
   IPCPathManager *ipc_path_manager_;
@@ -255,6 +316,15 @@ class IPCServer {
     return true;
   }
 
+  // Same as Process() but the response is written to |response|, which
+  // the implementation can grow up to IPC_MAX_RESPONSESIZE bytes.  The
+  // default implementation calls Process() with IPC_RESPONSESIZE bytes.
+  // Currently only the Unix domain socket server calls this method.
+  virtual bool ProcessWithBuffer(const char *request,
+                                 size_t request_size,
+                                 IPCResponseBuffer *response,
+                                 size_t *response_size);
+
   // Start select loop. It goes into infinite loop.
   void Loop();
 
@@ -310,8 +380,20 @@ class IPCServer {
   string name_;
   MachPortManagerInterface *mach_port_manager_;
 #else
+  // Serves a request on a new connection |socket|.  Returns true if the
+  // connection is kept open for the next request.
+  bool ProcessNewConnection(int socket, bool *error);
+  // Serves a framed request on |socket|.  Returns false if the connection
+  // should be closed.
+  bool ProcessFramedRequest(int socket, bool *error);
+  void CloseConnections();
+
   int socket_;
   string server_address_;
+  // Used instead of |response_| to send responses larger than it.
+  IPCResponseBuffer response_buffer_;
+  // Persistent connections waiting for the next framed request.
+  vector<int> connections_;
 #endif
 
   int timeout_;
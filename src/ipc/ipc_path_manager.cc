@@ -225,6 +225,10 @@ bool IPCPathManager::SavePathName() {
   // set the server version
   ipc_path_info_->set_protocol_version(IPC_PROTOCOL_VERSION);
   ipc_path_info_->set_product_version(Version::GetMozcVersion());
+#ifdef OS_LINUX
+  // Only the Unix domain socket server understands framed requests.
+  ipc_path_info_->set_transport_version(IPC_TRANSPORT_VERSION);
+#endif
 
 #ifdef OS_WINDOWS
   ipc_path_info_->set_process_id(static_cast<uint32>(::GetCurrentProcessId()));
@@ -288,6 +292,10 @@ uint32 IPCPathManager::GetServerProtocolVersion() const {
   return ipc_path_info_->protocol_version();
 }
 
+uint32 IPCPathManager::GetServerTransportVersion() const {
+  return ipc_path_info_->transport_version();
+}
+
 const string &IPCPathManager::GetServerProductVersion() const {
   return ipc_path_info_->product_version();
 }
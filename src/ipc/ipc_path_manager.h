@@ -69,6 +69,10 @@ class IPCPathManager {
   // return 0 if protocol version is not defined.
   uint32 GetServerProtocolVersion() const;
 
+  // return transport version.
+  // return 0 if the server accepts only one request per connection.
+  uint32 GetServerTransportVersion() const;
+
   // return product version.
   // return "0.0.0.0" if product version is not defined
   const string &GetServerProductVersion() const;
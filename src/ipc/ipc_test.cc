@@ -37,6 +37,13 @@
 #include "testing/base/public/gunit.h"
 #include "base/thread.h"
 
+#ifdef OS_LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "ipc/ipc_path_manager.h"
+#endif  // OS_LINUX
+
 DECLARE_string(test_tmpdir);
 
 namespace {
@@ -119,6 +126,24 @@ class EchoServer: public mozc::IPCServer {
 };
 }
 
+TEST(IPCTest, ResponseBufferTest) {
+  mozc::IPCResponseBuffer buffer;
+  EXPECT_EQ(0, buffer.capacity());
+  char *data = buffer.Reserve(100);
+  EXPECT_TRUE(data != NULL);
+  EXPECT_LE(100, buffer.capacity());
+
+  // The memory is reused for smaller sizes.
+  EXPECT_EQ(data, buffer.Reserve(10));
+  EXPECT_EQ(data, buffer.Reserve(buffer.capacity()));
+
+  // Grows at least twice.
+  const size_t capacity = buffer.capacity();
+  buffer.Reserve(capacity + 1);
+  EXPECT_LE(capacity * 2, buffer.capacity());
+  EXPECT_EQ(buffer.data(), buffer.Reserve(capacity + 1));
+}
+
 TEST(IPCTest, IPCTest) {
   mozc::Util::SetUserProfileDirectory(FLAGS_test_tmpdir);
 #ifdef OS_MACOSX
@@ -159,3 +184,125 @@ TEST(IPCTest, IPCTest) {
 
   con.Wait();
 }
+
+#ifdef OS_LINUX
+namespace {
+void KillServer(const char *name) {
+  mozc::IPCClient kill(name, "");
+  const char kill_cmd[32] = "kill";
+  char output[32];
+  size_t output_size = sizeof(output);
+  kill.Call(kill_cmd, strlen(kill_cmd), output, &output_size, 1000);
+}
+
+bool EchoCall(mozc::IPCClient *client, const string &input) {
+  char buf[8192];
+  size_t length = sizeof(buf);
+  if (!client->Call(input.data(), input.size(), buf, &length, 1000)) {
+    return false;
+  }
+  return input == string(buf, length);
+}
+}  // namespace
+
+TEST(IPCTest, PersistentConnectionTest) {
+  mozc::Util::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  EchoServer con(kServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(100);
+
+  {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    EXPECT_EQ(mozc::IPC_TRANSPORT_FRAMED,
+              mozc::IPCPathManager::GetIPCPathManager(kServerAddress)->
+              GetServerTransportVersion());
+    // Multiple calls on the same connection.
+    for (int i = 0; i < 10; ++i) {
+      EXPECT_TRUE(EchoCall(&client, "test" + GenRandomString(i * 100)));
+    }
+    // Empty response.
+    char buf[32];
+    size_t length = sizeof(buf);
+    EXPECT_TRUE(client.Call("test", 0, buf, &length, 1000));
+    EXPECT_EQ(0, length);
+  }
+
+  // The connection is reused by the following clients.
+  for (int i = 0; i < 10; ++i) {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    EXPECT_TRUE(EchoCall(&client, "test" + GenRandomString(100)));
+  }
+
+  KillServer(kServerAddress);
+  con.Wait();
+}
+
+TEST(IPCTest, ReconnectAfterServerRestartTest) {
+  mozc::Util::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  {
+    EchoServer con(kServerAddress, 10, 1000);
+    con.LoopAndReturn();
+    mozc::Util::Sleep(100);
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    EXPECT_TRUE(EchoCall(&client, "test1"));
+    // |client| puts the connection back to the pool.
+  }
+
+  // The new server doesn't know the pooled connection.
+  EchoServer con(kServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(100);
+  {
+    mozc::IPCClient client(kServerAddress, "");
+    ASSERT_TRUE(client.Connected());
+    EXPECT_TRUE(EchoCall(&client, "test2"));
+  }
+
+  KillServer(kServerAddress);
+  con.Wait();
+}
+
+TEST(IPCTest, LegacyClientTest) {
+  mozc::Util::SetUserProfileDirectory(FLAGS_test_tmpdir);
+  EchoServer con(kServerAddress, 10, 1000);
+  con.LoopAndReturn();
+  mozc::Util::Sleep(100);
+
+  // Keeps a persistent connection open while the legacy client talks.
+  mozc::IPCClient client(kServerAddress, "");
+  ASSERT_TRUE(client.Connected());
+  EXPECT_TRUE(EchoCall(&client, "test1"));
+
+  string address;
+  ASSERT_TRUE(mozc::IPCPathManager::GetIPCPathManager(kServerAddress)->
+              GetPathName(&address));
+  sockaddr_un addr;
+  ::memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  ::memcpy(addr.sun_path, address.data(), address.size());
+  const int sock = ::socket(PF_UNIX, SOCK_STREAM, 0);
+  ASSERT_LE(0, sock);
+  ASSERT_EQ(0, ::connect(sock, reinterpret_cast<sockaddr *>(&addr),
+                         sizeof(addr.sun_family) + address.size()));
+  // The legacy transport marks the end of the request by half-closing.
+  const string request = "test_legacy";
+  ASSERT_EQ(request.size(), ::send(sock, request.data(), request.size(), 0));
+  ::shutdown(sock, SHUT_WR);
+  string response;
+  char buf[32];
+  ssize_t length = 0;
+  while ((length = ::recv(sock, buf, sizeof(buf), 0)) > 0) {
+    response.append(buf, length);
+  }
+  ::close(sock);
+  EXPECT_EQ(request, response);
+
+  EXPECT_TRUE(EchoCall(&client, "test2"));
+
+  KillServer(kServerAddress);
+  con.Wait();
+}
+#endif  // OS_LINUX
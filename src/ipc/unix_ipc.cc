@@ -36,6 +36,7 @@
 #include <fcntl.h>
 #include <libgen.h>
 #include <netinet/in.h>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/time.h>
@@ -50,7 +51,10 @@
 #include <cerrno>
 #include <cstring>
 #include <cstdlib>
+#include <map>
 
+#include "base/mutex.h"
+#include "base/singleton.h"
 #include "base/util.h"
 #include "ipc/ipc_path_manager.h"
 
@@ -64,6 +68,82 @@ namespace {
 
 const int kInvalidSocket = -1;
 
+// The first byte of the magic is 0, which never starts a request of the
+// legacy transport in practice since field number 0 is invalid in protocol
+// buffers.  The server distinguishes the transports with this byte.
+const char kFrameMagic[4] = { '\0', 'M', 'Z', 'F' };
+
+// Frame header of IPC_TRANSPORT_FRAMED.  Both sides run on the same machine,
+// so integers are stored in the host byte order.
+struct FrameHeader {
+  char magic[4];
+  uint32 request_id;
+  uint32 size;
+};
+
+// Maximum number of persistent connections a server keeps open.  Requests
+// on further connections are served and the connections are closed.
+const size_t kMaxPersistentConnections = 64;
+
+// Maximum number of idle connections a client process keeps per server.
+const size_t kMaxPooledConnections = 4;
+
+// Idle connections of IPC_TRANSPORT_FRAMED.  IPCClient takes a connection
+// from the pool when it is created and puts it back when it is destructed,
+// so that a connection is used by one IPCClient at the same time.
+class ConnectionPool {
+ public:
+  ConnectionPool() : pid_(::getpid()) {}
+
+  ~ConnectionPool() {
+    CloseAll();
+  }
+
+  // Returns kInvalidSocket if no idle connection is available.
+  int Take(const string &key) {
+    scoped_lock l(&mutex_);
+    if (pid_ != ::getpid()) {
+      // Connections inherited from the parent process must not be shared.
+      CloseAll();
+      pid_ = ::getpid();
+    }
+    multimap<string, int>::iterator it = connections_.find(key);
+    if (it == connections_.end()) {
+      return kInvalidSocket;
+    }
+    const int socket = it->second;
+    connections_.erase(it);
+    return socket;
+  }
+
+  void Put(const string &key, int socket) {
+    scoped_lock l(&mutex_);
+    if (pid_ != ::getpid() ||
+        connections_.count(key) >= kMaxPooledConnections) {
+      ::close(socket);
+      return;
+    }
+    connections_.insert(make_pair(key, socket));
+  }
+
+ private:
+  void CloseAll() {
+    for (multimap<string, int>::const_iterator it = connections_.begin();
+         it != connections_.end(); ++it) {
+      ::close(it->second);
+    }
+    connections_.clear();
+  }
+
+  Mutex mutex_;
+  pid_t pid_;
+  multimap<string, int> connections_;
+};
+
+string GetPoolKey(const string &name, const string &server_path) {
+  return name + '\t' + server_path;
+}
+
 void mkdir_p(const string &dirname) {
   const string parent_dir = mozc::Util::Dirname(dirname);
   struct stat st;
@@ -239,6 +319,79 @@ bool RecvMessage(int socket,
   return true;
 }
 
+// Receives exactly |size| bytes.  |received_size| is set to the number of
+// bytes received before an error or the end of the stream.
+bool RecvData(int socket,
+              char *buf,
+              size_t size,
+              int timeout,
+              size_t *received_size,
+              IPCErrorType *last_ipc_error) {
+  *received_size = 0;
+  while (*received_size < size) {
+    if (IsReadTimeout(socket, timeout)) {
+      LOG(WARNING) << "Read timeout " << timeout;
+      *last_ipc_error = IPC_TIMEOUT_ERROR;
+      return false;
+    }
+    const ssize_t read_length = ::recv(socket, buf + *received_size,
+                                       size - *received_size, 0);
+    if (read_length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
+      *last_ipc_error = IPC_READ_ERROR;
+      return false;
+    }
+    if (read_length == 0) {
+      VLOG(1) << "connection closed by peer";
+      *last_ipc_error = IPC_READ_ERROR;
+      return false;
+    }
+    *received_size += read_length;
+  }
+  return true;
+}
+
+// Sends a frame header followed by |size| bytes of |buf|.
+bool SendFrame(int socket,
+               uint32 request_id,
+               const char *buf,
+               size_t size,
+               int timeout,
+               IPCErrorType *last_ipc_error) {
+  FrameHeader header;
+  ::memcpy(header.magic, kFrameMagic, sizeof(header.magic));
+  header.request_id = request_id;
+  header.size = static_cast<uint32>(size);
+  if (!SendMessage(socket, reinterpret_cast<const char *>(&header),
+                   sizeof(header), timeout, last_ipc_error)) {
+    return false;
+  }
+  return size == 0 ||
+      SendMessage(socket, buf, size, timeout, last_ipc_error);
+}
+
+// Receives a frame header.  |received_size| is set to the number of
+// bytes received.
+bool RecvFrameHeader(int socket,
+                     FrameHeader *header,
+                     int timeout,
+                     size_t *received_size,
+                     IPCErrorType *last_ipc_error) {
+  if (!RecvData(socket, reinterpret_cast<char *>(header), sizeof(*header),
+                timeout, received_size, last_ipc_error)) {
+    return false;
+  }
+  if (::memcmp(header->magic, kFrameMagic, sizeof(kFrameMagic)) != 0) {
+    LOG(ERROR) << "invalid frame header";
+    *last_ipc_error = IPC_READ_ERROR;
+    return false;
+  }
+  return true;
+}
+
 void SetCloseOnExecFlag(int fd) {
   int flags = ::fcntl(fd, F_GETFD, 0);
   if (flags < 0) {
@@ -262,14 +415,16 @@ bool IsAbstractSocket(const string& address) {
 
 // Client
 IPCClient::IPCClient(const string &name)
-    : socket_(kInvalidSocket), connected_(false),
+    : socket_(kInvalidSocket), framed_(false), reused_(false),
+      request_id_(0), connected_(false),
       ipc_path_manager_(NULL),
       last_ipc_error_(IPC_NO_ERROR) {
   Init(name, "");
 }
 
 IPCClient::IPCClient(const string &name, const string &server_path)
-    : socket_(kInvalidSocket), connected_(false),
+    : socket_(kInvalidSocket), framed_(false), reused_(false),
+      request_id_(0), connected_(false),
       ipc_path_manager_(NULL),
       last_ipc_error_(IPC_NO_ERROR) {
   Init(name, server_path);
@@ -277,6 +432,8 @@ IPCClient::IPCClient(const string &name, const string &server_path)
 
 void IPCClient::Init(const string &name, const string &server_path) {
   last_ipc_error_ = IPC_NO_CONNECTION;
+  name_ = name;
+  server_path_ = server_path;
 
   // Try twice, because key may be changed.
   IPCPathManager *manager = IPCPathManager::GetIPCPathManager(name);
@@ -287,6 +444,30 @@ void IPCClient::Init(const string &name, const string &server_path) {
 
   ipc_path_manager_ = manager;
 
+  // Reuses an idle connection validated by the previous IPCClient.  If the
+  // server has gone, Call() reconnects.
+  socket_ = Singleton<ConnectionPool>::get()->Take(
+      GetPoolKey(name_, server_path_));
+  if (socket_ != kInvalidSocket) {
+    framed_ = true;
+    reused_ = true;
+    last_ipc_error_ = IPC_NO_ERROR;
+    connected_ = true;
+    return;
+  }
+
+  Connect();
+}
+
+bool IPCClient::Connect() {
+  IPCPathManager *manager = ipc_path_manager_;
+  DCHECK(manager);
+  CloseSocket();
+  framed_ = false;
+  reused_ = false;
+  connected_ = false;
+  last_ipc_error_ = IPC_NO_CONNECTION;
+
   for (size_t trial = 0; trial < 2; ++trial) {
     string server_address;
     if (!manager->GetPathName(&server_address)) {
@@ -326,30 +507,44 @@ void IPCClient::Init(const string &name, const string &server_path) {
         ::unlink(server_address.c_str());
       }
       LOG(WARNING) << "connect failed: " << strerror(errno);
+      CloseSocket();
       connected_ = false;
       manager->Clear();
       continue;
     } else {
       if (!manager->IsValidServer(static_cast<uint32>(pid),
-                                  server_path)) {
+                                  server_path_)) {
         LOG(ERROR) << "Connecting to invalid server";
         last_ipc_error_ = IPC_INVALID_SERVER;
         break;
       }
       last_ipc_error_ = IPC_NO_ERROR;
+      framed_ = (manager->GetServerTransportVersion() >=
+                 IPC_TRANSPORT_FRAMED);
       connected_ = true;
       break;
     }
   }
+
+  return connected_;
 }
 
-IPCClient::~IPCClient() {
+void IPCClient::CloseSocket() {
   if (socket_ != kInvalidSocket) {
     if (::close(socket_) < 0) {
       LOG(WARNING) << "close failed: " << strerror(errno);
     }
     socket_ = kInvalidSocket;
   }
+}
+
+IPCClient::~IPCClient() {
+  if (connected_ && framed_ && socket_ != kInvalidSocket) {
+    Singleton<ConnectionPool>::get()->Put(GetPoolKey(name_, server_path_),
+                                          socket_);
+    socket_ = kInvalidSocket;
+  }
+  CloseSocket();
   connected_ = false;
   VLOG(1) << "connection closed (IPCClient destructed)";
 }
@@ -361,6 +556,11 @@ bool IPCClient::Call(const char *request_,
                      size_t *response_size,
                      int32 timeout) {
   last_ipc_error_ = IPC_NO_ERROR;
+  if (framed_) {
+    return CallFramed(request_, input_length, response_, response_size,
+                      timeout);
+  }
+
   if (!SendMessage(socket_, request_, input_length, timeout,
                    &last_ipc_error_)) {
     LOG(ERROR) << "SendMessage failed";
@@ -369,10 +569,8 @@ bool IPCClient::Call(const char *request_,
 
   // Half-close the socket so that mozc_server could know the length of the
   // request data. Without this, RecvMessage() in mozc_server would fail with
-  // timeout.
-  // TODO(yusukes): It would be also possible to modify Send and RecvMessage()
-  // so that they send/recv the payload size explicitly together with the actual
-  // data. Will revisit later.
+  // timeout.  The framed transport sends the payload size explicitly
+  // instead.
   ::shutdown(socket_, SHUT_WR);
 
   if (!RecvMessage(socket_, response_, response_size, timeout,
@@ -384,6 +582,67 @@ bool IPCClient::Call(const char *request_,
   return true;
 }
 
+bool IPCClient::CallFramed(const char *request,
+                           size_t request_size,
+                           char *response,
+                           size_t *response_size,
+                           int32 timeout) {
+  const size_t max_response_size = *response_size;
+  *response_size = 0;
+  for (int trial = 0; trial < 2; ++trial) {
+    if (socket_ == kInvalidSocket) {
+      LOG(ERROR) << "not connected";
+      last_ipc_error_ = IPC_NO_CONNECTION;
+      return false;
+    }
+    last_ipc_error_ = IPC_NO_ERROR;
+    const uint32 request_id = ++request_id_;
+    FrameHeader header;
+    size_t received_size = 0;
+    if (SendFrame(socket_, request_id, request, request_size, timeout,
+                  &last_ipc_error_) &&
+        RecvFrameHeader(socket_, &header, timeout, &received_size,
+                        &last_ipc_error_)) {
+      if (header.request_id != request_id ||
+          header.size > max_response_size) {
+        LOG(ERROR) << "unexpected response: " << header.request_id << " "
+                   << header.size;
+        last_ipc_error_ = IPC_READ_ERROR;
+        connected_ = false;
+        CloseSocket();
+        return false;
+      }
+      if (!RecvData(socket_, response, header.size, timeout, &received_size,
+                    &last_ipc_error_)) {
+        LOG(ERROR) << "RecvData failed";
+        connected_ = false;
+        CloseSocket();
+        return false;
+      }
+      *response_size = header.size;
+      VLOG(1) << "Call succeeded";
+      return true;
+    }
+
+    // The server may have closed an idle connection, e.g., when it was
+    // restarted.  Since nothing has been received, the request is sent
+    // again on a new connection.
+    const bool retry = (reused_ && received_size == 0 &&
+                        last_ipc_error_ != IPC_TIMEOUT_ERROR);
+    connected_ = false;
+    CloseSocket();
+    if (!retry || !Connect()) {
+      LOG(ERROR) << "Call failed";
+      return false;
+    }
+    if (!framed_) {
+      *response_size = max_response_size;
+      return Call(request, request_size, response, response_size, timeout);
+    }
+  }
+  return false;
+}
+
 bool IPCClient::Connected() const {
   return connected_;
 }
@@ -463,6 +722,7 @@ IPCServer::~IPCServer() {
   if (server_thread_.get() != NULL) {
     server_thread_->Terminate();
   }
+  CloseConnections();
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
@@ -479,39 +739,61 @@ bool IPCServer::Connected() const {
 }
 
 void IPCServer::Loop() {
-  // The most portable and straightforward single-thread server
+  // The most portable and straightforward single-thread server.
+  // Persistent connections of IPC_TRANSPORT_FRAMED are multiplexed with
+  // poll().  Each request is still processed one by one.
   bool error = false;
-  IPCErrorType last_ipc_error = IPC_NO_ERROR;
-  pid_t pid = 0;
+  vector<pollfd> fds;
   while (!error) {
+    fds.resize(connections_.size() + 1);
+    fds[0].fd = socket_;
+    fds[0].events = POLLIN;
+    fds[0].revents = 0;
+    for (size_t i = 0; i < connections_.size(); ++i) {
+      fds[i + 1].fd = connections_[i];
+      fds[i + 1].events = POLLIN;
+      fds[i + 1].revents = 0;
+    }
+    if (::poll(&fds[0], fds.size(), -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG(FATAL) << "poll() failed: " << strerror(errno);
+      return;
+    }
+
+    // Serves the persistent connections first.  |fds[i + 1]| corresponds
+    // to |connections_[i]|, so connections are erased from the back.
+    // A connection is erased before it is closed, so that the destructor
+    // never closes it twice even if the thread is terminated here.
+    for (size_t i = connections_.size(); !error && i > 0; --i) {
+      const int connection = connections_[i - 1];
+      if (fds[i].revents != 0 &&
+          !ProcessFramedRequest(connection, &error)) {
+        connections_.erase(connections_.begin() + i - 1);
+        ::close(connection);
+      }
+    }
+
+    if (error || (fds[0].revents & POLLIN) == 0) {
+      continue;
+    }
+
     const int new_sock = ::accept(socket_, NULL, NULL);
     if (new_sock < 0) {
       LOG(FATAL) << "accept() failed: " << strerror(errno);
       return;
     }
-    if (!IsPeerValid(new_sock, &pid)) {
-      continue;
+    SetCloseOnExecFlag(new_sock);
+    connections_.push_back(new_sock);
+    if (!ProcessNewConnection(new_sock, &error) || error ||
+        connections_.size() > kMaxPersistentConnections) {
+      connections_.pop_back();
+      ::close(new_sock);
     }
-    size_t request_size = sizeof(request_);
-    size_t response_size = sizeof(response_);
-    if (RecvMessage(new_sock,
-                    &request_[0],
-                    &request_size, timeout_, &last_ipc_error)) {
-      if (!Process(&request_[0], request_size,
-                   &response_[0], &response_size)) {
-        LOG(WARNING) << "Process() failed";
-        error = true;
-      }
-      if (response_size > 0) {
-        SendMessage(new_sock,
-                    &response_[0],
-                    response_size, timeout_, &last_ipc_error);
-      }
-    }
-
-    ::close(new_sock);
   }
 
+  CloseConnections();
   ::shutdown(socket_, SHUT_RDWR);
   ::close(socket_);
   if (!IsAbstractSocket(server_address_)) {
@@ -522,6 +804,85 @@ void IPCServer::Loop() {
   socket_ = kInvalidSocket;
 }
 
+bool IPCServer::ProcessNewConnection(int socket, bool *error) {
+  pid_t pid = 0;
+  if (!IsPeerValid(socket, &pid)) {
+    return false;
+  }
+
+  // Peeks the first byte to tell the framed transport from the legacy one.
+  // An empty request of the legacy transport reaches the end of the stream.
+  char first_byte = 0;
+  if (IsReadTimeout(socket, timeout_)) {
+    LOG(WARNING) << "Read timeout " << timeout_;
+    return false;
+  }
+  const ssize_t peek_length = ::recv(socket, &first_byte, 1, MSG_PEEK);
+  if (peek_length < 0) {
+    LOG(ERROR) << "an error occurred during recv(): " << strerror(errno);
+    return false;
+  }
+  if (peek_length == 1 && first_byte == kFrameMagic[0]) {
+    return ProcessFramedRequest(socket, error);
+  }
+
+  IPCErrorType last_ipc_error = IPC_NO_ERROR;
+  size_t request_size = sizeof(request_);
+  size_t response_size = 0;
+  if (RecvMessage(socket,
+                  &request_[0],
+                  &request_size, timeout_, &last_ipc_error)) {
+    if (!ProcessWithBuffer(&request_[0], request_size,
+                           &response_buffer_, &response_size)) {
+      LOG(WARNING) << "Process() failed";
+      *error = true;
+    }
+    if (response_size > 0) {
+      SendMessage(socket,
+                  response_buffer_.data(),
+                  response_size, timeout_, &last_ipc_error);
+    }
+  }
+  return false;
+}
+
+bool IPCServer::ProcessFramedRequest(int socket, bool *error) {
+  IPCErrorType last_ipc_error = IPC_NO_ERROR;
+  FrameHeader header;
+  size_t received_size = 0;
+  if (!RecvFrameHeader(socket, &header, timeout_, &received_size,
+                       &last_ipc_error)) {
+    // The client has closed the connection if nothing is received.
+    return false;
+  }
+  if (header.size > sizeof(request_)) {
+    LOG(ERROR) << "too large request: " << header.size;
+    return false;
+  }
+  if (!RecvData(socket, &request_[0], header.size, timeout_, &received_size,
+                &last_ipc_error)) {
+    return false;
+  }
+
+  size_t response_size = 0;
+  if (!ProcessWithBuffer(&request_[0], header.size, &response_buffer_,
+                         &response_size)) {
+    LOG(WARNING) << "Process() failed";
+    *error = true;
+  }
+  // The response is sent even if it is empty, since the client waits for
+  // the frame header.
+  return SendFrame(socket, header.request_id, response_buffer_.data(),
+                   response_size, timeout_, &last_ipc_error);
+}
+
+void IPCServer::CloseConnections() {
+  for (size_t i = 0; i < connections_.size(); ++i) {
+    ::close(connections_[i]);
+  }
+  connections_.clear();
+}
+
 };  // namespace mozc
 
 #endif  // OS_LINUX
@@ -0,0 +1,392 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/bigram_index.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "base/base.h"
+#include "base/util.h"
+#include "dictionary/dictionary_token.h"
+
+namespace mozc {
+namespace {
+
+// Only the cheapest follow words are kept for each history.
+// DictionaryPredictor never shows more than this number of
+// bigram suggestions at once.
+const size_t kDefaultMaxFollowsSize = 128;
+
+// Katakana compounds shorter than this are not trusted as they
+// tend to be split at a non-word boundary ("アメ" + "リカ").
+const size_t kMinKatakanaCompoundLength = 6;
+
+template <typename T>
+void AppendStruct(const T &value, string *output) {
+  output->append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+Util::ScriptType GetFirstCharScriptType(const string &str) {
+  return Util::GetScriptType(Util::SubString(str, 0, 1));
+}
+
+Util::ScriptType GetLastCharScriptType(const string &str) {
+  const size_t size = Util::CharsLen(str);
+  DCHECK_GT(size, 0);
+  return Util::GetScriptType(Util::SubString(str, size - 1, 1));
+}
+
+struct HistoryEntryCompare {
+  bool operator()(const BigramIndex::HistoryEntry &entry,
+                  uint64 fingerprint) const {
+    return entry.fingerprint < fingerprint;
+  }
+};
+}  // namespace
+
+BigramIndex::BigramIndex()
+    : histories_(NULL), follows_(NULL), words_(NULL), strings_(NULL),
+      num_histories_(0), num_follows_(0), num_words_(0), strings_size_(0) {}
+
+BigramIndex::~BigramIndex() {}
+
+// static
+BigramIndex *BigramIndex::Create(const char *image, size_t size) {
+  if (image == NULL || size < sizeof(Header)) {
+    LOG(ERROR) << "Not enough bufsize: could not read header";
+    return NULL;
+  }
+  if (reinterpret_cast<size_t>(image) % kImageAlignment != 0) {
+    LOG(ERROR) << "The image is not aligned";
+    return NULL;
+  }
+
+  Header header;
+  memcpy(&header, image, sizeof(header));
+  if (header.magic != kMagic || header.version != kVersion) {
+    LOG(ERROR) << "Unknown bigram index format: " << header.magic
+               << " version: " << header.version;
+    return NULL;
+  }
+
+  const size_t expected_size =
+      sizeof(Header) +
+      sizeof(HistoryEntry) * header.num_histories +
+      sizeof(FollowEntry) * header.num_follows +
+      sizeof(WordEntry) * header.num_words +
+      header.strings_size;
+  if (size < expected_size) {
+    LOG(ERROR) << "Not enough bufsize: " << size << " < " << expected_size;
+    return NULL;
+  }
+
+  BigramIndex *index = new BigramIndex;
+  const char *ptr = image + sizeof(Header);
+  index->histories_ = reinterpret_cast<const HistoryEntry *>(ptr);
+  ptr += sizeof(HistoryEntry) * header.num_histories;
+  index->follows_ = reinterpret_cast<const FollowEntry *>(ptr);
+  ptr += sizeof(FollowEntry) * header.num_follows;
+  index->words_ = reinterpret_cast<const WordEntry *>(ptr);
+  ptr += sizeof(WordEntry) * header.num_words;
+  index->strings_ = ptr;
+  index->num_histories_ = header.num_histories;
+  index->num_follows_ = header.num_follows;
+  index->num_words_ = header.num_words;
+  index->strings_size_ = header.strings_size;
+  return index;
+}
+
+// static
+uint64 BigramIndex::GetHistoryFingerprint(const string &key,
+                                          const string &value) {
+  string history;
+  history.reserve(key.size() + value.size() + 1);
+  history.append(key);
+  history.append(1, '\t');
+  history.append(value);
+  return Util::Fingerprint(history);
+}
+
+bool BigramIndex::Lookup(const string &history_key,
+                         const string &history_value,
+                         const string &key_prefix,
+                         vector<Follow> *follows) const {
+  DCHECK(follows);
+  if (num_histories_ == 0) {
+    return false;
+  }
+
+  const uint64 fingerprint = GetHistoryFingerprint(history_key,
+                                                   history_value);
+  const HistoryEntry *end = histories_ + num_histories_;
+  const HistoryEntry *history = lower_bound(histories_, end, fingerprint,
+                                            HistoryEntryCompare());
+  if (history == end || history->fingerprint != fingerprint) {
+    return false;
+  }
+
+  const uint32 follow_end = history->follow_begin + history->follow_size;
+  if (follow_end > num_follows_) {
+    LOG(ERROR) << "Broken follow range: " << follow_end;
+    return false;
+  }
+
+  for (uint32 i = history->follow_begin; i < follow_end; ++i) {
+    const FollowEntry &follow = follows_[i];
+    if (follow.word_id >= num_words_) {
+      LOG(ERROR) << "Broken word id: " << follow.word_id;
+      continue;
+    }
+    const WordEntry &word = words_[follow.word_id];
+    if (word.key_offset + word.key_size > strings_size_ ||
+        word.value_offset + word.value_size > strings_size_) {
+      LOG(ERROR) << "Broken word entry: " << follow.word_id;
+      continue;
+    }
+    const char *key = strings_ + word.key_offset;
+    if (word.key_size < key_prefix.size() ||
+        memcmp(key, key_prefix.data(), key_prefix.size()) != 0) {
+      continue;
+    }
+    follows->push_back(Follow());
+    Follow *result = &follows->back();
+    result->key.assign(key, word.key_size);
+    result->value.assign(strings_ + word.value_offset, word.value_size);
+    result->lid = follow.lid;
+    result->rid = follow.rid;
+    result->cost = follow.cost;
+    result->flags = follow.flags;
+  }
+
+  return true;
+}
+
+BigramIndexBuilder::BigramIndexBuilder()
+    : max_follows_size_(kDefaultMaxFollowsSize) {}
+
+BigramIndexBuilder::~BigramIndexBuilder() {}
+
+void BigramIndexBuilder::AddTokens(const vector<Token *> &tokens) {
+  // (key, value) => minimum cost
+  map<KeyValue, int> word_costs;
+  // value => keys
+  map<string, vector<string> > value_to_keys;
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    const Token *token = tokens[i];
+    if (token->attributes & Token::SPELLING_CORRECTION) {
+      continue;
+    }
+    const KeyValue word(token->key, token->value);
+    map<KeyValue, int>::iterator it = word_costs.find(word);
+    if (it == word_costs.end()) {
+      word_costs.insert(make_pair(word, token->cost));
+      value_to_keys[token->value].push_back(token->key);
+    } else {
+      it->second = min(it->second, token->cost);
+    }
+  }
+
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    const Token *token = tokens[i];
+    if (token->attributes & Token::SPELLING_CORRECTION) {
+      continue;
+    }
+    const string &key = token->key;
+    const string &value = token->value;
+    const char *begin = value.data();
+    const char *end = value.data() + value.size();
+    // Enumerates all proper prefixes of |value| as history values.
+    for (const char *pos = begin + Util::OneCharLen(begin);
+         pos < end; pos += Util::OneCharLen(pos)) {
+      const string history_value(begin, pos);
+      map<string, vector<string> >::const_iterator keys_it =
+          value_to_keys.find(history_value);
+      if (keys_it == value_to_keys.end()) {
+        continue;
+      }
+      const string follow_value(pos, end);
+      for (size_t j = 0; j < keys_it->second.size(); ++j) {
+        const string &history_key = keys_it->second[j];
+        if (key.size() <= history_key.size() ||
+            !Util::StartsWith(key, history_key)) {
+          continue;
+        }
+        const string follow_key = key.substr(history_key.size());
+
+        // If freq("アメ") < freq("アメリカ"), we don't need to suggest it,
+        // as "アメリカ" should already be suggested when user types "アメ".
+        const int history_cost =
+            word_costs[KeyValue(history_key, history_value)];
+        if (history_cost > token->cost) {
+          continue;
+        }
+
+        // If character type doesn't change, this boundary might NOT
+        // be a word boundary.
+        const Util::ScriptType ctype = GetFirstCharScriptType(follow_value);
+        if (ctype == GetLastCharScriptType(history_value) &&
+            (ctype == Util::HIRAGANA ||
+             (ctype == Util::KATAKANA &&
+              Util::CharsLen(key) < kMinKatakanaCompoundLength))) {
+          continue;
+        }
+
+        // The follow word must exist in the dictionary, except for
+        // Kanji compounds which are used for zero query suggestion.
+        uint16 flags = 0;
+        if (word_costs.find(KeyValue(follow_key, follow_value)) !=
+            word_costs.end()) {
+          flags |= BigramIndex::IN_DICTIONARY;
+        } else if (ctype != Util::KANJI) {
+          continue;
+        }
+
+        AddEntry(history_key, history_value, follow_key, follow_value,
+                 token->lid, token->rid,
+                 static_cast<int16>(min(token->cost,
+                                        static_cast<int>(kint16max))),
+                 flags);
+      }
+    }
+  }
+}
+
+void BigramIndexBuilder::AddEntry(const string &history_key,
+                                  const string &history_value,
+                                  const string &follow_key,
+                                  const string &follow_value,
+                                  uint16 lid, uint16 rid, int16 cost,
+                                  uint16 flags) {
+  FollowInfo follow;
+  follow.word = KeyValue(follow_key, follow_value);
+  follow.lid = lid;
+  follow.rid = rid;
+  follow.cost = cost;
+  follow.flags = flags;
+  entries_[BigramIndex::GetHistoryFingerprint(
+      history_key, history_value)].push_back(follow);
+}
+
+namespace {
+struct FollowInfoCompare {
+  template <typename T>
+  bool operator()(const T &a, const T &b) const {
+    if (a.cost != b.cost) {
+      return a.cost < b.cost;
+    }
+    return a.word < b.word;
+  }
+};
+}  // namespace
+
+void BigramIndexBuilder::Build(string *image) const {
+  DCHECK(image);
+  vector<BigramIndex::HistoryEntry> histories;
+  vector<BigramIndex::FollowEntry> follows;
+  vector<BigramIndex::WordEntry> words;
+  map<KeyValue, uint32> word_ids;
+  string strings;
+
+  // |entries_| is a std::map, so histories are sorted by fingerprint.
+  for (map<uint64, vector<FollowInfo> >::const_iterator it =
+           entries_.begin(); it != entries_.end(); ++it) {
+    vector<FollowInfo> sorted_follows = it->second;
+    sort(sorted_follows.begin(), sorted_follows.end(), FollowInfoCompare());
+
+    BigramIndex::HistoryEntry history;
+    history.fingerprint = it->first;
+    history.follow_begin = follows.size();
+    history.follow_size = 0;
+    const FollowInfo *prev = NULL;
+    for (size_t i = 0; i < sorted_follows.size() &&
+             history.follow_size < max_follows_size_; ++i) {
+      const FollowInfo &info = sorted_follows[i];
+      // The same compound can appear with several POS.
+      if (prev != NULL && prev->word == info.word) {
+        continue;
+      }
+      prev = &info;
+
+      map<KeyValue, uint32>::const_iterator id_it = word_ids.find(info.word);
+      uint32 word_id = 0;
+      if (id_it != word_ids.end()) {
+        word_id = id_it->second;
+      } else {
+        word_id = words.size();
+        word_ids.insert(make_pair(info.word, word_id));
+        BigramIndex::WordEntry word;
+        word.key_offset = strings.size();
+        word.key_size = info.word.first.size();
+        strings.append(info.word.first);
+        word.value_offset = strings.size();
+        word.value_size = info.word.second.size();
+        strings.append(info.word.second);
+        words.push_back(word);
+      }
+
+      BigramIndex::FollowEntry follow;
+      follow.word_id = word_id;
+      follow.lid = info.lid;
+      follow.rid = info.rid;
+      follow.cost = info.cost;
+      follow.flags = info.flags;
+      follows.push_back(follow);
+      ++history.follow_size;
+    }
+    histories.push_back(history);
+  }
+
+  BigramIndex::Header header;
+  header.magic = BigramIndex::kMagic;
+  header.version = BigramIndex::kVersion;
+  header.num_histories = histories.size();
+  header.num_follows = follows.size();
+  header.num_words = words.size();
+  header.strings_size = strings.size();
+
+  image->clear();
+  AppendStruct(header, image);
+  for (size_t i = 0; i < histories.size(); ++i) {
+    AppendStruct(histories[i], image);
+  }
+  for (size_t i = 0; i < follows.size(); ++i) {
+    AppendStruct(follows[i], image);
+  }
+  for (size_t i = 0; i < words.size(); ++i) {
+    AppendStruct(words[i], image);
+  }
+  image->append(strings);
+
+  LOG(INFO) << "bigram index: " << histories.size() << " histories, "
+            << follows.size() << " follows, " << words.size() << " words, "
+            << image->size() << " bytes";
+}
+}  // namespace mozc
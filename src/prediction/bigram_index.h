@@ -0,0 +1,211 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Compact index for bigram prediction.
+//
+// DictionaryPredictor suggests the rest of a compound word from the previous
+// word the user committed ("グーグル" -> "アドセンス").  Without this index it
+// does a predictive lookup on history_key + input_key and drops most of the
+// returned nodes.  The index is built from the system dictionary at build
+// time: for every compound entry whose key/value can be split into a history
+// word and a follow word, the follow word is recorded under the history word.
+//
+// Image layout (all integers are little endian):
+//   Header
+//   HistoryEntry[num_histories]  sorted by fingerprint of "key\tvalue"
+//   FollowEntry[num_follows]     grouped by history, sorted by cost
+//   WordEntry[num_words]         follow words, referred by FollowEntry
+//   char strings[strings_size]   key/value bytes of WordEntry
+
+#ifndef MOZC_PREDICTION_BIGRAM_INDEX_H_
+#define MOZC_PREDICTION_BIGRAM_INDEX_H_
+
+#include <map>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "base/base.h"
+
+namespace mozc {
+
+struct Token;
+
+class BigramIndex {
+ public:
+  static const uint32 kMagic = 0x4d424958;  // "MBIX"
+  static const uint32 kVersion = 1;
+  // The image is read in place, so it has to be aligned for HistoryEntry.
+  static const size_t kImageAlignment = 8;
+
+  enum FollowFlag {
+    // The follow word itself exists in the dictionary.  Follow words
+    // without this flag (Kanji compounds) are used only for zero query
+    // suggestion.
+    IN_DICTIONARY = 1,
+  };
+
+  struct Header {
+    uint32 magic;
+    uint32 version;
+    uint32 num_histories;
+    uint32 num_follows;
+    uint32 num_words;
+    uint32 strings_size;
+  };
+
+  struct HistoryEntry {
+    uint64 fingerprint;
+    uint32 follow_begin;
+    uint32 follow_size;
+  };
+
+  // |lid|, |rid| and |cost| are the ones of the whole compound word.
+  struct FollowEntry {
+    uint32 word_id;
+    uint16 lid;
+    uint16 rid;
+    int16 cost;
+    uint16 flags;
+  };
+
+  struct WordEntry {
+    uint32 key_offset;
+    uint32 value_offset;
+    uint16 key_size;
+    uint16 value_size;
+  };
+
+  // Follow word decoded from the image.
+  struct Follow {
+    string key;
+    string value;
+    uint16 lid;
+    uint16 rid;
+    int16 cost;
+    uint16 flags;
+  };
+
+  // Returns NULL if |image| is broken or is not aligned to
+  // kImageAlignment bytes.  |image| must outlive the index.
+  static BigramIndex *Create(const char *image, size_t size);
+
+  ~BigramIndex();
+
+  // Appends the follow words of (|history_key|, |history_value|) whose key
+  // starts with |key_prefix| to |follows| in ascending order of cost.
+  // Returns false if the history is not in the index.
+  bool Lookup(const string &history_key, const string &history_value,
+              const string &key_prefix, vector<Follow> *follows) const;
+
+  bool empty() const {
+    return num_histories_ == 0;
+  }
+
+  // Fingerprint used as the key of HistoryEntry.
+  static uint64 GetHistoryFingerprint(const string &key, const string &value);
+
+ private:
+  BigramIndex();
+
+  const HistoryEntry *histories_;
+  const FollowEntry *follows_;
+  const WordEntry *words_;
+  const char *strings_;
+  uint32 num_histories_;
+  uint32 num_follows_;
+  uint32 num_words_;
+  uint32 strings_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(BigramIndex);
+};
+
+class BigramIndexBuilder {
+ public:
+  BigramIndexBuilder();
+  ~BigramIndexBuilder();
+
+  // Extracts history/follow pairs from compound words in |tokens|.
+  // A token "ぐーぐるあどせんす/グーグルアドセンス" is registered as a follow
+  // word "あどせんす/アドセンス" of "ぐーぐる/グーグル" when "ぐーぐる/グーグル"
+  // is also in |tokens|.  The filters DictionaryPredictor used to apply on
+  // every lookup are applied here.
+  void AddTokens(const vector<Token *> &tokens);
+
+  // Adds one history/follow pair.  Exposed for unittesting.
+  void AddEntry(const string &history_key, const string &history_value,
+                const string &follow_key, const string &follow_value,
+                uint16 lid, uint16 rid, int16 cost, uint16 flags);
+
+  // Only the |size| cheapest follow words are kept for each history.
+  void set_max_follows_size(size_t size) {
+    max_follows_size_ = size;
+  }
+
+  size_t histories_size() const {
+    return entries_.size();
+  }
+
+  // Serializes the index into |image|.
+  void Build(string *image) const;
+
+ private:
+  typedef pair<string, string> KeyValue;
+  struct FollowInfo {
+    KeyValue word;
+    uint16 lid;
+    uint16 rid;
+    int16 cost;
+    uint16 flags;
+  };
+
+  map<uint64, vector<FollowInfo> > entries_;
+  size_t max_follows_size_;
+
+  DISALLOW_COPY_AND_ASSIGN(BigramIndexBuilder);
+};
+
+class BigramIndexFactory {
+ public:
+  // Returns the index built from the embedded system dictionary.
+  // Returns NULL when no index is available, e.g., when the dictionary
+  // is loaded from a separate file.
+  static const BigramIndex *GetBigramIndex();
+
+  // Dependency injection for unittesting.
+  static void SetBigramIndex(const BigramIndex *index);
+
+ private:
+  BigramIndexFactory() {}
+  ~BigramIndexFactory() {}
+};
+}  // namespace mozc
+
+#endif  // MOZC_PREDICTION_BIGRAM_INDEX_H_
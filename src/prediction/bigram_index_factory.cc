@@ -0,0 +1,94 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/bigram_index.h"
+
+#include <string.h>
+
+#include "base/base.h"
+#include "base/singleton.h"
+
+namespace mozc {
+namespace {
+
+#ifdef MOZC_USE_SEPARATE_DICTIONARY
+// The index must be built from the same dictionary as the one in use.
+const char *kBigramIndexData_data = NULL;
+const size_t kBigramIndexData_size = 0;
+#else
+#include "prediction/bigram_index_data.h"
+#endif  // MOZC_USE_SEPARATE_DICTIONARY
+
+const BigramIndex *g_bigram_index = NULL;
+
+class EmbeddedBigramIndex {
+ public:
+  EmbeddedBigramIndex() {
+    if (kBigramIndexData_size == 0) {
+      return;
+    }
+    // kBigramIndexData_data and kBigramIndexData_size
+    // are defined in bigram_index_data.h
+    const char *image = kBigramIndexData_data;
+    if (reinterpret_cast<size_t>(image) % BigramIndex::kImageAlignment != 0) {
+      // The compiler ignored the alignment of the generated array.
+      LOG(WARNING) << "Copying the unaligned BigramIndexData";
+      aligned_image_.reset(
+          new uint64[(kBigramIndexData_size + sizeof(uint64) - 1) /
+                     sizeof(uint64)]);
+      memcpy(aligned_image_.get(), image, kBigramIndexData_size);
+      image = reinterpret_cast<const char *>(aligned_image_.get());
+    }
+    index_.reset(BigramIndex::Create(image, kBigramIndexData_size));
+    LOG_IF(ERROR, index_.get() == NULL) << "BigramIndexData is broken";
+  }
+
+  const BigramIndex *get() const {
+    return index_.get();
+  }
+
+ private:
+  scoped_array<uint64> aligned_image_;
+  scoped_ptr<BigramIndex> index_;
+};
+}  // namespace
+
+const BigramIndex *BigramIndexFactory::GetBigramIndex() {
+  if (g_bigram_index == NULL) {
+    return Singleton<EmbeddedBigramIndex>::get()->get();
+  } else {
+    return g_bigram_index;
+  }
+}
+
+void BigramIndexFactory::SetBigramIndex(const BigramIndex *index) {
+  g_bigram_index = index;
+}
+}  // namespace mozc
@@ -0,0 +1,267 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "prediction/bigram_index.h"
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/util.h"
+#include "dictionary/dictionary_token.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+// "ぐーぐる", "グーグル"
+const char kGoogleKey[] = "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B";
+const char kGoogleValue[] =
+    "\xE3\x82\xB0\xE3\x83\xBC\xE3\x82\xB0\xE3\x83\xAB";
+// "あどせんす", "アドセンス"
+const char kAdsenseKey[] =
+    "\xE3\x81\x82\xE3\x81\xA9\xE3\x81\x9B\xE3\x82\x93\xE3\x81\x99";
+const char kAdsenseValue[] =
+    "\xE3\x82\xA2\xE3\x83\x89\xE3\x82\xBB\xE3\x83\xB3\xE3\x82\xB9";
+// "あどわーず", "アドワーズ"
+const char kAdwordsKey[] =
+    "\xE3\x81\x82\xE3\x81\xA9\xE3\x82\x8F\xE3\x83\xBC\xE3\x81\x9A";
+const char kAdwordsValue[] =
+    "\xE3\x82\xA2\xE3\x83\x89\xE3\x83\xAF\xE3\x83\xBC\xE3\x82\xBA";
+// "きょうとだいがく", "京都大学"
+const char kKyotoKey[] =
+    "\xE3\x81\x8D\xE3\x82\x87\xE3\x81\x86\xE3\x81\xA8"
+    "\xE3\x81\xA0\xE3\x81\x84\xE3\x81\x8C\xE3\x81\x8F";
+const char kKyotoValue[] = "\xE4\xBA\xAC\xE9\x83\xBD\xE5\xA4\xA7\xE5\xAD\xA6";
+// "れいちょうるいけんきゅうじょ", "霊長類研究所"
+const char kPrimateKey[] =
+    "\xE3\x82\x8C\xE3\x81\x84\xE3\x81\xA1\xE3\x82\x87\xE3\x81\x86"
+    "\xE3\x82\x8B\xE3\x81\x84\xE3\x81\x91\xE3\x82\x93\xE3\x81\x8D"
+    "\xE3\x82\x85\xE3\x81\x86\xE3\x81\x98\xE3\x82\x87";
+const char kPrimateValue[] =
+    "\xE9\x9C\x8A\xE9\x95\xB7\xE9\xA1\x9E\xE7\xA0\x94\xE7\xA9\xB6\xE6\x89\x80";
+
+Token *MakeToken(const string &key, const string &value, int cost) {
+  Token *token = new Token;
+  token->key = key;
+  token->value = value;
+  token->lid = 10;
+  token->rid = 20;
+  token->cost = cost;
+  return token;
+}
+
+class BigramIndexTest : public testing::Test {
+ protected:
+  virtual void TearDown() {
+    for (size_t i = 0; i < tokens_.size(); ++i) {
+      delete tokens_[i];
+    }
+    tokens_.clear();
+  }
+
+  void AddToken(const string &key, const string &value, int cost) {
+    tokens_.push_back(MakeToken(key, value, cost));
+  }
+
+  vector<Token *> tokens_;
+};
+
+TEST_F(BigramIndexTest, EmptyIndex) {
+  BigramIndexBuilder builder;
+  string image;
+  builder.Build(&image);
+
+  scoped_ptr<BigramIndex> index(BigramIndex::Create(image.data(),
+                                                    image.size()));
+  ASSERT_TRUE(index.get() != NULL);
+  EXPECT_TRUE(index->empty());
+  vector<BigramIndex::Follow> follows;
+  EXPECT_FALSE(index->Lookup(kGoogleKey, kGoogleValue, "", &follows));
+  EXPECT_TRUE(follows.empty());
+}
+
+TEST_F(BigramIndexTest, BrokenImage) {
+  EXPECT_TRUE(BigramIndex::Create(NULL, 0) == NULL);
+
+  BigramIndexBuilder builder;
+  builder.AddEntry(kGoogleKey, kGoogleValue, kAdsenseKey, kAdsenseValue,
+                   1, 2, 3000, BigramIndex::IN_DICTIONARY);
+  string image;
+  builder.Build(&image);
+  EXPECT_TRUE(BigramIndex::Create(image.data(), image.size() - 1) == NULL);
+
+  string wrong_magic = image;
+  wrong_magic[0] ^= 0xFF;
+  EXPECT_TRUE(BigramIndex::Create(wrong_magic.data(),
+                                  wrong_magic.size()) == NULL);
+
+  string misaligned = " " + image;
+  EXPECT_TRUE(BigramIndex::Create(misaligned.data() + 1,
+                                  image.size()) == NULL);
+}
+
+TEST_F(BigramIndexTest, AddEntryAndLookup) {
+  BigramIndexBuilder builder;
+  builder.AddEntry(kGoogleKey, kGoogleValue, kAdwordsKey, kAdwordsValue,
+                   1, 2, 4000, BigramIndex::IN_DICTIONARY);
+  builder.AddEntry(kGoogleKey, kGoogleValue, kAdsenseKey, kAdsenseValue,
+                   3, 4, 3000, BigramIndex::IN_DICTIONARY);
+  builder.AddEntry(kKyotoKey, kKyotoValue, kPrimateKey, kPrimateValue,
+                   5, 6, 5000, 0);
+  EXPECT_EQ(2, builder.histories_size());
+
+  string image;
+  builder.Build(&image);
+  scoped_ptr<BigramIndex> index(BigramIndex::Create(image.data(),
+                                                    image.size()));
+  ASSERT_TRUE(index.get() != NULL);
+  EXPECT_FALSE(index->empty());
+
+  {
+    vector<BigramIndex::Follow> follows;
+    EXPECT_TRUE(index->Lookup(kGoogleKey, kGoogleValue, "", &follows));
+    ASSERT_EQ(2, follows.size());
+    // Sorted by cost.
+    EXPECT_EQ(kAdsenseKey, follows[0].key);
+    EXPECT_EQ(kAdsenseValue, follows[0].value);
+    EXPECT_EQ(3, follows[0].lid);
+    EXPECT_EQ(4, follows[0].rid);
+    EXPECT_EQ(3000, follows[0].cost);
+    EXPECT_EQ(BigramIndex::IN_DICTIONARY, follows[0].flags);
+    EXPECT_EQ(kAdwordsKey, follows[1].key);
+    EXPECT_EQ(kAdwordsValue, follows[1].value);
+    EXPECT_EQ(4000, follows[1].cost);
+  }
+
+  {
+    // "あどわ"
+    vector<BigramIndex::Follow> follows;
+    EXPECT_TRUE(index->Lookup(kGoogleKey, kGoogleValue,
+                              "\xE3\x81\x82\xE3\x81\xA9\xE3\x82\x8F",
+                              &follows));
+    ASSERT_EQ(1, follows.size());
+    EXPECT_EQ(kAdwordsValue, follows[0].value);
+  }
+
+  {
+    vector<BigramIndex::Follow> follows;
+    EXPECT_TRUE(index->Lookup(kKyotoKey, kKyotoValue, "", &follows));
+    ASSERT_EQ(1, follows.size());
+    EXPECT_EQ(kPrimateValue, follows[0].value);
+    EXPECT_EQ(0, follows[0].flags);
+  }
+
+  {
+    // History key/value must match exactly.
+    vector<BigramIndex::Follow> follows;
+    EXPECT_FALSE(index->Lookup(kGoogleKey, kKyotoValue, "", &follows));
+    EXPECT_FALSE(index->Lookup(kGoogleKey, "", "", &follows));
+    EXPECT_TRUE(follows.empty());
+  }
+}
+
+TEST_F(BigramIndexTest, MaxFollowsSize) {
+  BigramIndexBuilder builder;
+  builder.set_max_follows_size(1);
+  builder.AddEntry(kGoogleKey, kGoogleValue, kAdwordsKey, kAdwordsValue,
+                   1, 2, 4000, BigramIndex::IN_DICTIONARY);
+  builder.AddEntry(kGoogleKey, kGoogleValue, kAdsenseKey, kAdsenseValue,
+                   3, 4, 3000, BigramIndex::IN_DICTIONARY);
+  string image;
+  builder.Build(&image);
+  scoped_ptr<BigramIndex> index(BigramIndex::Create(image.data(),
+                                                    image.size()));
+  ASSERT_TRUE(index.get() != NULL);
+
+  vector<BigramIndex::Follow> follows;
+  EXPECT_TRUE(index->Lookup(kGoogleKey, kGoogleValue, "", &follows));
+  ASSERT_EQ(1, follows.size());
+  EXPECT_EQ(kAdsenseValue, follows[0].value);
+}
+
+TEST_F(BigramIndexTest, AddTokens) {
+  AddToken(kGoogleKey, kGoogleValue, 3000);
+  AddToken(kAdsenseKey, kAdsenseValue, 4000);
+  AddToken(string(kGoogleKey) + kAdsenseKey,
+           string(kGoogleValue) + kAdsenseValue, 5000);
+  // The follow word is not in the dictionary.
+  AddToken(string(kGoogleKey) + kAdwordsKey,
+           string(kGoogleValue) + kAdwordsValue, 5000);
+  AddToken(kKyotoKey, kKyotoValue, 3000);
+  // Kanji compound is kept even if the follow word is not in the dictionary.
+  AddToken(string(kKyotoKey) + kPrimateKey,
+           string(kKyotoValue) + kPrimateValue, 6000);
+
+  // "あめ", "アメ", "りか", "リカ", "あめりか", "アメリカ"
+  const char kAmeKey[] = "\xE3\x81\x82\xE3\x82\x81";
+  const char kAmeValue[] = "\xE3\x82\xA2\xE3\x83\xA1";
+  const char kRikaKey[] = "\xE3\x82\x8A\xE3\x81\x8B";
+  const char kRikaValue[] = "\xE3\x83\xAA\xE3\x82\xAB";
+  AddToken(kAmeKey, kAmeValue, 7000);
+  AddToken(kRikaKey, kRikaValue, 7000);
+  // Short Katakana compound is not split.
+  AddToken(string(kAmeKey) + kRikaKey, string(kAmeValue) + kRikaValue, 3000);
+
+  BigramIndexBuilder builder;
+  builder.AddTokens(tokens_);
+  string image;
+  builder.Build(&image);
+  scoped_ptr<BigramIndex> index(BigramIndex::Create(image.data(),
+                                                    image.size()));
+  ASSERT_TRUE(index.get() != NULL);
+
+  {
+    vector<BigramIndex::Follow> follows;
+    EXPECT_TRUE(index->Lookup(kGoogleKey, kGoogleValue, "", &follows));
+    ASSERT_EQ(1, follows.size());
+    EXPECT_EQ(kAdsenseKey, follows[0].key);
+    EXPECT_EQ(kAdsenseValue, follows[0].value);
+    EXPECT_EQ(10, follows[0].lid);
+    EXPECT_EQ(20, follows[0].rid);
+    EXPECT_EQ(5000, follows[0].cost);
+    EXPECT_EQ(BigramIndex::IN_DICTIONARY, follows[0].flags);
+  }
+
+  {
+    vector<BigramIndex::Follow> follows;
+    EXPECT_TRUE(index->Lookup(kKyotoKey, kKyotoValue, "", &follows));
+    ASSERT_EQ(1, follows.size());
+    EXPECT_EQ(kPrimateValue, follows[0].value);
+    EXPECT_EQ(0, follows[0].flags);
+  }
+
+  {
+    vector<BigramIndex::Follow> follows;
+    EXPECT_FALSE(index->Lookup(kAmeKey, kAmeValue, "", &follows));
+  }
+}
+}  // namespace
+}  // namespace mozc
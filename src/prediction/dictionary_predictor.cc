@@ -57,6 +57,7 @@
 #include "dictionary/dictionary_interface.h"
 #include "dictionary/pos_matcher.h"
 #include "dictionary/suffix_dictionary.h"
+#include "prediction/bigram_index.h"
 #include "prediction/predictor_interface.h"
 #include "prediction/suggestion_filter.h"
 #include "session/commands.pb.h"
@@ -83,7 +84,8 @@ DictionaryPredictor::DictionaryPredictor()
       connector_(ConnectorFactory::GetConnector()),
       segmenter_(Singleton<Segmenter>::get()),
       immutable_converter_(
-          ImmutableConverterFactory::GetImmutableConverter()) {}
+          ImmutableConverterFactory::GetImmutableConverter()),
+      bigram_index_(BigramIndexFactory::GetBigramIndex()) {}
 
 DictionaryPredictor::DictionaryPredictor(SegmenterInterface *segmenter)
     : dictionary_(DictionaryFactory::GetDictionary()),
@@ -91,7 +93,8 @@ DictionaryPredictor::DictionaryPredictor(SegmenterInterface *segmenter)
       connector_(ConnectorFactory::GetConnector()),
       segmenter_(segmenter),
       immutable_converter_(
-          ImmutableConverterFactory::GetImmutableConverter()) {}
+          ImmutableConverterFactory::GetImmutableConverter()),
+      bigram_index_(BigramIndexFactory::GetBigramIndex()) {}
 
 DictionaryPredictor::~DictionaryPredictor() {}
 
@@ -273,9 +276,9 @@ bool DictionaryPredictor::AddPredictionToCandidates(
     DCHECK(candidate);
 
     candidate->Init();
-    candidate->content_key = key;
-    candidate->content_value = value;
     candidate->key = key;
+    candidate->content_key = candidate->key;
+    candidate->content_value = value;
     candidate->value = value;
     candidate->lid = node->lid;
     candidate->rid = node->rid;
@@ -806,6 +809,14 @@ void DictionaryPredictor::AggregateBigramPrediction(
   string history_key, history_value;
   GetHistoryKeyAndValue(*segments, &history_key, &history_value);
 
+  // The precomputed index already has the filters below applied.
+  if (bigram_index_ != NULL && !bigram_index_->empty()) {
+    AggregateBigramPredictionFromIndex(request, *segments,
+                                       history_key, history_value,
+                                       allocator, results);
+    return;
+  }
+
   // Check that history_key/history_value are in the dictionary.
   const Node *history_node = LookupKeyValueFromDictionary(
       history_key, history_value, allocator);
@@ -913,6 +924,78 @@ void DictionaryPredictor::AggregateBigramPrediction(
   }
 }
 
+void DictionaryPredictor::AggregateBigramPredictionFromIndex(
+    const ConversionRequest &request,
+    const Segments &segments,
+    const string &history_key,
+    const string &history_value,
+    NodeAllocatorInterface *allocator,
+    vector<Result> *results) const {
+  DCHECK(bigram_index_);
+  DCHECK(allocator);
+  DCHECK(results);
+
+  const string &input_key = segments.conversion_segment(0).key();
+  const bool is_zero_query = input_key.empty();
+
+  // If we have ambiguity for the input, the follow key must start with
+  // |base| followed by one of |expanded|.
+  string base = input_key;
+  set<string> expanded;
+  if (request.has_composer() &&
+      FLAGS_enable_expansion_for_dictionary_predictor) {
+    base.clear();
+    request.composer().GetQueriesForPrediction(&base, &expanded);
+  }
+
+  vector<BigramIndex::Follow> follows;
+  if (!bigram_index_->Lookup(history_key, history_value, base, &follows)) {
+    return;
+  }
+
+  const size_t max_nodes_size =
+      (segments.request_type() == Segments::PREDICTION) ?
+      kPredictionMaxNodesSize : kSuggestionMaxNodesSize;
+  const size_t prev_results_size = results->size();
+
+  for (size_t i = 0; i < follows.size(); ++i) {
+    const BigramIndex::Follow &follow = follows[i];
+    // Kanji compounds not in the dictionary are suggested only
+    // for zero query suggestion.
+    if (!(follow.flags & BigramIndex::IN_DICTIONARY) && !is_zero_query) {
+      continue;
+    }
+    if (!expanded.empty()) {
+      bool match = false;
+      for (set<string>::const_iterator it = expanded.begin();
+           it != expanded.end(); ++it) {
+        if (follow.key.compare(base.size(), it->size(), *it) == 0) {
+          match = true;
+          break;
+        }
+      }
+      if (!match) {
+        continue;
+      }
+    }
+
+    Node *node = allocator->NewNode();
+    DCHECK(node);
+    node->Init();
+    node->key = history_key + follow.key;
+    node->value = history_value + follow.value;
+    node->lid = follow.lid;
+    node->rid = follow.rid;
+    node->wcost = follow.cost;
+    results->push_back(Result(node, BIGRAM));
+  }
+
+  // See AggregateBigramPrediction for why too many results are dropped.
+  if (results->size() - prev_results_size >= max_nodes_size) {
+    results->resize(prev_results_size);
+  }
+}
+
 const Node *DictionaryPredictor::GetPredictiveNodes(
     const DictionaryInterface *dictionary,
     const string &history_key,
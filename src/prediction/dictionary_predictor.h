@@ -39,6 +39,7 @@
 
 namespace mozc {
 
+class BigramIndex;
 class ConnectorInterface;
 class ConversionRequest;
 class DictionaryInterface;
@@ -128,6 +129,7 @@ class DictionaryPredictor: public PredictorInterface {
   FRIEND_TEST(DictionaryPredictorTest, GetUnigramCandidateCutoffThreshold);
   FRIEND_TEST(DictionaryPredictorTest, AggregateUnigramPrediction);
   FRIEND_TEST(DictionaryPredictorTest, AggregateBigramPrediction);
+  FRIEND_TEST(DictionaryPredictorTest, AggregateBigramPredictionWithIndex);
   FRIEND_TEST(DictionaryPredictorTest, AggregateSuffixPrediction);
   FRIEND_TEST(DictionaryPredictorTest, ZeroQuerySuggestionAfterNumbers);
   FRIEND_TEST(DictionaryPredictorTest, GetHistoryKeyAndValue);
@@ -163,6 +165,15 @@ class DictionaryPredictor: public PredictorInterface {
   bool AddPredictionToCandidates(Segments *segments,
                                  vector<Result> *results) const;
 
+  // Aggregates bigram results from |bigram_index_| instead of
+  // a predictive lookup on the history key.
+  void AggregateBigramPredictionFromIndex(const ConversionRequest &request,
+                                          const Segments &segments,
+                                          const string &history_key,
+                                          const string &history_value,
+                                          NodeAllocatorInterface *allocator,
+                                          vector<Result> *results) const;
+
   const Node *GetPredictiveNodes(const DictionaryInterface *dictionary,
                                  const string &history_key,
                                  const ConversionRequest &request,
@@ -281,6 +292,7 @@ class DictionaryPredictor: public PredictorInterface {
   ConnectorInterface *connector_;
   const SegmenterInterface *segmenter_;
   ImmutableConverterInterface *immutable_converter_;
+  const BigramIndex *bigram_index_;
 };
 }  // namespace mozc
 
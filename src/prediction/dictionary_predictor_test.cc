@@ -45,6 +45,7 @@
 #include "dictionary/dictionary_mock.h"
 #include "dictionary/suffix_dictionary.h"
 #include "dictionary/pos_matcher.h"
+#include "prediction/bigram_index.h"
 #include "session/commands.pb.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gmock.h"
@@ -85,6 +86,7 @@ class DictionaryPredictorTest : public testing::Test {
 
   virtual ~DictionaryPredictorTest() {
     FLAGS_enable_expansion_for_dictionary_predictor = default_expansion_flag_;
+    BigramIndexFactory::SetBigramIndex(NULL);
   }
 
  protected:
@@ -96,6 +98,13 @@ class DictionaryPredictorTest : public testing::Test {
     GetMockDic()->ClearAll();
     AddWordsToMockDic();
     DictionaryFactory::SetDictionary(GetMockDic());
+    // The embedded bigram index doesn't match the mock dictionary.
+    // An empty index makes DictionaryPredictor look up the dictionary.
+    BigramIndexBuilder().Build(&empty_bigram_index_image_);
+    empty_bigram_index_.reset(
+        BigramIndex::Create(empty_bigram_index_image_.data(),
+                            empty_bigram_index_image_.size()));
+    BigramIndexFactory::SetBigramIndex(empty_bigram_index_.get());
   }
 
   DictionaryMock *GetMockDic() {
@@ -204,6 +213,8 @@ class DictionaryPredictorTest : public testing::Test {
  private:
   config::Config default_config_;
   const bool default_expansion_flag_;
+  string empty_bigram_index_image_;
+  scoped_ptr<BigramIndex> empty_bigram_index_;
 };
 
 void MakeSegmentsForSuggestion(const string key,
@@ -527,6 +538,88 @@ TEST_F(DictionaryPredictorTest,
   }
 }
 
+TEST_F(DictionaryPredictorTest, AggregateBigramPredictionWithIndex) {
+  // "ぐーぐる", "グーグル"
+  const char kHistoryKey[] =
+      "\xE3\x81\x90\xE3\x83\xBC\xE3\x81\x90\xE3\x82\x8B";
+  const char kHistoryValue[] =
+      "\xE3\x82\xB0\xE3\x83\xBC\xE3\x82\xB0\xE3\x83\xAB";
+  // "あどせんす", "アドセンス"
+  const char kAdsenseKey[] =
+      "\xE3\x81\x82\xE3\x81\xA9\xE3\x81\x9B\xE3\x82\x93\xE3\x81\x99";
+  const char kAdsenseValue[] =
+      "\xE3\x82\xA2\xE3\x83\x89\xE3\x82\xBB\xE3\x83\xB3\xE3\x82\xB9";
+  // "けんさく", "検索"
+  const char kSearchKey[] =
+      "\xE3\x81\x91\xE3\x82\x93\xE3\x81\x95\xE3\x81\x8F";
+  const char kSearchValue[] = "\xE6\xA4\x9C\xE7\xB4\xA2";
+
+  BigramIndexBuilder builder;
+  builder.AddEntry(kHistoryKey, kHistoryValue, kAdsenseKey, kAdsenseValue,
+                   10, 20, 3000, BigramIndex::IN_DICTIONARY);
+  // Kanji compound which is not in the dictionary.
+  builder.AddEntry(kHistoryKey, kHistoryValue, kSearchKey, kSearchValue,
+                   30, 40, 4000, 0);
+  string image;
+  builder.Build(&image);
+  scoped_ptr<BigramIndex> index(BigramIndex::Create(image.data(),
+                                                    image.size()));
+  ASSERT_TRUE(index.get() != NULL);
+  BigramIndexFactory::SetBigramIndex(index.get());
+
+  DictionaryPredictor predictor;
+  NodeAllocator allocator;
+  ConversionRequest dummy_request;
+
+  {
+    Segments segments;
+    // "あ"
+    MakeSegmentsForSuggestion("\xE3\x81\x82", &segments);
+    PrependHistorySegments(kHistoryKey, kHistoryValue, &segments);
+
+    vector<DictionaryPredictor::Result> results;
+    predictor.AggregateBigramPrediction(
+        DictionaryPredictor::BIGRAM,
+        dummy_request, &segments, &allocator, &results);
+    ASSERT_EQ(1, results.size());
+    EXPECT_EQ(DictionaryPredictor::BIGRAM, results[0].type);
+    EXPECT_EQ(string(kHistoryKey) + kAdsenseKey, results[0].node->key);
+    EXPECT_EQ(string(kHistoryValue) + kAdsenseValue, results[0].node->value);
+    EXPECT_EQ(10, results[0].node->lid);
+    EXPECT_EQ(20, results[0].node->rid);
+    EXPECT_EQ(3000, results[0].node->wcost);
+  }
+
+  {
+    // Zero query suggestion also returns the Kanji compound.
+    Segments segments;
+    MakeSegmentsForSuggestion("", &segments);
+    PrependHistorySegments(kHistoryKey, kHistoryValue, &segments);
+
+    vector<DictionaryPredictor::Result> results;
+    predictor.AggregateBigramPrediction(
+        DictionaryPredictor::BIGRAM,
+        dummy_request, &segments, &allocator, &results);
+    ASSERT_EQ(2, results.size());
+    EXPECT_EQ(string(kHistoryValue) + kAdsenseValue, results[0].node->value);
+    EXPECT_EQ(string(kHistoryValue) + kSearchValue, results[1].node->value);
+  }
+
+  {
+    // "てす", "テス" is not in the index.
+    Segments segments;
+    MakeSegmentsForSuggestion("\xE3\x81\x82", &segments);
+    PrependHistorySegments("\xE3\x81\xA6\xE3\x81\x99",
+                           "\xE3\x83\x86\xE3\x82\xB9", &segments);
+
+    vector<DictionaryPredictor::Result> results;
+    predictor.AggregateBigramPrediction(
+        DictionaryPredictor::BIGRAM,
+        dummy_request, &segments, &allocator, &results);
+    EXPECT_TRUE(results.empty());
+  }
+}
+
 TEST_F(DictionaryPredictorTest, GetRealtimeCandidateMaxSize) {
   DictionaryPredictor predictor;
   Segments segments;
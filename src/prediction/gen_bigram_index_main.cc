@@ -0,0 +1,93 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Generates the bigram index for DictionaryPredictor from the
+// system dictionary source files.
+//
+// gen_bigram_index_main
+//  --input="dictionary0.txt dictionary1.txt"
+//  --output="bigram_index_data.h"
+//  --make_header
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/codegen_bytearray_stream.h"
+#include "base/file_stream.h"
+#include "base/util.h"
+#include "dictionary/dictionary_token.h"
+#include "dictionary/text_dictionary_loader.h"
+#include "prediction/bigram_index.h"
+
+DEFINE_string(input, "", "space separated input text files");
+DEFINE_string(output, "", "output binary file");
+DEFINE_bool(make_header, false, "make header mode");
+DEFINE_int32(max_follows_size, 128,
+             "max number of follow words for each history word");
+DEFINE_string(name, "BigramIndexData",
+              "name for variable name in the header file");
+
+int main(int argc, char **argv) {
+  InitGoogle(argv[0], &argc, &argv, false);
+
+  vector<string> input_files;
+  mozc::Util::SplitStringUsing(FLAGS_input, " ", &input_files);
+  string input;
+  mozc::Util::JoinStrings(input_files, ",", &input);
+
+  mozc::TextDictionaryLoader loader;
+  CHECK(loader.Open(input.c_str())) << "cannot open: " << input;
+  vector<mozc::Token *> tokens;
+  loader.CollectTokens(&tokens);
+
+  mozc::BigramIndexBuilder builder;
+  builder.set_max_follows_size(FLAGS_max_follows_size);
+  builder.AddTokens(tokens);
+
+  string image;
+  builder.Build(&image);
+
+  LOG(INFO) << "writing bigram index: " << FLAGS_output;
+  if (FLAGS_make_header) {
+    mozc::OutputFileStream ofs(FLAGS_output.c_str());
+    mozc::CodeGenByteArrayOutputStream codegen_stream(
+        &ofs, mozc::codegenstream::NOT_OWN_STREAM);
+    codegen_stream.OpenVarDef(FLAGS_name, mozc::BigramIndex::kImageAlignment);
+    codegen_stream.write(image.data(), image.size());
+    codegen_stream.CloseVarDef();
+  } else {
+    mozc::OutputFileStream ofs(FLAGS_output.c_str(),
+                               ios::out | ios::trunc | ios::binary);
+    ofs.write(image.data(), image.size());
+  }
+
+  return 0;
+}
@@ -42,6 +42,9 @@ DEFINE_bool(header, true,
             "make header file instead of raw bloom filter");
 DEFINE_string(name, "SuggestionFilterData",
               "name for variable name in the header file");
+DEFINE_bool(blocked, false,
+            "make blocked bloom filter, which checks all the bits "
+            "of a word in one cache line");
 
 namespace {
 void ReadWords(const string &name, vector<uint64> *words) {
@@ -86,7 +89,10 @@ int main(int argc, char **argv) {
   LOG(INFO) << "num_bytes: " << num_bytes;
 
   scoped_ptr<mozc::ExistenceFilter> filter(
-      mozc::ExistenceFilter::CreateOptimal(num_bytes, words.size()));
+      mozc::ExistenceFilter::CreateOptimal(
+          num_bytes, words.size(),
+          FLAGS_blocked ? mozc::ExistenceFilter::BLOCKED
+                        : mozc::ExistenceFilter::STANDARD));
   for (size_t i = 0; i < words.size(); ++i) {
     filter->Insert(words[i]);
   }
@@ -101,7 +107,8 @@ int main(int argc, char **argv) {
     mozc::OutputFileStream ofs(FLAGS_output.c_str());
     mozc::CodeGenByteArrayOutputStream codegen_stream(
         &ofs, mozc::codegenstream::NOT_OWN_STREAM);
-    codegen_stream.OpenVarDef(FLAGS_name);
+    codegen_stream.OpenVarDef(FLAGS_name,
+                              mozc::ExistenceFilter::kImageAlignment);
     codegen_stream.write(buf, size);
     codegen_stream.CloseVarDef();
   } else {
@@ -37,6 +37,7 @@
       'target_name': 'prediction',
       'type': 'static_library',
       'sources': [
+        'bigram_index_factory.cc',
         'suggestion_filter.cc',
         'dictionary_predictor.cc',
         'predictor.cc',
@@ -57,10 +58,63 @@
         '../storage/storage.gyp:encrypted_string_storage',
         '../storage/storage.gyp:storage',
         '../usage_stats/usage_stats.gyp:usage_stats',
+        'bigram_index',
+        'gen_bigram_index_data',
         'gen_suggestion_filter_data',
         'prediction_protocol',
       ],
     },
+    {
+      'target_name': 'bigram_index',
+      'type': 'static_library',
+      'sources': [
+        'bigram_index.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+      ],
+    },
+    {
+      'target_name': 'gen_bigram_index_data',
+      'type': 'none',
+      'conditions': [
+        ['use_separate_dictionary==0', {
+          'actions': [
+            {
+              'action_name': 'gen_bigram_index_data',
+              'variables': {
+                'input_files%': [
+                  '../data/dictionary/dictionary00.txt',
+                  '../data/dictionary/dictionary01.txt',
+                  '../data/dictionary/dictionary02.txt',
+                  '../data/dictionary/dictionary03.txt',
+                  '../data/dictionary/dictionary04.txt',
+                  '../data/dictionary/dictionary05.txt',
+                  '../data/dictionary/dictionary06.txt',
+                  '../data/dictionary/dictionary07.txt',
+                  '../data/dictionary/dictionary08.txt',
+                  '../data/dictionary/dictionary09.txt',
+                ],
+              },
+              'inputs': [
+                '<@(input_files)',
+              ],
+              'outputs': [
+                '<(gen_out_dir)/bigram_index_data.h',
+              ],
+              'action': [
+                '<(mozc_build_tools_dir)/gen_bigram_index_main',
+                '--logtostderr',
+                '--input=<(input_files)',
+                '--make_header',
+                '--output=<(gen_out_dir)/bigram_index_data.h',
+              ],
+              'message': 'Generating <(gen_out_dir)/bigram_index_data.h.',
+            },
+          ],
+        }],
+      ],
+    },
     {
       'target_name': 'gen_suggestion_filter_data',
       'type': 'none',
@@ -83,6 +137,7 @@
             '<@(input_files)',
             '<(gen_out_dir)/suggestion_filter_data.h',
             '--header',
+            '--blocked',
             '--logtostderr',
           ],
         },
@@ -126,6 +181,28 @@
         '../storage/storage.gyp:storage',
       ],
     },
+    {
+      'target_name': 'gen_bigram_index_main',
+      'type': 'executable',
+      'sources': [
+        'gen_bigram_index_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../dictionary/dictionary_base.gyp:text_dictionary_loader',
+        'bigram_index',
+      ],
+    },
+    {
+      'target_name': 'install_gen_bigram_index_main',
+      'type': 'none',
+      'variables': {
+        'bin_name': 'gen_bigram_index_main'
+      },
+      'includes' : [
+        '../gyp/install_build_tool.gypi',
+      ]
+    },
     {
       'target_name': 'install_gen_suggestion_filter_main',
       'type': 'none',
@@ -37,6 +37,7 @@
       'target_name': 'prediction_test',
       'type': 'executable',
       'sources': [
+        'bigram_index_test.cc',
         'dictionary_predictor_test.cc',
         'suggestion_filter_test.cc',
         'user_history_predictor_test.cc',
@@ -30,7 +30,9 @@
 #include <string>
 #include <vector>
 #include "base/base.h"
+#include "base/latency_histogram.h"
 #include "base/singleton.h"
+#include "base/stage_tracer.h"
 #include "config/config_handler.h"
 #include "config/config.pb.h"
 #include "converter/segments.h"
@@ -130,7 +132,12 @@ bool BasePredictor::Reload() {
   return user_history_predictor->Reload();
 }
 
-DefaultPredictor::DefaultPredictor() : empty_request_(ConversionRequest()) {}
+DefaultPredictor::DefaultPredictor()
+    : empty_request_(ConversionRequest()),
+      user_history_latency_(
+          LatencyStats::GetHistogram("predictor/user_history")),
+      dictionary_latency_(LatencyStats::GetHistogram("predictor/dictionary")) {
+}
 
 DefaultPredictor::~DefaultPredictor() {}
 
@@ -165,7 +172,11 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
 
   int remained_size = size;
   segments->set_max_prediction_candidates_size(static_cast<size_t>(size));
-  result |= user_history_predictor->PredictForRequest(request, segments);
+  {
+    ScopedLatencyRecorder recorder(user_history_latency_);
+    ScopedTraceSpan span("predictor/user_history");
+    result |= user_history_predictor->PredictForRequest(request, segments);
+  }
   remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
 
   // Do not call dictionary_predictor if the size of candidates get
@@ -175,7 +186,11 @@ bool DefaultPredictor::PredictForRequest(const ConversionRequest &request,
   }
 
   segments->set_max_prediction_candidates_size(remained_size);
-  result |= dictionary_predictor->PredictForRequest(request, segments);
+  {
+    ScopedLatencyRecorder recorder(dictionary_latency_);
+    ScopedTraceSpan span("predictor/dictionary");
+    result |= dictionary_predictor->PredictForRequest(request, segments);
+  }
   remained_size = size - static_cast<size_t>(GetCandidatesSize(*segments));
 
 
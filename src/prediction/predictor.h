@@ -35,6 +35,8 @@
 
 namespace mozc {
 
+class LatencyHistogram;
+
 class BasePredictor : public PredictorInterface {
  public:
   BasePredictor();
@@ -78,6 +80,8 @@ class DefaultPredictor : public BasePredictor {
 
  private:
   const ConversionRequest empty_request_;
+  LatencyHistogram *user_history_latency_;
+  LatencyHistogram *dictionary_latency_;
 };
 
 
@@ -29,6 +29,8 @@
 
 #include "prediction/suggestion_filter.h"
 
+#include <string.h>
+
 #include "base/base.h"
 #include "base/singleton.h"
 #include "base/util.h"
@@ -54,13 +56,28 @@ class SuggestionFilterImpl {
   SuggestionFilterImpl() : filter_(NULL) {
     // kSuggestionFilterData_data and kSuggestionFilterData_size
     // are defined in suggest_filter_data.h
-    filter_.reset(ExistenceFilter::Read(kSuggestionFilterData_data,
-                                        kSuggestionFilterData_size));
+    const size_t kAlignment = ExistenceFilter::kImageAlignment;
+    const char *image = kSuggestionFilterData_data;
+    const size_t misalignment = reinterpret_cast<size_t>(image) % kAlignment;
+    if (misalignment != 0) {
+      // The compiler ignored the alignment of the generated array.  The
+      // filter is read in place, so its blocks would span cache lines.
+      LOG(WARNING) << "Copying the unaligned SuggestionFilterData";
+      aligned_image_.reset(
+          new char[kSuggestionFilterData_size + kAlignment - 1]);
+      char *aligned = aligned_image_.get();
+      aligned += (kAlignment - reinterpret_cast<size_t>(aligned) % kAlignment) %
+                 kAlignment;
+      memcpy(aligned, image, kSuggestionFilterData_size);
+      image = aligned;
+    }
+    filter_.reset(ExistenceFilter::Read(image, kSuggestionFilterData_size));
     LOG_IF(ERROR, filter_.get() == NULL)
         << "SuggestionFilterData is broken";
   }
 
  private:
+  scoped_array<char> aligned_image_;
   scoped_ptr<ExistenceFilter> filter_;
 };
 }  // namespace
@@ -1166,7 +1166,7 @@ bool UserHistoryPredictor::InsertCandidates(bool zero_query_suggestion,
     DCHECK(candidate);
     candidate->Init();
     candidate->key = result_entry->key();
-    candidate->content_key = result_entry->key();
+    candidate->content_key = candidate->key;
     candidate->value = result_entry->value();
     candidate->content_value = result_entry->value();
     candidate->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
@@ -1386,7 +1386,7 @@ void UserHistoryPredictor::Finish(Segments *segments) {
                               last_value.size()) == last_value) {
       const Segment::Candidate &candidate =
           segments->conversion_segment(0).candidate(0);
-      const string key = entry->key() + candidate.key;
+      const string key = entry->key() + candidate.key.str();
       const string value = entry->value() + candidate.value;
       // use the same last_access_time stored in the top element
       // so that this item can be grouped together.
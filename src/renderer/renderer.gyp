@@ -65,6 +65,7 @@
       'type': 'static_library',
       'sources': [
         'renderer_client.cc',
+        'renderer_command_delta.cc',
         'renderer_server.cc',
       ],
       'dependencies': [
@@ -89,6 +90,7 @@
       'type': 'executable',
       'sources': [
         'renderer_client_test.cc',
+        'renderer_command_delta_test.cc',
         'renderer_server_test.cc',
         'table_layout_test.cc',
         'window_util_test.cc',
@@ -30,6 +30,7 @@
 #include "renderer/renderer_client.h"
 
 #include <climits>
+#include <cstdlib>
 #include <string>
 #include "base/base.h"
 #include "base/const.h"
@@ -42,6 +43,7 @@
 #include "ipc/ipc.h"
 #include "ipc/named_event.h"
 #include "renderer/renderer_command.pb.h"
+#include "renderer/renderer_command_delta.h"
 
 #ifdef OS_MACOSX
 #include "base/mac_util.h"
@@ -72,20 +74,27 @@ string GetRendererPath() {
 #endif
 }
 
-inline void CallCommand(IPCClientInterface *client,
-                        const commands::RendererCommand &command) {
+// Returns false if the request cannot be sent or the renderer asks for the
+// full command instead of the delta command.
+bool CallCommand(IPCClientInterface *client,
+                 const commands::RendererCommand &command) {
   string buf;
   command.SerializeToString(&buf);
 
-  // basically, we don't need to get the result
+  // basically, we don't need to get the result except for delta commands.
   char result[32];
   size_t result_size = sizeof(result);
+  result[0] = RendererCommandDelta::ACCEPTED;
 
   if (!client->Call(buf.data(), buf.size(),
                     result, &result_size,
                     kIPCTimeout)) {
     LOG(ERROR) << "Cannot send the request: ";
+    return false;
   }
+
+  return (result_size == 0 ||
+          result[0] != RendererCommandDelta::NEED_FULL_COMMAND);
 }
 }  // namespace
 
@@ -317,11 +326,21 @@ RendererClient::RendererClient()
     : is_window_visible_(false),
       disable_renderer_path_check_(false),
       version_mismatch_nums_(0),
+      sequence_(0),
       ipc_client_factory_interface_(IPCClientFactory::GetIPCClientFactory()),
       renderer_launcher_(new RendererLauncher),
       renderer_launcher_interface_(NULL) {
   renderer_launcher_interface_ = renderer_launcher_.get();
 
+  // The renderer is shared by the clients in all the processes of the
+  // desktop.  The sequence starts from a random number so that a delta
+  // command is never applied to the command of another client.
+  if (!Util::GetSecureRandomSequence(
+          reinterpret_cast<char *>(&sequence_), sizeof(sequence_))) {
+    LOG(ERROR) << "GetSecureRandomSequence() failed. use random value";
+    sequence_ = static_cast<uint32>(Util::Random(RAND_MAX));
+  }
+
   name_ = kServiceName;
   const string desktop_name(Util::GetDesktopNameAsString());
   if (!desktop_name.empty()) {
@@ -423,6 +442,9 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
   }
 
   if (!renderer_launcher_interface_->CanConnect()) {
+    // The renderer may be restarted, so the next command must be a full
+    // command.
+    last_command_.reset(NULL);
     renderer_launcher_interface_->SetPendingCommand(command);
     // Check CanConnect() again, as the status might be changed
     // after SetPendingCommand().
@@ -455,6 +477,7 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
   is_window_visible_ = command.visible();
 
   if (!client->Connected()) {
+    last_command_.reset(NULL);
     // We don't need to send HIDE if the renderer is not running
     if (command.type() == commands::RendererCommand::UPDATE &&
         (!is_window_visible_ || !command.has_output())) {
@@ -478,6 +501,7 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
       LOG(ERROR) << "ForceTerminateServer failed";
     }
     ++version_mismatch_nums_;
+    last_command_.reset(NULL);
     renderer_launcher_interface_->SetPendingCommand(command);
     return true;
   } else if (IPC_PROTOCOL_VERSION < client->GetServerProtocolVersion()) {
@@ -494,6 +518,7 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     LOG(WARNING) << "Version mismatch: "
                  << client->GetServerProductVersion() << " "
                  << Version::GetMozcVersion();
+    last_command_.reset(NULL);
     renderer_launcher_interface_->SetPendingCommand(command);
     commands::RendererCommand shutdown_command;
     shutdown_command.set_type(commands::RendererCommand::SHUTDOWN);
@@ -502,9 +527,54 @@ bool RendererClient::ExecCommand(const commands::RendererCommand &command) {
     return true;
   }
 
-  CallCommand(client.get(), command);
+  if (command.type() == commands::RendererCommand::UPDATE) {
+    SendUpdateCommand(client.get(), command);
+  } else {
+    CallCommand(client.get(), command);
+  }
 
   return true;
 }
+
+void RendererClient::SendUpdateCommand(
+    IPCClientInterface *client, const commands::RendererCommand &command) {
+  scoped_ptr<commands::RendererCommand> current(
+      new commands::RendererCommand(command));
+  // 0 is reserved for the commands without sequence number.
+  if (++sequence_ == 0) {
+    ++sequence_;
+  }
+  current->set_sequence(sequence_);
+
+  commands::RendererCommand delta;
+  if (last_command_.get() != NULL &&
+      RendererCommandDelta::Encode(*last_command_, *current, &delta)) {
+    VLOG(2) << "Sending delta: " << delta.DebugString();
+    if (CallCommand(client, delta)) {
+      last_command_.swap(current);
+      return;
+    }
+    // The renderer doesn't have the base command.  The full command is sent
+    // with a new connection since the connection cannot be reused.
+    VLOG(1) << "Delta command is rejected";
+    scoped_ptr<IPCClientInterface> full_client(
+        ipc_client_factory_interface_->
+        NewClient(name_,
+                  disable_renderer_path_check_ ? "" : renderer_path_));
+    if (full_client.get() == NULL || !full_client->Connected() ||
+        !CallCommand(full_client.get(), *current)) {
+      last_command_.reset(NULL);
+      return;
+    }
+    last_command_.swap(current);
+    return;
+  }
+
+  if (CallCommand(client, *current)) {
+    last_command_.swap(current);
+  } else {
+    last_command_.reset(NULL);
+  }
+}
 }  // renderer
 }  // mozc
@@ -37,6 +37,7 @@
 namespace mozc {
 
 class IPCClientFactoryInterface;
+class IPCClientInterface;
 
 namespace renderer {
 
@@ -112,6 +113,8 @@ class RendererClient : public RendererInterface {
   // Otherwise command::RendererCommand::SHUDDOWN is used.
   bool Shutdown(bool force);
 
+  // UPDATE commands are sent as delta commands against the last UPDATE
+  // command when possible.  See RendererCommandDelta.
   bool ExecCommand(const commands::RendererCommand &command);
 
   // Don't check the renderer server path.
@@ -122,9 +125,15 @@ class RendererClient : public RendererInterface {
   void set_suppress_error_dialog(bool suppress);
 
  private:
+  // Sends |command| with a new sequence number as a delta command if
+  // possible, otherwise as a full command.
+  void SendUpdateCommand(IPCClientInterface *client,
+                         const commands::RendererCommand &command);
+
   bool is_window_visible_;
   bool disable_renderer_path_check_;
   int  version_mismatch_nums_;
+  uint32 sequence_;
   string name_;
   string renderer_path_;
 
@@ -132,6 +141,10 @@ class RendererClient : public RendererInterface {
 
   scoped_ptr<RendererLauncherInterface> renderer_launcher_;
   RendererLauncherInterface *renderer_launcher_interface_;
+
+  // The last UPDATE command accepted by the renderer.  NULL if the next
+  // UPDATE command must be sent as a full command.
+  scoped_ptr<commands::RendererCommand> last_command_;
 };
 }  // renderer
 }  // mozc
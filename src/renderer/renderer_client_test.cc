@@ -35,6 +35,7 @@
 #include "renderer/renderer_interface.h"
 #include "renderer/renderer_client.h"
 #include "renderer/renderer_command.pb.h"
+#include "renderer/renderer_command_delta.h"
 #include "testing/base/public/gunit.h"
 
 namespace mozc {
@@ -54,6 +55,8 @@ const string UpdateVersion(int diff) {
 
 int g_counter = 0;
 bool g_connected = false;
+string g_last_request;
+char g_response = RendererCommandDelta::ACCEPTED;
 uint32 g_server_protocol_version = IPC_PROTOCOL_VERSION;
 string g_server_product_version;
 
@@ -88,6 +91,9 @@ class TestIPCClient : public IPCClientInterface {
                     size_t *response_size,
                     int32 timeout) {
     g_counter++;
+    g_last_request.assign(request, request_size);
+    response[0] = g_response;
+    *response_size = 1;
     return true;
   }
 
@@ -582,5 +588,74 @@ TEST(RendererClient, SetPendingCommandTest) {
     EXPECT_FALSE(launcher.is_set_pending_command_called());
   }
 }
+
+TEST(RendererClient, DeltaCommandTest) {
+  TestIPCClientFactory factory;
+  TestRendererLauncher launcher;
+
+  RendererClient client;
+  client.SetIPCClientFactory(&factory);
+  client.SetRendererLauncherInterface(&launcher);
+
+  launcher.Reset();
+  launcher.set_available(true);
+  launcher.set_can_connect(true);
+  TestIPCClient::set_connected(true);
+  TestIPCClient::Reset();
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  commands::Candidates *candidates =
+      command.mutable_output()->mutable_candidates();
+  candidates->set_size(10);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+
+  // The first command is sent as a full command.
+  commands::RendererCommand sent;
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(1, TestIPCClient::counter());
+  EXPECT_TRUE(sent.ParseFromString(g_last_request));
+  EXPECT_FALSE(sent.has_base_sequence());
+  EXPECT_TRUE(sent.has_output());
+  const uint32 first_sequence = sent.sequence();
+
+  // Only the focused index is sent.
+  candidates->set_focused_index(1);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_EQ(2, TestIPCClient::counter());
+  EXPECT_TRUE(sent.ParseFromString(g_last_request));
+  EXPECT_EQ(first_sequence, sent.base_sequence());
+  EXPECT_FALSE(sent.has_output());
+  EXPECT_EQ(1, sent.delta().focused_index());
+
+  // The renderer rejects the delta, then the full command is sent.
+  g_response = RendererCommandDelta::NEED_FULL_COMMAND;
+  candidates->set_focused_index(2);
+  EXPECT_TRUE(client.ExecCommand(command));
+  g_response = RendererCommandDelta::ACCEPTED;
+  EXPECT_EQ(4, TestIPCClient::counter());
+  EXPECT_TRUE(sent.ParseFromString(g_last_request));
+  EXPECT_FALSE(sent.has_base_sequence());
+  EXPECT_EQ(2, sent.output().candidates().focused_index());
+
+  // Visibility cannot be sent as a delta.
+  command.set_visible(false);
+  EXPECT_TRUE(client.ExecCommand(command));
+  EXPECT_TRUE(sent.ParseFromString(g_last_request));
+  EXPECT_FALSE(sent.has_base_sequence());
+  EXPECT_FALSE(sent.visible());
+
+  // Another client, e.g., in another process, uses other sequence numbers.
+  RendererClient another_client;
+  another_client.SetIPCClientFactory(&factory);
+  another_client.SetRendererLauncherInterface(&launcher);
+  command.set_visible(true);
+  EXPECT_TRUE(another_client.ExecCommand(command));
+  EXPECT_TRUE(sent.ParseFromString(g_last_request));
+  EXPECT_FALSE(sent.has_base_sequence());
+  EXPECT_NE(first_sequence, sent.sequence());
+}
 }  // renderer
 }  // mozc
@@ -0,0 +1,302 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "renderer/renderer_command_delta.h"
+
+#include <algorithm>
+#include <string>
+#include <google/protobuf/io/coded_stream.h>
+#include <google/protobuf/wire_format_lite.h>
+#include "base/base.h"
+#include "base/protobuf/descriptor.h"
+#include "base/protobuf/message.h"
+#include "renderer/renderer_command.pb.h"
+#include "session/commands.pb.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+using ::google::protobuf::internal::WireFormatLite;
+
+// Returns true if the |index|-th values of |field| are the same in |a| and
+// |b|.  |index| is ignored unless |field| is repeated.
+bool IsSameValue(const protobuf::Message &a, const protobuf::Message &b,
+                 const protobuf::FieldDescriptor &field, int index);
+
+// Returns true if |a| and |b| of the same type have the same fields except
+// for the fields whose numbers are in |ignored_fields|.  The fields are
+// compared one by one without copying or serializing the messages, since
+// the command has all the candidates.
+bool IsSameMessageExcept(const protobuf::Message &a,
+                         const protobuf::Message &b,
+                         const int *ignored_fields,
+                         size_t num_ignored_fields) {
+  DCHECK_EQ(a.GetDescriptor(), b.GetDescriptor());
+  const protobuf::Descriptor *descriptor = a.GetDescriptor();
+  const protobuf::Reflection *reflection = a.GetReflection();
+  for (int i = 0; i < descriptor->field_count(); ++i) {
+    const protobuf::FieldDescriptor &field = *descriptor->field(i);
+    if (find(ignored_fields, ignored_fields + num_ignored_fields,
+             field.number()) != ignored_fields + num_ignored_fields) {
+      continue;
+    }
+    if (!field.is_repeated()) {
+      const bool has_field = reflection->HasField(a, &field);
+      if (has_field != reflection->HasField(b, &field)) {
+        return false;
+      }
+      if (has_field && !IsSameValue(a, b, field, 0)) {
+        return false;
+      }
+      continue;
+    }
+    const int size = reflection->FieldSize(a, &field);
+    if (size != reflection->FieldSize(b, &field)) {
+      return false;
+    }
+    for (int j = 0; j < size; ++j) {
+      if (!IsSameValue(a, b, field, j)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+bool IsSameMessage(const protobuf::Message &a, const protobuf::Message &b) {
+  return IsSameMessageExcept(a, b, NULL, 0);
+}
+
+bool IsSameValue(const protobuf::Message &a, const protobuf::Message &b,
+                 const protobuf::FieldDescriptor &field, int index) {
+  const protobuf::Reflection *r = a.GetReflection();
+  const protobuf::FieldDescriptor *f = &field;
+  const bool repeated = field.is_repeated();
+#define MOZC_IS_SAME_VALUE(getter)                                      \
+  (repeated ? r->GetRepeated##getter(a, f, index) ==                    \
+              r->GetRepeated##getter(b, f, index)                       \
+            : r->Get##getter(a, f) == r->Get##getter(b, f))
+  switch (field.cpp_type()) {
+    case protobuf::FieldDescriptor::CPPTYPE_INT32:
+      return MOZC_IS_SAME_VALUE(Int32);
+    case protobuf::FieldDescriptor::CPPTYPE_INT64:
+      return MOZC_IS_SAME_VALUE(Int64);
+    case protobuf::FieldDescriptor::CPPTYPE_UINT32:
+      return MOZC_IS_SAME_VALUE(UInt32);
+    case protobuf::FieldDescriptor::CPPTYPE_UINT64:
+      return MOZC_IS_SAME_VALUE(UInt64);
+    case protobuf::FieldDescriptor::CPPTYPE_DOUBLE:
+      return MOZC_IS_SAME_VALUE(Double);
+    case protobuf::FieldDescriptor::CPPTYPE_FLOAT:
+      return MOZC_IS_SAME_VALUE(Float);
+    case protobuf::FieldDescriptor::CPPTYPE_BOOL:
+      return MOZC_IS_SAME_VALUE(Bool);
+    case protobuf::FieldDescriptor::CPPTYPE_ENUM:
+      return MOZC_IS_SAME_VALUE(Enum);
+    case protobuf::FieldDescriptor::CPPTYPE_STRING: {
+      string a_scratch, b_scratch;
+      return repeated ?
+          r->GetRepeatedStringReference(a, f, index, &a_scratch) ==
+          r->GetRepeatedStringReference(b, f, index, &b_scratch) :
+          r->GetStringReference(a, f, &a_scratch) ==
+          r->GetStringReference(b, f, &b_scratch);
+    }
+    case protobuf::FieldDescriptor::CPPTYPE_MESSAGE:
+      return repeated ?
+          IsSameMessage(r->GetRepeatedMessage(a, f, index),
+                        r->GetRepeatedMessage(b, f, index)) :
+          IsSameMessage(r->GetMessage(a, f), r->GetMessage(b, f));
+  }
+#undef MOZC_IS_SAME_VALUE
+  LOG(ERROR) << "Unknown type: " << field.cpp_type();
+  return false;
+}
+
+// Returns true if |base| and |command| are the same except for the fields
+// which can be carried by a delta command.
+bool IsSameExceptDeltaFields(const commands::RendererCommand &base,
+                             const commands::RendererCommand &command) {
+  const int kCommandFields[] = {
+    commands::RendererCommand::kSequenceFieldNumber,
+    commands::RendererCommand::kBaseSequenceFieldNumber,
+    commands::RendererCommand::kDeltaFieldNumber,
+    commands::RendererCommand::kOutputFieldNumber,
+  };
+  const int kOutputFields[] = {
+    commands::Output::kPreeditFieldNumber,
+    commands::Output::kCandidatesFieldNumber,
+    commands::Output::kAllCandidateWordsFieldNumber,
+  };
+  const int kCandidateListFields[] = {
+    commands::CandidateList::kFocusedIndexFieldNumber,
+  };
+  return IsSameMessageExcept(base, command, kCommandFields,
+                             arraysize(kCommandFields)) &&
+      IsSameMessageExcept(base.output(), command.output(), kOutputFields,
+                          arraysize(kOutputFields)) &&
+      base.output().has_all_candidate_words() ==
+      command.output().has_all_candidate_words() &&
+      IsSameMessageExcept(base.output().all_candidate_words(),
+                          command.output().all_candidate_words(),
+                          kCandidateListFields,
+                          arraysize(kCandidateListFields));
+}
+
+// Returns true if |a| and |b| are the same except for the focused index.
+bool IsSamePage(const commands::Candidates &a,
+                const commands::Candidates &b) {
+  const int kCandidatesFields[] = {
+    commands::Candidates::kFocusedIndexFieldNumber,
+  };
+  return IsSameMessageExcept(a, b, kCandidatesFields,
+                             arraysize(kCandidatesFields));
+}
+}  // namespace
+
+bool RendererCommandDelta::Encode(const commands::RendererCommand &base,
+                                  const commands::RendererCommand &command,
+                                  commands::RendererCommand *delta) {
+  DCHECK(delta);
+  if (base.type() != commands::RendererCommand::UPDATE ||
+      command.type() != commands::RendererCommand::UPDATE ||
+      !base.has_sequence() || !command.has_sequence() ||
+      base.has_base_sequence() || command.has_base_sequence()) {
+    return false;
+  }
+
+  // A delta cannot remove a field, so the presence of the fields must be
+  // the same.
+  const commands::Output &base_output = base.output();
+  const commands::Output &output = command.output();
+  if (base.has_output() != command.has_output() ||
+      base_output.has_preedit() != output.has_preedit() ||
+      base_output.has_candidates() != output.has_candidates() ||
+      base_output.all_candidate_words().has_focused_index() !=
+      output.all_candidate_words().has_focused_index()) {
+    return false;
+  }
+
+  if (!IsSameExceptDeltaFields(base, command)) {
+    return false;
+  }
+
+  delta->Clear();
+  delta->set_type(commands::RendererCommand::UPDATE);
+  delta->set_sequence(command.sequence());
+  delta->set_base_sequence(base.sequence());
+  commands::RendererCommand::Delta *fields = delta->mutable_delta();
+
+  if (output.has_preedit() &&
+      !IsSameMessage(base_output.preedit(), output.preedit())) {
+    fields->mutable_preedit()->CopyFrom(output.preedit());
+  }
+
+  if (output.has_candidates()) {
+    const commands::Candidates &base_candidates = base_output.candidates();
+    const commands::Candidates &candidates = output.candidates();
+    if (base_candidates.has_focused_index() != candidates.has_focused_index() ||
+        !IsSamePage(base_candidates, candidates)) {
+      fields->mutable_candidates()->CopyFrom(candidates);
+    } else if (candidates.has_focused_index() &&
+               base_candidates.focused_index() != candidates.focused_index()) {
+      fields->set_focused_index(candidates.focused_index());
+    }
+  }
+
+  if (output.all_candidate_words().has_focused_index() &&
+      base_output.all_candidate_words().focused_index() !=
+      output.all_candidate_words().focused_index()) {
+    fields->set_all_candidate_words_focused_index(
+        output.all_candidate_words().focused_index());
+  }
+
+  return true;
+}
+
+bool RendererCommandDelta::Apply(const commands::RendererCommand &delta,
+                                 commands::RendererCommand *command) {
+  DCHECK(command);
+  if (!delta.has_base_sequence() ||
+      !command->has_sequence() ||
+      command->sequence() != delta.base_sequence() ||
+      command->type() != commands::RendererCommand::UPDATE) {
+    return false;
+  }
+
+  command->set_sequence(delta.sequence());
+  const commands::RendererCommand::Delta &fields = delta.delta();
+  commands::Output *output = command->mutable_output();
+  if (fields.has_preedit()) {
+    output->mutable_preedit()->CopyFrom(fields.preedit());
+  }
+  if (fields.has_candidates()) {
+    output->mutable_candidates()->CopyFrom(fields.candidates());
+  } else if (fields.has_focused_index()) {
+    output->mutable_candidates()->set_focused_index(fields.focused_index());
+  }
+  if (fields.has_all_candidate_words_focused_index()) {
+    output->mutable_all_candidate_words()->set_focused_index(
+        fields.all_candidate_words_focused_index());
+  }
+  return true;
+}
+
+bool RendererCommandDelta::ReadSequence(const char *data, size_t size,
+                                        uint32 *sequence,
+                                        uint32 *base_sequence) {
+  DCHECK(sequence);
+  DCHECK(base_sequence);
+  *sequence = 0;
+  *base_sequence = 0;
+
+  // Called on the IPC thread of the renderer for every command.  The
+  // output, which can be large, is skipped without being parsed.
+  ::google::protobuf::io::CodedInputStream input(
+      reinterpret_cast<const uint8 *>(data), static_cast<int>(size));
+  uint32 tag = 0;
+  while ((tag = input.ReadTag()) != 0) {
+    const int field = WireFormatLite::GetTagFieldNumber(tag);
+    if (field == commands::RendererCommand::kSequenceFieldNumber) {
+      if (!input.ReadVarint32(sequence)) {
+        return false;
+      }
+    } else if (field == commands::RendererCommand::kBaseSequenceFieldNumber) {
+      if (!input.ReadVarint32(base_sequence)) {
+        return false;
+      }
+    } else if (!WireFormatLite::SkipField(&input, tag)) {
+      return false;
+    }
+  }
+  return input.ConsumedEntireMessage();
+}
+}  // namespace renderer
+}  // namespace mozc
@@ -0,0 +1,81 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Delta encoding of RendererCommand.
+// While the user moves the focus or the page of the candidate window, only
+// a few fields of the UPDATE command are changed.  RendererClient sends
+// these fields against the last command the renderer received so that the
+// renderer does not have to parse the whole candidate list every time.
+
+#ifndef MOZC_RENDERER_RENDERER_COMMAND_DELTA_H_
+#define MOZC_RENDERER_RENDERER_COMMAND_DELTA_H_
+
+#include "base/base.h"
+
+namespace mozc {
+namespace commands {
+class RendererCommand;
+}  // namespace commands
+
+namespace renderer {
+
+class RendererCommandDelta {
+ public:
+  // One-byte response of RendererServer::Process.
+  enum Response {
+    ACCEPTED = 0,
+    NEED_FULL_COMMAND = 1,
+  };
+
+  // Makes a delta command which transforms |base| into |command|.
+  // Both commands must be UPDATE commands with sequence numbers.
+  // Returns false if |command| cannot be represented as a delta, e.g.,
+  // the visibility or the application info is changed.
+  static bool Encode(const commands::RendererCommand &base,
+                     const commands::RendererCommand &command,
+                     commands::RendererCommand *delta);
+
+  // Applies |delta| to |command| in place.  Returns false and leaves
+  // |command| untouched if |delta| is not based on |command|.
+  static bool Apply(const commands::RendererCommand &delta,
+                    commands::RendererCommand *command);
+
+  // Reads |sequence| and |base_sequence| from the serialized command
+  // without parsing the whole message.  The fields which are not set are
+  // filled with 0.  Returns false if the message is broken.
+  static bool ReadSequence(const char *data, size_t size,
+                           uint32 *sequence, uint32 *base_sequence);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(RendererCommandDelta);
+};
+}  // namespace renderer
+}  // namespace mozc
+#endif  // MOZC_RENDERER_RENDERER_COMMAND_DELTA_H_
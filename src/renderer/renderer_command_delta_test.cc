@@ -0,0 +1,228 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <string>
+#include "base/base.h"
+#include "renderer/renderer_command.pb.h"
+#include "renderer/renderer_command_delta.h"
+#include "session/commands.pb.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace renderer {
+namespace {
+
+void MakeUpdateCommand(uint32 sequence, commands::RendererCommand *command) {
+  command->Clear();
+  command->set_type(commands::RendererCommand::UPDATE);
+  command->set_visible(true);
+  command->set_sequence(sequence);
+  command->mutable_application_info()->set_process_id(1234);
+
+  commands::Output *output = command->mutable_output();
+  output->mutable_preedit()->set_cursor(1);
+  commands::Preedit::Segment *segment =
+      output->mutable_preedit()->add_segment();
+  segment->set_annotation(commands::Preedit::Segment::HIGHLIGHT);
+  segment->set_value("value");
+  segment->set_value_length(5);
+
+  commands::Candidates *candidates = output->mutable_candidates();
+  candidates->set_size(20);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+  for (int i = 0; i < 9; ++i) {
+    commands::Candidates::Candidate *candidate = candidates->add_candidate();
+    candidate->set_index(i);
+    candidate->set_id(i);
+    candidate->set_value("candidate");
+  }
+
+  commands::CandidateList *all_words = output->mutable_all_candidate_words();
+  all_words->set_focused_index(0);
+  for (int i = 0; i < 20; ++i) {
+    commands::CandidateWord *word = all_words->add_candidates();
+    word->set_index(i);
+    word->set_id(i);
+    word->set_value("candidate");
+  }
+}
+
+void ExpectSameCommand(const commands::RendererCommand &expected,
+                       const commands::RendererCommand &actual) {
+  EXPECT_EQ(expected.SerializeAsString(), actual.SerializeAsString());
+}
+
+TEST(RendererCommandDeltaTest, FocusedIndex) {
+  commands::RendererCommand base, command, delta;
+  MakeUpdateCommand(1, &base);
+  MakeUpdateCommand(2, &command);
+  command.mutable_output()->mutable_candidates()->set_focused_index(3);
+  command.mutable_output()->mutable_all_candidate_words()->set_focused_index(3);
+  command.mutable_output()->mutable_preedit()->mutable_segment(0)->set_value(
+      "other");
+
+  EXPECT_TRUE(RendererCommandDelta::Encode(base, command, &delta));
+  EXPECT_EQ(2, delta.sequence());
+  EXPECT_EQ(1, delta.base_sequence());
+  EXPECT_FALSE(delta.has_output());
+  EXPECT_FALSE(delta.delta().has_candidates());
+  EXPECT_EQ(3, delta.delta().focused_index());
+  EXPECT_EQ(3, delta.delta().all_candidate_words_focused_index());
+  EXPECT_TRUE(delta.delta().has_preedit());
+  EXPECT_GT(command.ByteSize() / 4, delta.ByteSize());
+
+  EXPECT_TRUE(RendererCommandDelta::Apply(delta, &base));
+  ExpectSameCommand(command, base);
+}
+
+TEST(RendererCommandDeltaTest, PageChange) {
+  commands::RendererCommand base, command, delta;
+  MakeUpdateCommand(1, &base);
+  MakeUpdateCommand(2, &command);
+  commands::Candidates *candidates =
+      command.mutable_output()->mutable_candidates();
+  candidates->set_position(9);
+  candidates->set_focused_index(9);
+  for (int i = 0; i < candidates->candidate_size(); ++i) {
+    candidates->mutable_candidate(i)->set_index(i + 9);
+  }
+
+  EXPECT_TRUE(RendererCommandDelta::Encode(base, command, &delta));
+  EXPECT_TRUE(delta.delta().has_candidates());
+  EXPECT_FALSE(delta.delta().has_focused_index());
+  EXPECT_FALSE(delta.delta().has_preedit());
+
+  EXPECT_TRUE(RendererCommandDelta::Apply(delta, &base));
+  ExpectSameCommand(command, base);
+}
+
+TEST(RendererCommandDeltaTest, NoDelta) {
+  commands::RendererCommand base, command, delta;
+  MakeUpdateCommand(1, &base);
+
+  // Visibility is changed.
+  MakeUpdateCommand(2, &command);
+  command.set_visible(false);
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // Application info is changed.
+  MakeUpdateCommand(2, &command);
+  command.mutable_application_info()->set_process_id(5678);
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // Candidate list is changed.
+  MakeUpdateCommand(2, &command);
+  command.mutable_output()->mutable_all_candidate_words()->
+      mutable_candidates(5)->set_value("other");
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // Candidate list is shortened.
+  MakeUpdateCommand(2, &command);
+  command.mutable_output()->mutable_all_candidate_words()->
+      mutable_candidates()->RemoveLast();
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // Another field of the output is changed.
+  MakeUpdateCommand(2, &command);
+  command.mutable_output()->set_mode(commands::FULL_KATAKANA);
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // Preedit is removed.
+  MakeUpdateCommand(2, &command);
+  command.mutable_output()->clear_preedit();
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // Not an update command.
+  MakeUpdateCommand(2, &command);
+  command.set_type(commands::RendererCommand::NOOP);
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+
+  // No sequence number.
+  MakeUpdateCommand(2, &command);
+  command.clear_sequence();
+  EXPECT_FALSE(RendererCommandDelta::Encode(base, command, &delta));
+}
+
+TEST(RendererCommandDeltaTest, ApplyToWrongBase) {
+  commands::RendererCommand base, command, delta;
+  MakeUpdateCommand(1, &base);
+  MakeUpdateCommand(2, &command);
+  command.mutable_output()->mutable_candidates()->set_focused_index(1);
+  EXPECT_TRUE(RendererCommandDelta::Encode(base, command, &delta));
+
+  commands::RendererCommand other;
+  MakeUpdateCommand(3, &other);
+  const string original = other.SerializeAsString();
+  EXPECT_FALSE(RendererCommandDelta::Apply(delta, &other));
+  EXPECT_EQ(original, other.SerializeAsString());
+
+  // A full command cannot be applied.
+  EXPECT_FALSE(RendererCommandDelta::Apply(command, &base));
+}
+
+TEST(RendererCommandDeltaTest, ReadSequence) {
+  commands::RendererCommand base, command, delta;
+  MakeUpdateCommand(10, &base);
+  MakeUpdateCommand(11, &command);
+  command.mutable_output()->mutable_candidates()->set_focused_index(1);
+  EXPECT_TRUE(RendererCommandDelta::Encode(base, command, &delta));
+
+  uint32 sequence = 0;
+  uint32 base_sequence = 0;
+  string buf;
+  command.SerializeToString(&buf);
+  EXPECT_TRUE(RendererCommandDelta::ReadSequence(buf.data(), buf.size(),
+                                                 &sequence, &base_sequence));
+  EXPECT_EQ(11, sequence);
+  EXPECT_EQ(0, base_sequence);
+
+  delta.SerializeToString(&buf);
+  EXPECT_TRUE(RendererCommandDelta::ReadSequence(buf.data(), buf.size(),
+                                                 &sequence, &base_sequence));
+  EXPECT_EQ(11, sequence);
+  EXPECT_EQ(10, base_sequence);
+
+  commands::RendererCommand noop;
+  noop.set_type(commands::RendererCommand::NOOP);
+  noop.SerializeToString(&buf);
+  EXPECT_TRUE(RendererCommandDelta::ReadSequence(buf.data(), buf.size(),
+                                                 &sequence, &base_sequence));
+  EXPECT_EQ(0, sequence);
+  EXPECT_EQ(0, base_sequence);
+
+  // Broken message.
+  command.SerializeToString(&buf);
+  EXPECT_FALSE(RendererCommandDelta::ReadSequence(buf.data(), buf.size() / 2,
+                                                  &sequence, &base_sequence));
+}
+}  // namespace
+}  // namespace renderer
+}  // namespace mozc
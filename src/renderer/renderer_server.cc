@@ -37,6 +37,7 @@
 #include "base/base.h"
 #include "base/const.h"
 #include "base/logging.h"
+#include "base/mutex.h"
 #include "base/util.h"
 #include "client/client_interface.h"
 #include "config/config_handler.h"
@@ -44,6 +45,7 @@
 #include "ipc/named_event.h"
 #include "ipc/process_watch_dog.h"
 #include "renderer/renderer_command.pb.h"
+#include "renderer/renderer_command_delta.h"
 
 // By default, mozc_renderer quits when user-input continues to be
 // idle for 10min.
@@ -153,7 +155,9 @@ class RendererServerSendCommand : public client::SendCommandInterface {
 RendererServer::RendererServer()
     : IPCServer(GetServiceName(), kNumConnections, kIPCServerTimeOut),
       timeout_(0),
+      last_executed_sequence_(0),
       renderer_interface_(NULL),
+      last_command_(new commands::RendererCommand),
       watch_dog_(new ParentApplicationWatchDog(this)),
       send_command_(new RendererServerSendCommand) {
   if (FLAGS_restricted) {
@@ -209,13 +213,28 @@ bool RendererServer::Process(const char *request,
   // different threads, we have to use heap to share the serialized message.
   // If we use stack, this program will be crashed.
   //
+  // AsyncExecCommand() keeps only the newest message, so a delta command
+  // is accepted only when its base has already been executed.  Otherwise
+  // the base may be overwritten by the delta before the main thread runs
+  // it.  The client sends the full command immediately when rejected.
+  *response_size = 1;
+  uint32 sequence = 0;
+  uint32 base_sequence = 0;
+  if (RendererCommandDelta::ReadSequence(request, request_size,
+                                         &sequence, &base_sequence) &&
+      base_sequence != 0) {
+    scoped_lock l(&mutex_);
+    if (base_sequence != last_executed_sequence_) {
+      VLOG(1) << "Base sequence is not executed: " << base_sequence;
+      response[0] = RendererCommandDelta::NEED_FULL_COMMAND;
+      return true;
+    }
+  }
+  response[0] = RendererCommandDelta::ACCEPTED;
+
   // The reciver of command_str takes the ownership of this string.
   string *command_str = new string(request, request_size);
 
-  // no need to set the result code.
-  *response_size = 1;
-  response[0] = '\0';
-
   // Cannot call the method directly like renderer_interface_->ExecCommand()
   // as it's not thread-safe.
   return AsyncExecCommand(command_str);
@@ -223,6 +242,39 @@ bool RendererServer::Process(const char *request,
 
 bool RendererServer::ExecCommandInternal(
     const commands::RendererCommand &command) {
+  if (command.has_base_sequence()) {
+    if (!RendererCommandDelta::Apply(command, last_command_.get())) {
+      LOG(WARNING) << "Discards a delta command: " << command.base_sequence();
+      // The following delta commands are rejected until the client sends
+      // the full command.
+      last_command_->Clear();
+      SetLastExecutedSequence(0);
+      return false;
+    }
+    SetLastExecutedSequence(last_command_->sequence());
+    return ExecFullCommand(*last_command_);
+  }
+
+  if (command.type() == commands::RendererCommand::UPDATE) {
+    if (command.has_sequence()) {
+      last_command_->CopyFrom(command);
+    } else {
+      // The command is not sent by RendererClient, e.g., the hide command
+      // of the watch dog.  The following delta commands are rejected.
+      last_command_->Clear();
+    }
+    SetLastExecutedSequence(last_command_->sequence());
+  }
+  return ExecFullCommand(command);
+}
+
+void RendererServer::SetLastExecutedSequence(uint32 sequence) {
+  scoped_lock l(&mutex_);
+  last_executed_sequence_ = sequence;
+}
+
+bool RendererServer::ExecFullCommand(
+    const commands::RendererCommand &command) {
   if (renderer_interface_ == NULL) {
     LOG(ERROR) << "renderer_interface is NULL";
     return false;
@@ -32,6 +32,7 @@
 
 #include <string>
 #include "base/base.h"
+#include "base/mutex.h"
 #include "ipc/ipc.h"
 #include "renderer/renderer_interface.h"
 
@@ -44,6 +45,9 @@ class ParentApplicationWatchDog;
 
 
 // RendererServer base class. Implement Async* method.
+// RendererServer also accepts the delta commands made by
+// RendererCommandDelta.  They are applied to the last UPDATE command before
+// being passed to RendererInterface.
 class RendererServer : public IPCServer {
  public:
   explicit RendererServer();
@@ -84,14 +88,29 @@ class RendererServer : public IPCServer {
 
   // Call ExecCommandInternal() from the implementation
   // of AsyncExecCommand()
+  // A delta command is applied to the last UPDATE command, and is
+  // discarded if its base is not the last one.  Process() rejects the
+  // delta commands whose base has not been executed here yet.
   bool ExecCommandInternal(const commands::RendererCommand &command);
 
   // return timeout (msec) passed by FLAGS_timeout
   uint32 timeout() const;
 
  private:
+  // Passes |command| to the renderer interface.
+  bool ExecFullCommand(const commands::RendererCommand &command);
+
+  void SetLastExecutedSequence(uint32 sequence);
+
   uint32 timeout_;
+  // The sequence number of |last_command_|, or 0 if delta commands can't
+  // be applied.  Written by ExecCommandInternal() and read by Process().
+  uint32 last_executed_sequence_;
+  Mutex mutex_;
   RendererInterface *renderer_interface_;
+  // The last UPDATE command which delta commands are applied to.
+  // Only accessed by ExecCommandInternal().
+  scoped_ptr<commands::RendererCommand> last_command_;
   scoped_ptr<ParentApplicationWatchDog> watch_dog_;
   scoped_ptr<RendererServerSendCommand> send_command_;
 
@@ -35,6 +35,7 @@
 #include "renderer/renderer_interface.h"
 #include "renderer/renderer_client.h"
 #include "renderer/renderer_command.pb.h"
+#include "renderer/renderer_command_delta.h"
 #include "renderer/renderer_server.h"
 #include "testing/base/public/gunit.h"
 
@@ -58,6 +59,7 @@ class TestRenderer : public RendererInterface {
       return false;
     }
     counter_++;
+    last_command_.CopyFrom(command);
     return true;
   }
 
@@ -73,9 +75,14 @@ class TestRenderer : public RendererInterface {
     finished_ = true;
   }
 
+  const commands::RendererCommand &last_command() const {
+    return last_command_;
+  }
+
  private:
   int counter_;
   bool finished_;
+  commands::RendererCommand last_command_;
 };
 
 class TestRendererServer : public RendererServer {
@@ -97,6 +104,37 @@ class TestRendererServer : public RendererServer {
   }
 };
 
+// Keeps only the newest message until ExecPendingCommand() is called, as
+// UnixServer and Win32Server do until their main loop wakes up.
+class CoalescingRendererServer : public RendererServer {
+ public:
+  CoalescingRendererServer() {}
+
+  virtual ~CoalescingRendererServer() {}
+
+  int StartMessageLoop() {
+    return 0;
+  }
+
+  bool AsyncExecCommand(string *proto_message) {
+    message_.assign(*proto_message);
+    delete proto_message;
+    return true;
+  }
+
+  bool ExecPendingCommand() {
+    commands::RendererCommand command;
+    if (!command.ParseFromString(message_)) {
+      return false;
+    }
+    message_.clear();
+    return ExecCommandInternal(command);
+  }
+
+ private:
+  string message_;
+};
+
 // A renderer launcher which does nothing.
 class DummyRendererLauncher : public RendererLauncherInterface {
  public:
@@ -177,5 +215,116 @@ TEST_F(RendererServerTest, IPCTest) {
   server->Wait();
 }
 
+TEST_F(RendererServerTest, DeltaCommandTest) {
+  scoped_ptr<TestRendererServer> server(new TestRendererServer);
+  TestRenderer renderer;
+  server->SetRendererInterface(&renderer);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  command.set_sequence(1);
+  commands::Candidates *candidates =
+      command.mutable_output()->mutable_candidates();
+  candidates->set_size(10);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+
+  char response[32];
+  size_t response_size = sizeof(response);
+  string buf;
+  command.SerializeToString(&buf);
+  EXPECT_TRUE(server->Process(buf.data(), buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(1, response_size);
+  EXPECT_EQ(RendererCommandDelta::ACCEPTED, response[0]);
+  EXPECT_EQ(1, renderer.counter());
+
+  commands::RendererCommand next(command);
+  next.set_sequence(2);
+  next.mutable_output()->mutable_candidates()->set_focused_index(3);
+  commands::RendererCommand delta;
+  EXPECT_TRUE(RendererCommandDelta::Encode(command, next, &delta));
+  delta.SerializeToString(&buf);
+  response_size = sizeof(response);
+  EXPECT_TRUE(server->Process(buf.data(), buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(RendererCommandDelta::ACCEPTED, response[0]);
+  EXPECT_EQ(2, renderer.counter());
+  EXPECT_EQ(next.SerializeAsString(),
+            renderer.last_command().SerializeAsString());
+
+  // The base of the delta is not the last command.
+  response_size = sizeof(response);
+  EXPECT_TRUE(server->Process(buf.data(), buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(RendererCommandDelta::NEED_FULL_COMMAND, response[0]);
+  EXPECT_EQ(2, renderer.counter());
+}
+
+TEST_F(RendererServerTest, DeltaCommandIsNotCoalescedWithItsBase) {
+  scoped_ptr<CoalescingRendererServer> server(new CoalescingRendererServer);
+  TestRenderer renderer;
+  server->SetRendererInterface(&renderer);
+
+  commands::RendererCommand command;
+  command.set_type(commands::RendererCommand::UPDATE);
+  command.set_visible(true);
+  command.set_sequence(1);
+  commands::Candidates *candidates =
+      command.mutable_output()->mutable_candidates();
+  candidates->set_size(10);
+  candidates->set_position(0);
+  candidates->set_focused_index(0);
+
+  char response[32];
+  size_t response_size = sizeof(response);
+  string buf;
+  command.SerializeToString(&buf);
+  EXPECT_TRUE(server->Process(buf.data(), buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(RendererCommandDelta::ACCEPTED, response[0]);
+
+  // The delta arrives before the main thread runs its base, which would
+  // be overwritten by the delta.
+  commands::RendererCommand next(command);
+  next.set_sequence(2);
+  next.mutable_output()->mutable_candidates()->set_focused_index(3);
+  commands::RendererCommand delta;
+  EXPECT_TRUE(RendererCommandDelta::Encode(command, next, &delta));
+  string delta_buf;
+  delta.SerializeToString(&delta_buf);
+  response_size = sizeof(response);
+  EXPECT_TRUE(server->Process(delta_buf.data(), delta_buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(RendererCommandDelta::NEED_FULL_COMMAND, response[0]);
+
+  // The client sends the full command instead.
+  next.SerializeToString(&buf);
+  response_size = sizeof(response);
+  EXPECT_TRUE(server->Process(buf.data(), buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(RendererCommandDelta::ACCEPTED, response[0]);
+  EXPECT_TRUE(server->ExecPendingCommand());
+  EXPECT_EQ(1, renderer.counter());
+  EXPECT_EQ(next.SerializeAsString(),
+            renderer.last_command().SerializeAsString());
+
+  // Deltas are accepted once the base has been executed.
+  commands::RendererCommand last(next);
+  last.set_sequence(3);
+  last.mutable_output()->mutable_candidates()->set_focused_index(5);
+  EXPECT_TRUE(RendererCommandDelta::Encode(next, last, &delta));
+  delta.SerializeToString(&delta_buf);
+  response_size = sizeof(response);
+  EXPECT_TRUE(server->Process(delta_buf.data(), delta_buf.size(),
+                              response, &response_size));
+  EXPECT_EQ(RendererCommandDelta::ACCEPTED, response[0]);
+  EXPECT_TRUE(server->ExecPendingCommand());
+  EXPECT_EQ(2, renderer.counter());
+  EXPECT_EQ(last.SerializeAsString(),
+            renderer.last_command().SerializeAsString());
+}
+
 } // renderer
 } // mozc
@@ -38,6 +38,7 @@
 #include "converter/converter_interface.h"
 #include "converter/segments.h"
 #include "rewriter/calculator/calculator_interface.h"
+#include "rewriter/rewriter_trigger.h"
 
 namespace mozc {
 
@@ -46,6 +47,11 @@ CalculatorRewriter::CalculatorRewriter() {
 
 CalculatorRewriter::~CalculatorRewriter() {}
 
+void CalculatorRewriter::GetTrigger(RewriterTrigger *trigger) const {
+  // An expression has at least one number.
+  trigger->RequireFeatures(RewriterTrigger::HAS_NUMBER);
+}
+
 bool CalculatorRewriter::Rewrite(Segments *segments) const {
   return RewriteForRequest(ConversionRequest(), segments);
 }
@@ -38,6 +38,7 @@ namespace mozc {
 
 class CalculatorRewriterTest;
 class ConversionRequest;
+class RewriterTrigger;
 class Segments;
 
 class CalculatorRewriter : public RewriterInterface {
@@ -47,6 +48,8 @@ class CalculatorRewriter : public RewriterInterface {
   CalculatorRewriter();
   virtual ~CalculatorRewriter();
 
+  virtual void GetTrigger(RewriterTrigger *trigger) const;
+
   virtual bool Rewrite(Segments *segments) const;
   virtual bool RewriteForRequest(const ConversionRequest &request,
                                  Segments *segments) const;
@@ -64,19 +64,68 @@ class CollocationFilter {
     return filter_->Exists(id);
   }
 
+  // Returns the index of the first id in |ids| which exists, or
+  // |ids.size()| if none exists.
+  size_t FindFirst(const vector<uint64> &ids) const {
+    if (ids.empty()) {
+      return 0;
+    }
+    scoped_array<bool> results(new bool[ids.size()]);
+    filter_->BatchExists(&ids[0], ids.size(), results.get());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      if (results[i]) {
+        return i;
+      }
+    }
+    return ids.size();
+  }
+
  private:
   scoped_ptr<ExistenceFilter> filter_;
 };
 
-bool LookupPair(const string &left, const string &right) {
-  if (left.empty() || right.empty()) {
-    return false;
+// Collocation pairs to be looked up. The id of a pair is the fingerprint
+// of left + right, which is computed from the fingerprint of left
+// without building the concatenated string.
+class CollocationPairs {
+ public:
+  CollocationPairs() {}
+
+  // Adds the pair of |left| and |right|. |left| is the state of
+  // FingerprintBuilder after the left string is appended. |tag| is
+  // returned by GetTag() for the pair.
+  void Add(const FingerprintBuilder &left, const string &right, size_t tag) {
+    FingerprintBuilder builder(left);
+    builder.Append(right);
+    ids_.push_back(builder.Get());
+    tags_.push_back(tag);
   }
 
-  const string pair = left + right;
-  const uint64 id = Util::Fingerprint(pair);
-  return Singleton<CollocationFilter>::get()->Exists(id);
-}
+  // Returns the index of the first pair in the collocation data, or
+  // size() if none is found. All the pairs are probed in one batch.
+  size_t FindFirst() const {
+    return Singleton<CollocationFilter>::get()->FindFirst(ids_);
+  }
+
+  size_t size() const {
+    return ids_.size();
+  }
+
+  size_t GetTag(size_t index) const {
+    return tags_[index];
+  }
+
+  void Clear() {
+    ids_.clear();
+    tags_.clear();
+  }
+
+ private:
+  vector<uint64> ids_;
+  vector<size_t> tags_;
+
+  DISALLOW_COPY_AND_ASSIGN(CollocationPairs);
+};
 
 bool ContainsScriptType(const string &str, Util::ScriptType type) {
   const char *begin = str.data();
@@ -476,81 +525,128 @@ bool IsNaturalContent(const Segment::Candidate &cand,
 
 
 
-bool RewriteFromPrevSegment(const Segment::Candidate &prev_cand,
-                            Segment *seg) {
-  string prev;
-  CollocationUtil::GetNormalizedScript(prev_cand.value, &prev);
+// Normalized strings of a candidate which are used as a part of
+// collocation pairs.
+struct CandidatePhrases {
+  size_t index;
+  vector<string> phrases;
+};
 
-  const size_t i_max = min(seg->candidates_size(), kCandidateSize);
+// Collects the phrases of the top candidates in |seg|. The phrases are
+// normalized here once, so that they are not recomputed for every pair.
+// Empty phrases are skipped, as they never make a collocation.
+void GetCandidatePhrases(const Segment &seg, bool is_first,
+                         vector<CandidatePhrases> *output) {
+  const size_t i_max = min(seg.candidates_size(), kCandidateSize);
   for (size_t i = 0; i < i_max; ++i) {
-    vector<string> curs;
-    if (!IsNaturalContent(seg->candidate(i), seg->candidate(0),
-                          false, &curs)) {
+    vector<string> values;
+    if (!IsNaturalContent(seg.candidate(i), seg.candidate(0),
+                          is_first, &values)) {
       continue;
     }
-    if (IsName(seg->candidate(i))) {
+    if (IsName(seg.candidate(i))) {
       continue;
     }
 
-    for (int j = 0; j < curs.size(); ++j) {
-      string cur;
-      CollocationUtil::GetNormalizedScript(curs[j], &cur);
-      if (LookupPair(prev, cur)) {
-        if (i != 0) {
-          VLOG(3) << prev << cur << " "
-                  << seg->candidate(0).value << "->"
-                  << seg->candidate(i).value;
-        }
-        seg->move_candidate(i, 0);
-        seg->mutable_candidate(0)->attributes
-            |= Segment::Candidate::CONTEXT_SENSITIVE;
-        return true;
+    output->push_back(CandidatePhrases());
+    CandidatePhrases *phrases = &output->back();
+    phrases->index = i;
+    for (size_t j = 0; j < values.size(); ++j) {
+      string normalized;
+      CollocationUtil::GetNormalizedScript(values[j], &normalized);
+      if (!normalized.empty()) {
+        phrases->phrases.push_back(normalized);
       }
     }
   }
-  return false;
 }
 
-bool RewriteUsingNextSegment(Segment *next_seg, Segment *seg) {
-  const size_t i_max = min(seg->candidates_size(), kCandidateSize);
-  for (size_t i = 0; i < i_max; ++i) {
-    vector<string> curs;
-    if (!IsNaturalContent(seg->candidate(i), seg->candidate(0), true, &curs)) {
-      continue;
-    }
-    if (IsName(seg->candidate(i))) {
-      continue;
+bool RewriteFromPrevSegment(const Segment::Candidate &prev_cand,
+                            Segment *seg) {
+  string prev;
+  CollocationUtil::GetNormalizedScript(prev_cand.value, &prev);
+  if (prev.empty()) {
+    return false;
+  }
+  FingerprintBuilder prev_builder;
+  prev_builder.Append(prev);
+
+  vector<CandidatePhrases> curs;
+  GetCandidatePhrases(*seg, false, &curs);
+
+  CollocationPairs pairs;
+  for (size_t i = 0; i < curs.size(); ++i) {
+    for (size_t j = 0; j < curs[i].phrases.size(); ++j) {
+      pairs.Add(prev_builder, curs[i].phrases[j], curs[i].index);
     }
+  }
 
-    const size_t j_max = min(next_seg->candidates_size(), kCandidateSize);
-    for (size_t j = 0; j < j_max; ++j) {
-      vector<string> nexts;
-      if (!IsNaturalContent(next_seg->candidate(j),
-                            next_seg->candidate(0), false, &nexts)) {
-        continue;
-      }
-      if (IsName(next_seg->candidate(j))) {
-        continue;
-      }
+  const size_t found = pairs.FindFirst();
+  if (found == pairs.size()) {
+    return false;
+  }
 
-      for (int k = 0; k < curs.size(); ++k) {
-        for (int l = 0; l < nexts.size(); ++l) {
-          string cur, next;
-          CollocationUtil::GetNormalizedScript(curs[k], &cur);
-          CollocationUtil::GetNormalizedScript(nexts[l], &next);
-          if (LookupPair(cur, next)) {
-            VLOG(3) << curs[k] << nexts[l] << " " << cur << next;
-            seg->move_candidate(i, 0);
-            seg->mutable_candidate(0)->attributes
-                |= Segment::Candidate::CONTEXT_SENSITIVE;
-            next_seg->move_candidate(j, 0);
-            next_seg->mutable_candidate(0)->attributes
-                |= Segment::Candidate::CONTEXT_SENSITIVE;
-            return true;
-          }
+  const size_t i = pairs.GetTag(found);
+  if (i != 0) {
+    VLOG(3) << prev << " "
+            << seg->candidate(0).value << "->"
+            << seg->candidate(i).value;
+  }
+  seg->move_candidate(i, 0);
+  seg->mutable_candidate(0)->attributes
+      |= Segment::Candidate::CONTEXT_SENSITIVE;
+  return true;
+}
+
+bool RewriteUsingNextSegment(Segment *next_seg, Segment *seg) {
+  vector<CandidatePhrases> curs;
+  GetCandidatePhrases(*seg, true, &curs);
+  if (curs.empty()) {
+    return false;
+  }
+
+  vector<CandidatePhrases> nexts;
+  GetCandidatePhrases(*next_seg, false, &nexts);
+  if (nexts.empty()) {
+    return false;
+  }
+
+  // The pairs of a candidate in |seg| are probed at once, in the same
+  // order as the candidates of |next_seg|.
+  CollocationPairs pairs;
+  vector<FingerprintBuilder> cur_builders;
+  for (size_t i = 0; i < curs.size(); ++i) {
+    const vector<string> &cur_phrases = curs[i].phrases;
+    cur_builders.assign(cur_phrases.size(), FingerprintBuilder());
+    for (size_t k = 0; k < cur_phrases.size(); ++k) {
+      cur_builders[k].Append(cur_phrases[k]);
+    }
+
+    pairs.Clear();
+    for (size_t j = 0; j < nexts.size(); ++j) {
+      for (size_t k = 0; k < cur_builders.size(); ++k) {
+        for (size_t l = 0; l < nexts[j].phrases.size(); ++l) {
+          pairs.Add(cur_builders[k], nexts[j].phrases[l], nexts[j].index);
         }
       }
     }
+
+    const size_t found = pairs.FindFirst();
+    if (found == pairs.size()) {
+      continue;
+    }
+
+    const size_t cur_index = curs[i].index;
+    const size_t next_index = pairs.GetTag(found);
+    VLOG(3) << seg->candidate(cur_index).value
+            << next_seg->candidate(next_index).value;
+    seg->move_candidate(cur_index, 0);
+    seg->mutable_candidate(0)->attributes
+        |= Segment::Candidate::CONTEXT_SENSITIVE;
+    next_seg->move_candidate(next_index, 0);
+    next_seg->mutable_candidate(0)->attributes
+        |= Segment::Candidate::CONTEXT_SENSITIVE;
+    return true;
   }
   return false;
 }
@@ -35,6 +35,7 @@
 #include "converter/segments.h"
 #include "config/config_handler.h"
 #include "config/config.pb.h"
+#include "rewriter/rewriter_trigger.h"
 
 namespace mozc {
 namespace {
@@ -252,6 +253,13 @@ bool CommandRewriter::RewriteSegment(Segment *segment) const {
   return false;
 }
 
+void CommandRewriter::GetTrigger(RewriterTrigger *trigger) const {
+  trigger->RequireFeatures(RewriterTrigger::SINGLE_SEGMENT);
+  for (size_t i = 0; i < arraysize(kTriggerKeys); ++i) {
+    trigger->AddKey(kTriggerKeys[i]);
+  }
+}
+
 bool CommandRewriter::Rewrite(Segments *segments) const {
   if (segments == NULL || segments->conversion_segments_size() != 1) {
     return false;
@@ -34,6 +34,7 @@
 
 namespace mozc {
 
+class RewriterTrigger;
 class Segments;
 class Segment;
 
@@ -47,6 +48,8 @@ class CommandRewriter: public RewriterInterface  {
 
   virtual int capability() const;
 
+  virtual void GetTrigger(RewriterTrigger *trigger) const;
+
   virtual bool Rewrite(Segments *segments) const;
 
   virtual void Finish(Segments *segments);
@@ -35,6 +35,7 @@
 #include "base/util.h"
 #include "converter/segments.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/rewriter_trigger.h"
 
 namespace mozc {
 namespace {
@@ -87,6 +88,12 @@ DiceRewriter::DiceRewriter() {}
 
 DiceRewriter::~DiceRewriter() {}
 
+void DiceRewriter::GetTrigger(RewriterTrigger *trigger) const {
+  trigger->RequireFeatures(RewriterTrigger::SINGLE_SEGMENT);
+  // "さいころ"
+  trigger->AddKey("\xE3\x81\x95\xE3\x81\x84\xE3\x81\x93\xE3\x82\x8D");
+}
+
 bool DiceRewriter::Rewrite(Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
     return false;
@@ -34,6 +34,7 @@
 
 namespace mozc {
 
+class RewriterTrigger;
 class Segments;
 
 class DiceRewriter : public RewriterInterface {
@@ -41,6 +42,8 @@ class DiceRewriter : public RewriterInterface {
   DiceRewriter();
   virtual ~DiceRewriter();
 
+  virtual void GetTrigger(RewriterTrigger *trigger) const;
+
   virtual bool Rewrite(Segments *segments) const;
 };
 }  // namespace mozc
@@ -34,6 +34,7 @@
 #include <map>
 #include "base/file_stream.h"
 #include "rewriter/embedded_dictionary.h"
+#include "rewriter/perfect_hash.h"
 
 namespace mozc {
 
@@ -49,13 +50,6 @@ struct CompilerToken {
   int16 cost;
 };
 
-struct TokenCompare {
-  bool operator()(const EmbeddedDictionary::Token &s1,
-                  const EmbeddedDictionary::Token &s2) {
-    return (strcmp(s1.key, s2.key) < 0);
-  }
-};
-
 struct CompareByCost {
   bool operator()(const CompilerToken &t1, const CompilerToken &t2) {
     return (t1.cost < t2.cost);
@@ -64,24 +58,28 @@ struct CompareByCost {
 }  // namespace
 
 EmbeddedDictionary::EmbeddedDictionary(const EmbeddedDictionary::Token *token,
-                                       size_t size)
-    : token_(token), size_(size) {
+                                       size_t size,
+                                       const uint32 *displacement,
+                                       size_t displacement_size)
+    : token_(token), size_(size),
+      displacement_(displacement),
+      displacement_size_(displacement_size) {
   CHECK(token_);
   CHECK_GT(size_, 0);
+  CHECK(displacement_);
+  CHECK_GT(displacement_size_, 0);
 }
 
 EmbeddedDictionary::~EmbeddedDictionary() {}
 
-// do binary-search
+// The perfect hash gives the only slot where |key| can be placed.
 const EmbeddedDictionary::Token*
 EmbeddedDictionary::Lookup(const string &key) const {
-  Token key_token;
-  key_token.key = key.c_str();
-  key_token.value = NULL;
-  key_token.value_size = 0;
-  const Token *result = lower_bound(token_, token_ + size_,
-                                    key_token, TokenCompare());
-  if (result == (token_ + size_) || key != result->key) {
+  const size_t slot = PerfectHash::GetSlot(
+      PerfectHash::Hash(key.data(), key.size()),
+      displacement_, displacement_size_, size_);
+  const Token *result = token_ + slot;
+  if (key != result->key) {
     return NULL;
   }
   return result;
@@ -155,18 +153,46 @@ void EmbeddedDictionary::Compile(const string &name,
   ofs << "static const size_t k" << name << "_token_size = "
       << dic.size() << ";" << endl;
 
-  ofs << "static const mozc::EmbeddedDictionary::Token k" << name
-      << "_token_data[] = {" << endl;
-
+  // Values are laid out in the order of keys, while tokens are placed
+  // in the slots of the perfect hash.
+  vector<uint64> hashes;
+  vector<string> tokens;
   size_t offset = 0;
   for (map<string, vector<CompilerToken> >::const_iterator it = dic.begin();
        it != dic.end(); ++it) {
+    hashes.push_back(PerfectHash::Hash(it->first.data(), it->first.size()));
     string escaped;
     Util::Escape(it->first, &escaped);
-    ofs << "  { \"" << escaped << "\", k" << name << "_value + "
-        << offset << ", " << it->second.size() << "}," << endl;
+    tokens.push_back("  { \"" + escaped + "\", k" + name + "_value + " +
+                     Util::SimpleItoa(static_cast<int32>(offset)) + ", " +
+                     Util::SimpleItoa(static_cast<int32>(it->second.size())) +
+                     "},");
     offset += it->second.size();
   }
+
+  vector<uint32> displacement;
+  vector<size_t> slots;
+  CHECK(PerfectHash::Build(hashes, &displacement, &slots))
+      << "Failed to build perfect hash: " << name;
+
+  ofs << "static const uint32 k" << name << "_displacement[] = {" << endl;
+  for (size_t i = 0; i < displacement.size(); ++i) {
+    ofs << "  " << displacement[i] << "," << endl;
+  }
+  ofs << "};" << endl;
+  ofs << "static const size_t k" << name << "_displacement_size = "
+      << displacement.size() << ";" << endl;
+
+  vector<string> slot_tokens(tokens.size());
+  for (size_t i = 0; i < tokens.size(); ++i) {
+    slot_tokens[slots[i]] = tokens[i];
+  }
+
+  ofs << "static const mozc::EmbeddedDictionary::Token k" << name
+      << "_token_data[] = {" << endl;
+  for (size_t i = 0; i < slot_tokens.size(); ++i) {
+    ofs << slot_tokens[i] << endl;
+  }
   ofs << "  { NULL, " << "k" << name << "_value, " << value_size << " }" << endl;
 
   ofs << "};" << endl;
@@ -57,9 +57,11 @@ class EmbeddedDictionary {
     size_t value_size;
   };
 
-  // Initialize dictionary with a constant token table
-  // generated with Compile method
-  EmbeddedDictionary(const Token *token, size_t size);
+  // Initialize dictionary with a constant token table and its
+  // displacement table generated with Compile method. Tokens are placed
+  // in the slots assigned by PerfectHash.
+  EmbeddedDictionary(const Token *token, size_t size,
+                     const uint32 *displacement, size_t displacement_size);
   virtual ~EmbeddedDictionary();
 
   // Lookup key. Return NULL if no key is found.
@@ -78,8 +80,10 @@ class EmbeddedDictionary {
   // Given mozc-dictionary tsv file (e.g, data/dictionary/dic.txt)
   // output *.h file that contains array of token.
   //
-  // static const EmbeddedDictionary::Token k$(NAME)_token_data[] and
-  // static const size_t k$(NAME)_token_size;
+  // static const EmbeddedDictionary::Token k$(NAME)_token_data[],
+  // static const size_t k$(NAME)_token_size,
+  // static const uint32 k$(NAME)_displacement[] and
+  // static const size_t k$(NAME)_displacement_size;
   static void Compile(const string &name,
                       const string &input,
                       const string &output);
@@ -87,6 +91,8 @@ class EmbeddedDictionary {
  private:
   const Token *token_;
   const size_t size_;
+  const uint32 *displacement_;
+  const size_t displacement_size_;
 };
 }  // mozc
 
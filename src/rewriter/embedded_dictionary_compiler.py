@@ -32,6 +32,14 @@
 
 __author__ = "hidehiko"
 
+# The perfect hash below must be kept in sync with rewriter/perfect_hash.cc.
+_UINT64_MASK = (1 << 64) - 1
+_FNV_OFFSET_BASIS = 14695981039346656037
+_FNV_PRIME = 1099511628211
+_GOLDEN_RATIO = 0x9E3779B97F4A7C15
+_BUCKET_SIZE = 3
+_MAX_DISPLACEMENT = 1 << 26
+
 
 class Token(object):
   def __init__(
@@ -55,6 +63,69 @@ def ToCConstCharPointer(s):
   return '"%s"' % ''.join('\\x%02X' % ord(c) for c in s) if s else 'NULL'
 
 
+def Hash(s):
+  """Returns 64bit FNV-1a hash of the byte string s."""
+  h = _FNV_OFFSET_BASIS
+  for c in bytearray(s):
+    h = ((h ^ c) * _FNV_PRIME) & _UINT64_MASK
+  return h
+
+
+def _Mix(x):
+  """Finalizer of SplitMix64."""
+  x = ((x ^ (x >> 30)) * 0xBF58476D1CE4E5B9) & _UINT64_MASK
+  x = ((x ^ (x >> 27)) * 0x94D049BB133111EB) & _UINT64_MASK
+  return x ^ (x >> 31)
+
+
+def _GetSlot(h, displacement, table_size):
+  return _Mix((h + (displacement + 1) * _GOLDEN_RATIO) & _UINT64_MASK) % (
+      table_size)
+
+
+def BuildPerfectHash(hashes):
+  """Builds the minimal perfect hash table for hashes.
+
+  Args:
+    hashes: a list of distinct hash values.
+  Returns: a tuple of the displacement list and the list of slots assigned
+    to each hash.
+  """
+  table_size = len(hashes)
+  if len(set(hashes)) != table_size:
+    raise ValueError('Duplicated hash values')
+  if table_size == 0:
+    return [], []
+
+  displacement_size = (table_size + _BUCKET_SIZE - 1) // _BUCKET_SIZE
+  displacement = [0] * displacement_size
+  buckets = [[] for _ in xrange(displacement_size)]
+  for index, h in enumerate(hashes):
+    buckets[_Mix(h) % displacement_size].append(index)
+
+  slots = [0] * table_size
+  used = [False] * table_size
+  # Place the largest buckets first. sorted() is stable, as stable_sort.
+  for bucket_id in sorted(xrange(displacement_size),
+                          key=lambda i: -len(buckets[i])):
+    bucket = buckets[bucket_id]
+    if not bucket:
+      break
+    for d in xrange(_MAX_DISPLACEMENT):
+      bucket_slots = [_GetSlot(hashes[i], d, table_size) for i in bucket]
+      if (len(set(bucket_slots)) == len(bucket_slots) and
+          not any(used[slot] for slot in bucket_slots)):
+        break
+    else:
+      raise ValueError('Cannot find displacement for bucket %d' % bucket_id)
+    for index, slot in zip(bucket, bucket_slots):
+      used[slot] = True
+      slots[index] = slot
+    displacement[bucket_id] = d
+
+  return displacement, slots
+
+
 def OutputValue(name, input_data, output_stream):
   """Outputs mozc::EmbeddedDictionary::Value data to given output_stream.
 
@@ -94,26 +165,46 @@ def OutputTokenSize(name, input_data, output_stream):
 
 
 def OutputTokenData(name, input_data, output_stream):
-  """Output token_data to the given output_stream.
+  """Output displacement and token_data to the given output_stream.
 
-  The generated code should look like:
+  Tokens are placed in the slots of the perfect hash, while values are
+  in the order of keys. The generated code should look like:
+  static const uint32 kNAME_displacement[] = {
+    0,
+    3,
+       :
+  };
+  static const size_t kNAME_displacement_size = 3334;
   static const mozc::EmbeddedDictionary::Token kNAME_token_data[] = {
-    { "key1", kNAME_value + 0, 10 },
     { "key2", kNAME_value + 10, 30 },
+    { "key1", kNAME_value + 0, 10 },
        :
     { NULL, kNAME_value, 10000},
   };
   """
+  items = sorted(input_data.items())
+  displacement, slots = BuildPerfectHash([Hash(key) for key, _ in items])
+
+  output_stream.write('static const uint32 k%s_displacement[] = {\n' % name)
+  for d in displacement:
+    output_stream.write('  %d,\n' % d)
+  output_stream.write('};\n')
+  output_stream.write('static const size_t k%s_displacement_size = %d;\n' % (
+      name, len(displacement)))
+
   output_stream.write(
       'static const mozc::EmbeddedDictionary::Token '
       'k%s_token_data[] = {\n' % name)
 
   offset = 0
-  for key, token_list in sorted(input_data.items()):
+  tokens = [None] * len(items)
+  for (key, token_list), slot in zip(items, slots):
     size = len(token_list)
-    output_stream.write('  { %s, k%s_value + %d, %d },\n' % (
-        ToCConstCharPointer(key), name, offset, size))
+    tokens[slot] = '  { %s, k%s_value + %d, %d },\n' % (
+        ToCConstCharPointer(key), name, offset, size)
     offset += size
+  for token in tokens:
+    output_stream.write(token)
 
   # Sentinel.
   output_stream.write('  { NULL, k%s_value, %d }\n' % (name, offset))
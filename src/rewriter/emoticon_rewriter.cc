@@ -52,7 +52,9 @@ class EmoticonDictionary {
  public:
   EmoticonDictionary()
       : dic_(new EmbeddedDictionary(kEmoticonData_token_data,
-                                    kEmoticonData_token_size)) {}
+                                    kEmoticonData_token_size,
+                                    kEmoticonData_displacement,
+                                    kEmoticonData_displacement_size)) {}
 
   ~EmoticonDictionary() {}
 
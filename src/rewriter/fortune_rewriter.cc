@@ -37,6 +37,7 @@
 #include "base/util.h"
 #include "converter/segments.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/rewriter_trigger.h"
 
 namespace mozc {
 namespace {
@@ -181,6 +182,12 @@ FortuneRewriter::FortuneRewriter() {}
 
 FortuneRewriter::~FortuneRewriter() {}
 
+void FortuneRewriter::GetTrigger(RewriterTrigger *trigger) const {
+  trigger->RequireFeatures(RewriterTrigger::SINGLE_SEGMENT);
+  // "おみくじ"
+  trigger->AddKey("\xE3\x81\x8A\xE3\x81\xBF\xE3\x81\x8F\xE3\x81\x98");
+}
+
 bool FortuneRewriter::Rewrite(Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
     return false;
@@ -34,6 +34,7 @@
 
 namespace mozc {
 
+class RewriterTrigger;
 class Segments;
 
 class FortuneRewriter: public RewriterInterface  {
@@ -41,6 +42,8 @@ class FortuneRewriter: public RewriterInterface  {
   FortuneRewriter();
   virtual ~FortuneRewriter();
 
+  virtual void GetTrigger(RewriterTrigger *trigger) const;
+
   virtual bool Rewrite(Segments *segments) const;
 };
 }  // namespace mozc
@@ -42,6 +42,7 @@
 #include "base/base.h"
 #include "base/file_stream.h"
 #include "base/util.h"
+#include "rewriter/perfect_hash.h"
 
 DEFINE_string(usage_data_file, "", "usage data file");
 DEFINE_string(cforms_file, "", "cforms file");
@@ -210,6 +211,7 @@ void Convert() {
 
   // Output kConjugationSuffixData
   vector<int> conjugation_index(conjugation_list.size() + 1);
+  vector<ConjugationType> conjugation_suffix;
   *ofs << "static const ConjugationSuffix kConjugationSuffixData[] = {" << endl;
   int out_count = 0;
   for (size_t i = 0; i < conjugation_list.size(); ++i) {
@@ -219,6 +221,7 @@ void Convert() {
       *ofs << "  // " << i << ": (" << out_count << "-" << out_count
            << "): no conjugations" << endl;
       *ofs << "  {\"\",\"\"}," << endl;
+      conjugation_suffix.push_back(ConjugationType());
       ++out_count;
     } else {
       typedef pair<string, string> StrPair;
@@ -239,6 +242,10 @@ void Convert() {
         Util::Escape(itr->second, &key_suffix);
         *ofs << " {\"" << value_suffix <<
                 "\", \"" << key_suffix << "\"},";
+        ConjugationType suffix;
+        suffix.value_suffix = itr->first;
+        suffix.key_suffix = itr->second;
+        conjugation_suffix.push_back(suffix);
         ++out_count;
       }
       *ofs << endl;
@@ -283,6 +290,69 @@ void Convert() {
   *ofs << "  { 0, NULL, NULL, 0, NULL }" << endl;
   *ofs << "};" << endl;
 
+  // Expand all the conjugations of the usage entries. Each entry is
+  // looked up both with the (key, value) pair and with the value only.
+  // When the same pair comes from several entries, the last one is used.
+  typedef pair<string, string> StrPair;
+  map<StrPair, int32> key_value_usage_id_map;
+  for (size_t id = 0; id < usage_entries.size(); ++id) {
+    const UsageItem &item = usage_entries[id];
+    for (size_t i = conjugation_index[item.conjugation_id];
+         i < conjugation_index[item.conjugation_id + 1]; ++i) {
+      const string value = item.value + conjugation_suffix[i].value_suffix;
+      key_value_usage_id_map[
+          StrPair(item.key + conjugation_suffix[i].key_suffix, value)] = id;
+      key_value_usage_id_map[StrPair("", value)] = id;
+    }
+  }
+
+  // The pair is hashed as key + "\t" + value.
+  vector<uint64> hashes;
+  for (map<StrPair, int32>::const_iterator it =
+           key_value_usage_id_map.begin();
+       it != key_value_usage_id_map.end(); ++it) {
+    const string key_value = it->first.first + "\t" + it->first.second;
+    hashes.push_back(PerfectHash::Hash(key_value.data(), key_value.size()));
+  }
+  vector<uint32> displacement;
+  vector<size_t> slots;
+  CHECK(PerfectHash::Build(hashes, &displacement, &slots));
+  if (displacement.empty()) {
+    // Avoid a zero-sized array.
+    displacement.push_back(0);
+  }
+
+  // Output kUsageDataIndex_displacement
+  *ofs << "static const uint32 kUsageDataIndex_displacement[] = {" << endl;
+  for (size_t i = 0; i < displacement.size(); ++i) {
+    *ofs << "  " << displacement[i] << "," << endl;
+  }
+  *ofs << "};" << endl;
+  *ofs << "static const size_t kUsageDataIndex_displacement_size = "
+       << displacement.size() << ";" << endl;
+
+  // Output kUsageDataIndex in the order of the slots.
+  vector<string> index_items(key_value_usage_id_map.size());
+  size_t index = 0;
+  for (map<StrPair, int32>::const_iterator it =
+           key_value_usage_id_map.begin();
+       it != key_value_usage_id_map.end(); ++it, ++index) {
+    string key, value;
+    Util::Escape(it->first.first, &key);
+    Util::Escape(it->first.second, &value);
+    index_items[slots[index]] =
+        "  {\"" + key + "\", \"" + value + "\", " +
+        Util::SimpleItoa(it->second) + "},";
+  }
+  *ofs << "static const size_t kUsageDataIndexSize = "
+       << index_items.size() << ";" << endl;
+  *ofs << "static const UsageDictIndexItem kUsageDataIndex[] = {" << endl;
+  for (size_t i = 0; i < index_items.size(); ++i) {
+    *ofs << index_items[i] << endl;
+  }
+  *ofs << "  { NULL, NULL, 0 }" << endl;
+  *ofs << "};" << endl;
+
   if (ofs != &cout) {
     delete ofs;
   }
@@ -30,13 +30,17 @@
 #ifndef MOZC_REWRITER_MERGER_REWRITER_H_
 #define MOZC_REWRITER_MERGER_REWRITER_H_
 
+#include <string>
 #include <vector>
 
 #include "base/base.h"
+#include "base/latency_histogram.h"
+#include "base/stage_tracer.h"
 #include "base/stl_util.h"
 #include "converter/conversion_request.h"
 #include "converter/segments.h"
 #include "rewriter/rewriter_interface.h"
+#include "rewriter/rewriter_trigger.h"
 
 namespace mozc {
 
@@ -73,27 +77,65 @@ class MergerRewriter : public RewriterInterface {
 
   // This instance owns the rewriter.
   void AddRewriter(RewriterInterface *rewriter) {
-    rewriters_.push_back(rewriter);
+    AddRewriterInternal(rewriter);
+    names_.push_back("rewriter");
+    latencies_.push_back(NULL);
+    skipped_.push_back(NULL);
+  }
+
+  // Same as above, but the processing time of the rewriter is recorded
+  // to the latency histogram and the stage trace as "rewriter/|name|".
+  // The rewrites skipped by the trigger are counted by the histogram
+  // "rewriter/|name|/skipped".
+  void AddRewriter(RewriterInterface *rewriter, const string &name) {
+    AddRewriterInternal(rewriter);
+    names_.push_back("rewriter/" + name);
+    latencies_.push_back(LatencyStats::GetHistogram(names_.back()));
+    skipped_.push_back(LatencyStats::GetHistogram(names_.back() + "/skipped"));
   }
 
   // Rewrites segments based on a request.
   virtual bool RewriteForRequest(const ConversionRequest &request,
                                  Segments *segments) const {
-    bool result = false;
-    for (size_t i = 0; i < rewriters_.size(); ++i) {
-      if (CheckCapablity(segments, rewriters_[i])) {
-        result |= rewriters_[i]->RewriteForRequest(request, segments);
-      }
-    }
-    return result;
+    return RewriteInternal(&request, kNoFocus, segments);
   }
 
   // Rewrites request and/or result.
   virtual bool Rewrite(Segments *segments) const {
+    return RewriteInternal(NULL, kNoFocus, segments);
+  }
+
+  // Same as RewriteForRequest() but the deferrable rewriters are applied
+  // only to the focused segment.  The rest of the conversion segments are
+  // marked as rewrite_pending() and completed by RewriteSegment().
+  virtual bool RewriteForRequestWithFocus(const ConversionRequest &request,
+                                          size_t focused_segment_index,
+                                          Segments *segments) const {
+    return RewriteInternal(&request, focused_segment_index, segments);
+  }
+
+  // Applies the deferrable rewriters to the |segment_index|-th segment if
+  // it is marked as rewrite_pending().  The rewriters reranking the
+  // deferred candidates are applied again in the order of the chain once
+  // a deferrable rewriter modifies the segment.
+  virtual bool RewriteSegment(size_t segment_index,
+                              Segments *segments) const {
+    if (segments == NULL || segment_index >= segments->segments_size()) {
+      return false;
+    }
+    Segment *segment = segments->mutable_segment(segment_index);
+    if (!segment->rewrite_pending()) {
+      return false;
+    }
+    segment->set_rewrite_pending(false);
     bool result = false;
     for (size_t i = 0; i < rewriters_.size(); ++i) {
-      if (CheckCapablity(segments, rewriters_[i])) {
-        result |= rewriters_[i]->Rewrite(segments);
+      if (!CheckCapablity(segments, rewriters_[i])) {
+        continue;
+      }
+      if (rewriters_[i]->deferrable() ||
+          (result && rewriters_[i]->reranks_deferred_candidates())) {
+        result |= RewriteOneSegment(i, segment_index, segments);
       }
     }
     return result;
@@ -149,7 +191,95 @@ class MergerRewriter : public RewriterInterface {
   }
 
  private:
+  // Used as |focused_segment_index| when all the segments are rewritten.
+  static const size_t kNoFocus = static_cast<size_t>(-1);
+
+  // Calls RewriteSegment() of the |index|-th rewriter.
+  bool RewriteOneSegment(size_t index, size_t segment_index,
+                         Segments *segments) const {
+    ScopedLatencyRecorder recorder(latencies_[index]);
+    ScopedTraceSpan span(names_[index]);
+    return rewriters_[index]->RewriteSegment(segment_index, segments);
+  }
+
+  // Calls RewriteSegment() of the |index|-th rewriter if it is deferrable
+  // and |focused_segment_index| is given.  Otherwise calls Rewrite() if
+  // |request| is NULL, or RewriteForRequest().
+  bool RewriteOne(size_t index, const ConversionRequest *request,
+                  size_t focused_segment_index, Segments *segments) const {
+    if (focused_segment_index != kNoFocus && rewriters_[index]->deferrable()) {
+      return RewriteOneSegment(index, focused_segment_index, segments);
+    }
+    ScopedLatencyRecorder recorder(latencies_[index]);
+    ScopedTraceSpan span(names_[index]);
+    if (request == NULL) {
+      return rewriters_[index]->Rewrite(segments);
+    }
+    return rewriters_[index]->RewriteForRequest(*request, segments);
+  }
+
+  void AddRewriterInternal(RewriterInterface *rewriter) {
+    RewriterTrigger trigger;
+    rewriter->GetTrigger(&trigger);
+    trigger_index_.Add(rewriters_.size(), trigger);
+    rewriters_.push_back(rewriter);
+  }
+
+  bool RewriteInternal(const ConversionRequest *request,
+                       size_t focused_segment_index,
+                       Segments *segments) const {
+    if (segments == NULL) {
+      return false;
+    }
+    const uint64 active_rewriters =
+        trigger_index_.GetActiveRewriters(*segments);
+    vector<size_t> targets;
+    for (size_t i = 0; i < rewriters_.size(); ++i) {
+      if (!CheckCapablity(segments, rewriters_[i])) {
+        continue;
+      }
+      if (i < RewriterTriggerIndex::kMaxRewritersSize &&
+          !(active_rewriters & (1ULL << i))) {
+        if (skipped_[i] != NULL) {
+          // Only the count matters.
+          skipped_[i]->Record(0);
+        }
+        continue;
+      }
+      targets.push_back(i);
+    }
+
+    bool deferred = false;
+    if (focused_segment_index != kNoFocus) {
+      for (size_t i = 0; i < targets.size(); ++i) {
+        deferred |= rewriters_[targets[i]]->deferrable();
+      }
+    }
+
+    bool result = false;
+    for (size_t i = 0; i < targets.size(); ++i) {
+      result |= RewriteOne(targets[i], request, focused_segment_index,
+                           segments);
+    }
+
+    // The flags are updated at last, since a rewriter may resize the
+    // segments and rewrite them again in the middle of the chain.
+    for (size_t i = segments->history_segments_size();
+         i < segments->segments_size(); ++i) {
+      segments->mutable_segment(i)->set_rewrite_pending(
+          deferred && i != focused_segment_index);
+    }
+    return result;
+  }
+
   vector<RewriterInterface *> rewriters_;
+  // The following are parallel to |rewriters_|.
+  vector<string> names_;
+  // Not owned.  NULL if not recorded.
+  vector<LatencyHistogram *> latencies_;
+  vector<LatencyHistogram *> skipped_;
+
+  RewriterTriggerIndex trigger_index_;
 
   DISALLOW_COPY_AND_ASSIGN(MergerRewriter);
 };
@@ -29,10 +29,12 @@
 
 #include <string>
 
+#include "base/latency_histogram.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "config/config.pb.h"
 #include "rewriter/merger_rewriter.h"
+#include "rewriter/rewriter_trigger.h"
 #include "testing/base/public/gunit.h"
 
 DECLARE_string(test_tmpdir);
@@ -95,6 +97,58 @@ class TestRewriter : public mozc::RewriterInterface {
   int capability_;
 };
 
+// Triggered only by the key "trigger".
+class TriggeredTestRewriter : public TestRewriter {
+ public:
+  TriggeredTestRewriter(string *buffer, const string &name)
+      : TestRewriter(buffer, name, true) {}
+
+  virtual void GetTrigger(mozc::RewriterTrigger *trigger) const {
+    trigger->AddKey("trigger");
+  }
+};
+
+// Rewriter recording the segments rewritten by RewriteSegment().
+class SegmentTestRewriter : public TestRewriter {
+ public:
+  SegmentTestRewriter(string *buffer, const string &name, bool return_value)
+      : TestRewriter(buffer, name, return_value),
+        buffer_(buffer), name_(name), return_value_(return_value) {}
+
+  virtual bool RewriteSegment(size_t segment_index,
+                              mozc::Segments *segments) const {
+    buffer_->append(name_ + ".RewriteSegment(" +
+                    mozc::Util::SimpleItoa(segment_index) + ");");
+    return return_value_;
+  }
+
+ private:
+  string *buffer_;
+  const string name_;
+  const bool return_value_;
+};
+
+class DeferrableTestRewriter : public SegmentTestRewriter {
+ public:
+  DeferrableTestRewriter(string *buffer, const string &name,
+                         bool return_value)
+      : SegmentTestRewriter(buffer, name, return_value) {}
+
+  virtual bool deferrable() const {
+    return true;
+  }
+};
+
+class RerankingTestRewriter : public SegmentTestRewriter {
+ public:
+  RerankingTestRewriter(string *buffer, const string &name)
+      : SegmentTestRewriter(buffer, name, false) {}
+
+  virtual bool reranks_deferred_candidates() const {
+    return true;
+  }
+};
+
 class MergerRewriterTest : public testing::Test {
  protected:
   virtual void SetUp() {
@@ -128,6 +182,151 @@ TEST_F(MergerRewriterTest, Rewrite) {
             call_result);
 }
 
+TEST_F(MergerRewriterTest, RecordLatency) {
+  string call_result;
+  mozc::MergerRewriter merger;
+  mozc::Segments segments;
+  segments.set_request_type(mozc::Segments::CONVERSION);
+  mozc::LatencyHistogram *histogram =
+      mozc::LatencyStats::GetHistogram("rewriter/merger_rewriter_test");
+  histogram->Clear();
+  merger.AddRewriter(new TestRewriter(&call_result, "a", false),
+                     "merger_rewriter_test");
+  merger.AddRewriter(new TestRewriter(&call_result, "b", false));
+  EXPECT_FALSE(merger.Rewrite(&segments));
+  EXPECT_EQ("a.Rewrite();"
+            "b.Rewrite();",
+            call_result);
+  EXPECT_EQ(1, histogram->count());
+
+  // Rewriters without the capability are not recorded.
+  segments.set_request_type(mozc::Segments::SUGGESTION);
+  EXPECT_FALSE(merger.Rewrite(&segments));
+  EXPECT_EQ(1, histogram->count());
+}
+
+TEST_F(MergerRewriterTest, SkipByTrigger) {
+  string call_result;
+  mozc::MergerRewriter merger;
+  mozc::Segments segments;
+  segments.set_request_type(mozc::Segments::CONVERSION);
+  segments.add_segment()->set_key("other");
+  merger.AddRewriter(new TestRewriter(&call_result, "a", false));
+  merger.AddRewriter(new TriggeredTestRewriter(&call_result, "b"),
+                     "merger_rewriter_test_triggered");
+  mozc::LatencyHistogram *run = mozc::LatencyStats::GetHistogram(
+      "rewriter/merger_rewriter_test_triggered");
+  mozc::LatencyHistogram *skipped = mozc::LatencyStats::GetHistogram(
+      "rewriter/merger_rewriter_test_triggered/skipped");
+  run->Clear();
+  skipped->Clear();
+
+  EXPECT_FALSE(merger.Rewrite(&segments));
+  EXPECT_EQ("a.Rewrite();", call_result);
+  EXPECT_EQ(0, run->count());
+  EXPECT_EQ(1, skipped->count());
+
+  call_result.clear();
+  segments.mutable_segment(0)->set_key("trigger");
+  EXPECT_TRUE(merger.Rewrite(&segments));
+  EXPECT_EQ("a.Rewrite();"
+            "b.Rewrite();",
+            call_result);
+  EXPECT_EQ(1, run->count());
+  EXPECT_EQ(1, skipped->count());
+}
+
+TEST_F(MergerRewriterTest, RewriteWithFocus) {
+  string call_result;
+  mozc::MergerRewriter merger;
+  mozc::Segments segments;
+  segments.set_request_type(mozc::Segments::CONVERSION);
+  segments.add_segment()->set_segment_type(mozc::Segment::HISTORY);
+  segments.add_segment();
+  segments.add_segment();
+  segments.add_segment();
+  merger.AddRewriter(new TestRewriter(&call_result, "a", false));
+  merger.AddRewriter(new DeferrableTestRewriter(&call_result, "b", true));
+
+  // The deferrable rewriter is applied only to the focused segment.
+  EXPECT_TRUE(merger.RewriteForRequestWithFocus(mozc::ConversionRequest(),
+                                                1, &segments));
+  EXPECT_EQ("a.Rewrite();"
+            "b.RewriteSegment(1);",
+            call_result);
+  EXPECT_FALSE(segments.segment(0).rewrite_pending());
+  EXPECT_FALSE(segments.segment(1).rewrite_pending());
+  EXPECT_TRUE(segments.segment(2).rewrite_pending());
+  EXPECT_TRUE(segments.segment(3).rewrite_pending());
+
+  // Completes the pending segment only once.
+  call_result.clear();
+  EXPECT_TRUE(merger.RewriteSegment(3, &segments));
+  EXPECT_EQ("b.RewriteSegment(3);", call_result);
+  EXPECT_FALSE(segments.segment(3).rewrite_pending());
+  call_result.clear();
+  EXPECT_FALSE(merger.RewriteSegment(3, &segments));
+  EXPECT_FALSE(merger.RewriteSegment(1, &segments));
+  EXPECT_TRUE(call_result.empty());
+
+  // Rewriting all the segments clears the pending flags.
+  call_result.clear();
+  EXPECT_TRUE(merger.RewriteForRequest(mozc::ConversionRequest(),
+                                       &segments));
+  EXPECT_EQ("a.Rewrite();"
+            "b.Rewrite();",
+            call_result);
+  EXPECT_FALSE(segments.segment(2).rewrite_pending());
+
+  // Nothing is pending without the deferrable rewriters.
+  mozc::MergerRewriter merger2;
+  merger2.AddRewriter(new TestRewriter(&call_result, "c", false));
+  EXPECT_FALSE(merger2.RewriteForRequestWithFocus(mozc::ConversionRequest(),
+                                                  1, &segments));
+  EXPECT_FALSE(segments.segment(2).rewrite_pending());
+}
+
+TEST_F(MergerRewriterTest, RerankDeferredCandidates) {
+  string call_result;
+  mozc::MergerRewriter merger;
+  mozc::Segments segments;
+  segments.set_request_type(mozc::Segments::CONVERSION);
+  segments.add_segment();
+  segments.add_segment();
+  segments.add_segment();
+  merger.AddRewriter(new RerankingTestRewriter(&call_result, "a"));
+  merger.AddRewriter(new DeferrableTestRewriter(&call_result, "b", true));
+  merger.AddRewriter(new RerankingTestRewriter(&call_result, "c"));
+  merger.AddRewriter(new DeferrableTestRewriter(&call_result, "d", false));
+
+  EXPECT_TRUE(merger.RewriteForRequestWithFocus(mozc::ConversionRequest(),
+                                                0, &segments));
+  EXPECT_EQ("a.Rewrite();"
+            "b.RewriteSegment(0);"
+            "c.Rewrite();"
+            "d.RewriteSegment(0);",
+            call_result);
+
+  // Only the rerankers following the modifying deferrable rewriter are
+  // applied again.
+  call_result.clear();
+  EXPECT_TRUE(merger.RewriteSegment(1, &segments));
+  EXPECT_EQ("b.RewriteSegment(1);"
+            "c.RewriteSegment(1);"
+            "d.RewriteSegment(1);",
+            call_result);
+
+  // Nothing is reranked if no deferrable rewriter modifies the segment.
+  mozc::MergerRewriter merger2;
+  merger2.AddRewriter(new DeferrableTestRewriter(&call_result, "e", false));
+  merger2.AddRewriter(new RerankingTestRewriter(&call_result, "f"));
+  EXPECT_FALSE(merger2.RewriteForRequestWithFocus(mozc::ConversionRequest(),
+                                                  0, &segments));
+  call_result.clear();
+  EXPECT_FALSE(merger2.RewriteSegment(2, &segments));
+  EXPECT_EQ("e.RewriteSegment(2);", call_result);
+}
+
 TEST_F(MergerRewriterTest, RewriteCheckTest) {
   string call_result;
   mozc::MergerRewriter merger;
@@ -44,6 +44,18 @@ enum CandidateType {
   TRANSLITERATION
 };
 
+bool NormalizeText(CandidateType type, string *text) {
+  switch (type) {
+    case CANDIDATE:
+      return TextNormalizer::NormalizeCandidateTextInPlace(text);
+    case TRANSLITERATION:
+      return TextNormalizer::NormalizeTransliterationTextInPlace(text);
+    default:
+      LOG(ERROR) << "unkown type";
+      return false;
+  }
+}
+
 bool NormalizeCandidate(Segment::Candidate *candidate,
                         CandidateType type) {
   DCHECK(candidate);
@@ -51,28 +63,26 @@ bool NormalizeCandidate(Segment::Candidate *candidate,
     return false;
   }
 
-  string value, content_value;
-  switch (type) {
-    case CANDIDATE:
-      TextNormalizer::NormalizeCandidateText(candidate->value, &value);
-      TextNormalizer::NormalizeCandidateText(candidate->content_value,
-                                             &content_value);
-      break;
-    case TRANSLITERATION:
-      TextNormalizer::NormalizeTransliterationText(candidate->value, &value);
-      TextNormalizer::NormalizeTransliterationText(candidate->content_value,
-                                                   &content_value);
-      break;
-    default:
-      LOG(ERROR) << "unkown type";
+  // content_value is usually a prefix of value.  Since the normalization
+  // works character by character, content_value needs no normalization
+  // when value needs none, and it is the same as normalized value when
+  // they are identical.
+  if (Util::StartsWith(candidate->value, candidate->content_value)) {
+    const bool same_value =
+        (candidate->value.size() == candidate->content_value.size());
+    if (!NormalizeText(type, &candidate->value)) {
       return false;
+    }
+    if (same_value) {
+      candidate->content_value = candidate->value;
+    } else {
+      NormalizeText(type, &candidate->content_value);
+    }
+    return true;
   }
 
-  const bool modified = (content_value != candidate->content_value ||
-                         value != candidate->value);
-  candidate->value = value;
-  candidate->content_value = content_value;
-
+  bool modified = NormalizeText(type, &candidate->value);
+  modified |= NormalizeText(type, &candidate->content_value);
   return modified;
 }
 }  // namespace
@@ -98,6 +98,39 @@ TEST_F(NormalizationRewriterTest, NormalizationTest) {
   EXPECT_EQ("\xE3\x80\x9C", segments.segment(0).candidate(0).value);
 #endif
 
+  // Transliteration in meta candidates.
+  segments.Clear();
+  //  AddSegment("ゔぁいおりんを", "ゔぁいおりんを", &segments);
+  AddSegment("\xE3\x82\x94\xE3\x81\x81\xE3\x81\x84\xE3\x81\x8A"
+             "\xE3\x82\x8A\xE3\x82\x93\xE3\x82\x92",
+             "\xE3\x82\x94\xE3\x81\x81\xE3\x81\x84\xE3\x81\x8A"
+             "\xE3\x82\x8A\xE3\x82\x93\xE3\x82\x92", &segments);
+  {
+    Segment::Candidate *meta =
+        segments.mutable_segment(0)->add_meta_candidate();
+    meta->Init();
+    // "ゔぁいおりんを"
+    meta->value = "\xE3\x82\x94\xE3\x81\x81\xE3\x81\x84\xE3\x81\x8A"
+        "\xE3\x82\x8A\xE3\x82\x93\xE3\x82\x92";
+    // "ゔぁいおりん"
+    meta->content_value = "\xE3\x82\x94\xE3\x81\x81\xE3\x81\x84"
+        "\xE3\x81\x8A\xE3\x82\x8A\xE3\x82\x93";
+  }
+  EXPECT_TRUE(normalization_rewriter.Rewrite(&segments));
+  // "ヴぁいおりんを"
+  EXPECT_EQ("\xE3\x83\xB4\xE3\x81\x81\xE3\x81\x84\xE3\x81\x8A"
+            "\xE3\x82\x8A\xE3\x82\x93\xE3\x82\x92",
+            segments.segment(0).meta_candidate(0).value);
+  // "ヴぁいおりん"
+  EXPECT_EQ("\xE3\x83\xB4\xE3\x81\x81\xE3\x81\x84\xE3\x81\x8A"
+            "\xE3\x82\x8A\xE3\x82\x93",
+            segments.segment(0).meta_candidate(0).content_value);
+  // Regular candidates are not transliterations.
+  // "ゔぁいおりんを"
+  EXPECT_EQ("\xE3\x82\x94\xE3\x81\x81\xE3\x81\x84\xE3\x81\x8A"
+            "\xE3\x82\x8A\xE3\x82\x93\xE3\x82\x92",
+            segments.segment(0).candidate(0).value);
+
   // not normalized.
   segments.Clear();
   // AddSegment("なみ", "〜", &segments);
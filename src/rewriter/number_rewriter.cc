@@ -40,6 +40,7 @@
 #include "config/config_handler.h"
 #include "config/config.pb.h"
 #include "converter/segments.h"
+#include "rewriter/rewriter_result_cache.h"
 #include "session/commands.pb.h"
 
 namespace mozc {
@@ -303,7 +304,7 @@ void InsertHalfArabic(const string &half_arabic,
                                        Util::NumberString::DEFAULT_STYLE));
 }
 
-void GetNumbers(RewriteType type, const Segments &segments,
+void GetNumbers(RewriteType type, bool use_radixes,
                 const string &arabic_content_value,
                 vector<Util::NumberString> *output) {
   DCHECK(output);
@@ -321,12 +322,54 @@ void GetNumbers(RewriteType type, const Segments &segments,
     Util::ArabicToOtherForms(arabic_content_value, output);
   }
 
+  if (use_radixes) {
+    Util::ArabicToOtherRadixes(arabic_content_value, output);
+  }
+}
+
+// Gets the candidates of GetNumbers() without duplicated values.  Only
+// value, description and style are set.  The results are memoized in
+// RewriterResultCache as the triples of them.
+void GetConvertedNumbers(RewriteType type, const Segments &segments,
+                         const string &arabic_content_value,
+                         vector<Segment::Candidate> *results) {
+  DCHECK(results);
   // Radix conversion is done only for conversion mode.
   // Showing radix candidates is annoying for an user.
-  if (segments.conversion_segments_size() == 1 &&
-      segments.request_type() == Segments::CONVERSION) {
-    Util::ArabicToOtherRadixes(arabic_content_value, output);
+  const bool use_radixes = (segments.conversion_segments_size() == 1 &&
+                            segments.request_type() == Segments::CONVERSION);
+
+  string key = Util::SimpleItoa(type);
+  key.append(use_radixes ? "R" : "N");
+  key.append(arabic_content_value);
+
+  vector<string> cached;
+  if (RewriterResultCache::Lookup(RewriterResultCache::NUMBER_REWRITER,
+                                  key, &cached)) {
+    for (size_t i = 0; i + 2 < cached.size(); i += 3) {
+      Segment::Candidate cand;
+      cand.value = cached[i];
+      cand.description = cached[i + 1];
+      cand.style = static_cast<Util::NumberString::Style>(
+          Util::SimpleAtoi(cached[i + 2]));
+      results->push_back(cand);
+    }
+    return;
+  }
+
+  vector<Util::NumberString> output;
+  GetNumbers(type, use_radixes, arabic_content_value, &output);
+  for (int j = 0; j < output.size(); j++) {
+    PushBackCandidate(output[j].value, output[j].description, output[j].style,
+                      results);
   }
+  for (size_t i = 0; i < results->size(); ++i) {
+    cached.push_back(results->at(i).value);
+    cached.push_back(results->at(i).description);
+    cached.push_back(Util::SimpleItoa(results->at(i).style));
+  }
+  RewriterResultCache::Insert(RewriterResultCache::NUMBER_REWRITER,
+                              key, cached);
 }
 }  // namespace
 
@@ -376,13 +419,9 @@ bool NumberRewriter::Rewrite(Segments *segments) const {
                  << arabic_content_value;
       continue;
     }
-    vector<Util::NumberString> output;
-    GetNumbers(type, *segments, arabic_content_value, &output);
     vector<Segment::Candidate> converted_numbers;
-    for (int j = 0; j < output.size(); j++) {
-      PushBackCandidate(output[j].value, output[j].description, output[j].style,
+    GetConvertedNumbers(type, *segments, arabic_content_value,
                         &converted_numbers);
-    }
     SetCandidatesInfo(arabic_cand, &converted_numbers);
     int insert_pos = GetInsertPos(base_candidate_pos, *seg, type);
     EraseExistingCandidates(
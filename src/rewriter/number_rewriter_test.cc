@@ -29,12 +29,14 @@
 
 #include <string>
 
+#include "base/latency_histogram.h"
 #include "base/util.h"
 #include "config/config_handler.h"
 #include "config/config.pb.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
 #include "rewriter/number_rewriter.h"
+#include "rewriter/rewriter_result_cache.h"
 #include "session/commands.pb.h"
 #include "testing/base/public/gunit.h"
 
@@ -191,6 +193,33 @@ TEST_F(NumberRewriterTest, BasicTest) {
   seg->clear_candidates();
 }
 
+TEST_F(NumberRewriterTest, ResultIsCached) {
+  NumberRewriter number_rewriter;
+  RewriterResultCache::Clear();
+  LatencyStats::ClearAll();
+  const LatencyHistogram *hits =
+      LatencyStats::GetHistogram("rewriter_cache/number/hit");
+
+  Segments segments;
+  SetupSegments("123", &segments);
+  EXPECT_TRUE(number_rewriter.Rewrite(&segments));
+  vector<string> first_values;
+  for (size_t i = 0; i < segments.segment(0).candidates_size(); ++i) {
+    first_values.push_back(segments.segment(0).candidate(i).value);
+  }
+
+  EXPECT_EQ(0, hits->count());
+
+  SetupSegments("123", &segments);
+  EXPECT_TRUE(number_rewriter.Rewrite(&segments));
+  EXPECT_EQ(1, hits->count());
+  ASSERT_EQ(first_values.size(), segments.segment(0).candidates_size());
+  for (size_t i = 0; i < first_values.size(); ++i) {
+    EXPECT_EQ(first_values[i], segments.segment(0).candidate(i).value);
+  }
+  RewriterResultCache::Clear();
+}
+
 TEST_F(NumberRewriterTest, RequestType) {
   class TestData {
    public:
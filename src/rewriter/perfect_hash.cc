@@ -0,0 +1,182 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/perfect_hash.h"
+
+#include <algorithm>
+#include <vector>
+#include "base/base.h"
+
+namespace mozc {
+namespace {
+// Constants of 64bit FNV-1a.
+const uint64 kFnvOffsetBasis = 14695981039346656037ULL;
+const uint64 kFnvPrime = 1099511628211ULL;
+
+const uint64 kGoldenRatio = 0x9E3779B97F4A7C15ULL;
+
+// Average number of keys in a bucket.
+const size_t kBucketSize = 3;
+
+// Give up when no displacement is found for a bucket within this range.
+const uint32 kMaxDisplacement = 1 << 26;
+
+// Finalizer of SplitMix64.
+inline uint64 Mix(uint64 x) {
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  return x ^ (x >> 31);
+}
+
+inline size_t GetBucket(uint64 hash, size_t displacement_size) {
+  return static_cast<size_t>(Mix(hash) % displacement_size);
+}
+
+inline size_t GetSlotWithDisplacement(uint64 hash, uint32 displacement,
+                                      size_t table_size) {
+  return static_cast<size_t>(
+      Mix(hash + (static_cast<uint64>(displacement) + 1) * kGoldenRatio) %
+      table_size);
+}
+
+struct CompareBySize {
+  bool operator()(const vector<size_t> *lhs,
+                  const vector<size_t> *rhs) const {
+    return lhs->size() > rhs->size();
+  }
+};
+}  // namespace
+
+// static
+uint64 PerfectHash::Hash(const char *data, size_t size) {
+  return HashAppend(kFnvOffsetBasis, data, size);
+}
+
+// static
+uint64 PerfectHash::HashAppend(uint64 hash, const char *data, size_t size) {
+  for (size_t i = 0; i < size; ++i) {
+    hash ^= static_cast<uint8>(data[i]);
+    hash *= kFnvPrime;
+  }
+  return hash;
+}
+
+// static
+size_t PerfectHash::GetSlot(uint64 hash,
+                            const uint32 *displacement,
+                            size_t displacement_size,
+                            size_t table_size) {
+  DCHECK(displacement);
+  DCHECK_GT(displacement_size, 0);
+  DCHECK_GT(table_size, 0);
+  return GetSlotWithDisplacement(
+      hash, displacement[GetBucket(hash, displacement_size)], table_size);
+}
+
+// static
+bool PerfectHash::Build(const vector<uint64> &hashes,
+                        vector<uint32> *displacement,
+                        vector<size_t> *slots) {
+  DCHECK(displacement);
+  DCHECK(slots);
+  const size_t table_size = hashes.size();
+  displacement->clear();
+  slots->assign(table_size, 0);
+  if (table_size == 0) {
+    return true;
+  }
+
+  vector<uint64> sorted_hashes(hashes);
+  sort(sorted_hashes.begin(), sorted_hashes.end());
+  if (adjacent_find(sorted_hashes.begin(), sorted_hashes.end()) !=
+      sorted_hashes.end()) {
+    LOG(ERROR) << "Duplicated hash values";
+    return false;
+  }
+
+  const size_t displacement_size =
+      (table_size + kBucketSize - 1) / kBucketSize;
+  displacement->assign(displacement_size, 0);
+
+  // Each bucket holds the indices of |hashes|.
+  vector<vector<size_t> > buckets(displacement_size);
+  for (size_t i = 0; i < table_size; ++i) {
+    buckets[GetBucket(hashes[i], displacement_size)].push_back(i);
+  }
+
+  // Place the largest buckets first, as they are the hardest to place.
+  vector<const vector<size_t> *> order;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    if (!buckets[i].empty()) {
+      order.push_back(&buckets[i]);
+    }
+  }
+  stable_sort(order.begin(), order.end(), CompareBySize());
+
+  vector<bool> used(table_size, false);
+  vector<size_t> bucket_slots;
+  for (size_t i = 0; i < order.size(); ++i) {
+    const vector<size_t> &bucket = *order[i];
+    const size_t bucket_id = GetBucket(hashes[bucket[0]], displacement_size);
+    bool found = false;
+    for (uint32 d = 0; d < kMaxDisplacement; ++d) {
+      bucket_slots.clear();
+      bool ok = true;
+      for (size_t j = 0; j < bucket.size(); ++j) {
+        const size_t slot =
+            GetSlotWithDisplacement(hashes[bucket[j]], d, table_size);
+        if (used[slot] ||
+            find(bucket_slots.begin(), bucket_slots.end(), slot) !=
+            bucket_slots.end()) {
+          ok = false;
+          break;
+        }
+        bucket_slots.push_back(slot);
+      }
+      if (!ok) {
+        continue;
+      }
+      for (size_t j = 0; j < bucket.size(); ++j) {
+        used[bucket_slots[j]] = true;
+        (*slots)[bucket[j]] = bucket_slots[j];
+      }
+      (*displacement)[bucket_id] = d;
+      found = true;
+      break;
+    }
+    if (!found) {
+      LOG(ERROR) << "Cannot find displacement for bucket " << bucket_id;
+      return false;
+    }
+  }
+
+  return true;
+}
+}  // namespace mozc
@@ -0,0 +1,74 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Minimal perfect hash (CHD: compress, hash and displace) for the static
+// tables embedded into the rewriters. The table is built offline by the
+// dictionary generators; at runtime a lookup is one hash computation and
+// one access to the displacement array. The hash function and the slot
+// assignment are also implemented in embedded_dictionary_compiler.py, so
+// both implementations must be kept in sync.
+
+#ifndef MOZC_REWRITER_PERFECT_HASH_H_
+#define MOZC_REWRITER_PERFECT_HASH_H_
+
+#include <vector>
+#include "base/base.h"
+
+namespace mozc {
+
+class PerfectHash {
+ public:
+  // Returns FNV-1a hash of |data|.
+  static uint64 Hash(const char *data, size_t size);
+
+  // Continues |hash| with |data|. Used to hash several fields without
+  // concatenating them into a temporary string.
+  static uint64 HashAppend(uint64 hash, const char *data, size_t size);
+
+  // Returns the slot in [0, table_size) assigned to |hash|.
+  // For a hash which was not used to build the table, an arbitrary slot
+  // is returned, so the caller has to compare the key stored in the slot.
+  static size_t GetSlot(uint64 hash,
+                        const uint32 *displacement,
+                        size_t displacement_size,
+                        size_t table_size);
+
+  // Builds the displacement table for |hashes|. |slots|[i] is the slot
+  // assigned to |hashes|[i]. Returns false if |hashes| has duplicates.
+  static bool Build(const vector<uint64> &hashes,
+                    vector<uint32> *displacement,
+                    vector<size_t> *slots);
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(PerfectHash);
+};
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_PERFECT_HASH_H_
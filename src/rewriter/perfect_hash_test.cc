@@ -0,0 +1,103 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include <set>
+#include <string>
+#include <vector>
+#include "base/base.h"
+#include "base/util.h"
+#include "rewriter/perfect_hash.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+TEST(PerfectHashTest, Hash) {
+  // Test vectors of 64bit FNV-1a. The same values are expected by
+  // embedded_dictionary_compiler.py.
+  EXPECT_EQ(14695981039346656037ULL, PerfectHash::Hash("", 0));
+  EXPECT_EQ(0xAF63DC4C8601EC8CULL, PerfectHash::Hash("a", 1));
+  EXPECT_EQ(0x85944171F73967E8ULL, PerfectHash::Hash("foobar", 6));
+
+  const uint64 foo = PerfectHash::Hash("foo", 3);
+  EXPECT_EQ(PerfectHash::Hash("foobar", 6),
+            PerfectHash::HashAppend(foo, "bar", 3));
+}
+
+TEST(PerfectHashTest, Build) {
+  const size_t kSizes[] = { 1, 2, 3, 10, 1000, 20000 };
+  for (size_t n = 0; n < arraysize(kSizes); ++n) {
+    vector<string> keys;
+    vector<uint64> hashes;
+    for (size_t i = 0; i < kSizes[n]; ++i) {
+      keys.push_back("key" + Util::SimpleItoa(static_cast<int32>(i)));
+      hashes.push_back(PerfectHash::Hash(keys.back().data(),
+                                         keys.back().size()));
+    }
+
+    vector<uint32> displacement;
+    vector<size_t> slots;
+    ASSERT_TRUE(PerfectHash::Build(hashes, &displacement, &slots));
+    ASSERT_EQ(keys.size(), slots.size());
+    ASSERT_FALSE(displacement.empty());
+
+    // The slots are a permutation of [0, n).
+    set<size_t> used;
+    for (size_t i = 0; i < keys.size(); ++i) {
+      EXPECT_GT(keys.size(), slots[i]);
+      EXPECT_TRUE(used.insert(slots[i]).second);
+      EXPECT_EQ(slots[i],
+                PerfectHash::GetSlot(hashes[i], &displacement[0],
+                                     displacement.size(), keys.size()));
+    }
+  }
+}
+
+TEST(PerfectHashTest, BuildEmpty) {
+  vector<uint64> hashes;
+  vector<uint32> displacement;
+  vector<size_t> slots;
+  EXPECT_TRUE(PerfectHash::Build(hashes, &displacement, &slots));
+  EXPECT_TRUE(displacement.empty());
+  EXPECT_TRUE(slots.empty());
+}
+
+TEST(PerfectHashTest, BuildDuplicated) {
+  vector<uint64> hashes;
+  hashes.push_back(1);
+  hashes.push_back(2);
+  hashes.push_back(1);
+  vector<uint32> displacement;
+  vector<size_t> slots;
+  EXPECT_FALSE(PerfectHash::Build(hashes, &displacement, &slots));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -66,34 +66,35 @@ class RewriterImpl : public MergerRewriter {
 };
 
 RewriterImpl::RewriterImpl() {
-  AddRewriter(new UserDictionaryRewriter);
-  AddRewriter(new FocusCandidateRewriter);
-  AddRewriter(new TransliterationRewriter);
-  AddRewriter(new EnglishVariantsRewriter);
-  AddRewriter(new NumberRewriter);
-  AddRewriter(new CollocationRewriter);
-  AddRewriter(new SingleKanjiRewriter);
-  AddRewriter(new EmoticonRewriter);
-  AddRewriter(new CalculatorRewriter);
-  AddRewriter(new SymbolRewriter);
-  AddRewriter(new UnicodeRewriter);
-  AddRewriter(new VariantsRewriter);
-  AddRewriter(new ZipcodeRewriter);
-  AddRewriter(new DiceRewriter);
+  AddRewriter(new UserDictionaryRewriter, "user_dictionary");
+  AddRewriter(new FocusCandidateRewriter, "focus_candidate");
+  AddRewriter(new TransliterationRewriter, "transliteration");
+  AddRewriter(new EnglishVariantsRewriter, "english_variants");
+  AddRewriter(new NumberRewriter, "number");
+  AddRewriter(new CollocationRewriter, "collocation");
+  AddRewriter(new SingleKanjiRewriter, "single_kanji");
+  AddRewriter(new EmoticonRewriter, "emoticon");
+  AddRewriter(new CalculatorRewriter, "calculator");
+  AddRewriter(new SymbolRewriter, "symbol");
+  AddRewriter(new UnicodeRewriter, "unicode");
+  AddRewriter(new VariantsRewriter, "variants");
+  AddRewriter(new ZipcodeRewriter, "zipcode");
+  AddRewriter(new DiceRewriter, "dice");
 
   if (FLAGS_use_history_rewriter) {
-    AddRewriter(new UserBoundaryHistoryRewriter);
-    AddRewriter(new UserSegmentHistoryRewriter);
+    AddRewriter(new UserBoundaryHistoryRewriter, "user_boundary_history");
+    AddRewriter(new UserSegmentHistoryRewriter, "user_segment_history");
   }
-  AddRewriter(new DateRewriter);
-  AddRewriter(new FortuneRewriter);
-  AddRewriter(new CommandRewriter);
-  AddRewriter(new VersionRewriter);
+  AddRewriter(new DateRewriter, "date");
+  AddRewriter(new FortuneRewriter, "fortune");
+  AddRewriter(new CommandRewriter, "command");
+  AddRewriter(new VersionRewriter, "version");
 #ifdef USE_USAGE_REWRITER
-  AddRewriter(new UsageRewriter);
+  AddRewriter(new UsageRewriter, "usage");
 #endif  // USE_USAGE_REWRITER
-  AddRewriter(new NormalizationRewriter);
-  AddRewriter(new RemoveRedundantCandidateRewriter);
+  AddRewriter(new NormalizationRewriter, "normalization");
+  AddRewriter(new RemoveRedundantCandidateRewriter,
+              "remove_redundant_candidate");
 }
 
 RewriterInterface *g_rewriter = NULL;
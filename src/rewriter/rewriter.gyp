@@ -57,8 +57,11 @@
         'fortune_rewriter.cc',
         'normalization_rewriter.cc',
         'number_rewriter.cc',
+        'perfect_hash.cc',
         'remove_redundant_candidate_rewriter.cc',
         'rewriter.cc',
+        'rewriter_result_cache.cc',
+        'rewriter_trigger.cc',
         'single_kanji_rewriter.cc',
         'symbol_rewriter.cc',
         'transliteration_rewriter.cc',
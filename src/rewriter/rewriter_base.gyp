@@ -207,6 +207,7 @@
       'sources': [
         'embedded_dictionary.cc',
         'gen_single_kanji_rewriter_dictionary_main.cc',
+        'perfect_hash.cc',
       ],
        'dependencies': [
          '../base/base.gyp:base',
@@ -231,6 +232,7 @@
         'dictionary_generator.cc',
         'embedded_dictionary.cc',
         'gen_symbol_rewriter_dictionary_main.cc',
+        'perfect_hash.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -253,6 +255,7 @@
       'type': 'executable',
       'sources': [
         'gen_usage_rewriter_dictionary_main.cc',
+        'perfect_hash.cc',
       ],
       'dependencies': [
         '../base/base.gyp:base',
@@ -35,6 +35,7 @@
 namespace mozc {
 
 class ConversionRequest;
+class RewriterTrigger;
 class Segments;
 
 class RewriterInterface {
@@ -56,6 +57,31 @@ class RewriterInterface {
     return CONVERSION;
   }
 
+  // Fills the condition of the segments under which this rewriter can
+  // modify them.  MergerRewriter skips the rewriter without calling it
+  // when the condition is not satisfied.  Leave |trigger| untouched if
+  // the rewriter should always be called.
+  virtual void GetTrigger(RewriterTrigger *trigger) const {}
+
+  // Returns true if this rewriter changes each conversion segment
+  // independently and, when there are two or more conversion segments,
+  // only appends candidates to the tail or writes the usage fields, which
+  // no rewriter reads to rank the candidates.  Such a rewriter does not
+  // change the top candidates of the segments by itself, so it is applied
+  // only to the focused segment by RewriteForRequestWithFocus(), and to
+  // the other segments by RewriteSegment() when they get focused.
+  virtual bool deferrable() const {
+    return false;
+  }
+
+  // Returns true if this rewriter reranks the candidates of each segment
+  // including the ones appended by the deferrable rewriters.  Such a
+  // rewriter is applied again by RewriteSegment() to a segment to which
+  // the deferrable rewriters have appended candidates later.
+  virtual bool reranks_deferred_candidates() const {
+    return false;
+  }
+
   // TODO(noriyukit): Deprecates this method and migrate to RewriteForRequest.
   // Rewrite request and/or result.
   virtual bool Rewrite(Segments *segments) const = 0;
@@ -66,6 +92,23 @@ class RewriterInterface {
     return Rewrite(segments);
   }
 
+  // Same as RewriteForRequest() but the deferrable rewriters may be applied
+  // only to the |focused_segment_index|-th segment.  The other conversion
+  // segments are then marked as Segment::rewrite_pending().  The index
+  // counts the history segments as in Focus().
+  virtual bool RewriteForRequestWithFocus(const ConversionRequest &request,
+                                          size_t focused_segment_index,
+                                          Segments *segments) const {
+    return RewriteForRequest(request, segments);
+  }
+
+  // Rewrites only the |segment_index|-th segment.  Deferrable rewriters
+  // implement this to complete a segment marked as rewrite_pending().
+  virtual bool RewriteSegment(size_t segment_index,
+                              Segments *segments) const {
+    return false;
+  }
+
   // This method is mainly called when user puts SPACE key
   // and changes the focused candidate.
   // In this method, Converter will find bracketing matching.
@@ -0,0 +1,141 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/rewriter_result_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/latency_histogram.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+#include "base/stopwatch.h"
+#include "config/config_handler.h"
+#include "storage/lru_cache.h"
+
+namespace mozc {
+namespace {
+
+const char *GetRewriterName(RewriterResultCache::RewriterId id) {
+  switch (id) {
+    case RewriterResultCache::NUMBER_REWRITER:
+      return "number";
+    case RewriterResultCache::TRANSLITERATION_REWRITER:
+      return "transliteration";
+    default:
+      return "unknown";
+  }
+}
+
+class RewriterResultCacheImpl {
+ public:
+  RewriterResultCacheImpl() : cache_(RewriterResultCache::kMaxSize) {
+    for (int i = 0; i < RewriterResultCache::NUM_REWRITERS; ++i) {
+      const string name = string("rewriter_cache/") + GetRewriterName(
+          static_cast<RewriterResultCache::RewriterId>(i));
+      hit_latency_[i] = LatencyStats::GetHistogram(name + "/hit");
+      miss_latency_[i] = LatencyStats::GetHistogram(name + "/miss");
+    }
+  }
+
+  bool Lookup(RewriterResultCache::RewriterId id, const string &key,
+              vector<string> *result) {
+    DCHECK_LT(id, RewriterResultCache::NUM_REWRITERS);
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    bool found = false;
+    {
+      scoped_lock l(&mutex_);
+      const vector<string> *value = cache_.Lookup(key);
+      if (value != NULL) {
+        *result = *value;
+        found = true;
+      }
+    }
+    LatencyHistogram *histogram =
+        found ? hit_latency_[id] : miss_latency_[id];
+    histogram->Record(
+        static_cast<uint64>(stopwatch.GetElapsedMicroseconds()));
+    return found;
+  }
+
+  void Insert(const string &key, const vector<string> &result) {
+    scoped_lock l(&mutex_);
+    cache_.Insert(key, result);
+  }
+
+  void Clear() {
+    scoped_lock l(&mutex_);
+    cache_.Clear();
+  }
+
+ private:
+  Mutex mutex_;
+  LRUCache<string, vector<string> > cache_;
+  LatencyHistogram *hit_latency_[RewriterResultCache::NUM_REWRITERS];
+  LatencyHistogram *miss_latency_[RewriterResultCache::NUM_REWRITERS];
+};
+
+string GetCacheKey(RewriterResultCache::RewriterId id, const string &key) {
+  const uint64 generation = config::ConfigHandler::GetConfigGeneration();
+  string result;
+  result.reserve(1 + sizeof(generation) + key.size());
+  result.push_back(static_cast<char>(id));
+  result.append(reinterpret_cast<const char *>(&generation),
+                sizeof(generation));
+  result.append(key);
+  return result;
+}
+
+}  // namespace
+
+const size_t RewriterResultCache::kMaxSize;
+
+// static
+bool RewriterResultCache::Lookup(RewriterId id, const string &key,
+                                 vector<string> *result) {
+  DCHECK(result);
+  return Singleton<RewriterResultCacheImpl>::get()->Lookup(
+      id, GetCacheKey(id, key), result);
+}
+
+// static
+void RewriterResultCache::Insert(RewriterId id, const string &key,
+                                 const vector<string> &result) {
+  Singleton<RewriterResultCacheImpl>::get()->Insert(
+      GetCacheKey(id, key), result);
+}
+
+// static
+void RewriterResultCache::Clear() {
+  Singleton<RewriterResultCacheImpl>::get()->Clear();
+}
+
+}  // namespace mozc
@@ -0,0 +1,84 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// RewriterResultCache memoizes the candidates computed by the rewriters
+// whose results are determined by a few strings such as the segment key
+// or the content value of a base candidate, so that repeated conversions
+// of the same phrase during editing skip the computation.
+
+#ifndef MOZC_REWRITER_REWRITER_RESULT_CACHE_H_
+#define MOZC_REWRITER_REWRITER_RESULT_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+
+namespace mozc {
+
+// The cache is process-wide, bounded and thread-safe.  An entry is keyed
+// by the rewriter, the key given by the rewriter and the generation of
+// the config, so that updating the config invalidates all the entries.
+// The cached value is a list of strings whose meaning is defined by each
+// rewriter.
+//
+// Lookups are recorded to the latency histograms named like
+// "rewriter_cache/number/hit" and "rewriter_cache/number/miss", so that
+// the hit ratio is reported by GET_LATENCY_STATS and DUMP_LATENCY_STATS.
+class RewriterResultCache {
+ public:
+  enum RewriterId {
+    NUMBER_REWRITER = 0,
+    TRANSLITERATION_REWRITER,
+    NUM_REWRITERS,
+  };
+
+  // Maximum number of the entries.
+  static const size_t kMaxSize = 1024;
+
+  // Returns true and copies the cached value to |result| if found.
+  static bool Lookup(RewriterId id, const string &key,
+                     vector<string> *result);
+
+  // Inserts |result| for |key|.  The least recently used entry is evicted
+  // if the cache is full.
+  static void Insert(RewriterId id, const string &key,
+                     const vector<string> &result);
+
+  // Removes all the entries.
+  static void Clear();
+
+ private:
+  DISALLOW_IMPLICIT_CONSTRUCTORS(RewriterResultCache);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_REWRITER_RESULT_CACHE_H_
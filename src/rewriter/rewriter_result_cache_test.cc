@@ -0,0 +1,131 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/rewriter_result_cache.h"
+
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/latency_histogram.h"
+#include "base/util.h"
+#include "config/config.pb.h"
+#include "config/config_handler.h"
+#include "testing/base/public/googletest.h"
+#include "testing/base/public/gunit.h"
+
+DECLARE_string(test_tmpdir);
+
+namespace mozc {
+namespace {
+
+class RewriterResultCacheTest : public testing::Test {
+ protected:
+  virtual void SetUp() {
+    Util::SetUserProfileDirectory(FLAGS_test_tmpdir);
+    RewriterResultCache::Clear();
+    LatencyStats::ClearAll();
+  }
+
+  virtual void TearDown() {
+    RewriterResultCache::Clear();
+  }
+};
+
+TEST_F(RewriterResultCacheTest, LookupAndInsert) {
+  vector<string> result;
+  EXPECT_FALSE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER, "key", &result));
+
+  vector<string> values;
+  values.push_back("a");
+  values.push_back("b");
+  RewriterResultCache::Insert(RewriterResultCache::NUMBER_REWRITER,
+                              "key", values);
+  EXPECT_TRUE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER, "key", &result));
+  EXPECT_EQ(values, result);
+
+  // Entries are separated by the rewriters.
+  EXPECT_FALSE(RewriterResultCache::Lookup(
+      RewriterResultCache::TRANSLITERATION_REWRITER, "key", &result));
+
+  // Empty result is also cached.
+  RewriterResultCache::Insert(RewriterResultCache::TRANSLITERATION_REWRITER,
+                              "key", vector<string>());
+  EXPECT_TRUE(RewriterResultCache::Lookup(
+      RewriterResultCache::TRANSLITERATION_REWRITER, "key", &result));
+  EXPECT_TRUE(result.empty());
+
+  // Lookups are recorded to the latency histograms.
+  EXPECT_EQ(1, LatencyStats::GetHistogram(
+      "rewriter_cache/number/hit")->count());
+  EXPECT_EQ(1, LatencyStats::GetHistogram(
+      "rewriter_cache/number/miss")->count());
+  EXPECT_EQ(1, LatencyStats::GetHistogram(
+      "rewriter_cache/transliteration/hit")->count());
+  EXPECT_EQ(1, LatencyStats::GetHistogram(
+      "rewriter_cache/transliteration/miss")->count());
+
+  RewriterResultCache::Clear();
+  EXPECT_FALSE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER, "key", &result));
+}
+
+TEST_F(RewriterResultCacheTest, ConfigUpdateInvalidatesEntries) {
+  RewriterResultCache::Insert(RewriterResultCache::NUMBER_REWRITER,
+                              "key", vector<string>(1, "value"));
+  vector<string> result;
+  EXPECT_TRUE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER, "key", &result));
+
+  config::Config config;
+  config::ConfigHandler::GetDefaultConfig(&config);
+  config::ConfigHandler::SetConfig(config);
+  EXPECT_FALSE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER, "key", &result));
+}
+
+TEST_F(RewriterResultCacheTest, SizeIsBounded) {
+  for (size_t i = 0; i < RewriterResultCache::kMaxSize * 2; ++i) {
+    RewriterResultCache::Insert(RewriterResultCache::NUMBER_REWRITER,
+                                Util::SimpleItoa(i), vector<string>());
+  }
+  // The recent entries are kept.
+  vector<string> result;
+  EXPECT_TRUE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER,
+      Util::SimpleItoa(RewriterResultCache::kMaxSize * 2 - 1), &result));
+  EXPECT_FALSE(RewriterResultCache::Lookup(
+      RewriterResultCache::NUMBER_REWRITER, "0", &result));
+}
+
+}  // namespace
+}  // namespace mozc
@@ -51,7 +51,10 @@
         'merger_rewriter_test.cc',
         'number_rewriter_test.cc',
         'normalization_rewriter_test.cc',
+        'perfect_hash_test.cc',
         'remove_redundant_candidate_rewriter_test.cc',
+        'rewriter_result_cache_test.cc',
+        'rewriter_trigger_test.cc',
         'rewriter_test.cc',
         'symbol_rewriter_test.cc',
         'transliteration_rewriter_test.cc',
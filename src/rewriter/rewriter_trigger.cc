@@ -0,0 +1,112 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/rewriter_trigger.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/util.h"
+#include "converter/segments.h"
+
+namespace mozc {
+
+// static
+int RewriterTrigger::GetFeatures(const Segments &segments) {
+  int features = NO_FEATURE;
+  const size_t size = segments.conversion_segments_size();
+  if (size == 1) {
+    features |= SINGLE_SEGMENT;
+  }
+  for (size_t i = 0; i < size; ++i) {
+    if (Util::ContainsScriptType(segments.conversion_segment(i).key(),
+                                 Util::NUMBER)) {
+      features |= HAS_NUMBER;
+      break;
+    }
+  }
+  return features;
+}
+
+RewriterTriggerIndex::RewriterTriggerIndex()
+    : single_segment_rewriters_(0),
+      has_number_rewriters_(0),
+      keyed_rewriters_(0) {}
+
+RewriterTriggerIndex::~RewriterTriggerIndex() {}
+
+void RewriterTriggerIndex::Add(size_t id, const RewriterTrigger &trigger) {
+  if (id >= kMaxRewritersSize) {
+    LOG(WARNING) << "Too many rewriters. The trigger is ignored: " << id;
+    return;
+  }
+  const uint64 bit = 1ULL << id;
+  if (trigger.required_features() & RewriterTrigger::SINGLE_SEGMENT) {
+    single_segment_rewriters_ |= bit;
+  }
+  if (trigger.required_features() & RewriterTrigger::HAS_NUMBER) {
+    has_number_rewriters_ |= bit;
+  }
+  if (!trigger.keys().empty()) {
+    keyed_rewriters_ |= bit;
+    for (size_t i = 0; i < trigger.keys().size(); ++i) {
+      key_to_rewriters_[trigger.keys()[i]] |= bit;
+    }
+  }
+}
+
+uint64 RewriterTriggerIndex::GetActiveRewriters(
+    const Segments &segments) const {
+  uint64 inactive = 0;
+  const int features = RewriterTrigger::GetFeatures(segments);
+  if (!(features & RewriterTrigger::SINGLE_SEGMENT)) {
+    inactive |= single_segment_rewriters_;
+  }
+  if (!(features & RewriterTrigger::HAS_NUMBER)) {
+    inactive |= has_number_rewriters_;
+  }
+
+  if (keyed_rewriters_ != 0) {
+    uint64 matched = 0;
+    for (size_t i = 0; i < segments.conversion_segments_size(); ++i) {
+      const map<string, uint64>::const_iterator it =
+          key_to_rewriters_.find(segments.conversion_segment(i).key());
+      if (it != key_to_rewriters_.end()) {
+        matched |= it->second;
+      }
+    }
+    inactive |= keyed_rewriters_ & ~matched;
+  }
+  return ~inactive;
+}
+
+}  // namespace mozc
@@ -0,0 +1,113 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Triggers let MergerRewriter skip the rewriters which cannot modify the
+// segments, without calling them.
+
+#ifndef MOZC_REWRITER_REWRITER_TRIGGER_H_
+#define MOZC_REWRITER_REWRITER_TRIGGER_H_
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+
+namespace mozc {
+
+class Segments;
+
+// Condition of the conversion segments for a rewriter to modify them.
+// A trigger without any condition always fires.
+class RewriterTrigger {
+ public:
+  enum Feature {
+    NO_FEATURE = 0,
+    // The segments have exactly one conversion segment.
+    SINGLE_SEGMENT = 1,
+    // A key of the conversion segments has a digit, including full-width
+    // ones.
+    HAS_NUMBER = 2,
+  };
+
+  RewriterTrigger() : required_features_(NO_FEATURE) {}
+
+  // All the features in |features| are required.
+  void RequireFeatures(int features) {
+    required_features_ |= features;
+  }
+
+  // If keys are added, one of the keys of the conversion segments must be
+  // one of them.
+  void AddKey(const string &key) {
+    keys_.push_back(key);
+  }
+
+  int required_features() const { return required_features_; }
+  const vector<string> &keys() const { return keys_; }
+
+  // Returns the bitwise-or of the features of |segments|.
+  static int GetFeatures(const Segments &segments);
+
+ private:
+  int required_features_;
+  vector<string> keys_;
+};
+
+// Evaluates the triggers of up to 64 rewriters at once.
+class RewriterTriggerIndex {
+ public:
+  static const size_t kMaxRewritersSize = 64;
+
+  RewriterTriggerIndex();
+  ~RewriterTriggerIndex();
+
+  // Registers the trigger of the |id|-th rewriter.  Rewriters not
+  // registered are always active.
+  void Add(size_t id, const RewriterTrigger &trigger);
+
+  // Returns the bitmask of the active rewriters for |segments|; the
+  // |id|-th bit is set if the trigger of the |id|-th rewriter fires.
+  uint64 GetActiveRewriters(const Segments &segments) const;
+
+ private:
+  // Bitmasks of the rewriters requiring each feature.
+  uint64 single_segment_rewriters_;
+  uint64 has_number_rewriters_;
+  // Bitmask of the rewriters having keys.
+  uint64 keyed_rewriters_;
+  map<string, uint64> key_to_rewriters_;
+
+  DISALLOW_COPY_AND_ASSIGN(RewriterTriggerIndex);
+};
+
+}  // namespace mozc
+
+#endif  // MOZC_REWRITER_REWRITER_TRIGGER_H_
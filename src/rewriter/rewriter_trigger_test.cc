@@ -0,0 +1,113 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "rewriter/rewriter_trigger.h"
+
+#include <string>
+
+#include "base/base.h"
+#include "converter/segments.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+void AddSegment(const string &key, Segment::SegmentType type,
+                Segments *segments) {
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  segment->set_segment_type(type);
+}
+
+TEST(RewriterTriggerTest, GetFeatures) {
+  Segments segments;
+  EXPECT_EQ(RewriterTrigger::NO_FEATURE,
+            RewriterTrigger::GetFeatures(segments));
+
+  AddSegment("1", Segment::HISTORY, &segments);
+  AddSegment("abc", Segment::FREE, &segments);
+  EXPECT_EQ(RewriterTrigger::SINGLE_SEGMENT,
+            RewriterTrigger::GetFeatures(segments));
+
+  // "２"
+  AddSegment("\xEF\xBC\x92", Segment::FREE, &segments);
+  EXPECT_EQ(RewriterTrigger::HAS_NUMBER,
+            RewriterTrigger::GetFeatures(segments));
+
+  segments.Clear();
+  AddSegment("1+1=", Segment::FREE, &segments);
+  EXPECT_EQ(RewriterTrigger::SINGLE_SEGMENT | RewriterTrigger::HAS_NUMBER,
+            RewriterTrigger::GetFeatures(segments));
+}
+
+TEST(RewriterTriggerIndexTest, GetActiveRewriters) {
+  RewriterTriggerIndex index;
+  // 0: always.
+  index.Add(0, RewriterTrigger());
+  // 1: single segment.
+  RewriterTrigger single;
+  single.RequireFeatures(RewriterTrigger::SINGLE_SEGMENT);
+  index.Add(1, single);
+  // 2: number.
+  RewriterTrigger number;
+  number.RequireFeatures(RewriterTrigger::HAS_NUMBER);
+  index.Add(2, number);
+  // 3: "foo" or "bar".
+  RewriterTrigger keys;
+  keys.AddKey("foo");
+  keys.AddKey("bar");
+  index.Add(3, keys);
+  // 4: "foo" in single segment.
+  RewriterTrigger single_key;
+  single_key.RequireFeatures(RewriterTrigger::SINGLE_SEGMENT);
+  single_key.AddKey("foo");
+  index.Add(4, single_key);
+  // Too large id is ignored.
+  index.Add(RewriterTriggerIndex::kMaxRewritersSize, single);
+
+  const uint64 kMask = 0x1F;
+  Segments segments;
+  AddSegment("foo", Segment::FREE, &segments);
+  EXPECT_EQ(0x1B, index.GetActiveRewriters(segments) & kMask);
+
+  // History segments are not looked at.
+  segments.mutable_segment(0)->set_segment_type(Segment::HISTORY);
+  AddSegment("1", Segment::FREE, &segments);
+  EXPECT_EQ(0x07, index.GetActiveRewriters(segments) & kMask);
+
+  AddSegment("bar", Segment::FREE, &segments);
+  EXPECT_EQ(0x0D, index.GetActiveRewriters(segments) & kMask);
+
+  // Rewriters not registered are active.
+  EXPECT_EQ(~kMask, index.GetActiveRewriters(segments) & ~kMask);
+}
+
+}  // namespace
+}  // namespace mozc
@@ -33,6 +33,7 @@
 #include <vector>
 #include <set>
 #include "base/base.h"
+#include "base/shared_string.h"
 #include "base/singleton.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -40,6 +41,7 @@
 #include "converter/segments.h"
 #include "rewriter/rewriter_interface.h"
 #include "rewriter/embedded_dictionary.h"
+#include "rewriter/variants_rewriter.h"
 #include "session/commands.pb.h"
 
 namespace mozc {
@@ -52,7 +54,9 @@ class SingleKanjiDictionary {
  public:
   SingleKanjiDictionary()
       : dic_(new EmbeddedDictionary(kSingleKanjiData_token_data,
-                                    kSingleKanjiData_token_size)) {}
+                                    kSingleKanjiData_token_size,
+                                    kSingleKanjiData_displacement,
+                                    kSingleKanjiData_displacement_size)) {}
 
   ~SingleKanjiDictionary() {}
 
@@ -77,9 +81,10 @@ void InsertCandidate(Segment *segment,
   // Adding 5000 to the single kanji cost
   const int kOffsetDiff = 5000;
 
-  const string &candidate_key = ((!segment->key().empty()) ?
-                                 segment->key() :
-                                 segment->candidate(0).key);
+  // Shared by all the candidates added here.
+  const SharedString candidate_key = ((!segment->key().empty()) ?
+                                      segment->key() :
+                                      segment->candidate(0).key.str());
   size_t idx_j = 0;
 
   if (is_single_segment) {
@@ -127,6 +132,7 @@ void InsertCandidate(Segment *segment,
       if (dict_values[idx_j].description != NULL) {
         c->description = dict_values[idx_j].description;
       }
+      VariantsRewriter::SetDescriptionForCandidate(c);
       ++idx_i;
       ++idx_j;
     }
@@ -147,6 +153,9 @@ void InsertCandidate(Segment *segment,
     if (dict_values[idx_j].description != NULL) {
       c->description = dict_values[idx_j].description;
     }
+    // VariantsRewriter has already run when the candidates are appended
+    // to a segment which gets focused later.
+    VariantsRewriter::SetDescriptionForCandidate(c);
     ++idx_j;
   }
 }
@@ -161,8 +170,7 @@ int SingleKanjiRewriter::capability() const {
 }
 
 bool SingleKanjiRewriter::Rewrite(Segments *segments) const {
-  if (!GET_CONFIG(use_single_kanji_conversion)) {
-    VLOG(2) << "no use_single_kanji_conversion";
+  if (!IsEnabled()) {
     return false;
   }
 
@@ -170,18 +178,46 @@ bool SingleKanjiRewriter::Rewrite(Segments *segments) const {
   const size_t segments_size = segments->conversion_segments_size();
   const bool is_single_segment = (segments_size == 1);
   for (size_t i = 0; i < segments_size; ++i) {
-    const string &key = segments->conversion_segment(i).key();
-    const EmbeddedDictionary::Token *token =
-        Singleton<SingleKanjiDictionary>::get()->GetDictionary()->Lookup(key);
-    if (token == NULL) {
-      continue;
-    }
-    InsertCandidate(segments->mutable_conversion_segment(i),
-                    is_single_segment,
-                    token->value, token->value_size);
-    modified = true;
+    modified |= RewriteCandidates(is_single_segment,
+                                  segments->mutable_conversion_segment(i));
   }
 
   return modified;
 }
+
+bool SingleKanjiRewriter::RewriteSegment(size_t segment_index,
+                                         Segments *segments) const {
+  if (!IsEnabled() ||
+      segment_index < segments->history_segments_size() ||
+      segment_index >= segments->segments_size()) {
+    return false;
+  }
+  const bool is_single_segment =
+      (segments->conversion_segments_size() == 1);
+  return RewriteCandidates(is_single_segment,
+                           segments->mutable_segment(segment_index));
+}
+
+// static
+bool SingleKanjiRewriter::IsEnabled() {
+  if (!GET_CONFIG(use_single_kanji_conversion)) {
+    VLOG(2) << "no use_single_kanji_conversion";
+    return false;
+  }
+  return true;
+}
+
+bool SingleKanjiRewriter::RewriteCandidates(bool is_single_segment,
+                                            Segment *segment) const {
+  DCHECK(segment);
+  const EmbeddedDictionary::Token *token =
+      Singleton<SingleKanjiDictionary>::get()->GetDictionary()->Lookup(
+          segment->key());
+  if (token == NULL) {
+    return false;
+  }
+  InsertCandidate(segment, is_single_segment,
+                  token->value, token->value_size);
+  return true;
+}
 }  // namespace mozc
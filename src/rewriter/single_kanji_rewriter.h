@@ -34,6 +34,7 @@
 
 namespace mozc {
 
+class Segment;
 class Segments;
 
 class SingleKanjiRewriter: public RewriterInterface  {
@@ -44,6 +45,21 @@ class SingleKanjiRewriter: public RewriterInterface  {
   virtual int capability() const;
 
   virtual bool Rewrite(Segments *segments) const;
+
+  // The single kanji are appended to the tail unless there is only one
+  // conversion segment, so they are added to the unfocused segments when
+  // they get focused.
+  virtual bool deferrable() const {
+    return true;
+  }
+  virtual bool RewriteSegment(size_t segment_index,
+                              Segments *segments) const;
+
+ private:
+  // Returns false if the single kanji conversion is disabled by the config.
+  static bool IsEnabled();
+
+  bool RewriteCandidates(bool is_single_segment, Segment *segment) const;
 };
 }  // namespace mozc
 
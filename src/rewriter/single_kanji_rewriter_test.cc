@@ -78,4 +78,38 @@ TEST_F(SingleKanjiRewriterTest, SetKeyTest) {
   }
 }
 
+TEST_F(SingleKanjiRewriterTest, RewriteSegment) {
+  SingleKanjiRewriter rewriter;
+  EXPECT_TRUE(rewriter.deferrable());
+
+  Segments segments;
+  // "あ"
+  const string kKey = "\xe3\x81\x82";
+  for (size_t i = 0; i < 2; ++i) {
+    Segment *segment = segments.add_segment();
+    segment->set_key(kKey);
+    Segment::Candidate *candidate = segment->add_candidate();
+    candidate->Init();
+    candidate->key = kKey;
+    candidate->content_key = kKey;
+    candidate->value = "value";
+    candidate->content_value = "value";
+  }
+
+  // The single kanji are appended only to the given segment, after the
+  // existing candidate.
+  EXPECT_TRUE(rewriter.RewriteSegment(1, &segments));
+  EXPECT_EQ(1, segments.segment(0).candidates_size());
+  const Segment &segment = segments.segment(1);
+  EXPECT_GT(segment.candidates_size(), 1);
+  EXPECT_EQ("value", segment.candidate(0).value);
+  for (size_t i = 1; i < segment.candidates_size(); ++i) {
+    // The descriptions are set without VariantsRewriter.
+    EXPECT_TRUE(segment.candidate(i).attributes &
+                Segment::Candidate::NO_EXTRA_DESCRIPTION);
+  }
+
+  EXPECT_FALSE(rewriter.RewriteSegment(2, &segments));
+}
+
 }  // namespace mozc
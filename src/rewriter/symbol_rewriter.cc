@@ -35,6 +35,7 @@
 #include <set>
 
 #include "base/base.h"
+#include "base/shared_string.h"
 #include "base/singleton.h"
 #include "base/util.h"
 #include "config/config_handler.h"
@@ -68,7 +69,9 @@ class SymbolDictionary {
  public:
   SymbolDictionary()
       : dic_(new EmbeddedDictionary(kSymbolData_token_data,
-                                    kSymbolData_token_size)) {}
+                                    kSymbolData_token_size,
+                                    kSymbolData_displacement,
+                                    kSymbolData_displacement_size)) {}
 
   ~SymbolDictionary() {}
 
@@ -191,9 +194,10 @@ void SymbolRewriter::InsertCandidates(const EmbeddedDictionary::Value *value,
   // include the target symbols, do assign description to these candidates.
   AddDescForCurrentCandidates(value, size, segment);
 
-  const string &candidate_key = ((!segment->key().empty()) ?
-                                 segment->key() :
-                                 segment->candidate(0).key);
+  // Shared by all the candidates added here.
+  const SharedString candidate_key = ((!segment->key().empty()) ?
+                                      segment->key() :
+                                      segment->candidate(0).key.str());
   size_t offset = 0;
 
   // If the key is "かおもじ", set the insert position at the bottom,
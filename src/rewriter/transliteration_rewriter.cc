@@ -38,6 +38,7 @@
 #include "converter/conversion_request.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
+#include "rewriter/rewriter_result_cache.h"
 #include "session/commands.pb.h"
 #include "session/request_handler.h"
 // For T13N normalize
@@ -146,7 +147,7 @@ void InitT13NCandidate(const string &key,
   cand->value = value;
   cand->key = key;
   cand->content_value = value;
-  cand->content_key = key;
+  cand->content_key = cand->key;
   cand->lid = (lid != 0) ? lid : POSMatcher::GetUnknownId();
   cand->rid = (rid != 0) ? rid : POSMatcher::GetUnknownId();
 }
@@ -272,6 +273,51 @@ bool FillT13NsFromComposer(const ConversionRequest &request,
   return modified;
 }
 
+// Computes the transliterations of |hiragana|.  As they are determined by
+// |hiragana|, the results are memoized in RewriterResultCache.
+void GetT13NsFromKey(const string &hiragana, vector<string> *t13ns) {
+  DCHECK(t13ns);
+  if (RewriterResultCache::Lookup(
+          RewriterResultCache::TRANSLITERATION_REWRITER, hiragana, t13ns)) {
+    return;
+  }
+  string full_katakana, ascii;
+  Util::HiraganaToKatakana(hiragana, &full_katakana);
+  Util::HiraganaToRomanji(hiragana, &ascii);
+  string half_ascii, full_ascii, half_katakana;
+  Util::FullWidthAsciiToHalfWidthAscii(ascii, &half_ascii);
+  Util::HalfWidthAsciiToFullWidthAscii(half_ascii, &full_ascii);
+  Util::FullWidthToHalfWidth(full_katakana, &half_katakana);
+  string half_ascii_upper = half_ascii;
+  string half_ascii_lower = half_ascii;
+  string half_ascii_capitalized = half_ascii;
+  Util::UpperString(&half_ascii_upper);
+  Util::LowerString(&half_ascii_lower);
+  Util::CapitalizeString(&half_ascii_capitalized);
+  string full_ascii_upper = full_ascii;
+  string full_ascii_lower = full_ascii;
+  string full_ascii_capitalized = full_ascii;
+  Util::UpperString(&full_ascii_upper);
+  Util::LowerString(&full_ascii_lower);
+  Util::CapitalizeString(&full_ascii_capitalized);
+
+  t13ns->resize(transliteration::NUM_T13N_TYPES);
+  (*t13ns)[transliteration::HIRAGANA] = hiragana;
+  (*t13ns)[transliteration::FULL_KATAKANA] = full_katakana;
+  (*t13ns)[transliteration::HALF_KATAKANA] = half_katakana;
+  (*t13ns)[transliteration::HALF_ASCII] = half_ascii;
+  (*t13ns)[transliteration::HALF_ASCII_UPPER] = half_ascii_upper;
+  (*t13ns)[transliteration::HALF_ASCII_LOWER] = half_ascii_lower;
+  (*t13ns)[transliteration::HALF_ASCII_CAPITALIZED] = half_ascii_capitalized;
+  (*t13ns)[transliteration::FULL_ASCII] = full_ascii;
+  (*t13ns)[transliteration::FULL_ASCII_UPPER] = full_ascii_upper;
+  (*t13ns)[transliteration::FULL_ASCII_LOWER] = full_ascii_lower;
+  (*t13ns)[transliteration::FULL_ASCII_CAPITALIZED] = full_ascii_capitalized;
+  NormalizeT13Ns(t13ns);
+  RewriterResultCache::Insert(RewriterResultCache::TRANSLITERATION_REWRITER,
+                              hiragana, *t13ns);
+}
+
 // This function is used for a fail-safe.
 // Ambiguities of roman rule are ignored here.
 // ('n' or 'nn' for "ん", etc)
@@ -283,45 +329,11 @@ bool FillT13NsFromKey(Segments *segments) {
     if (segment->key().empty()) {
       continue;
     }
-    const string &hiragana = segment->key();
-    string full_katakana, ascii;
-    Util::HiraganaToKatakana(hiragana, &full_katakana);
-    Util::HiraganaToRomanji(hiragana, &ascii);
-    string half_ascii, full_ascii, half_katakana;
-    Util::FullWidthAsciiToHalfWidthAscii(ascii, &half_ascii);
-    Util::HalfWidthAsciiToFullWidthAscii(half_ascii, &full_ascii);
-    Util::FullWidthToHalfWidth(full_katakana, &half_katakana);
-    string half_ascii_upper = half_ascii;
-    string half_ascii_lower = half_ascii;
-    string half_ascii_capitalized = half_ascii;
-    Util::UpperString(&half_ascii_upper);
-    Util::LowerString(&half_ascii_lower);
-    Util::CapitalizeString(&half_ascii_capitalized);
-    string full_ascii_upper = full_ascii;
-    string full_ascii_lower = full_ascii;
-    string full_ascii_capitalized = full_ascii;
-    Util::UpperString(&full_ascii_upper);
-    Util::LowerString(&full_ascii_lower);
-    Util::CapitalizeString(&full_ascii_capitalized);
-
     T13NIds ids;
     GetIds(*segment, &ids);
 
     vector<string> t13ns;
-    t13ns.resize(transliteration::NUM_T13N_TYPES);
-    t13ns[transliteration::HIRAGANA] = hiragana;
-    t13ns[transliteration::FULL_KATAKANA] = full_katakana;
-    t13ns[transliteration::HALF_KATAKANA] = half_katakana;
-    t13ns[transliteration::HALF_ASCII] = half_ascii;
-    t13ns[transliteration::HALF_ASCII_UPPER] = half_ascii_upper;
-    t13ns[transliteration::HALF_ASCII_LOWER] = half_ascii_lower;
-    t13ns[transliteration::HALF_ASCII_CAPITALIZED] = half_ascii_capitalized;
-    t13ns[transliteration::FULL_ASCII] = full_ascii;
-    t13ns[transliteration::FULL_ASCII_UPPER] = full_ascii_upper;
-    t13ns[transliteration::FULL_ASCII_LOWER] = full_ascii_lower;
-    t13ns[transliteration::FULL_ASCII_CAPITALIZED] = full_ascii_capitalized;
-
-    NormalizeT13Ns(&t13ns);
+    GetT13NsFromKey(segment->key(), &t13ns);
     if (!IsTransliterated(t13ns)) {
       continue;
     }
@@ -32,6 +32,7 @@
 #include "config/config.pb.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
+#include "rewriter/perfect_hash.h"
 #include "rewriter/usage_rewriter.h"
 
 namespace mozc {
@@ -40,28 +41,37 @@ struct ConjugationSuffix {
   const char *value_suffix;
   const char *key_suffix;
 };
+
+// Conjugated (key, value) pair and the index of kUsageData_value.
+struct UsageDictIndexItem {
+  const char *key;
+  const char *value;
+  int32 usage_index;
+};
 #include "rewriter/usage_rewriter_data.h"
-}
 
-UsageRewriter::UsageRewriter() {
-  const UsageDictItem *item = kUsageData_value;
-  // TODO(taku): To reduce memory footprint, better to replace it with
-  // binary search over the kConjugationSuffixDataIndex diretly.
-  for (; item->key != NULL; ++item) {
-    for (size_t i = kConjugationSuffixDataIndex[item->conjugation_id];
-         i < kConjugationSuffixDataIndex[item->conjugation_id + 1];
-         ++i) {
-      StrPair key_value1(
-          string(item->key) + kConjugationSuffixData[i].key_suffix,
-          string(item->value) + kConjugationSuffixData[i].value_suffix);
-      key_value_usageitem_map_[key_value1] = item;
-      StrPair key_value2(
-          "",
-          string(item->value) + kConjugationSuffixData[i].value_suffix);
-      key_value_usageitem_map_[key_value2] = item;
-    }
+// Looks up the usage with the conjugated key and value. The index is a
+// perfect hash over key + "\t" + value built by
+// gen_usage_rewriter_dictionary_main.
+const UsageDictItem *LookupKeyValue(const string &key, const string &value) {
+  if (kUsageDataIndexSize == 0) {
+    return NULL;
+  }
+  uint64 hash = PerfectHash::Hash(key.data(), key.size());
+  hash = PerfectHash::HashAppend(hash, "\t", 1);
+  hash = PerfectHash::HashAppend(hash, value.data(), value.size());
+  const UsageDictIndexItem &item = kUsageDataIndex[
+      PerfectHash::GetSlot(hash, kUsageDataIndex_displacement,
+                           kUsageDataIndex_displacement_size,
+                           kUsageDataIndexSize)];
+  if (key != item.key || value != item.value) {
+    return NULL;
   }
+  return kUsageData_value + item.usage_index;
 }
+}  // namespace
+
+UsageRewriter::UsageRewriter() {}
 
 UsageRewriter::~UsageRewriter() {
 }
@@ -116,13 +126,10 @@ const UsageDictItem* UsageRewriter::LookupUnmatchedUsageHeuristically(
   }
 
   // key is empty;
-  StrPair key_value("", value);
-  const map<StrPair, const UsageDictItem *>::const_iterator itr =
-      key_value_usageitem_map_.find(key_value);
+  const UsageDictItem *item = LookupKeyValue("", value);
   // Check result key part is a prefix of the content_key.
-  if (itr != key_value_usageitem_map_.end() &&
-      Util::StartsWith(candidate.content_key, itr->second->key)) {
-    return itr->second;
+  if (item != NULL && Util::StartsWith(candidate.content_key, item->key)) {
+    return item;
   }
 
   return NULL;
@@ -130,13 +137,10 @@ const UsageDictItem* UsageRewriter::LookupUnmatchedUsageHeuristically(
 
 const UsageDictItem* UsageRewriter::LookupUsage(
     const Segment::Candidate &candidate) const {
-  const string &key = candidate.content_key;
-  const string &value = candidate.content_value;
-  StrPair key_value(key, value);
-  const map<StrPair, const UsageDictItem *>::const_iterator itr =
-      key_value_usageitem_map_.find(key_value);
-  if (itr != key_value_usageitem_map_.end()) {
-    return itr->second;
+  const UsageDictItem *item =
+      LookupKeyValue(candidate.content_key, candidate.content_value);
+  if (item != NULL) {
+    return item;
   }
 
   return LookupUnmatchedUsageHeuristically(candidate);
@@ -145,35 +149,53 @@ const UsageDictItem* UsageRewriter::LookupUsage(
 bool UsageRewriter::Rewrite(Segments *segments) const {
   DLOG(INFO) << segments->DebugString();
 
+  if (!IsEnabled()) {
+    return false;
+  }
+
+  bool modified = false;
+  for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
+    modified |= RewriteCandidates(segments->mutable_conversion_segment(i));
+  }
+  return modified;
+}
+
+bool UsageRewriter::RewriteSegment(size_t segment_index,
+                                   Segments *segments) const {
+  if (!IsEnabled() || segment_index >= segments->segments_size()) {
+    return false;
+  }
+  return RewriteCandidates(segments->mutable_segment(segment_index));
+}
+
+// static
+bool UsageRewriter::IsEnabled() {
   const config::Config &config = config::ConfigHandler::GetConfig();
   // Default value of use_local_usage_dictionary() is true.
   // So if information_list_config() is not available in the config,
   // we don't need to return false here.
-  if (config.has_information_list_config() &&
-      !config.information_list_config().use_local_usage_dictionary()) {
-    return false;
-  }
+  return !(config.has_information_list_config() &&
+           !config.information_list_config().use_local_usage_dictionary());
+}
 
+bool UsageRewriter::RewriteCandidates(Segment *segment) const {
+  DCHECK(segment);
   bool modified = false;
-  for (size_t i = 0; i < segments->conversion_segments_size(); ++i) {
-    Segment *segment = segments->mutable_conversion_segment(i);
-    DCHECK(segment);
-    for (size_t j = 0; j < segment->candidates_size(); ++j) {
-      const UsageDictItem *usage = LookupUsage(segment->candidate(j));
-
-      if (usage != NULL) {
-        Segment::Candidate *candidate = segment->mutable_candidate(j);
-        DCHECK(candidate);
-        candidate->usage_id = usage->id;
-        candidate->usage_title = string(usage->value)
-          + kBaseConjugationSuffix[usage->conjugation_id].value_suffix;
-        candidate->usage_description = usage->meaning;
-        DLOG(INFO) << i << ":" << j << ":" <<
-            candidate->content_key << ":" << candidate->content_value <<
-            ":" << usage->key << ":" << usage->value <<
-            ":" << usage->conjugation_id << ":" << usage->meaning;
-        modified = true;
-      }
+  for (size_t j = 0; j < segment->candidates_size(); ++j) {
+    const UsageDictItem *usage = LookupUsage(segment->candidate(j));
+
+    if (usage != NULL) {
+      Segment::Candidate *candidate = segment->mutable_candidate(j);
+      DCHECK(candidate);
+      candidate->usage_id = usage->id;
+      candidate->usage_title = string(usage->value)
+        + kBaseConjugationSuffix[usage->conjugation_id].value_suffix;
+      candidate->usage_description = usage->meaning;
+      DLOG(INFO) << j << ":" <<
+          candidate->content_key << ":" << candidate->content_value <<
+          ":" << usage->key << ":" << usage->value <<
+          ":" << usage->conjugation_id << ":" << usage->meaning;
+      modified = true;
     }
   }
   return modified;
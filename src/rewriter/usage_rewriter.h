@@ -29,8 +29,6 @@
 
 #ifndef MOZC_REWRITER_USAGE_REWRITER_H_
 #define MOZC_REWRITER_USAGE_REWRITER_H_
-#include <list>
-#include <map>
 #include <string>
 
 #include "base/base.h"
@@ -58,18 +56,28 @@ class UsageRewriter: public RewriterInterface  {
     return CONVERSION | PREDICTION;
   }
 
+  // The usages are shown only in the candidate window of the focused
+  // segment.
+  virtual bool deferrable() const {
+    return true;
+  }
+  virtual bool RewriteSegment(size_t segment_index,
+                              Segments *segments) const;
+
  private:
   FRIEND_TEST(UsageRewriterTest, GetKanjiPrefixAndOneHiragana);
 
-  typedef pair<string, string> StrPair;
   static string GetKanjiPrefixAndOneHiragana(const string &word);
 
+  // Returns false if the local usage dictionary is disabled by the config.
+  static bool IsEnabled();
+
+  bool RewriteCandidates(Segment *segment) const;
+
   const UsageDictItem *LookupUnmatchedUsageHeuristically(
       const Segment::Candidate &candidate) const;
   const UsageDictItem *LookupUsage(
       const Segment::Candidate &candidate) const;
-
-  map<StrPair, const UsageDictItem *> key_value_usageitem_map_;
 };
 }  // namespace mozc
 #endif  // MOZC_REWRITER_USAGE_REWRITER_H_
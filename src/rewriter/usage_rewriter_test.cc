@@ -350,6 +350,31 @@ TEST_F(UsageRewriterTest, MultiSegmentsTest) {
   EXPECT_NE("", segments.conversion_segment(1).candidate(1).usage_description);
 }
 
+TEST_F(UsageRewriterTest, RewriteSegmentTest) {
+  Segments segments;
+  UsageRewriter rewriter;
+  EXPECT_TRUE(rewriter.deferrable());
+
+  for (size_t i = 0; i < 2; ++i) {
+    Segment *seg = segments.push_back_segment();
+    // "あおく"
+    seg->set_key("\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x8F");
+    // "あおく", "青く", "あおく", "青く"
+    AddCandidate("\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x8F",
+                 "\xE9\x9D\x92\xE3\x81\x8F",
+                 "\xE3\x81\x82\xE3\x81\x8A\xE3\x81\x8F",
+                 "\xE9\x9D\x92\xE3\x81\x8F", seg);
+  }
+
+  // Only the given segment is rewritten.
+  EXPECT_TRUE(rewriter.RewriteSegment(1, &segments));
+  EXPECT_EQ("", segments.segment(0).candidate(0).usage_title);
+  // "青い"
+  EXPECT_EQ("\xE9\x9D\x92\xE3\x81\x84",
+            segments.segment(1).candidate(0).usage_title);
+  EXPECT_FALSE(rewriter.RewriteSegment(2, &segments));
+}
+
 TEST_F(UsageRewriterTest, SameUsageTest) {
   Segments segments;
   UsageRewriter rewriter;
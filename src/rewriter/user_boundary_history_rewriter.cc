@@ -176,6 +176,13 @@ bool UserBoundaryHistoryRewriter::RewriteForRequest(
   return false;
 }
 
+bool UserBoundaryHistoryRewriter::Sync() {
+  if (storage_.get() == NULL) {
+    return true;
+  }
+  return storage_->Sync();
+}
+
 bool UserBoundaryHistoryRewriter::Reload() {
   const string filename = ConfigFileStream::GetFileName(kFileName);
   if (!storage_->OpenOrCreate(filename.c_str(),
@@ -53,6 +53,9 @@ class UserBoundaryHistoryRewriter: public RewriterInterface {
 
   virtual void Finish(Segments *segments);
 
+  // Writes a checkpoint of the storage.
+  virtual bool Sync();
+
   virtual bool Reload();
 
   virtual void Clear();
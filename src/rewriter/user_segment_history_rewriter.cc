@@ -29,6 +29,7 @@
 
 #include "rewriter/user_segment_history_rewriter.h"
 
+#include <string.h>
 #include <algorithm>
 #include <cctype>
 #include <set>
@@ -138,6 +139,17 @@ class ScoreTypeCompare {
   }
 };
 
+// Maps the |l|-th of the candidates and the meta candidates to the
+// index of Segment::candidate(), which is negative for meta candidates.
+inline int GetCandidateIndex(const Segment &segment, size_t l) {
+  int j = static_cast<int>(l);
+  if (j >= static_cast<int>(segment.candidates_size())) {
+    j -= static_cast<int>(segment.candidates_size() +
+                          transliteration::NUM_T13N_TYPES);
+  }
+  return j;
+}
+
 // return the first candiadte which has "BEST_CANDIDATE" attribute
 inline int GetDefaultCandidateIndex(const Segment &segment) {
   const int size = min(static_cast<int>(segment.candidates_size()), 5);
@@ -152,92 +164,109 @@ inline int GetDefaultCandidateIndex(const Segment &segment) {
   return 0;
 }
 
+// Feature keys are tab separated strings like "LR\tkey\tvalue...".
+// They are built directly into fingerprints of LRUStorage.
+inline void StartFeature(const char *type, FingerprintBuilder *key) {
+  key->Reset();
+  key->Append(type, strlen(type));
+}
+
+inline void AddFeatureField(const string &field, FingerprintBuilder *key) {
+  key->Append('\t');
+  key->Append(field);
+}
+
 // Feature "Left Right"
 inline bool GetFeatureLR(const Segments &segments, size_t i,
                          const string &base_key,
-                         const string &base_value, string *value) {
-  DCHECK(value);
+                         const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i + 1 >= segments.segments_size() || i <= 0) {
     return false;
   }
   const int j1 = GetDefaultCandidateIndex(segments.segment(i - 1));
   const int j2 = GetDefaultCandidateIndex(segments.segment(i + 1));
-  *value = string("LR") + '\t' + base_key + '\t' +
-      segments.segment(i - 1).candidate(j1).value + '\t' +
-      base_value + '\t' +
-      segments.segment(i + 1).candidate(j2).value;
+  StartFeature("LR", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(segments.segment(i - 1).candidate(j1).value, key);
+  AddFeatureField(base_value, key);
+  AddFeatureField(segments.segment(i + 1).candidate(j2).value, key);
   return true;
 }
 
 // Feature "Left Left"
 inline bool GetFeatureLL(const Segments &segments, size_t i,
                          const string &base_key,
-                         const string &base_value, string *value) {
-  DCHECK(value);
+                         const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i < 2) {
     return false;
   }
   const int j1 = GetDefaultCandidateIndex(segments.segment(i - 2));
   const int j2 = GetDefaultCandidateIndex(segments.segment(i - 1));
-  *value = string("LL") + '\t' + base_key + '\t' +
-      segments.segment(i - 2).candidate(j1).value + '\t' +
-      segments.segment(i - 1).candidate(j2).value + '\t' +
-      base_value;
+  StartFeature("LL", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(segments.segment(i - 2).candidate(j1).value, key);
+  AddFeatureField(segments.segment(i - 1).candidate(j2).value, key);
+  AddFeatureField(base_value, key);
   return true;
 }
 
 // Feature "Right Right"
 inline bool GetFeatureRR(const Segments &segments, size_t i,
                          const string &base_key,
-                         const string &base_value, string *value) {
-  DCHECK(value);
+                         const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i + 2 >= segments.segments_size()) {
     return false;
   }
   const int j1 = GetDefaultCandidateIndex(segments.segment(i + 1));
   const int j2 = GetDefaultCandidateIndex(segments.segment(i + 2));
-  *value = string("RR") + '\t' + base_key + '\t' +
-      base_value + '\t' +
-      segments.segment(i + 1).candidate(j1).value + '\t' +
-      segments.segment(i + 2).candidate(j2).value;
+  StartFeature("RR", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(base_value, key);
+  AddFeatureField(segments.segment(i + 1).candidate(j1).value, key);
+  AddFeatureField(segments.segment(i + 2).candidate(j2).value, key);
   return true;
 }
 
 // Feature "Left"
 inline bool GetFeatureL(const Segments &segments, size_t i,
                         const string &base_key,
-                        const string &base_value, string *value) {
-  DCHECK(value);
+                        const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i < 1) {
     return false;
   }
   const int j = GetDefaultCandidateIndex(segments.segment(i - 1));
-  *value = string("L") + '\t' + base_key + '\t' +
-      segments.segment(i - 1).candidate(j).value + '\t' +
-      base_value;
+  StartFeature("L", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(segments.segment(i - 1).candidate(j).value, key);
+  AddFeatureField(base_value, key);
   return true;
 }
 
 // Feature "Right"
 inline bool GetFeatureR(const Segments &segments, size_t i,
                         const string &base_key,
-                        const string &base_value, string *value) {
-  DCHECK(value);
+                        const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i + 1 >= segments.segments_size()) {
     return false;
   }
   const int j = GetDefaultCandidateIndex(segments.segment(i + 1));
-  *value = string("R") + '\t' + base_key + '\t' +
-      base_value + '\t' +
-      segments.segment(i + 1).candidate(j).value;
+  StartFeature("R", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(base_value, key);
+  AddFeatureField(segments.segment(i + 1).candidate(j).value, key);
   return true;
 }
 
 // Feature "Left Number"
 inline bool GetFeatureLN(const Segments &segments, size_t i,
                          const string &base_key,
-                         const string &base_value, string *value) {
-  DCHECK(value);
+                         const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i < 1) {
     return false;
   }
@@ -246,7 +275,9 @@ inline bool GetFeatureLN(const Segments &segments, size_t i,
   if (POSMatcher::IsNumber(candidate.rid) ||
       POSMatcher::IsKanjiNumber(candidate.rid) ||
       Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    *value = string("LN") + '\t' + base_key + '\t' + base_value;
+    StartFeature("LN", key);
+    AddFeatureField(base_key, key);
+    AddFeatureField(base_value, key);
     return true;
   }
   return false;
@@ -255,8 +286,8 @@ inline bool GetFeatureLN(const Segments &segments, size_t i,
 // Feature "Right Number"
 inline bool GetFeatureRN(const Segments &segments, size_t i,
                          const string &base_key,
-                         const string &base_value, string *value) {
-  DCHECK(value);
+                         const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (i + 1 >= segments.segments_size()) {
     return false;
   }
@@ -265,7 +296,9 @@ inline bool GetFeatureRN(const Segments &segments, size_t i,
   if (POSMatcher::IsNumber(candidate.lid) ||
       POSMatcher::IsKanjiNumber(candidate.lid) ||
       Util::GetScriptType(candidate.value) == Util::NUMBER) {
-    *value = string("RN") + '\t' + base_key + '\t' + base_value;
+    StartFeature("RN", key);
+    AddFeatureField(base_key, key);
+    AddFeatureField(base_value, key);
     return true;
   }
   return false;
@@ -274,21 +307,25 @@ inline bool GetFeatureRN(const Segments &segments, size_t i,
 // Feature "Current"
 inline bool GetFeatureC(const Segments &segments, size_t i,
                         const string &base_key,
-                        const string &base_value, string *value) {
-  DCHECK(value);
-  *value = string("C") + '\t' + base_key + '\t' + base_value;
+                        const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
+  StartFeature("C", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(base_value, key);
   return true;
 }
 
 // Feature "Single"
 inline bool GetFeatureS(const Segments &segments, size_t i,
                         const string &base_key,
-                        const string &base_value, string *value) {
-  DCHECK(value);
+                        const string &base_value, FingerprintBuilder *key) {
+  DCHECK(key);
   if (segments.segments_size() - segments.history_segments_size() != 1) {
     return false;
   }
-  *value = string("S") + '\t' + base_key + '\t' + base_value;
+  StartFeature("S", key);
+  AddFeatureField(base_key, key);
+  AddFeatureField(base_value, key);
   return true;
 }
 
@@ -490,31 +527,29 @@ do { \
     FeatureValue v; \
     DCHECK(v.IsValid()); \
     if (force_insert) { \
-      storage_->Insert(feature_key, reinterpret_cast<const char *>(&v)); \
+      storage_->InsertFingerprint(feature_key.Get(), \
+                                  reinterpret_cast<const char *>(&v)); \
     } else { \
-      storage_->TryInsert(feature_key, reinterpret_cast<const char *>(&v)); \
+      storage_->TryInsertFingerprint(feature_key.Get(), \
+                                     reinterpret_cast<const char *>(&v)); \
     } \
   } \
 } while (0)
 
+// The features are looked up later at once.
 #define FETCH_FEATURE(func, base_key, base_value, weight)        \
 do { \
   if (func(segments, segment_index, base_key, base_value, &feature_key)) { \
-    const FeatureValue *v = \
-      reinterpret_cast<const FeatureValue *> \
-       (storage_->Lookup(feature_key, &last_access_time_result)); \
-    if (v != NULL && v->IsValid()) { \
-       *score = max(*score, weight);                                     \
-       *last_access_time = max(*last_access_time, last_access_time_result); \
-    } \
+    fps->push_back(feature_key.Get()); \
+    weights->push_back(weight); \
   } \
 } while (0)
 
-bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
-                                          size_t segment_index,
-                                          int candidate_index,
-                                          uint32 *score,
-                                          uint32 *last_access_time) const {
+void UserSegmentHistoryRewriter::GetFeatures(const Segments &segments,
+                                             size_t segment_index,
+                                             int candidate_index,
+                                             vector<uint64> *fps,
+                                             vector<uint32> *weights) const {
   const size_t segments_size = segments.conversion_segments_size();
   const Segment::Candidate &top_candidate =
       segments.segment(segment_index).candidate(0);
@@ -532,15 +567,11 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
       (candidate.attributes & Segment::Candidate::CONTEXT_SENSITIVE) ||
       (segments.segment(segment_index).candidate(0).attributes &
        Segment::Candidate::CONTEXT_SENSITIVE);
-  DCHECK(score);
-  DCHECK(last_access_time);
-
-  *score = 0;
-  *last_access_time = 0;
+  DCHECK(fps);
+  DCHECK(weights);
 
-  // They are used inside FETCH_FEATURE
-  uint32 last_access_time_result = 0;
-  string feature_key;
+  // |feature_key| is used inside FETCH_FEATURE
+  FingerprintBuilder feature_key(storage_->seed());
 
   const uint32 trigram_score       = (segments_size == 3) ? 180 : 30;
   const uint32 bigram_score        = (segments_size == 2) ? 60  : 10;
@@ -564,7 +595,7 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
   }
 
   if (!is_replaceable) {
-    return (*score > 0);
+    return;
   }
 
   FETCH_FEATURE(GetFeatureLR, content_key, content_value, trigram_score / 2);
@@ -581,8 +612,6 @@ bool UserSegmentHistoryRewriter::GetScore(const Segments &segments,
   if (!context_sensitive) {
     FETCH_FEATURE(GetFeatureC,  content_key, content_value, unigram_score / 2);
   }
-
-  return (*score > 0);
 }
 
 namespace {
@@ -672,7 +701,7 @@ void UserSegmentHistoryRewriter::RememberFirstCandidate(
       ((top_index == 0) || Replaceable(seg.candidate(top_index), candidate));
 
   // |feature_key| is used inside INSERT_FEATURE
-  string feature_key;
+  FingerprintBuilder feature_key(storage_->seed());
   INSERT_FEATURE(GetFeatureLR, all_key, all_value, force_insert);
   INSERT_FEATURE(GetFeatureLL, all_key, all_value, force_insert);
   INSERT_FEATURE(GetFeatureRR, all_key, all_value, force_insert);
@@ -776,6 +805,13 @@ void UserSegmentHistoryRewriter::Finish(Segments *segments) {
                                       static_cast<int>(storage_->used_size()));
 }
 
+bool UserSegmentHistoryRewriter::Sync() {
+  if (storage_.get() == NULL) {
+    return true;
+  }
+  return storage_->Sync();
+}
+
 bool UserSegmentHistoryRewriter::Reload() {
   const string filename = ConfigFileStream::GetFileName(kFileName);
   if (!storage_->OpenOrCreate(filename.c_str(),
@@ -895,6 +931,14 @@ bool UserSegmentHistoryRewriter::RewriteNumber(Segment *segment) const {
   return SortCandidates(scores, segment);
 }
 
+struct UserSegmentHistoryRewriter::LookupBuffer {
+  vector<uint64> fps;
+  vector<uint32> weights;
+  vector<size_t> feature_begins;
+  vector<const char *> values;
+  vector<uint32> last_access_times;
+};
+
 bool UserSegmentHistoryRewriter::Rewrite(Segments *segments) const {
   if (!IsAvailable(*segments)) {
     return false;
@@ -915,65 +959,115 @@ bool UserSegmentHistoryRewriter::Rewrite(Segments *segments) const {
         Segment::Candidate::BEST_CANDIDATE;
   }
 
+  LookupBuffer buffer;
   bool modified = false;
   for (size_t i = segments->history_segments_size();
        i < segments->segments_size(); ++i) {
-    Segment *segment = segments->mutable_segment(i);
-    DCHECK(segment);
-    DCHECK_GT(segment->candidates_size(), 0);
+    modified |= RewriteOneSegment(i, segments, &buffer);
+  }
+  return modified;
+}
 
-    if (segment->segment_type() == Segment::FIXED_VALUE) {
-      continue;
-    }
+bool UserSegmentHistoryRewriter::RewriteSegment(size_t segment_index,
+                                                Segments *segments) const {
+  if (!IsAvailable(*segments) ||
+      segment_index < segments->history_segments_size() ||
+      segment_index >= segments->segments_size()) {
+    return false;
+  }
 
-    if (IsPunctuation(*segment, segment->candidate(0))) {
-      continue;
-    }
+  if (GET_CONFIG(history_learning_level) == config::Config::NO_HISTORY) {
+    VLOG(2) << "history_learning_level is NO_HISTORY";
+    return false;
+  }
 
-    if (IsNumberSegment(*segment)) {
-      modified |= RewriteNumber(segment);
-      continue;
-    }
+  // BEST_CANDIDATE marker has been set by Rewrite().
+  LookupBuffer buffer;
+  return RewriteOneSegment(segment_index, segments, &buffer);
+}
 
-    size_t max_candidates_size = 0;
-    if (!ShouldRewrite(*segment, &max_candidates_size)) {
-      continue;
-    }
+bool UserSegmentHistoryRewriter::RewriteOneSegment(
+    size_t segment_index, Segments *segments, LookupBuffer *buffer) const {
+  vector<uint64> &fps = buffer->fps;
+  vector<uint32> &weights = buffer->weights;
+  vector<size_t> &feature_begins = buffer->feature_begins;
+  vector<const char *> &values = buffer->values;
+  vector<uint32> &last_access_times = buffer->last_access_times;
 
-    if (segment->candidates_size() < max_candidates_size) {
-      LOG(WARNING) << "cannot expand candidates. ignored."
-                   << "rewrite may be failed ";
-    }
+  Segment *segment = segments->mutable_segment(segment_index);
+  DCHECK(segment);
+  DCHECK_GT(segment->candidates_size(), 0);
 
-    // for each all candidates expanded
-    vector<ScoreType> scores;
-    for (size_t l = 0;
-         l < segment->candidates_size() + segment->meta_candidates_size();
-         ++l) {
-      int j = static_cast<int>(l);
-      if (j >= static_cast<int>(segment->candidates_size())) {
-        j -= static_cast<int>(segment->candidates_size() +
-                              transliteration::NUM_T13N_TYPES);
-      }
+  if (segment->segment_type() == Segment::FIXED_VALUE) {
+    return false;
+  }
+
+  if (IsPunctuation(*segment, segment->candidate(0))) {
+    return false;
+  }
+
+  if (IsNumberSegment(*segment)) {
+    return RewriteNumber(segment);
+  }
 
-      uint32 score = 0;
-      uint32 last_access_time = 0;
-      if (GetScore(*segments, i, j, &score, &last_access_time)) {
-        scores.resize(scores.size() + 1);
-        scores.back().score = score;
-        scores.back().last_access_time = last_access_time;
-        scores.back().candidate = segment->mutable_candidate(j);
+  size_t max_candidates_size = 0;
+  if (!ShouldRewrite(*segment, &max_candidates_size)) {
+    return false;
+  }
+
+  if (segment->candidates_size() < max_candidates_size) {
+    LOG(WARNING) << "cannot expand candidates. ignored."
+                 << "rewrite may be failed ";
+  }
+
+  // Collects the features of all the candidates expanded and looks
+  // them up at once.
+  fps.clear();
+  weights.clear();
+  feature_begins.clear();
+  const size_t candidates_size =
+      segment->candidates_size() + segment->meta_candidates_size();
+  for (size_t l = 0; l < candidates_size; ++l) {
+    feature_begins.push_back(fps.size());
+    GetFeatures(*segments, segment_index, GetCandidateIndex(*segment, l),
+                &fps, &weights);
+  }
+  feature_begins.push_back(fps.size());
+  if (fps.empty()) {
+    return false;
+  }
+  values.resize(fps.size());
+  last_access_times.resize(fps.size());
+  storage_->BatchLookup(&fps[0], fps.size(),
+                        &values[0], &last_access_times[0]);
+
+  vector<ScoreType> scores;
+  for (size_t l = 0; l < candidates_size; ++l) {
+    uint32 score = 0;
+    uint32 last_access_time = 0;
+    for (size_t k = feature_begins[l]; k < feature_begins[l + 1]; ++k) {
+      const FeatureValue *v =
+          reinterpret_cast<const FeatureValue *>(values[k]);
+      if (v != NULL && v->IsValid()) {
+        score = max(score, weights[k]);
+        last_access_time = max(last_access_time, last_access_times[k]);
       }
     }
-
-    if (scores.empty()) {
-      continue;
+    if (score > 0) {
+      scores.resize(scores.size() + 1);
+      scores.back().score = score;
+      scores.back().last_access_time = last_access_time;
+      scores.back().candidate =
+          segment->mutable_candidate(GetCandidateIndex(*segment, l));
     }
+  }
 
-    stable_sort(scores.begin(), scores.end(), ScoreTypeCompare());
-    modified |= SortCandidates(scores, segment);
+  if (scores.empty()) {
+    return false;
   }
-  return modified;
+
+  stable_sort(scores.begin(), scores.end(), ScoreTypeCompare());
+  return SortCandidates(scores, segment);
 }
 
 void UserSegmentHistoryRewriter::Clear() {
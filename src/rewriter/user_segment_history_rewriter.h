@@ -44,8 +44,19 @@ class UserSegmentHistoryRewriter: public RewriterInterface {
 
   virtual bool Rewrite(Segments *segments) const;
 
+  // A learned candidate may be appended to an unfocused segment when it
+  // gets focused.
+  virtual bool reranks_deferred_candidates() const {
+    return true;
+  }
+  virtual bool RewriteSegment(size_t segment_index,
+                              Segments *segments) const;
+
   virtual void Finish(Segments *segments);
 
+  // Writes a checkpoint of the storage.
+  virtual bool Sync();
+
   virtual bool Reload();
 
   virtual void Clear();
@@ -57,12 +68,19 @@ class UserSegmentHistoryRewriter: public RewriterInterface {
   static LRUStorage *GetStorage();
 
  private:
+  // Buffers for the batched lookup, reused for all the segments.
+  struct LookupBuffer;
+
   bool IsAvailable(const Segments &segments) const;
-  bool GetScore(const Segments &segments,
-                size_t segment_index,
-                int candidate_index,
-                uint32 *score,
-                uint32 *last_access_time) const;
+  bool RewriteOneSegment(size_t segment_index, Segments *segments,
+                         LookupBuffer *buffer) const;
+  // Appends the fingerprints of the features of the candidate and their
+  // scores to |fps| and |weights|.
+  void GetFeatures(const Segments &segments,
+                   size_t segment_index,
+                   int candidate_index,
+                   vector<uint64> *fps,
+                   vector<uint32> *weights) const;
   bool Replaceable(const Segment::Candidate &lhs,
                    const Segment::Candidate &rhs) const;
   void RememberFirstCandidate(const Segments &segments,
@@ -42,6 +42,7 @@
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
 #include "rewriter/number_rewriter.h"
+#include "storage/lru_storage.h"
 #include "testing/base/public/googletest.h"
 #include "testing/base/public/gunit.h"
 
@@ -422,6 +423,44 @@ TEST_F(UserSegmentHistoryRewriterTest, BasicTest) {
   }
 }
 
+// Features are stored with the fingerprint of the tab separated string,
+// which is compatible with the storage files written by older versions.
+TEST_F(UserSegmentHistoryRewriterTest, FeatureKeyCompatibility) {
+  SetLearningLevel(config::Config::DEFAULT_HISTORY);
+  Segments segments;
+  UserSegmentHistoryRewriter rewriter;
+
+  const uint64 kSeconds = 0;
+  const uint32 kMicroSeconds = 0;
+  ClockMock clock(kSeconds, kMicroSeconds);
+  Util::SetClockHandler(&clock);
+
+  rewriter.Clear();
+  InitSegments(&segments, 1);
+  segments.mutable_segment(0)->move_candidate(2, 0);
+  segments.mutable_segment(0)->mutable_candidate(0)->attributes
+      |= Segment::Candidate::RERANKED;
+  segments.mutable_segment(0)->set_segment_type(Segment::FIXED_VALUE);
+  rewriter.Finish(&segments);
+
+  LRUStorage *storage = UserSegmentHistoryRewriter::GetStorage();
+  ASSERT_TRUE(storage != NULL);
+  const char *value = storage->Lookup("S\tsegment0\tcandidate2");
+  ASSERT_TRUE(value != NULL);
+
+  // Learned with the string key as older versions did.
+  clock.PutClockForward(1, 0);
+  const string feature_value(value, storage->value_size());
+  storage->Insert("S\tsegment0\tcandidate5", feature_value.data());
+
+  InitSegments(&segments, 1);
+  EXPECT_TRUE(rewriter.Rewrite(&segments));
+  EXPECT_EQ("candidate5", segments.segment(0).candidate(0).value);
+  EXPECT_EQ("candidate2", segments.segment(0).candidate(1).value);
+
+  Util::SetClockHandler(NULL);
+}
+
 // Test for Issue 2155278
 TEST_F(UserSegmentHistoryRewriterTest, SequenceTest) {
   SetLearningLevel(config::Config::DEFAULT_HISTORY);
@@ -1607,4 +1646,37 @@ TEST_F(UserSegmentHistoryRewriterTest, AnnotationAfterLearning) {
     rewriter.Finish(&segments);
   }
 }
+
+TEST_F(UserSegmentHistoryRewriterTest, RewriteSegment) {
+  SetLearningLevel(config::Config::DEFAULT_HISTORY);
+  Segments segments;
+  UserSegmentHistoryRewriter rewriter;
+  EXPECT_TRUE(rewriter.reranks_deferred_candidates());
+
+  rewriter.Clear();
+  InitSegments(&segments, 2);
+  segments.mutable_segment(1)->move_candidate(3, 0);
+  segments.mutable_segment(1)->mutable_candidate(0)->attributes
+      |= Segment::Candidate::RERANKED;
+  segments.mutable_segment(1)->set_segment_type(Segment::FIXED_VALUE);
+  rewriter.Finish(&segments);
+
+  // The learned candidate is not expanded yet.
+  InitSegments(&segments, 2, 3);
+  rewriter.Rewrite(&segments);
+  EXPECT_EQ("candidate0", segments.segment(1).candidate(0).value);
+
+  // The learned candidate is appended later, e.g. by a deferrable
+  // rewriter.
+  Segment *segment = segments.mutable_segment(1);
+  Segment::Candidate *candidate = segment->add_candidate();
+  candidate->content_key = segment->key();
+  candidate->content_value = "candidate3";
+  candidate->value = "candidate3";
+  EXPECT_TRUE(rewriter.RewriteSegment(1, &segments));
+  EXPECT_EQ("candidate3", segments.segment(1).candidate(0).value);
+  EXPECT_EQ("candidate0", segments.segment(0).candidate(0).value);
+
+  EXPECT_FALSE(rewriter.RewriteSegment(2, &segments));
+}
 }  // namespace mozc
@@ -37,6 +37,7 @@
 #include "base/version.h"
 #include "base/singleton.h"
 #include "converter/segments.h"
+#include "rewriter/rewriter_trigger.h"
 #include "session/commands.pb.h"
 
 namespace mozc {
@@ -93,6 +94,14 @@ class VersionDataImpl {
     //     new VersionEntry("バージョン", Version::GetMozcVersion(), 9);
   }
 
+  // Adds the keys of the entries to |trigger|.
+  void GetKeys(RewriterTrigger *trigger) const {
+    for (map<string, VersionEntry *>::const_iterator it = entries_.begin();
+         it != entries_.end(); ++it) {
+      trigger->AddKey(it->first);
+    }
+  }
+
   ~VersionDataImpl() {
     for (map<string, VersionEntry *>::iterator it = entries_.begin();
          it != entries_.end();
@@ -115,6 +124,10 @@ int VersionRewriter::capability() const {
   return RewriterInterface::CONVERSION;
 }
 
+void VersionRewriter::GetTrigger(RewriterTrigger *trigger) const {
+  Singleton<VersionDataImpl>::get()->GetKeys(trigger);
+}
+
 bool VersionRewriter::Rewrite(Segments *segments) const {
   bool result = false;
   for (size_t i = segments->history_segments_size();
@@ -138,7 +151,7 @@ bool VersionRewriter::Rewrite(Segments *segments) const {
             new_cand->value = ent->output_;
             new_cand->content_value = ent->output_;
             new_cand->key = seg->key();
-            new_cand->content_key = seg->key();
+            new_cand->content_key = new_cand->key;
             // we don't learn version
             new_cand->attributes |= Segment::Candidate::NO_LEARNING;
             result = true;
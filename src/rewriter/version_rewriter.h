@@ -34,6 +34,7 @@
 
 namespace mozc {
 
+class RewriterTrigger;
 class Segments;
 
 // A very simple rewriter to put version candidates for some segments.
@@ -44,6 +45,8 @@ class VersionRewriter: public RewriterInterface  {
 
   virtual int capability() const;
 
+  virtual void GetTrigger(RewriterTrigger *trigger) const;
+
   virtual bool Rewrite(Segments *segments) const;
 };
 }
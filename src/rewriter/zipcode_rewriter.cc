@@ -35,6 +35,7 @@
 #include "config/config.pb.h"
 #include "converter/segments.h"
 #include "dictionary/pos_matcher.h"
+#include "rewriter/rewriter_trigger.h"
 
 namespace mozc {
 namespace {
@@ -112,7 +113,7 @@ bool InsertCandidate(size_t insert_pos,
   candidate->value = value;
   candidate->content_value = value;
   candidate->key = zipcode;
-  candidate->content_key = zipcode;
+  candidate->content_key = candidate->key;
   candidate->attributes |= Segment::Candidate::NO_VARIANTS_EXPANSION;
   candidate->attributes |= Segment::Candidate::NO_LEARNING;
   // "郵便番号と住所"
@@ -129,6 +130,12 @@ ZipcodeRewriter::ZipcodeRewriter() {}
 
 ZipcodeRewriter::~ZipcodeRewriter() {}
 
+void ZipcodeRewriter::GetTrigger(RewriterTrigger *trigger) const {
+  // Zipcode candidates are looked up by the digits of zipcodes.
+  trigger->RequireFeatures(RewriterTrigger::SINGLE_SEGMENT |
+                           RewriterTrigger::HAS_NUMBER);
+}
+
 bool ZipcodeRewriter::Rewrite(Segments *segments) const {
   if (segments->conversion_segments_size() != 1) {
     return false;
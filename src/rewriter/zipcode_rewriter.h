@@ -34,6 +34,7 @@
 
 namespace mozc {
 
+class RewriterTrigger;
 class Segments;
 
 class ZipcodeRewriter: public RewriterInterface  {
@@ -41,6 +42,8 @@ class ZipcodeRewriter: public RewriterInterface  {
   ZipcodeRewriter();
   virtual ~ZipcodeRewriter();
 
+  virtual void GetTrigger(RewriterTrigger *trigger) const;
+
   virtual bool Rewrite(Segments *segments) const;
 };
 }  // namespace mozc
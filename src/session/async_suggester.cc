@@ -0,0 +1,454 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/async_suggester.h"
+
+#include <algorithm>
+#include <deque>
+#include <map>
+
+#include "base/base.h"
+#include "base/mutex.h"
+#include "base/singleton.h"
+#include "base/thread.h"
+#include "base/unnamed_event.h"
+#include "base/util.h"
+#include "composer/composer.h"
+#include "converter/conversion_request.h"
+#include "converter/converter_interface.h"
+#include "converter/segments.h"
+
+namespace mozc {
+namespace session {
+namespace {
+// The speculative conversion starts when no request has been started for
+// this period, i.e. the user pauses.  It is longer than the interval of
+// keys in continuous typing.
+const int kConversionDelayMsec = 150;
+
+// They are not Singletons because the worker uses them until it is joined.
+// Held by the worker while it processes a request, and by the thread
+// processing a command.
+Mutex g_converter_mutex;
+// Guards |g_num_waiting_commands|.
+Mutex g_command_mutex;
+// The number of the commands holding or waiting for |g_converter_mutex|.
+int g_num_waiting_commands = 0;
+// Notified when |g_num_waiting_commands| becomes 0.
+UnnamedEvent g_no_command_event;
+}  // namespace
+
+// The thread shared by all the suggesters.
+class AsyncSuggesterWorker : public Thread {
+ public:
+  AsyncSuggesterWorker() : current_(NULL), stopped_(false) {
+    Start();
+  }
+
+  virtual ~AsyncSuggesterWorker() {
+    {
+      scoped_lock l(&mutex_);
+      stopped_ = true;
+    }
+    event_.Notify();
+    Join();
+  }
+
+  // Queues the suggestion of |suggester| unless it is already queued.
+  void Push(AsyncSuggester *suggester) {
+    {
+      scoped_lock l(&mutex_);
+      if (find(queue_.begin(), queue_.end(), suggester) != queue_.end()) {
+        return;
+      }
+      queue_.push_back(suggester);
+    }
+    event_.Notify();
+  }
+
+  // Schedules the conversion of |suggester| after |delay_msec|.  The
+  // previous schedule of |suggester| is replaced, so the conversion is
+  // delayed by every new request.  The queued suggestions precede it.
+  void PushConversion(AsyncSuggester *suggester, int delay_msec) {
+    const uint64 time =
+        Util::GetTicks() + Util::GetFrequency() * delay_msec / 1000;
+    {
+      scoped_lock l(&mutex_);
+      conversions_[suggester] = time;
+    }
+    event_.Notify();
+  }
+
+  // Removes |suggester| from the queues and waits until it is no longer
+  // processed.
+  void Remove(AsyncSuggester *suggester) {
+    while (true) {
+      {
+        scoped_lock l(&mutex_);
+        queue_.erase(remove(queue_.begin(), queue_.end(), suggester),
+                     queue_.end());
+        conversions_.erase(suggester);
+        if (current_ != suggester) {
+          return;
+        }
+      }
+      // |idle_event_| may have been notified for another suggester, so
+      // |current_| is checked again.
+      idle_event_.Wait(-1);
+    }
+  }
+
+  virtual void Run() {
+    while (true) {
+      WaitForCommands();
+      // Milliseconds to the next conversion.  Negative if none.
+      int wait_msec = -1;
+      {
+        // |current_| is set only with |g_converter_mutex| held, so the
+        // suggesters can be deleted by the commands without waiting for
+        // the worker.
+        scoped_lock converter_lock(&g_converter_mutex);
+        AsyncSuggester *suggester = NULL;
+        bool convert = false;
+        {
+          scoped_lock l(&mutex_);
+          if (stopped_) {
+            return;
+          }
+          if (!queue_.empty()) {
+            suggester = queue_.front();
+            queue_.pop_front();
+          } else if (!conversions_.empty()) {
+            map<AsyncSuggester *, uint64>::iterator next =
+                conversions_.begin();
+            for (map<AsyncSuggester *, uint64>::iterator it = next;
+                 it != conversions_.end(); ++it) {
+              if (it->second < next->second) {
+                next = it;
+              }
+            }
+            const uint64 now = Util::GetTicks();
+            if (next->second <= now) {
+              suggester = next->first;
+              convert = true;
+              conversions_.erase(next);
+            } else {
+              wait_msec = static_cast<int>(
+                  (next->second - now) * 1000 / Util::GetFrequency()) + 1;
+            }
+          }
+          current_ = suggester;
+        }
+        if (suggester != NULL) {
+          // |suggester| is not deleted while it is processed; see Remove().
+          if (convert) {
+            suggester->ProcessConversion();
+          } else {
+            suggester->Process();
+          }
+          {
+            scoped_lock l(&mutex_);
+            current_ = NULL;
+          }
+          idle_event_.Notify();
+          continue;
+        }
+      }
+      event_.Wait(wait_msec);
+    }
+  }
+
+ private:
+  // Waits while any command holds or waits for |g_converter_mutex|.
+  // Otherwise the worker could take the mutex again right after releasing
+  // it, and a command could wait for more than one request.
+  static void WaitForCommands() {
+    while (true) {
+      {
+        scoped_lock l(&g_command_mutex);
+        if (g_num_waiting_commands == 0) {
+          return;
+        }
+      }
+      g_no_command_event.Wait(-1);
+    }
+  }
+
+  Mutex mutex_;
+  UnnamedEvent event_;
+  // Notified when the worker finishes processing a suggester.
+  UnnamedEvent idle_event_;
+  deque<AsyncSuggester *> queue_;
+  // The suggesters to convert and the ticks to start the conversion.
+  map<AsyncSuggester *, uint64> conversions_;
+  AsyncSuggester *current_;
+  bool stopped_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncSuggesterWorker);
+};
+
+AsyncSuggester::ScopedCommandLock::ScopedCommandLock() {
+  {
+    scoped_lock l(&g_command_mutex);
+    ++g_num_waiting_commands;
+  }
+  g_converter_mutex.Lock();
+}
+
+AsyncSuggester::ScopedCommandLock::~ScopedCommandLock() {
+  g_converter_mutex.Unlock();
+  bool notify = false;
+  {
+    scoped_lock l(&g_command_mutex);
+    --g_num_waiting_commands;
+    notify = (g_num_waiting_commands == 0);
+  }
+  if (notify) {
+    g_no_command_event.Notify();
+  }
+}
+
+AsyncSuggester::AsyncSuggester(const ConverterInterface *converter)
+    : converter_(converter),
+      state_(IDLE),
+      conversion_state_(IDLE),
+      generation_(0),
+      has_suggestions_(false),
+      has_conversion_(false) {
+  DCHECK(converter_);
+}
+
+AsyncSuggester::~AsyncSuggester() {
+  Singleton<AsyncSuggesterWorker>::get()->Remove(this);
+}
+
+void AsyncSuggester::Start(const composer::Composer &composer,
+                           const Segments &segments,
+                           bool convert) {
+  {
+    scoped_lock l(&mutex_);
+    ++generation_;
+    state_ = RUNNING;
+    has_suggestions_ = false;
+    result_.reset(NULL);
+    conversion_state_ = convert ? RUNNING : IDLE;
+    has_conversion_ = false;
+    conversion_result_.reset(NULL);
+    conversion_key_.clear();
+    if (convert) {
+      composer.GetQueryForConversion(&conversion_key_);
+    }
+    request_composer_.reset(new composer::Composer);
+    request_composer_->CopyFrom(composer);
+    request_segments_.reset(new Segments);
+    request_segments_->CopyFrom(segments);
+  }
+  AsyncSuggesterWorker *worker = Singleton<AsyncSuggesterWorker>::get();
+  worker->Push(this);
+  if (convert) {
+    worker->PushConversion(this, kConversionDelayMsec);
+  }
+}
+
+void AsyncSuggester::Cancel() {
+  scoped_lock l(&mutex_);
+  ++generation_;
+  state_ = IDLE;
+  has_suggestions_ = false;
+  result_.reset(NULL);
+  conversion_state_ = IDLE;
+  has_conversion_ = false;
+  conversion_result_.reset(NULL);
+  conversion_key_.clear();
+  request_composer_.reset(NULL);
+  request_segments_.reset(NULL);
+}
+
+void AsyncSuggester::CancelSuggestion() {
+  scoped_lock l(&mutex_);
+  if (conversion_state_ == IDLE) {
+    // Nothing to keep.
+    ++generation_;
+    request_composer_.reset(NULL);
+    request_segments_.reset(NULL);
+  }
+  state_ = IDLE;
+  has_suggestions_ = false;
+  result_.reset(NULL);
+}
+
+AsyncSuggester::State AsyncSuggester::state() const {
+  scoped_lock l(&mutex_);
+  return state_;
+}
+
+AsyncSuggester::State AsyncSuggester::conversion_state() const {
+  scoped_lock l(&mutex_);
+  return conversion_state_;
+}
+
+bool AsyncSuggester::TakeResult(Segments *segments) {
+  DCHECK(segments);
+  scoped_lock l(&mutex_);
+  if (state_ != FINISHED) {
+    return false;
+  }
+  state_ = IDLE;
+  if (!has_suggestions_ || result_.get() == NULL) {
+    return false;
+  }
+  segments->CopyFrom(*result_);
+  result_.reset(NULL);
+  return true;
+}
+
+bool AsyncSuggester::TakeConversion(const string &key, Segments *segments) {
+  DCHECK(segments);
+  scoped_lock l(&mutex_);
+  const bool available = (conversion_state_ == FINISHED &&
+                          conversion_key_ == key &&
+                          has_conversion_ &&
+                          conversion_result_.get() != NULL);
+  if (available) {
+    segments->CopyFrom(*conversion_result_);
+  }
+  // The conversion is no longer needed even if it is not available.  The
+  // one not started yet is skipped by ProcessConversion().
+  conversion_state_ = IDLE;
+  has_conversion_ = false;
+  conversion_result_.reset(NULL);
+  conversion_key_.clear();
+  if (state_ != RUNNING) {
+    request_composer_.reset(NULL);
+    request_segments_.reset(NULL);
+  }
+  return available;
+}
+
+bool AsyncSuggester::Wait(int msec) {
+  return WaitWhileRunning(&state_, msec);
+}
+
+bool AsyncSuggester::WaitForConversion(int msec) {
+  return WaitWhileRunning(&conversion_state_, msec);
+}
+
+bool AsyncSuggester::WaitWhileRunning(const State *state, int msec) {
+  while (true) {
+    {
+      scoped_lock l(&mutex_);
+      if (*state != RUNNING) {
+        return true;
+      }
+    }
+    // The event may have been notified for an older request or for the
+    // other stage, so the state is checked again after the wait.
+    if (!finished_event_.Wait(msec)) {
+      scoped_lock l(&mutex_);
+      return *state != RUNNING;
+    }
+  }
+}
+
+void AsyncSuggester::Process() {
+  scoped_ptr<composer::Composer> composer;
+  scoped_ptr<Segments> segments;
+  uint64 generation = 0;
+  {
+    scoped_lock l(&mutex_);
+    if (state_ != RUNNING || request_composer_.get() == NULL) {
+      // Cancelled before the worker picked it up.
+      return;
+    }
+    generation = generation_;
+    TakeRequest(conversion_state_ == RUNNING, &composer, &segments);
+  }
+
+  const bool has_suggestions =
+      converter_->StartSuggestionWithComposer(segments.get(), composer.get());
+  {
+    scoped_lock l(&mutex_);
+    if (generation != generation_ || state_ != RUNNING) {
+      VLOG(2) << "Discarding the suggestion of a stale request";
+      return;
+    }
+    state_ = FINISHED;
+    has_suggestions_ = has_suggestions;
+    result_.reset(segments.release());
+  }
+  finished_event_.Notify();
+}
+
+void AsyncSuggester::ProcessConversion() {
+  scoped_ptr<composer::Composer> composer;
+  scoped_ptr<Segments> segments;
+  uint64 generation = 0;
+  {
+    scoped_lock l(&mutex_);
+    if (conversion_state_ != RUNNING || request_composer_.get() == NULL) {
+      // Cancelled or taken before the worker picked it up.
+      return;
+    }
+    generation = generation_;
+    TakeRequest(state_ == RUNNING, &composer, &segments);
+  }
+
+  segments->set_request_type(Segments::CONVERSION);
+  const bool has_conversion = converter_->StartConversionForRequest(
+      ConversionRequest(composer.get()), segments.get());
+  {
+    scoped_lock l(&mutex_);
+    if (generation != generation_ || conversion_state_ != RUNNING) {
+      VLOG(2) << "Discarding the conversion of a stale request";
+      return;
+    }
+    conversion_state_ = FINISHED;
+    has_conversion_ = has_conversion;
+    conversion_result_.reset(segments.release());
+  }
+  finished_event_.Notify();
+}
+
+void AsyncSuggester::TakeRequest(bool keep,
+                                 scoped_ptr<composer::Composer> *composer,
+                                 scoped_ptr<Segments> *segments) {
+  if (!keep) {
+    composer->reset(request_composer_.release());
+    segments->reset(request_segments_.release());
+    return;
+  }
+  composer->reset(new composer::Composer);
+  (*composer)->CopyFrom(*request_composer_);
+  segments->reset(new Segments);
+  (*segments)->CopyFrom(*request_segments_);
+}
+
+}  // namespace session
+}  // namespace mozc
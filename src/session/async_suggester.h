@@ -0,0 +1,175 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Runs suggestion for a session on a background thread, so that the key
+// event which changed the composition can be answered before the
+// suggestion is ready.  Optionally the composition is also converted in
+// advance while the user pauses, so that the conversion key can be
+// answered without running the conversion.
+
+#ifndef MOZC_SESSION_ASYNC_SUGGESTER_H_
+#define MOZC_SESSION_ASYNC_SUGGESTER_H_
+
+#include <string>
+
+#include "base/base.h"
+#include "base/mutex.h"
+#include "base/unnamed_event.h"
+
+namespace mozc {
+class ConverterInterface;
+class Segments;
+namespace composer {
+class Composer;
+}  // namespace composer
+
+namespace session {
+
+// Each session has its own AsyncSuggester and all of them share one worker
+// thread.  Only the latest request of a suggester is meaningful: Start()
+// and Cancel() drop the request which is still in the queue, and the result
+// of the request which is already running on the worker is discarded when
+// it finishes.
+//
+// When speculative conversion is requested, the worker converts the
+// composition after the suggestion once no other request has been started
+// for a while, i.e. the user pauses typing.  Each request delays the
+// conversion of the suggester, and the conversion of a stale request is
+// skipped.  The result is kept with the composition string until it is
+// taken or another request is started.
+//
+// The methods are called from the thread processing the session's commands.
+// The converter, its dictionaries and the config are not safe to use from
+// two threads at the same time, so the worker processes a request only
+// while no command holds ScopedCommandLock.
+class AsyncSuggester {
+ public:
+  enum State {
+    IDLE,      // No request
+    RUNNING,   // The latest request is queued or running
+    FINISHED,  // The result of the latest request is ready
+  };
+
+  // Held by the thread processing a command while it runs the command.
+  // The worker doesn't start a request while a command holds or waits for
+  // the lock, so a command waits at most for the request already running.
+  class ScopedCommandLock {
+   public:
+    ScopedCommandLock();
+    ~ScopedCommandLock();
+
+   private:
+    DISALLOW_COPY_AND_ASSIGN(ScopedCommandLock);
+  };
+
+  // |converter| is used on the worker thread.
+  explicit AsyncSuggester(const ConverterInterface *converter);
+
+  // Waits for the request running on the worker if any.  It never waits
+  // with ScopedCommandLock held.
+  ~AsyncSuggester();
+
+  // Requests suggestion for |composer|.  |segments| has the history
+  // segments and the preferences for the request.  Both are copied.
+  // If |convert| is true, |composer| is also converted unless another
+  // request is started soon.
+  void Start(const composer::Composer &composer, const Segments &segments,
+             bool convert);
+
+  // Drops the current request and its results.
+  void Cancel();
+
+  // Drops the suggestion of the current request.  The speculative
+  // conversion is kept.
+  void CancelSuggestion();
+
+  State state() const;
+  State conversion_state() const;
+
+  // Moves the suggestion of the finished request to |segments| and goes
+  // back to IDLE.  Returns false if the request has not finished or the
+  // converter returned no suggestions.
+  bool TakeResult(Segments *segments);
+
+  // Moves the speculative conversion to |segments| if it has finished for
+  // the composition |key|, the query for conversion.  Returns false if the
+  // conversion is not available.  It doesn't wait for the worker, which
+  // can't run while the caller holds ScopedCommandLock.  The conversion
+  // is dropped in either case.
+  bool TakeConversion(const string &key, Segments *segments);
+
+  // Waits until the suggestion of the latest request finishes.  Returns
+  // false if it is still running after |msec| milliseconds.  A negative
+  // |msec| waits forever.  Don't call it with ScopedCommandLock held.
+  bool Wait(int msec);
+
+  // Same as Wait() but waits for the speculative conversion.
+  bool WaitForConversion(int msec);
+
+ private:
+  friend class AsyncSuggesterWorker;
+
+  // Runs the suggestion of the request on the worker thread.
+  void Process();
+
+  // Runs the speculative conversion of the request on the worker thread.
+  void ProcessConversion();
+
+  // Moves the request to |composer| and |segments|, or copies it if |keep|
+  // is true, i.e. the other stage still needs it.  |mutex_| is held.
+  void TakeRequest(bool keep, scoped_ptr<composer::Composer> *composer,
+                   scoped_ptr<Segments> *segments);
+
+  // Waits while |*state| is RUNNING.
+  bool WaitWhileRunning(const State *state, int msec);
+
+  const ConverterInterface *converter_;
+  mutable Mutex mutex_;
+  State state_;
+  State conversion_state_;
+  // Incremented for every Start() and Cancel() so that Process() can tell
+  // whether its request is still the latest one.
+  uint64 generation_;
+  bool has_suggestions_;
+  bool has_conversion_;
+  scoped_ptr<composer::Composer> request_composer_;
+  scoped_ptr<Segments> request_segments_;
+  scoped_ptr<Segments> result_;
+  // The query for conversion of the requested composition.
+  string conversion_key_;
+  scoped_ptr<Segments> conversion_result_;
+  UnnamedEvent finished_event_;
+
+  DISALLOW_COPY_AND_ASSIGN(AsyncSuggester);
+};
+
+}  // namespace session
+}  // namespace mozc
+#endif  // MOZC_SESSION_ASYNC_SUGGESTER_H_
@@ -0,0 +1,407 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/async_suggester.h"
+
+#include "base/base.h"
+#include "base/mutex.h"
+#include "base/thread.h"
+#include "base/unnamed_event.h"
+#include "base/util.h"
+#include "composer/composer.h"
+#include "composer/table.h"
+#include "converter/converter_mock.h"
+#include "converter/segments.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace session {
+namespace {
+
+// Converter which can hold suggestion requests until Release() is called.
+class BlockingConverter : public ConverterMock {
+ public:
+  BlockingConverter()
+      : blocked_(false), num_calls_(0), num_conversions_(0) {}
+
+  void Block() {
+    scoped_lock l(&mutex_);
+    blocked_ = true;
+  }
+
+  void Release() {
+    {
+      scoped_lock l(&mutex_);
+      blocked_ = false;
+    }
+    release_event_.Notify();
+  }
+
+  int num_calls() const {
+    scoped_lock l(&mutex_);
+    return num_calls_;
+  }
+
+  virtual bool StartSuggestionWithComposer(
+      Segments *segments, const composer::Composer *composer) const {
+    bool blocked = false;
+    {
+      scoped_lock l(&mutex_);
+      ++num_calls_;
+      blocked = blocked_;
+    }
+    if (blocked) {
+      release_event_.Wait(-1);
+    }
+    segments->CopyFrom(suggestion_);
+    return suggestion_.conversion_segments_size() > 0;
+  }
+
+  void SetSuggestion(const Segments &segments) {
+    suggestion_.CopyFrom(segments);
+  }
+
+  int num_conversions() const {
+    scoped_lock l(&mutex_);
+    return num_conversions_;
+  }
+
+  virtual bool StartConversionForRequest(const ConversionRequest &request,
+                                         Segments *segments) const {
+    {
+      scoped_lock l(&mutex_);
+      ++num_conversions_;
+    }
+    return ConverterMock::StartConversionForRequest(request, segments);
+  }
+
+ private:
+  mutable Mutex mutex_;
+  mutable UnnamedEvent release_event_;
+  bool blocked_;
+  mutable int num_calls_;
+  mutable int num_conversions_;
+  Segments suggestion_;
+};
+
+void AddSuggestion(const string &key, const string &value,
+                   Segments *segments) {
+  segments->set_request_type(Segments::SUGGESTION);
+  Segment *segment = segments->add_segment();
+  segment->set_key(key);
+  segment->add_candidate()->value = value;
+}
+
+bool WaitForCalls(const BlockingConverter &converter, int num_calls) {
+  for (int i = 0; i < 1000; ++i) {
+    if (converter.num_calls() >= num_calls) {
+      return true;
+    }
+    Util::Sleep(1);
+  }
+  return false;
+}
+
+TEST(AsyncSuggesterTest, StartAndTakeResult) {
+  BlockingConverter converter;
+  Segments suggestion;
+  AddSuggestion("mo", "MOZUKU", &suggestion);
+  converter.SetSuggestion(suggestion);
+
+  AsyncSuggester suggester(&converter);
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.state());
+
+  composer::Composer composer;
+  Segments segments;
+  suggester.Start(composer, segments, false);
+  EXPECT_TRUE(suggester.Wait(-1));
+  EXPECT_EQ(AsyncSuggester::FINISHED, suggester.state());
+
+  Segments result;
+  EXPECT_TRUE(suggester.TakeResult(&result));
+  ASSERT_EQ(1, result.conversion_segments_size());
+  EXPECT_EQ("MOZUKU", result.conversion_segment(0).candidate(0).value);
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.state());
+  EXPECT_FALSE(suggester.TakeResult(&result));
+}
+
+TEST(AsyncSuggesterTest, NoSuggestion) {
+  BlockingConverter converter;
+  AsyncSuggester suggester(&converter);
+
+  composer::Composer composer;
+  Segments segments;
+  suggester.Start(composer, segments, false);
+  EXPECT_TRUE(suggester.Wait(-1));
+  EXPECT_EQ(AsyncSuggester::FINISHED, suggester.state());
+
+  Segments result;
+  EXPECT_FALSE(suggester.TakeResult(&result));
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.state());
+}
+
+TEST(AsyncSuggesterTest, StaleRequestsAreDropped) {
+  BlockingConverter converter;
+  Segments suggestion;
+  AddSuggestion("mo", "MOZUKU", &suggestion);
+  converter.SetSuggestion(suggestion);
+  converter.Block();
+
+  AsyncSuggester suggester(&converter);
+  composer::Composer composer;
+  Segments segments;
+  suggester.Start(composer, segments, false);
+  ASSERT_TRUE(WaitForCalls(converter, 1));
+
+  // The first request is running.  The second one is replaced by the
+  // third one before the worker picks it up.
+  suggester.Start(composer, segments, false);
+  suggester.Start(composer, segments, false);
+  EXPECT_EQ(AsyncSuggester::RUNNING, suggester.state());
+  EXPECT_FALSE(suggester.Wait(10));
+
+  converter.Release();
+  EXPECT_TRUE(suggester.Wait(-1));
+  EXPECT_EQ(AsyncSuggester::FINISHED, suggester.state());
+  EXPECT_EQ(2, converter.num_calls());
+
+  Segments result;
+  EXPECT_TRUE(suggester.TakeResult(&result));
+}
+
+TEST(AsyncSuggesterTest, Cancel) {
+  BlockingConverter converter;
+  Segments suggestion;
+  AddSuggestion("mo", "MOZUKU", &suggestion);
+  converter.SetSuggestion(suggestion);
+  converter.Block();
+
+  AsyncSuggester suggester(&converter);
+  composer::Composer composer;
+  Segments segments;
+  suggester.Start(composer, segments, false);
+  ASSERT_TRUE(WaitForCalls(converter, 1));
+
+  suggester.Cancel();
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.state());
+  converter.Release();
+
+  // The result of the cancelled request is discarded.
+  Util::Sleep(10);
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.state());
+  Segments result;
+  EXPECT_FALSE(suggester.TakeResult(&result));
+}
+
+TEST(AsyncSuggesterTest, CommandLockBlocksRequests) {
+  BlockingConverter converter;
+  Segments suggestion;
+  AddSuggestion("mo", "MOZUKU", &suggestion);
+  converter.SetSuggestion(suggestion);
+
+  AsyncSuggester suggester(&converter);
+  composer::Composer composer;
+  Segments segments;
+  {
+    AsyncSuggester::ScopedCommandLock l;
+    suggester.Start(composer, segments, false);
+    EXPECT_FALSE(suggester.Wait(10));
+    EXPECT_EQ(0, converter.num_calls());
+
+    // A queued suggester can be deleted with the lock held.
+    scoped_ptr<AsyncSuggester> other(new AsyncSuggester(&converter));
+    other->Start(composer, segments, false);
+    other.reset(NULL);
+  }
+  EXPECT_TRUE(suggester.Wait(-1));
+  EXPECT_EQ(1, converter.num_calls());
+  Segments result;
+  EXPECT_TRUE(suggester.TakeResult(&result));
+}
+
+class CommandThread : public Thread {
+ public:
+  explicit CommandThread(const BlockingConverter *converter)
+      : converter_(converter), num_calls_(-1) {}
+
+  virtual void Run() {
+    AsyncSuggester::ScopedCommandLock l;
+    num_calls_ = converter_->num_calls();
+  }
+
+  // The number of the suggestions run before the command.
+  int num_calls() const {
+    return num_calls_;
+  }
+
+ private:
+  const BlockingConverter *converter_;
+  int num_calls_;
+};
+
+TEST(AsyncSuggesterTest, WaitingCommandPrecedesQueuedRequests) {
+  BlockingConverter converter;
+  converter.Block();
+
+  AsyncSuggester suggester1(&converter);
+  AsyncSuggester suggester2(&converter);
+  composer::Composer composer;
+  Segments segments;
+  suggester1.Start(composer, segments, false);
+  ASSERT_TRUE(WaitForCalls(converter, 1));
+  suggester2.Start(composer, segments, false);
+
+  // The command waits for the request of |suggester1| but not for the
+  // one of |suggester2|.
+  CommandThread command(&converter);
+  command.SetJoinable(true);
+  command.Start();
+  Util::Sleep(50);
+  converter.Release();
+  command.Join();
+  EXPECT_EQ(1, command.num_calls());
+
+  EXPECT_TRUE(suggester2.Wait(-1));
+  EXPECT_EQ(2, converter.num_calls());
+}
+
+TEST(AsyncSuggesterTest, SpeculativeConversion) {
+  BlockingConverter converter;
+  Segments suggestion;
+  AddSuggestion("mo", "MOZUKU", &suggestion);
+  converter.SetSuggestion(suggestion);
+  Segments conversion;
+  {
+    conversion.set_request_type(Segments::CONVERSION);
+    Segment *segment = conversion.add_segment();
+    segment->set_key("mo");
+    segment->add_candidate()->value = "MO";
+  }
+  converter.SetStartConversionForRequest(&conversion, true);
+
+  composer::Table table;
+  composer::Composer composer;
+  composer.SetTableForUnittest(&table);
+  composer.InsertCharacterPreedit("mo");
+  Segments segments;
+
+  AsyncSuggester suggester(&converter);
+  suggester.Start(composer, segments, true);
+  EXPECT_TRUE(suggester.Wait(-1));
+
+  // The conversion waits for the pause after the request.
+  EXPECT_EQ(AsyncSuggester::RUNNING, suggester.conversion_state());
+  EXPECT_EQ(0, converter.num_conversions());
+
+  // The suggestion can be dropped without the conversion.
+  suggester.CancelSuggestion();
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.state());
+
+  EXPECT_TRUE(suggester.WaitForConversion(-1));
+  EXPECT_EQ(1, converter.num_conversions());
+  Segments result;
+  EXPECT_TRUE(suggester.TakeConversion("mo", &result));
+  ASSERT_EQ(1, result.conversion_segments_size());
+  EXPECT_EQ(Segments::CONVERSION, result.request_type());
+  EXPECT_EQ("MO", result.conversion_segment(0).candidate(0).value);
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.conversion_state());
+
+  // The result is taken only once.
+  EXPECT_FALSE(suggester.TakeConversion("mo", &result));
+
+  // The result for another composition is dropped.
+  suggester.Start(composer, segments, true);
+  EXPECT_TRUE(suggester.WaitForConversion(-1));
+  EXPECT_FALSE(suggester.TakeConversion("m", &result));
+  EXPECT_FALSE(suggester.TakeConversion("mo", &result));
+}
+
+TEST(AsyncSuggesterTest, SpeculativeConversionWaitsForPause) {
+  BlockingConverter converter;
+  composer::Table table;
+  composer::Composer composer;
+  composer.SetTableForUnittest(&table);
+  composer.InsertCharacterPreedit("mo");
+  Segments segments;
+
+  // The requests started at shorter intervals than the delay of the
+  // conversion are not converted except for the last one.
+  AsyncSuggester suggester(&converter);
+  for (int i = 0; i < 5; ++i) {
+    suggester.Start(composer, segments, true);
+    Util::Sleep(50);
+  }
+  EXPECT_TRUE(suggester.WaitForConversion(-1));
+  EXPECT_EQ(1, converter.num_conversions());
+
+  // The conversion not started yet is skipped once it is taken.
+  suggester.Start(composer, segments, true);
+  EXPECT_TRUE(suggester.Wait(-1));
+  Segments result;
+  EXPECT_FALSE(suggester.TakeConversion("mo", &result));
+  Util::Sleep(300);
+  EXPECT_EQ(1, converter.num_conversions());
+}
+
+TEST(AsyncSuggesterTest, SpeculativeConversionIsDiscarded) {
+  BlockingConverter converter;
+  Segments conversion;
+  {
+    conversion.set_request_type(Segments::CONVERSION);
+    Segment *segment = conversion.add_segment();
+    segment->set_key("mo");
+    segment->add_candidate()->value = "MO";
+  }
+  converter.SetStartConversionForRequest(&conversion, true);
+
+  composer::Table table;
+  composer::Composer composer;
+  composer.SetTableForUnittest(&table);
+  composer.InsertCharacterPreedit("mo");
+  Segments segments;
+  Segments result;
+
+  AsyncSuggester suggester(&converter);
+  suggester.Start(composer, segments, true);
+  suggester.Cancel();
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.conversion_state());
+  EXPECT_FALSE(suggester.TakeConversion("mo", &result));
+
+  // A new request discards the previous conversion.
+  suggester.Start(composer, segments, true);
+  suggester.Start(composer, segments, false);
+  EXPECT_EQ(AsyncSuggester::IDLE, suggester.conversion_state());
+  EXPECT_TRUE(suggester.Wait(-1));
+  EXPECT_FALSE(suggester.TakeConversion("mo", &result));
+}
+
+}  // namespace
+}  // namespace session
+}  // namespace mozc
@@ -43,6 +43,7 @@
 #include "config/config.pb.h"
 // TODO(komatsu): Delete the next line by refactoring of the initializer.
 #include "converter/converter_interface.h"
+#include "converter/segments.h"
 #include "rewriter/calculator/calculator_interface.h"
 #include "session/internal/keymap.h"
 #include "session/internal/keymap-inl.h"
@@ -50,6 +51,7 @@
 #include "session/internal/session_output.h"
 #include "session/internal/key_event_transformer.h"
 #include "session/key_event_util.h"
+#include "session/async_suggester.h"
 #include "session/request_handler.h"
 #include "session/session_converter.h"
 
@@ -57,6 +59,9 @@ namespace mozc {
 namespace session {
 
 namespace {
+// Delay before the client fetches the suggestion computed in background.
+const uint32 kAsyncSuggestionDelayMsec = 10;
+
 // Logic of nested calculation
 // Returns the number of characters to expand preedit to left.
 size_t GetCompositionExpansionForCalculator(const string &preceding_text,
@@ -157,12 +162,27 @@ bool IsPureSpaceKey(const commands::KeyEvent &key) {
   }
   return true;
 }
+
+// Returns true if |type| neither modifies the composition nor shows
+// candidates, so that the suggestion in background can be kept running.
+bool KeepsAsyncSuggestion(commands::SessionCommand::CommandType type) {
+  switch (type) {
+    case commands::SessionCommand::GET_STATUS:
+    case commands::SessionCommand::USAGE_STATS_EVENT:
+    case commands::SessionCommand::SEND_CARET_LOCATION:
+    case commands::SessionCommand::GET_ASYNC_SUGGESTION:
+      return true;
+    default:
+      return false;
+  }
+}
 }  // namespace
 
 // TODO(komatsu): Remove these argument by using/making singletons.
 Session::Session()
     : context_(new ImeContext),
-      prev_context_(NULL) {
+      prev_context_(NULL),
+      keep_speculative_conversion_(false) {
   InitContext(context_.get());
 }
 
@@ -239,6 +259,9 @@ bool Session::SendCommand(commands::Command *command) {
   }
   TransformInput(command->mutable_input());
   const commands::SessionCommand &session_command = command->input().command();
+  if (!KeepsAsyncSuggestion(session_command.type())) {
+    ApplyAsyncSuggestion();
+  }
 
   // TODO(peria): Set usage stats tracker for each command like SendKey()
 
@@ -323,6 +346,9 @@ bool Session::SendCommand(commands::Command *command) {
     case commands::SessionCommand::SEND_CARET_LOCATION:
       result = SetCaretLocation(command);
       break;
+    case commands::SessionCommand::GET_ASYNC_SUGGESTION:
+      result = GetAsyncSuggestion(command);
+      break;
     default:
       LOG(WARNING) << "Unkown command" << command->DebugString();
       result = DoNothing(command);
@@ -432,6 +458,7 @@ bool Session::SendKey(commands::Command *command) {
   UpdateTime();
   UpdatePreferences(command);
   TransformInput(command->mutable_input());
+  ApplyAsyncSuggestion();
 
   bool result = false;
   switch (context_->state()) {
@@ -1019,6 +1046,11 @@ bool Session::ResetContext(commands::Command *command) {
 
 void Session::ReloadConfig() {
   UpdateConfig(config::ConfigHandler::GetConfig(), context_.get());
+  if (async_suggester_.get() != NULL) {
+    // The results computed with the old config must not be shown.
+    async_suggester_->Cancel();
+    keep_speculative_conversion_ = false;
+  }
 }
 
 // static
@@ -1433,6 +1465,9 @@ bool Session::InsertCharacter(commands::Command *command) {
     return Convert(command);
   }
 
+  if (StartAsyncSuggestion(command)) {
+    return true;
+  }
   if (context_->mutable_converter()->Suggest(context_->composer())) {
     DCHECK(context_->converter().IsActive());
     Output(command);
@@ -2125,7 +2160,8 @@ bool Session::Convert(commands::Command *command) {
     }
   }
 
-  if (!context_->mutable_converter()->Convert(context_->composer())) {
+  if (!ApplySpeculativeConversion() &&
+      !context_->mutable_converter()->Convert(context_->composer())) {
     LOG(ERROR) << "Conversion failed for some reasons.";
     OutputComposition(command);
     return true;
@@ -2248,6 +2284,8 @@ bool Session::Delete(commands::Command *command) {
   if (context_->mutable_composer()->Empty()) {
     SetSessionState(ImeContext::PRECOMPOSITION);
     OutputMode(command);
+  } else if (StartAsyncSuggestion(command)) {
+    return true;
   } else if (context_->mutable_converter()->Suggest(context_->composer())) {
     DCHECK(context_->converter().IsActive());
     Output(command);
@@ -2264,6 +2302,8 @@ bool Session::Backspace(commands::Command *command) {
   if (context_->mutable_composer()->Empty()) {
     SetSessionState(ImeContext::PRECOMPOSITION);
     OutputMode(command);
+  } else if (StartAsyncSuggestion(command)) {
+    return true;
   } else if (context_->mutable_converter()->Suggest(context_->composer())) {
     DCHECK(context_->converter().IsActive());
     Output(command);
@@ -2395,6 +2435,101 @@ bool Session::PredictAndConvert(commands::Command *command) {
   return true;
 }
 
+bool Session::StartAsyncSuggestion(commands::Command *command) {
+  if (!GET_REQUEST(async_suggestion)) {
+    return false;
+  }
+  if (async_suggester_.get() == NULL) {
+    async_suggester_.reset(
+        new AsyncSuggester(ConverterFactory::GetConverter()));
+  }
+
+  Segments segments;
+  if (!context_->mutable_converter()->PrepareSuggestion(
+          context_->composer(), &segments)) {
+    async_suggester_->Cancel();
+    OutputComposition(command);
+    return true;
+  }
+  async_suggester_->Start(context_->composer(), segments,
+                          GET_REQUEST(speculative_conversion));
+  keep_speculative_conversion_ = true;
+  OutputComposition(command);
+
+  // Ask the client to fetch the suggestion.
+  commands::Output::Callback *callback =
+      command->mutable_output()->mutable_callback();
+  callback->mutable_session_command()->set_type(
+      commands::SessionCommand::GET_ASYNC_SUGGESTION);
+  callback->set_delay_millisec(kAsyncSuggestionDelayMsec);
+  return true;
+}
+
+void Session::ApplyAsyncSuggestion() {
+  if (async_suggester_.get() == NULL) {
+    return;
+  }
+  Segments segments;
+  if (async_suggester_->TakeResult(&segments) &&
+      context_->state() == ImeContext::COMPOSITION) {
+    context_->mutable_converter()->ApplySuggestion(segments);
+  }
+  // A request still running is stale for the command to be processed,
+  // except that the speculative conversion is kept for the command right
+  // after the one which started it.
+  if (keep_speculative_conversion_) {
+    async_suggester_->CancelSuggestion();
+    keep_speculative_conversion_ = false;
+  } else {
+    async_suggester_->Cancel();
+  }
+}
+
+bool Session::ApplySpeculativeConversion() {
+  if (async_suggester_.get() == NULL) {
+    return false;
+  }
+  string key;
+  context_->composer().GetQueryForConversion(&key);
+  Segments segments;
+  if (!async_suggester_->TakeConversion(key, &segments)) {
+    return false;
+  }
+  return context_->mutable_converter()->ApplyConversion(segments);
+}
+
+bool Session::GetAsyncSuggestion(commands::Command *command) {
+  if (context_->state() != ImeContext::COMPOSITION ||
+      async_suggester_.get() == NULL) {
+    return DoNothing(command);
+  }
+  command->mutable_output()->set_consumed(true);
+
+  if (async_suggester_->state() == AsyncSuggester::RUNNING) {
+    // Not ready yet.  Ask the client to try again.
+    OutputComposition(command);
+    commands::Output::Callback *callback =
+        command->mutable_output()->mutable_callback();
+    callback->mutable_session_command()->set_type(
+        commands::SessionCommand::GET_ASYNC_SUGGESTION);
+    callback->set_delay_millisec(kAsyncSuggestionDelayMsec);
+    return true;
+  }
+
+  // The request is kept so that the speculative conversion is available
+  // for the next command.
+  Segments segments;
+  if (async_suggester_->TakeResult(&segments)) {
+    context_->mutable_converter()->ApplySuggestion(segments);
+  }
+  if (context_->converter().IsActive()) {
+    Output(command);
+  } else {
+    OutputComposition(command);
+  }
+  return true;
+}
+
 bool Session::ExpandSuggestion(commands::Command *command) {
   if (context_->state() == ImeContext::CONVERSION ||
       context_->state() == ImeContext::DIRECT) {
@@ -55,10 +55,23 @@
         'session_base.gyp:keymap',
         'session_base.gyp:keymap_factory',
         'session_base.gyp:session_protocol',
+        'async_suggester',
         'session_handler',
         'session_internal',
       ],
     },
+    {
+      'target_name': 'async_suggester',
+      'type': 'static_library',
+      'sources': [
+        'async_suggester.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../composer/composer.gyp:composer',
+        '../converter/converter_base.gyp:segments',
+      ],
+    },
     {
       'target_name': 'session_internal',
       'type' : 'static_library',
@@ -83,6 +96,7 @@
         'session_factory_manager.cc',
         'session_handler.cc',
         'session_observer_handler.cc',
+        'session_table.cc',
         'session_watch_dog.cc',
       ],
       'dependencies': [
@@ -92,6 +106,7 @@
         'session_base.gyp:generic_storage_manager',
         'session_base.gyp:request_handler',
         'session_base.gyp:session_protocol',
+        'async_suggester',
       ],
       'conditions': [
         ['enable_cloud_sync==1', {
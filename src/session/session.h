@@ -47,6 +47,7 @@
 
 namespace mozc {
 namespace session {
+class AsyncSuggester;
 class SessionCursorManageTest;
 class Session : public SessionInterface {
  public:
@@ -136,6 +137,11 @@ class Session : public SessionInterface {
   // Expands suggestion candidates.
   bool ExpandSuggestion(commands::Command *command);
 
+  // Returns the suggestion computed in background if it is ready.  This
+  // function is called when the GET_ASYNC_SUGGESTION SessionCommand is
+  // called.
+  bool GetAsyncSuggestion(commands::Command *command);
+
   // Commit only the first segment.
   bool CommitSegment(commands::Command *command);
   // Commit some characters at the head of the preedit.
@@ -246,9 +252,14 @@ class Session : public SessionInterface {
   FRIEND_TEST(SessionTest, OutputInitialComposition);
   FRIEND_TEST(SessionTest, IsFullWidthInsertSpace);
   FRIEND_TEST(SessionTest, RequestUndo);
+  FRIEND_TEST(SessionTest, SpeculativeConversionIsDiscardedByReloadConfig);
 
   scoped_ptr<ImeContext> context_;
   scoped_ptr<ImeContext> prev_context_;
+  // Created when Request::async_suggestion is enabled.
+  scoped_ptr<AsyncSuggester> async_suggester_;
+  // True until the command after the one which started the request.
+  bool keep_speculative_conversion_;
 
   void InitContext(ImeContext *context) const;
 
@@ -297,6 +308,20 @@ class Session : public SessionInterface {
   // Process it and return true, otherwise return false.
   bool MaybeSelectCandidate(commands::Command *command);
 
+  // Starts suggestion in background and fills the composition and the
+  // callback to fetch the suggestion.  Returns false if
+  // Request::async_suggestion is disabled.
+  bool StartAsyncSuggestion(commands::Command *command);
+
+  // Shows the suggestion computed in background if it is ready, and
+  // cancels the request otherwise.  This is called before a command
+  // modifies the composition.
+  void ApplyAsyncSuggestion();
+
+  // Shows the conversion computed in background for the current
+  // composition.  Returns false if it is not available.
+  bool ApplySpeculativeConversion();
+
   // Fill command's output according to the current state.
   void OutputFromState(commands::Command *command);
   void Output(commands::Command *command);
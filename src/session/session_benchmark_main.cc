@@ -0,0 +1,466 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Latency benchmark of SessionHandler.
+// Replays key event sequences with concurrent sessions, either calling
+// SessionHandler in process or sending the commands to SessionServer
+// through IPC, and reports the latency distribution of each command type.
+//
+// Usage:
+//   session_benchmark_main --mode=ipc --sessions=8 --json_output=result.json
+//
+// Give a scratch directory with --profile_dir, since the benchmark updates
+// the user history of the profile.
+//
+// The key event trace given by --trace has the same format as the input of
+// session_client_main: each line is a key event parsed by KeyParser, and an
+// empty line ends the composition.  Without --trace, the test sentences of
+// RandomKeyEventsGenerator are typed in Romaji and converted or predicted.
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "base/base.h"
+#include "base/file_stream.h"
+#include "base/mutex.h"
+#include "base/stopwatch.h"
+#include "base/thread.h"
+#include "base/util.h"
+#include "ipc/ipc.h"
+#include "session/commands.pb.h"
+#include "session/japanese_session_factory.h"
+#include "session/key_parser.h"
+#include "session/random_keyevents_generator.h"
+#include "session/session_factory_manager.h"
+#include "session/session_handler.h"
+#include "session/session_server.h"
+
+DEFINE_string(mode, "inprocess",
+              "\"inprocess\" calls SessionHandler directly. "
+              "\"ipc\" sends commands to SessionServer via IPC");
+DEFINE_int32(sessions, 1, "number of concurrent sessions");
+DEFINE_int32(iterations, 1, "number of times each session replays keys");
+DEFINE_string(trace, "", "key event trace file");
+DEFINE_int32(max_sentences, 200,
+             "maximum number of test sentences used without --trace");
+DEFINE_string(json_output, "", "output file of the result in JSON");
+DEFINE_string(profile_dir, "", "profile dir");
+DECLARE_int32(max_session_size);
+
+namespace mozc {
+namespace {
+
+// Same as the service name of SessionServer.
+const char kSessionName[] = "session";
+const int32 kIPCTimeout = 30 * 1000;  // 30 sec
+
+typedef vector<commands::KeyEvent> KeySequence;
+
+const char *GetCommandType(const commands::KeyEvent &key) {
+  if (key.has_special_key()) {
+    switch (key.special_key()) {
+      case commands::KeyEvent::SPACE:
+      case commands::KeyEvent::HENKAN:
+        return "conversion";
+      case commands::KeyEvent::TAB:
+        return "prediction";
+      case commands::KeyEvent::ENTER:
+        return "commit";
+      default:
+        break;
+    }
+  }
+  return "send_key";
+}
+
+void AddRomanjiKeys(const string &hiragana, KeySequence *keys) {
+  string romanji;
+  Util::HiraganaToRomanji(hiragana, &romanji);
+  for (ConstChar32Iterator iter(romanji); !iter.Done(); iter.Next()) {
+    const char32 ucs4 = iter.Get();
+    if (ucs4 >= static_cast<char32>('a') &&
+        ucs4 <= static_cast<char32>('z')) {
+      commands::KeyEvent key;
+      key.set_key_code(static_cast<int>(ucs4));
+      keys->push_back(key);
+    }
+  }
+}
+
+void AddSpecialKey(commands::KeyEvent::SpecialKey special_key,
+                   KeySequence *keys) {
+  commands::KeyEvent key;
+  key.set_special_key(special_key);
+  keys->push_back(key);
+}
+
+// Makes the sequences from the test sentences.  The odd sentences are
+// converted and the even ones are predicted before committed.
+void GenerateSequences(vector<KeySequence> *sequences) {
+  size_t size = 0;
+  const char **sentences =
+      session::RandomKeyEventsGenerator::GetTestSentences(&size);
+  CHECK_GT(size, 0);
+  size = min(static_cast<size_t>(max(1, FLAGS_max_sentences)), size);
+  for (size_t i = 0; i < size; ++i) {
+    KeySequence keys;
+    AddRomanjiKeys(sentences[i], &keys);
+    if (keys.empty()) {
+      continue;
+    }
+    AddSpecialKey(i % 2 == 0 ? commands::KeyEvent::SPACE :
+                  commands::KeyEvent::TAB, &keys);
+    AddSpecialKey(commands::KeyEvent::ENTER, &keys);
+    sequences->push_back(keys);
+  }
+}
+
+bool LoadSequences(const string &filename, vector<KeySequence> *sequences) {
+  InputFileStream input(filename.c_str());
+  if (input.fail()) {
+    LOG(ERROR) << "cannot open: " << filename;
+    return false;
+  }
+  KeySequence keys;
+  string line;
+  while (getline(input, line)) {
+    Util::ChopReturns(&line);
+    if (line.size() > 1 && line[0] == '#' && line[1] == '#') {
+      continue;
+    }
+    if (line.empty()) {
+      if (!keys.empty()) {
+        sequences->push_back(keys);
+        keys.clear();
+      }
+      continue;
+    }
+    commands::KeyEvent key;
+    if (!KeyParser::ParseKey(line, &key)) {
+      LOG(ERROR) << "cannot parse: " << line;
+      continue;
+    }
+    keys.push_back(key);
+  }
+  if (!keys.empty()) {
+    sequences->push_back(keys);
+  }
+  return !sequences->empty();
+}
+
+class CommandDriverInterface {
+ public:
+  virtual ~CommandDriverInterface() {}
+  virtual bool EvalCommand(commands::Command *command) = 0;
+};
+
+// SessionHandler is not thread-safe.  The drivers sharing |handler|
+// evaluate the commands one by one under |mutex|, as SessionServer
+// evaluates them on its IPC thread.
+class InProcessDriver : public CommandDriverInterface {
+ public:
+  InProcessDriver(SessionHandler *handler, Mutex *mutex)
+      : handler_(handler), mutex_(mutex) {}
+
+  bool EvalCommand(commands::Command *command) {
+    scoped_lock l(mutex_);
+    return handler_->EvalCommand(command);
+  }
+
+ private:
+  SessionHandler *handler_;
+  Mutex *mutex_;
+};
+
+class IPCDriver : public CommandDriverInterface {
+ public:
+  IPCDriver() : response_(IPC_MAX_RESPONSESIZE) {}
+
+  bool EvalCommand(commands::Command *command) {
+    string request;
+    command->input().SerializeToString(&request);
+    // Idle connections are pooled, so creating a client per call costs the
+    // same as the production client.
+    IPCClient client(kSessionName, "");
+    size_t response_size = response_.size();
+    if (!client.Connected() ||
+        !client.Call(request.data(), request.size(),
+                     &response_[0], &response_size, kIPCTimeout)) {
+      LOG(ERROR) << "IPC call failed: " << client.GetLastIPCError();
+      return false;
+    }
+    return command->mutable_output()->ParseFromArray(
+        &response_[0], static_cast<int>(response_size));
+  }
+
+ private:
+  vector<char> response_;
+};
+
+typedef map<string, vector<uint32> > LatencyMap;
+
+// Replays the sequences with one session.
+class BenchmarkWorker : public Thread {
+ public:
+  BenchmarkWorker(CommandDriverInterface *driver,
+                  const vector<KeySequence> *sequences,
+                  size_t offset)
+      : driver_(driver), sequences_(sequences), offset_(offset),
+        succeeded_(false) {}
+
+  virtual void Run() {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::CREATE_SESSION);
+    if (!driver_->EvalCommand(&command) || command.output().id() == 0) {
+      LOG(ERROR) << "CreateSession failed";
+      return;
+    }
+    const uint64 id = command.output().id();
+
+    commands::KeyEvent on_key;
+    on_key.set_special_key(commands::KeyEvent::ON);
+    SendKey(id, on_key, NULL);
+
+    for (int n = 0; n < max(1, FLAGS_iterations); ++n) {
+      for (size_t i = 0; i < sequences_->size(); ++i) {
+        // Each session starts from a different sequence so that the
+        // sessions do not run the same conversion at the same time.
+        const KeySequence &keys =
+            (*sequences_)[(offset_ + i) % sequences_->size()];
+        for (size_t j = 0; j < keys.size(); ++j) {
+          SendKey(id, keys[j], &latencies_[GetCommandType(keys[j])]);
+        }
+        Revert(id);
+      }
+    }
+
+    command.Clear();
+    command.mutable_input()->set_type(commands::Input::DELETE_SESSION);
+    command.mutable_input()->set_id(id);
+    driver_->EvalCommand(&command);
+    succeeded_ = true;
+  }
+
+  const LatencyMap &latencies() const { return latencies_; }
+  bool succeeded() const { return succeeded_; }
+
+ private:
+  void SendKey(uint64 id, const commands::KeyEvent &key,
+               vector<uint32> *latencies) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_KEY);
+    command.mutable_input()->set_id(id);
+    command.mutable_input()->mutable_key()->CopyFrom(key);
+    Stopwatch stopwatch = Stopwatch::StartNew();
+    if (!driver_->EvalCommand(&command)) {
+      LOG(ERROR) << "SendKey failed";
+      return;
+    }
+    stopwatch.Stop();
+    if (latencies != NULL) {
+      latencies->push_back(
+          static_cast<uint32>(stopwatch.GetElapsedMicroseconds()));
+    }
+  }
+
+  // Discards the remaining composition, if any.
+  void Revert(uint64 id) {
+    commands::Command command;
+    command.mutable_input()->set_type(commands::Input::SEND_COMMAND);
+    command.mutable_input()->set_id(id);
+    command.mutable_input()->mutable_command()->set_type(
+        commands::SessionCommand::REVERT);
+    driver_->EvalCommand(&command);
+  }
+
+  CommandDriverInterface *driver_;
+  const vector<KeySequence> *sequences_;
+  const size_t offset_;
+  bool succeeded_;
+  LatencyMap latencies_;
+};
+
+// Returns the nearest-rank percentile of |sorted_times|.
+uint32 GetPercentile(const vector<uint32> &sorted_times, int percentile) {
+  if (sorted_times.empty()) {
+    return 0;
+  }
+  const size_t rank = static_cast<size_t>(
+      ceil(percentile / 100.0 * sorted_times.size()));
+  return sorted_times[min(max(rank, static_cast<size_t>(1)),
+                          sorted_times.size()) - 1];
+}
+
+struct Stats {
+  size_t count;
+  uint32 p50;
+  uint32 p95;
+  uint32 p99;
+  uint32 max;
+};
+
+void GetStats(vector<uint32> *times, Stats *stats) {
+  sort(times->begin(), times->end());
+  stats->count = times->size();
+  stats->p50 = GetPercentile(*times, 50);
+  stats->p95 = GetPercentile(*times, 95);
+  stats->p99 = GetPercentile(*times, 99);
+  stats->max = times->empty() ? 0 : times->back();
+}
+
+void OutputText(const map<string, Stats> &stats, ostream *os) {
+  *os << "mode=" << FLAGS_mode << " sessions=" << FLAGS_sessions
+      << " (usec)" << endl;
+  for (map<string, Stats>::const_iterator it = stats.begin();
+       it != stats.end(); ++it) {
+    *os << Util::StringPrintf(
+        "%s: count=%d p50=%d p95=%d p99=%d max=%d",
+        it->first.c_str(), static_cast<int>(it->second.count),
+        it->second.p50, it->second.p95, it->second.p99,
+        it->second.max) << endl;
+  }
+}
+
+void OutputJSON(const map<string, Stats> &stats, ostream *os) {
+  *os << "{\"mode\": \"" << FLAGS_mode << "\", "
+      << "\"sessions\": " << FLAGS_sessions << ", "
+      << "\"unit\": \"usec\", \"commands\": {";
+  for (map<string, Stats>::const_iterator it = stats.begin();
+       it != stats.end(); ++it) {
+    if (it != stats.begin()) {
+      *os << ", ";
+    }
+    *os << Util::StringPrintf(
+        "\"%s\": {\"count\": %d, \"p50\": %d, \"p95\": %d, "
+        "\"p99\": %d, \"max\": %d}",
+        it->first.c_str(), static_cast<int>(it->second.count),
+        it->second.p50, it->second.p95, it->second.p99,
+        it->second.max);
+  }
+  *os << "}}" << endl;
+}
+
+int Run() {
+  vector<KeySequence> sequences;
+  if (!FLAGS_trace.empty()) {
+    if (!LoadSequences(FLAGS_trace, &sequences)) {
+      return 1;
+    }
+  } else {
+    GenerateSequences(&sequences);
+  }
+
+  const int num_sessions = max(1, FLAGS_sessions);
+  FLAGS_max_session_size = max(FLAGS_max_session_size, num_sessions);
+
+  scoped_ptr<SessionHandler> handler;
+  Mutex handler_mutex;
+  scoped_ptr<SessionServer> server;
+  vector<CommandDriverInterface *> drivers;
+  if (FLAGS_mode == "inprocess") {
+    handler.reset(new SessionHandler);
+    CHECK(handler->IsAvailable()) << "SessionHandler is not available";
+    for (int i = 0; i < num_sessions; ++i) {
+      drivers.push_back(new InProcessDriver(handler.get(), &handler_mutex));
+    }
+  } else if (FLAGS_mode == "ipc") {
+    server.reset(new SessionServer);
+    CHECK(server->Connected()) << "SessionServer is not available";
+    server->LoopAndReturn();
+    for (int i = 0; i < num_sessions; ++i) {
+      drivers.push_back(new IPCDriver);
+    }
+  } else {
+    LOG(ERROR) << "unknown mode: " << FLAGS_mode;
+    return 1;
+  }
+
+  vector<BenchmarkWorker *> workers;
+  for (int i = 0; i < num_sessions; ++i) {
+    workers.push_back(new BenchmarkWorker(
+        drivers[i], &sequences, i * sequences.size() / num_sessions));
+    workers.back()->SetJoinable(true);
+    workers.back()->Start();
+  }
+
+  LatencyMap latencies;
+  int result = 0;
+  for (size_t i = 0; i < workers.size(); ++i) {
+    workers[i]->Join();
+    if (!workers[i]->succeeded()) {
+      result = 1;
+    }
+    for (LatencyMap::const_iterator it = workers[i]->latencies().begin();
+         it != workers[i]->latencies().end(); ++it) {
+      vector<uint32> *times = &latencies[it->first];
+      times->insert(times->end(), it->second.begin(), it->second.end());
+    }
+    delete workers[i];
+    delete drivers[i];
+  }
+
+  map<string, Stats> stats;
+  for (LatencyMap::iterator it = latencies.begin();
+       it != latencies.end(); ++it) {
+    GetStats(&it->second, &stats[it->first]);
+  }
+
+  OutputText(stats, &cout);
+  if (!FLAGS_json_output.empty()) {
+    OutputFileStream output(FLAGS_json_output.c_str());
+    if (output.fail()) {
+      LOG(ERROR) << "cannot open: " << FLAGS_json_output;
+      return 1;
+    }
+    OutputJSON(stats, &output);
+  }
+
+  return result;
+}
+}  // namespace
+}  // namespace mozc
+
+int main(int argc, char **argv) {
+  InitGoogle(argv[0], &argc, &argv, false);
+
+  if (!FLAGS_profile_dir.empty()) {
+    mozc::Util::CreateDirectory(FLAGS_profile_dir);
+    mozc::Util::SetUserProfileDirectory(FLAGS_profile_dir);
+  }
+
+  mozc::session::JapaneseSessionFactory session_factory;
+  mozc::session::SessionFactoryManager::SetSessionFactory(&session_factory);
+
+  return mozc::Run();
+}
@@ -441,6 +441,62 @@ bool SessionConverter::SuggestWithPreferences(
   return true;
 }
 
+bool SessionConverter::PrepareSuggestion(const composer::Composer &composer,
+                                         Segments *segments) {
+  DCHECK(CheckState(COMPOSITION | SUGGESTION));
+  DCHECK(segments);
+  candidate_list_visible_ = false;
+  ResetState();
+
+  // Clear segments and keep the context, so that the stale suggestion is
+  // not used while the request is processed.
+  converter_->CancelConversion(segments_.get());
+
+  // If we are on a password field, suppress suggestion.
+  if (composer.GetInputFieldType() == commands::SessionCommand::PASSWORD) {
+    return false;
+  }
+
+  SetConversionPreferences(conversion_preferences_, segments_.get());
+  segments->CopyFrom(*segments_);
+  return true;
+}
+
+bool SessionConverter::ApplySuggestion(const Segments &segments) {
+  DCHECK(CheckState(COMPOSITION | SUGGESTION));
+  if (segments.conversion_segments_size() != 1) {
+    LOG(WARNING) << "Unexpected suggestion segments: "
+                 << segments.conversion_segments_size();
+    return false;
+  }
+  ResetState();
+  segments_->CopyFrom(segments);
+
+  // Copy current suggestions so that we can merge
+  // prediction/suggestions later
+  previous_suggestions_.CopyFrom(segments_->conversion_segment(0));
+
+  segment_index_ = 0;
+  state_ = SUGGESTION;
+  UpdateCandidateList();
+  candidate_list_visible_ = true;
+  return true;
+}
+
+bool SessionConverter::ApplyConversion(const Segments &segments) {
+  DCHECK(CheckState(COMPOSITION | SUGGESTION | CONVERSION));
+  if (segments.conversion_segments_size() == 0) {
+    LOG(WARNING) << "No conversion segments";
+    return false;
+  }
+  segments_->CopyFrom(segments);
+
+  segment_index_ = 0;
+  state_ = CONVERSION;
+  candidate_list_visible_ = false;
+  UpdateCandidateList();
+  return true;
+}
 
 bool SessionConverter::Predict(const composer::Composer &composer) {
   return PredictWithPreferences(composer, conversion_preferences_);
@@ -95,6 +95,14 @@ class SessionConverter : public SessionConverterInterface {
   bool SuggestWithPreferences(const composer::Composer &composer,
                               const ConversionPreferences &preferences);
 
+  // Prepare a suggestion request processed outside of this object.
+  bool PrepareSuggestion(const composer::Composer &composer,
+                         Segments *segments);
+  // Show the suggestion prepared by PrepareSuggestion.
+  bool ApplySuggestion(const Segments &segments);
+  // Show the conversion computed outside of this object.
+  bool ApplyConversion(const Segments &segments);
+
   // Send a prediction request to the converter.
   bool Predict(const composer::Composer &composer);
   bool PredictWithPreferences(const composer::Composer &composer,
@@ -125,6 +125,22 @@ class SessionConverterInterface {
       const composer::Composer &composer,
       const ConversionPreferences &preferences) ABSTRACT;
 
+  // Prepare a suggestion request which is processed outside of this
+  // object, e.g. by AsyncSuggester.  The current suggestion is cleared and
+  // |segments| is filled with the context for the request.  False is
+  // returned if suggestion is not available for |composer|.
+  virtual bool PrepareSuggestion(const composer::Composer &composer,
+                                 Segments *segments) ABSTRACT;
+
+  // Show the suggestion |segments| returned for the request prepared by
+  // PrepareSuggestion.  The composer should not have been modified since
+  // then.
+  virtual bool ApplySuggestion(const Segments &segments) ABSTRACT;
+
+  // Show the conversion |segments| computed outside of this object for
+  // the current composition, instead of sending a conversion request.
+  virtual bool ApplyConversion(const Segments &segments) ABSTRACT;
+
   // Send a prediction request to the converter.
   virtual bool Predict(const composer::Composer &composer) ABSTRACT;
   virtual bool PredictWithPreferences(
@@ -348,6 +348,31 @@ TEST_F(SessionConverterTest, Convert) {
   EXPECT_FALSE(converter.IsCandidateListVisible());
 }
 
+TEST_F(SessionConverterTest, ApplyConversion) {
+  SessionConverter converter(convertermock_.get());
+  composer_->InsertCharacterPreedit(aiueo_);
+
+  Segments empty_segments;
+  EXPECT_FALSE(converter.ApplyConversion(empty_segments));
+  EXPECT_FALSE(converter.IsActive());
+
+  // The segments converted in advance are shown without any request to
+  // the converter.
+  Segments segments;
+  SetAiueo(&segments);
+  FillT13Ns(&segments, composer_.get());
+  EXPECT_TRUE(converter.ApplyConversion(segments));
+  ASSERT_TRUE(converter.IsActive());
+  EXPECT_EQ(SessionConverterInterface::CONVERSION, converter.GetState());
+  EXPECT_FALSE(converter.IsCandidateListVisible());
+
+  commands::Output output;
+  converter.FillOutput(*composer_, &output);
+  EXPECT_TRUE(output.has_preedit());
+  ASSERT_EQ(1, output.preedit().segment_size());
+  EXPECT_EQ(aiueo_, output.preedit().segment(0).value());
+}
+
 TEST_F(SessionConverterTest, ConvertWithSpellingCorrection) {
   SessionConverter converter(convertermock_.get());
   Segments segments;
@@ -35,18 +35,24 @@
 #include <vector>
 
 #include "base/base.h"
+#include "base/file_stream.h"
+#include "base/latency_histogram.h"
+#include "base/mutex.h"
 #include "base/util.h"
 #include "base/process.h"
 #include "base/singleton.h"
+#include "base/stage_tracer.h"
 #include "base/stopwatch.h"
 #include "config/config_handler.h"
 #include "config/config.pb.h"
 #include "converter/user_data_manager_interface.h"
+#include "session/async_suggester.h"
 #include "session/commands.pb.h"
 #include "session/generic_storage_manager.h"
 #include "session/session_factory_manager.h"
 #include "session/session_interface.h"
 #include "session/session_observer_handler.h"
+#include "session/session_table.h"
 #include "session/session_watch_dog.h"
 #ifdef ENABLE_CLOUD_SYNC
 #include "sync/sync_handler.h"
@@ -69,6 +75,14 @@ DEFINE_int32(create_session_min_interval, 0,
 DEFINE_int32(watch_dog_interval, 180,
              "watch dog timer intaval (sec)");
 
+DEFINE_bool(record_latency_stats, true,
+            "record the processing time of each command to the latency "
+            "histograms");
+
+DEFINE_string(stage_trace_file, "",
+              "if nonempty, trace the stages of every command and append "
+              "them to this file in the Chrome trace event format");
+
 DEFINE_int32(last_command_timeout, 3600,
              "remove session if it is not accessed for "
              "\"last_command_timeout\" sec");
@@ -84,6 +98,10 @@ DEFINE_bool(restricted, false,
 namespace mozc {
 
 namespace {
+// Cleanup checks the applications of this number of sessions at a time
+// so that its cost does not grow with the number of the sessions.
+const size_t kMaxApplicationCheckSize = 64;
+
 bool IsApplicationAlive(const session::SessionInterface *session) {
   const commands::ApplicationInfo &info = session->application_info();
   // When the thread/process's current status is unknown, i.e.,
@@ -105,6 +123,63 @@ bool IsApplicationAlive(const session::SessionInterface *session) {
 #endif  // OS_WINDOWS
   return true;
 }
+
+// Returns the name of the command like "command/SEND_KEY" or
+// "command/SEND_COMMAND/SUBMIT".
+string GetCommandName(const commands::Input &input) {
+  string name = "command/";
+  name += commands::Input::CommandType_Name(input.type());
+  if (input.type() == commands::Input::SEND_COMMAND &&
+      input.has_command()) {
+    name += "/";
+    name += commands::SessionCommand::CommandType_Name(
+        input.command().type());
+  }
+  return name;
+}
+
+void FillStageTrace(const StageTracer &tracer, commands::Output *output) {
+  const vector<StageTracer::Span> &spans = tracer.spans();
+  for (size_t i = 0; i < spans.size(); ++i) {
+    const StageTracer::Span &span = spans[i];
+    commands::StageTraceSpan *proto = output->add_stage_trace();
+    proto->set_name(span.name);
+    proto->set_depth(span.depth);
+    const uint64 begin = tracer.GetRelativeMicroseconds(span.begin_ticks);
+    proto->set_begin_usec(begin);
+    if (span.end_ticks != 0) {
+      proto->set_duration_usec(
+          tracer.GetRelativeMicroseconds(span.end_ticks) - begin);
+    }
+    for (size_t j = 0; j < span.counters.size(); ++j) {
+      commands::StageTraceSpan::Counter *counter = proto->add_counter();
+      counter->set_name(span.counters[j].first);
+      counter->set_value(span.counters[j].second);
+    }
+  }
+}
+
+// Guards the file of --stage_trace_file, which is appended by the session
+// commands running on different threads.
+Mutex g_stage_trace_file_mutex;
+
+// Appends the spans to |filename| in the Chrome trace event format.
+// Each session is shown as a thread.
+void AppendStageTraceToFile(const StageTracer &tracer, SessionID id,
+                            const string &filename) {
+  scoped_lock l(&g_stage_trace_file_mutex);
+  string events;
+  if (!Util::FileExists(filename)) {
+    events = "[\n";
+  }
+  tracer.AppendChromeTraceEvents(1, static_cast<uint32>(id), &events);
+  OutputFileStream ofs(filename.c_str(), ios::app);
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << filename;
+    return;
+  }
+  ofs << events;
+}
 }  // namespace
 
 SessionHandler::SessionHandler()
@@ -114,10 +189,10 @@ SessionHandler::SessionHandler()
       last_session_empty_time_(Util::GetTime()),
       last_cleanup_time_(0),
       last_create_session_time_(0),
+      config_fingerprint_(0),
       session_factory_(
           session::SessionFactoryManager::GetSessionFactory()),
-      observer_handler_(new session::SessionObserverHandler()),
-      stopwatch_(new Stopwatch) {
+      observer_handler_(new session::SessionObserverHandler()) {
   if (FLAGS_restricted) {
     VLOG(1) << "Server starts with restricted mode";
     // --restricted is almost always specified when mozc_client is inside Job.
@@ -134,9 +209,9 @@ SessionHandler::SessionHandler()
 
   session_watch_dog_.reset(new SessionWatchDog(FLAGS_watch_dog_interval));
 
-  // allow [2..128] sessions
-  max_session_size_ = max(2, min(FLAGS_max_session_size, 128));
-  session_map_.reset(new SessionMap(max_session_size_));
+  // allow [2..4096] sessions
+  max_session_size_ = max(2, min(FLAGS_max_session_size, 4096));
+  session_map_.reset(new SessionTable(max_session_size_));
 
   if (session_factory_ == NULL || !session_factory_->IsAvailable()) {
     return;
@@ -147,13 +222,7 @@ SessionHandler::SessionHandler()
 }
 
 SessionHandler::~SessionHandler() {
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
-    delete element->value;
-    element->value = NULL;
-  }
-  session_map_->Clear();
+  session_map_.reset(NULL);   // deletes all sessions
   if (session_watch_dog_->IsRunning()) {
     session_watch_dog_->Terminate();
   }
@@ -176,15 +245,24 @@ void SessionHandler::ReloadSession() {
 }
 
 void SessionHandler::ReloadConfig() {
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
-    if (element->value != NULL) {
-      element->value->ReloadConfig();
-    }
+  config_fingerprint_ = Util::Fingerprint(
+      config::ConfigHandler::GetConfig().SerializeAsString());
+  vector<session::SessionInterface *> sessions;
+  session_map_->GetAllSessions(&sessions);
+  for (size_t i = 0; i < sessions.size(); ++i) {
+    sessions[i]->ReloadConfig();
   }
 }
 
+void SessionHandler::ReloadConfigIfChanged() {
+  const uint64 fingerprint = Util::Fingerprint(
+      config::ConfigHandler::GetConfig().SerializeAsString());
+  if (fingerprint == config_fingerprint_) {
+    return;
+  }
+  ReloadConfig();
+}
+
 bool SessionHandler::SyncData(commands::Command *command) {
   VLOG(1) << "Syncing user data";
   session_factory_->GetUserDataManager()->Sync();
@@ -234,7 +312,9 @@ bool SessionHandler::GetStoredConfig(commands::Command *command) {
   VLOG(1) << "Getting stored config";
   // Ensure the onmemory config is same as the locally stored one
   // because the local data could be changed by sync.
-  ReloadConfig();
+  // The new session already has the current config, so the other sessions
+  // are visited only when the config is changed.
+  ReloadConfigIfChanged();
 
   // Use GetStoredConfig instead of GetConfig because GET_CONFIG
   // command should return raw stored config, which is not
@@ -409,14 +489,67 @@ bool SessionHandler::ClearStorage(commands::Command *command) {
   return storage->Clear();
 }
 
+bool SessionHandler::GetLatencyStats(commands::Command *command) {
+  commands::Output *output = command->mutable_output();
+  output->set_id(command->input().id());
+  vector<const LatencyHistogram *> histograms;
+  LatencyStats::GetAllHistograms(&histograms);
+  vector<LatencyHistogram::Bucket> buckets;
+  for (size_t i = 0; i < histograms.size(); ++i) {
+    const LatencyHistogram *histogram = histograms[i];
+    commands::LatencyHistogram *proto = output->add_latency_histogram();
+    proto->set_name(histogram->name());
+    proto->set_count(histogram->count());
+    proto->set_total_usec(histogram->total_usec());
+    proto->set_min_usec(histogram->min_usec());
+    proto->set_max_usec(histogram->max_usec());
+    buckets.clear();
+    histogram->GetBuckets(&buckets);
+    for (size_t j = 0; j < buckets.size(); ++j) {
+      commands::LatencyHistogram::Bucket *bucket = proto->add_bucket();
+      bucket->set_lower_bound_usec(buckets[j].lower_bound);
+      bucket->set_upper_bound_usec(buckets[j].upper_bound);
+      bucket->set_count(buckets[j].count);
+    }
+  }
+  return true;
+}
+
+bool SessionHandler::DumpLatencyStats(commands::Command *command) {
+  command->mutable_output()->set_id(command->input().id());
+  const string filename = Util::JoinPath(Util::GetUserProfileDirectory(),
+                                         "latency_stats.txt");
+  OutputFileStream ofs(filename.c_str());
+  if (!ofs) {
+    LOG(ERROR) << "cannot open " << filename;
+    return false;
+  }
+  ofs << LatencyStats::DumpToString();
+  VLOG(1) << "Latency stats are written to " << filename;
+  return true;
+}
+
 bool SessionHandler::EvalCommand(commands::Command *command) {
+  // The background suggestion and conversion must not use the converter
+  // while a command uses it or modifies the config or the dictionaries.
+  session::AsyncSuggester::ScopedCommandLock worker_lock;
+  return EvalCommandInternal(command);
+}
+
+bool SessionHandler::EvalCommandInternal(commands::Command *command) {
   if (!is_available_) {
     return false;
   }
 
   bool eval_succeeded = false;
-  stopwatch_->Reset();
-  stopwatch_->Start();
+  Stopwatch stopwatch = Stopwatch::StartNew();
+
+  scoped_ptr<StageTracer> tracer;
+  if (command->input().trace_stages() || !FLAGS_stage_trace_file.empty()) {
+    tracer.reset(new StageTracer);
+    StageTracer::SetCurrent(tracer.get());
+    tracer->BeginSpan(GetCommandName(command->input()));
+  }
 
   switch (command->input().type()) {
     case commands::Input::CREATE_SESSION:
@@ -485,6 +618,12 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
     case commands::Input::CLEAR_STORAGE:
       eval_succeeded = ClearStorage(command);
       break;
+    case commands::Input::GET_LATENCY_STATS:
+      eval_succeeded = GetLatencyStats(command);
+      break;
+    case commands::Input::DUMP_LATENCY_STATS:
+      eval_succeeded = DumpLatencyStats(command);
+      break;
     case commands::Input::NO_OPERATION:
       eval_succeeded = NoOperation(command);
       break;
@@ -503,9 +642,25 @@ bool SessionHandler::EvalCommand(commands::Command *command) {
   // Stop the timer before usage stats aggregation.
   // This won't be good if UsageStats aggregator consumes a lot of
   // CPU time
-  stopwatch_->Stop();
+  stopwatch.Stop();
   command->mutable_output()->set_elapsed_time(
-      static_cast<int32>(stopwatch_->GetElapsedMicroseconds()));
+      static_cast<int32>(stopwatch.GetElapsedMicroseconds()));
+  if (FLAGS_record_latency_stats) {
+    LatencyStats::GetHistogram(GetCommandName(command->input()))->Record(
+        stopwatch.GetElapsedMicroseconds());
+  }
+
+  if (tracer.get() != NULL) {
+    tracer->EndSpan();
+    StageTracer::SetCurrent(NULL);
+    if (command->input().trace_stages()) {
+      FillStageTrace(*tracer, command->mutable_output());
+    }
+    if (!FLAGS_stage_trace_file.empty()) {
+      AppendStageTraceToFile(*tracer, command->input().id(),
+                             FLAGS_stage_trace_file);
+    }
+  }
 
   if (eval_succeeded) {
     // TODO(komatsu): Make sre if checking eval_succeeded is necessary or not.
@@ -528,41 +683,47 @@ void SessionHandler::AddObserver(session::SessionObserverInterface *observer) {
   observer_handler_->AddObserver(observer);
 }
 
+session::SessionInterface *SessionHandler::LookupSession(SessionID id) {
+  // Lookup() updates the order of LRU.
+  session::SessionInterface *session =
+      session_map_->Lookup(id, Util::GetTime());
+  if (session == NULL) {
+    LOG(WARNING) << "SessionID " << id << " is not available";
+    return NULL;
+  }
+  return session;
+}
+
 bool SessionHandler::SendKey(commands::Command *command) {
   const SessionID id = command->input().id();
   command->mutable_output()->set_id(id);
-
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == NULL || *session == NULL) {
-    LOG(WARNING) << "SessionID " << id << " is not available";
+  session::SessionInterface *session = LookupSession(id);
+  if (session == NULL) {
     return false;
   }
-  (*session)->SendKey(command);
+  session->SendKey(command);
   return true;
 }
 
 bool SessionHandler::TestSendKey(commands::Command *command) {
   const SessionID id = command->input().id();
   command->mutable_output()->set_id(id);
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == NULL || *session == NULL) {
-    LOG(WARNING) << "SessionID " << id << " is not available";
+  session::SessionInterface *session = LookupSession(id);
+  if (session == NULL) {
     return false;
   }
-  (*session)->TestSendKey(command);
+  session->TestSendKey(command);
   return true;
 }
 
 bool SessionHandler::SendCommand(commands::Command *command) {
   const SessionID id = command->input().id();
   command->mutable_output()->set_id(id);
-  session::SessionInterface **session =
-    const_cast<session::SessionInterface **>(session_map_->Lookup(id));
-  if (session == NULL || *session == NULL) {
-    LOG(WARNING) << "SessionID " << id << " is not available";
+  session::SessionInterface *session = LookupSession(id);
+  if (session == NULL) {
     return false;
   }
-  (*session)->SendCommand(command);
+  session->SendCommand(command);
   return true;
 }
 
@@ -583,19 +744,15 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   last_create_session_time_ = current_time;
 
   // if session map is FULL, remove the oldest item from the LRU
-  SessionElement *oldest_element = NULL;
-  if (session_map_->Size() >= max_session_size_) {
-    oldest_element = const_cast<SessionElement *>(session_map_->Tail());
-    if (oldest_element == NULL) {
-      LOG(ERROR) << "oldest SessionElement is NULL";
+  if (session_map_->IsFull()) {
+    const SessionID oldest_id = session_map_->EraseLeastRecentlyUsed();
+    if (oldest_id == 0) {
+      LOG(ERROR) << "oldest SessionID is not found";
       return false;
     }
-    delete oldest_element->value;
-    oldest_element->value = NULL;
-    session_map_->Erase(oldest_element->key);
     VLOG(1) << "Session is FULL, oldest SessionID "
-            << oldest_element->key << " is removed";
-  };
+            << oldest_id << " is removed";
+  }
 
   session::SessionInterface *session = NewSession();
   if (session == NULL) {
@@ -604,13 +761,13 @@ bool SessionHandler::CreateSession(commands::Command *command) {
   }
 
   const SessionID new_id = CreateNewSessionID();
-  SessionElement *element = session_map_->Insert(new_id);
-  element->value = session;
+  if (!session_map_->Insert(new_id, session, current_time)) {
+    LOG(ERROR) << "Cannot insert SessionID " << new_id;
+    delete session;
+    return false;
+  }
   command->mutable_output()->set_id(new_id);
 
-  // The oldes item should be reused
-  DCHECK(oldest_element == NULL || oldest_element == element);
-
   if (command->input().has_capability()) {
     session->set_client_capability(command->input().capability());
   }
@@ -621,7 +778,9 @@ bool SessionHandler::CreateSession(commands::Command *command) {
 
   // Ensure the onmemory config is same as the locally stored one
   // because the local data could be changed by sync.
-  ReloadConfig();
+  // The new session already has the current config, so the other sessions
+  // are visited only when the config is changed.
+  ReloadConfigIfChanged();
 
   // session is not empty.
   last_session_empty_time_ = 0;
@@ -672,27 +831,25 @@ bool SessionHandler::Cleanup(commands::Command *command) {
       suspend_time +
       max(10, min(FLAGS_last_command_timeout, 7200));
 
+  // The sessions are ordered by the last access, so only the expired
+  // ones are visited.
   vector<SessionID> remove_ids;
-  for (SessionElement *element =
-           const_cast<SessionElement *>(session_map_->Head());
-       element != NULL; element = element->next) {
-    session::SessionInterface *session = element->value;
-    if (!IsApplicationAlive(session)) {
-      VLOG(2) << "Application is not alive. Removing: " << element->key;
-      remove_ids.push_back(element->key);
-    } else if (session->last_command_time() == 0) {
-      // no command is exectuted
-      if ((current_time - session->create_session_time()) >=
-          kCreateSessionTimeout) {
-        remove_ids.push_back(element->key);
-      }
-    } else {  // some commands are executed already
-      if ((current_time - session->last_command_time()) >=
-          kLastCommandTimeout) {
-        remove_ids.push_back(element->key);
-      }
+  session_map_->GetExpiredIds(current_time,
+                              kCreateSessionTimeout,
+                              kLastCommandTimeout,
+                              &remove_ids);
+
+  vector<pair<SessionID, session::SessionInterface *> > sessions;
+  session_map_->GetNextSessions(kMaxApplicationCheckSize, &sessions);
+  for (size_t i = 0; i < sessions.size(); ++i) {
+    if (!IsApplicationAlive(sessions[i].second)) {
+      VLOG(2) << "Application is not alive. Removing: " << sessions[i].first;
+      remove_ids.push_back(sessions[i].first);
     }
   }
+  sort(remove_ids.begin(), remove_ids.end());
+  remove_ids.erase(unique(remove_ids.begin(), remove_ids.end()),
+                   remove_ids.end());
 
   for (size_t i = 0; i < remove_ids.size(); ++i) {
     DeleteSessionID(remove_ids[i]);
@@ -745,18 +902,15 @@ SessionID SessionHandler::CreateNewSessionID() {
 }
 
 bool SessionHandler::DeleteSessionID(SessionID id) {
-  session::SessionInterface **session = session_map_->MutableLookup(id);
-  if (session == NULL || *session == NULL) {
+  // Erase() deletes the session.
+  if (!session_map_->Erase(id)) {
     LOG_IF(WARNING, id != 0) << "cannot find SessionID " << id;
     return false;
   }
-  delete *session;
-
-  session_map_->Erase(id);   // remove from LRU
 
   // if session gets empty, save the timestamp
   if (last_session_empty_time_ == 0 &&
-      session_map_->Size() == 0) {
+      session_map_->size() == 0) {
     last_session_empty_time_ = Util::GetTime();
   }
 
@@ -39,14 +39,13 @@
 #include "base/base.h"
 #include "session/common.h"
 #include "session/session_handler_interface.h"
-#include "storage/lru_cache.h"
 
 // for FRIEND_TEST()
 #include "testing/base/public/gunit_prod.h"
 
 namespace mozc {
+class SessionTable;
 class SessionWatchDog;
-class Stopwatch;
 
 namespace commands {
 class Command;
@@ -87,6 +86,14 @@ class SessionHandler : public SessionHandlerInterface {
   void ReloadSession();
   // Reload the configurations on the current sessions.
   void ReloadConfig();
+  // Same as ReloadConfig() but does nothing when the configuration is not
+  // changed since the last reload.
+  void ReloadConfigIfChanged();
+
+  bool EvalCommandInternal(commands::Command *command);
+
+  // Returns the session of |id| or NULL.
+  session::SessionInterface *LookupSession(SessionID id);
 
   bool CreateSession(commands::Command *command);
   bool DeleteSession(commands::Command *command);
@@ -110,16 +117,15 @@ class SessionHandler : public SessionHandlerInterface {
   bool InsertToStorage(commands::Command *command);
   bool ReadAllFromStorage(commands::Command *command);
   bool ClearStorage(commands::Command *command);
+  bool GetLatencyStats(commands::Command *command);
+  bool DumpLatencyStats(commands::Command *command);
   bool Cleanup(commands::Command *command);
   bool NoOperation(commands::Command *command);
 
   SessionID CreateNewSessionID();
   bool DeleteSessionID(SessionID id);
 
-  typedef LRUCache<SessionID, session::SessionInterface*> SessionMap;
-  typedef LRUCache<SessionID,
-                   session::SessionInterface*>::Element SessionElement;
-  scoped_ptr<SessionMap> session_map_;
+  scoped_ptr<SessionTable> session_map_;
   scoped_ptr<SessionWatchDog> session_watch_dog_;
   bool is_available_;
   int keyevent_counter_;
@@ -127,10 +133,10 @@ class SessionHandler : public SessionHandlerInterface {
   uint64 last_session_empty_time_;
   uint64 last_cleanup_time_;
   uint64 last_create_session_time_;
+  uint64 config_fingerprint_;
 
   session::SessionFactoryInterface *session_factory_;
   scoped_ptr<session::SessionObserverHandler> observer_handler_;
-  scoped_ptr<Stopwatch> stopwatch_;
 
   DISALLOW_COPY_AND_ASSIGN(SessionHandler);
 };
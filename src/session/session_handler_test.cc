@@ -32,6 +32,9 @@
 #include <vector>
 
 #include "base/base.h"
+#include "base/file_stream.h"
+#include "base/latency_histogram.h"
+#include "base/stage_tracer.h"
 #include "base/util.h"
 #include "config/config.pb.h"
 #include "config/config_handler.h"
@@ -67,6 +70,7 @@ DECLARE_int32(max_session_size);
 DECLARE_int32(create_session_min_interval);
 DECLARE_int32(last_command_timeout);
 DECLARE_int32(last_create_session_timeout);
+DECLARE_string(stage_trace_file);
 
 
 namespace mozc {
@@ -339,4 +343,93 @@ TEST_F(SessionHandlerTest, StorageTest) {
   }
 }
 
+TEST_F(SessionHandlerTest, LatencyStats) {
+  LatencyStats::ClearAll();
+  SessionHandler handler;
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::GET_LATENCY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  const commands::LatencyHistogram *create_session = NULL;
+  for (size_t i = 0; i < command.output().latency_histogram_size(); ++i) {
+    if (command.output().latency_histogram(i).name() ==
+        "command/CREATE_SESSION") {
+      create_session = &command.output().latency_histogram(i);
+    }
+  }
+  ASSERT_TRUE(create_session != NULL);
+  EXPECT_EQ(1, create_session->count());
+  ASSERT_EQ(1, create_session->bucket_size());
+  EXPECT_EQ(1, create_session->bucket(0).count());
+  EXPECT_LE(create_session->bucket(0).lower_bound_usec(),
+            create_session->min_usec());
+  EXPECT_GE(create_session->bucket(0).upper_bound_usec(),
+            create_session->max_usec());
+
+  // GET_LATENCY_STATS itself is recorded after the evaluation.
+  EXPECT_EQ(1, LatencyStats::GetHistogram(
+      "command/GET_LATENCY_STATS")->count());
+
+  const string filename = Util::JoinPath(Util::GetUserProfileDirectory(),
+                                         "latency_stats.txt");
+  Util::Unlink(filename);
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::DUMP_LATENCY_STATS);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_TRUE(Util::FileExists(filename));
+  Util::Unlink(filename);
+}
+
+TEST_F(SessionHandlerTest, TraceStages) {
+  SessionHandler handler;
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+
+  commands::Command command;
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->mutable_key()->set_key_code('a');
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  EXPECT_EQ(0, command.output().stage_trace_size());
+
+  command.Clear();
+  command.mutable_input()->set_type(commands::Input::SEND_KEY);
+  command.mutable_input()->set_id(id);
+  command.mutable_input()->mutable_key()->set_key_code('i');
+  command.mutable_input()->set_trace_stages(true);
+  EXPECT_TRUE(handler.EvalCommand(&command));
+  ASSERT_LE(1, command.output().stage_trace_size());
+  const commands::StageTraceSpan &root = command.output().stage_trace(0);
+  EXPECT_EQ("command/SEND_KEY", root.name());
+  EXPECT_EQ(0, root.depth());
+  EXPECT_EQ(0, root.begin_usec());
+  for (size_t i = 1; i < command.output().stage_trace_size(); ++i) {
+    EXPECT_LT(0, command.output().stage_trace(i).depth());
+  }
+  // The tracer is uninstalled after the command.
+  EXPECT_TRUE(StageTracer::GetCurrent() == NULL);
+}
+
+TEST_F(SessionHandlerTest, StageTraceFile) {
+  const string filename = Util::JoinPath(FLAGS_test_tmpdir,
+                                         "stage_trace.json");
+  Util::Unlink(filename);
+  FLAGS_stage_trace_file = filename;
+  SessionHandler handler;
+  uint64 id = 0;
+  EXPECT_TRUE(CreateSession(&handler, &id));
+  EXPECT_TRUE(IsGoodSession(&handler, id));
+  FLAGS_stage_trace_file = "";
+
+  InputFileStream ifs(filename.c_str());
+  string line;
+  ASSERT_TRUE(getline(ifs, line));
+  EXPECT_EQ("[", line);
+  ASSERT_TRUE(getline(ifs, line));
+  EXPECT_NE(string::npos, line.find("\"name\":\"command/CREATE_SESSION\""));
+  Util::Unlink(filename);
+}
+
 }  // namespace mozc
@@ -85,7 +85,11 @@ SessionServer::SessionServer()
   }
 }
 
-SessionServer::~SessionServer() {}
+SessionServer::~SessionServer() {
+  for (size_t i = 0; i < free_commands_.size(); ++i) {
+    delete free_commands_[i];
+  }
+}
 
 bool SessionServer::Connected() const {
   return (handler_.get() != NULL &&
@@ -97,45 +101,90 @@ bool SessionServer::Process(const char *request,
                             size_t request_size,
                             char *response,
                             size_t *response_size) {
+  commands::Command *command = AcquireCommand();
+  bool evaluated = false;
+  const bool result = EvalRequest(request, request_size, command, &evaluated);
+  const size_t max_response_size = *response_size;
+  *response_size = 0;
+  if (evaluated) {
+    const int output_size = command->output().ByteSize();
+    if (static_cast<size_t>(output_size) > max_response_size) {
+      LOG(WARNING) << "response size < output size: " << output_size;
+    } else {
+      command->output().SerializeWithCachedSizesToArray(
+          reinterpret_cast<uint8 *>(response));
+      *response_size = output_size;
+    }
+  }
+  ReleaseCommand(command);
+  return result;
+}
+
+bool SessionServer::ProcessWithBuffer(const char *request,
+                                      size_t request_size,
+                                      IPCResponseBuffer *response,
+                                      size_t *response_size) {
+  commands::Command *command = AcquireCommand();
+  bool evaluated = false;
+  const bool result = EvalRequest(request, request_size, command, &evaluated);
+  *response_size = 0;
+  if (evaluated) {
+    const int output_size = command->output().ByteSize();
+    if (output_size > IPC_MAX_RESPONSESIZE) {
+      LOG(WARNING) << "too large output: " << output_size;
+    } else {
+      command->output().SerializeWithCachedSizesToArray(
+          reinterpret_cast<uint8 *>(response->Reserve(output_size)));
+      *response_size = output_size;
+    }
+  }
+  ReleaseCommand(command);
+  return result;
+}
+
+bool SessionServer::EvalRequest(const char *request,
+                                size_t request_size,
+                                commands::Command *command,
+                                bool *evaluated) {
+  *evaluated = false;
   if (handler_.get() == NULL) {
     LOG(WARNING) << "handler is not available";
     return false;   // shutdown the server if handler doesn't exist
   }
 
-  commands::Command command;   // can define as a private member?
-  if (!command.mutable_input()->ParseFromArray(request, request_size)) {
+  if (!command->mutable_input()->ParseFromArray(request, request_size)) {
     LOG(WARNING) << "Invalid request";
-    *response_size = 0;
     return true;
   }
 
-  if (!handler_->EvalCommand(&command)) {
+  if (!handler_->EvalCommand(command)) {
     LOG(WARNING) << "EvalCommand() returned false. Exiting the loop.";
-    *response_size = 0;
     return false;
   }
 
-  string output;
-  if (!command.output().SerializeToString(&output)) {
-    LOG(WARNING) << "SerializeToString() failed";
-    *response_size = 0;
-    return true;
-  }
-
-  // TODO(taku) automatically increase the buffer.
-  // Needs to fix IPCServer as well
-  if (*response_size < output.size()) {
-    LOG(WARNING) << "response size < output.size";
-    *response_size = 0;
-    return true;
-  }
-
-  ::memcpy(response, output.data(), output.size());
-  *response_size = output.size();
-
   // debug message
-  VLOG(2) << command.DebugString();
+  VLOG(2) << command->DebugString();
 
+  *evaluated = true;
   return true;
 }
+
+commands::Command *SessionServer::AcquireCommand() {
+  {
+    scoped_lock l(&free_commands_mutex_);
+    if (!free_commands_.empty()) {
+      commands::Command *command = free_commands_.back();
+      free_commands_.pop_back();
+      return command;
+    }
+  }
+  return new commands::Command;
+}
+
+void SessionServer::ReleaseCommand(commands::Command *command) {
+  // Clear() keeps the memory of the sub messages and strings.
+  command->Clear();
+  scoped_lock l(&free_commands_mutex_);
+  free_commands_.push_back(command);
+}
 }  // namespace mozc
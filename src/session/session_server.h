@@ -33,7 +33,9 @@
 #define MOZC_SESSION_SESSION_SERVER_H_
 
 #include <string>
+#include <vector>
 #include "base/base.h"
+#include "base/mutex.h"
 #include "ipc/ipc.h"
 #include "session/session_handler.h"
 
@@ -41,6 +43,10 @@ class SessionHandlerInterface;
 
 namespace mozc {
 
+namespace commands {
+class Command;
+}  // namespace commands
+
 namespace session {
 class SessionUsageObserver;
 }
@@ -67,9 +73,29 @@ class SessionServer: public IPCServer {
                        char *response,
                        size_t *response_size);
 
+  // Serializes the output directly into |response|, growing it for large
+  // outputs.
+  virtual bool ProcessWithBuffer(const char *request,
+                                 size_t request_size,
+                                 IPCResponseBuffer *response,
+                                 size_t *response_size);
+
  private:
+  // Parses |request| into |command| and evaluates it.  Returns false if
+  // the server should shut down.  |command->output()| is valid only when
+  // |*evaluated| is true.
+  bool EvalRequest(const char *request, size_t request_size,
+                   commands::Command *command, bool *evaluated);
+
+  // Command objects are reused across requests so that the messages and
+  // strings they have allocated are recycled.
+  commands::Command *AcquireCommand();
+  void ReleaseCommand(commands::Command *command);
+
   scoped_ptr<SessionHandlerInterface> handler_;
   scoped_ptr<session::SessionUsageObserver> usage_observer_;
+  Mutex free_commands_mutex_;
+  vector<commands::Command *> free_commands_;
   DISALLOW_COPY_AND_ASSIGN(SessionServer);
 };
 }  // namespace mozc
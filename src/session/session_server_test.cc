@@ -31,6 +31,7 @@
 
 #include "base/base.h"
 #include "base/scheduler.h"
+#include "session/commands.pb.h"
 #include "session/session_server.h"
 #include "testing/base/public/gunit.h"
 
@@ -66,3 +67,46 @@ TEST(SessionServerTest, SetSchedulerJobTest) {
 #endif  // ENABLE_CLOUD_SYNC
   mozc::Scheduler::SetSchedulerHandler(NULL);
 }
+
+TEST(SessionServerTest, ProcessWithBufferTest) {
+  scoped_ptr<JobRecorder> job_recorder(new JobRecorder);
+  mozc::Scheduler::SetSchedulerHandler(job_recorder.get());
+  scoped_ptr<mozc::SessionServer> session_server(new mozc::SessionServer);
+
+  mozc::commands::Input input;
+  input.set_type(mozc::commands::Input::NO_OPERATION);
+  input.set_id(12345);
+  string request;
+  input.SerializeToString(&request);
+
+  mozc::IPCResponseBuffer buffer;
+  size_t response_size = 0;
+  for (int i = 0; i < 2; ++i) {
+    EXPECT_TRUE(session_server->ProcessWithBuffer(request.data(),
+                                                  request.size(),
+                                                  &buffer, &response_size));
+    mozc::commands::Output output;
+    EXPECT_TRUE(output.ParseFromArray(buffer.data(), response_size));
+    EXPECT_EQ(12345, output.id());
+  }
+
+  // The fixed size buffer gets the same response.
+  char response[1024];
+  size_t fixed_response_size = sizeof(response);
+  EXPECT_TRUE(session_server->Process(request.data(), request.size(),
+                                      response, &fixed_response_size));
+  EXPECT_EQ(string(buffer.data(), response_size),
+            string(response, fixed_response_size));
+
+  // Too small buffer.
+  fixed_response_size = 1;
+  EXPECT_TRUE(session_server->Process(request.data(), request.size(),
+                                      response, &fixed_response_size));
+  EXPECT_EQ(0, fixed_response_size);
+
+  // Invalid request.
+  EXPECT_TRUE(session_server->ProcessWithBuffer("\xff", 1, &buffer,
+                                                &response_size));
+  EXPECT_EQ(0, response_size);
+  mozc::Scheduler::SetSchedulerHandler(NULL);
+}
@@ -0,0 +1,275 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/session_table.h"
+
+#include "base/base.h"
+#include "session/session_interface.h"
+
+namespace mozc {
+namespace {
+const size_t kMinBucketSize = 16;
+}  // namespace
+
+SessionTable::SessionTable(size_t max_size)
+    : max_size_(max_size),
+      size_(0),
+      access_serial_(0),
+      buckets_(kMinBucketSize, static_cast<Entry *>(NULL)),
+      next_bucket_(0) {
+  unused_list_.head = unused_list_.tail = NULL;
+  used_list_.head = used_list_.tail = NULL;
+}
+
+SessionTable::~SessionTable() {
+  for (size_t i = 0; i < buckets_.size(); ++i) {
+    Entry *entry = buckets_[i];
+    while (entry != NULL) {
+      Entry *next = entry->hash_next;
+      delete entry->session;
+      delete entry;
+      entry = next;
+    }
+  }
+}
+
+bool SessionTable::Insert(SessionID id, session::SessionInterface *session,
+                          uint64 current_time) {
+  if (IsFull() || LookupEntry(id) != NULL) {
+    return false;
+  }
+
+  // Keeps the load factor at most 1.
+  if (size_ >= buckets_.size()) {
+    Rehash(buckets_.size() * 2);
+  }
+
+  Entry *entry = new Entry;
+  entry->id = id;
+  entry->session = session;
+  entry->last_access_time = current_time;
+  entry->last_access_serial = ++access_serial_;
+  entry->used = false;
+  entry->prev = NULL;
+  entry->next = NULL;
+
+  const size_t index = GetBucketIndex(id);
+  entry->hash_next = buckets_[index];
+  buckets_[index] = entry;
+  PushHead(entry, &unused_list_);
+  ++size_;
+  return true;
+}
+
+session::SessionInterface *SessionTable::Lookup(SessionID id,
+                                                uint64 current_time) {
+  Entry *entry = LookupEntry(id);
+  if (entry == NULL) {
+    return NULL;
+  }
+  Touch(entry, current_time);
+  return entry->session;
+}
+
+bool SessionTable::HasKey(SessionID id) const {
+  return LookupEntry(id) != NULL;
+}
+
+bool SessionTable::Erase(SessionID id) {
+  Entry *entry = LookupEntry(id);
+  if (entry == NULL) {
+    return false;
+  }
+  EraseEntry(entry);
+  return true;
+}
+
+SessionID SessionTable::EraseLeastRecentlyUsed() {
+  Entry *entry = unused_list_.tail;
+  if (entry == NULL ||
+      (used_list_.tail != NULL &&
+       used_list_.tail->last_access_serial < entry->last_access_serial)) {
+    entry = used_list_.tail;
+  }
+  if (entry == NULL) {
+    return 0;
+  }
+  const SessionID id = entry->id;
+  EraseEntry(entry);
+  return id;
+}
+
+void SessionTable::GetExpiredIds(uint64 current_time,
+                                 uint64 create_timeout,
+                                 uint64 command_timeout,
+                                 vector<SessionID> *ids) const {
+  DCHECK(ids);
+  // The lists are ordered by the last access time, so only the expired
+  // sessions and one more are visited from the tails.
+  for (const Entry *entry = unused_list_.tail; entry != NULL;
+       entry = entry->prev) {
+    if (current_time < entry->last_access_time + create_timeout) {
+      break;
+    }
+    ids->push_back(entry->id);
+  }
+  for (const Entry *entry = used_list_.tail; entry != NULL;
+       entry = entry->prev) {
+    if (current_time < entry->last_access_time + command_timeout) {
+      break;
+    }
+    ids->push_back(entry->id);
+  }
+}
+
+void SessionTable::GetNextSessions(
+    size_t max_size,
+    vector<pair<SessionID, session::SessionInterface *> > *sessions) {
+  DCHECK(sessions);
+  if (size_ == 0) {
+    return;
+  }
+  if (max_size >= size_) {
+    max_size = size_;
+  }
+  // Whole buckets are visited, so slightly more sessions than |max_size|
+  // can be returned.
+  size_t num_sessions = 0;
+  for (size_t i = 0; i < buckets_.size() && num_sessions < max_size; ++i) {
+    if (next_bucket_ >= buckets_.size()) {
+      next_bucket_ = 0;
+    }
+    for (Entry *entry = buckets_[next_bucket_]; entry != NULL;
+         entry = entry->hash_next) {
+      sessions->push_back(make_pair(entry->id, entry->session));
+      ++num_sessions;
+    }
+    ++next_bucket_;
+  }
+}
+
+void SessionTable::GetAllSessions(
+    vector<session::SessionInterface *> *sessions) const {
+  DCHECK(sessions);
+  for (const Entry *entry = used_list_.head; entry != NULL;
+       entry = entry->next) {
+    sessions->push_back(entry->session);
+  }
+  for (const Entry *entry = unused_list_.head; entry != NULL;
+       entry = entry->next) {
+    sessions->push_back(entry->session);
+  }
+}
+
+size_t SessionTable::GetBucketIndex(SessionID id) const {
+  // Session ids are random numbers, so the lower bits are good enough as
+  // the hash value.  The upper bits are mixed for the sequential ids.
+  return static_cast<size_t>(id ^ (id >> 32)) & (buckets_.size() - 1);
+}
+
+SessionTable::Entry *SessionTable::LookupEntry(SessionID id) const {
+  for (Entry *entry = buckets_[GetBucketIndex(id)]; entry != NULL;
+       entry = entry->hash_next) {
+    if (entry->id == id) {
+      return entry;
+    }
+  }
+  return NULL;
+}
+
+void SessionTable::EraseEntry(Entry *entry) {
+  Entry **link = &buckets_[GetBucketIndex(entry->id)];
+  while (*link != entry) {
+    DCHECK(*link != NULL);
+    link = &(*link)->hash_next;
+  }
+  *link = entry->hash_next;
+  Remove(entry, GetList(entry));
+  --size_;
+  delete entry->session;
+  delete entry;
+}
+
+void SessionTable::Rehash(size_t bucket_size) {
+  vector<Entry *> buckets(bucket_size, static_cast<Entry *>(NULL));
+  buckets_.swap(buckets);
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    Entry *entry = buckets[i];
+    while (entry != NULL) {
+      Entry *next = entry->hash_next;
+      const size_t index = GetBucketIndex(entry->id);
+      entry->hash_next = buckets_[index];
+      buckets_[index] = entry;
+      entry = next;
+    }
+  }
+  next_bucket_ = 0;
+}
+
+void SessionTable::Touch(Entry *entry, uint64 current_time) {
+  Remove(entry, GetList(entry));
+  entry->used = true;
+  entry->last_access_time = current_time;
+  entry->last_access_serial = ++access_serial_;
+  PushHead(entry, &used_list_);
+}
+
+// static
+void SessionTable::PushHead(Entry *entry, EntryList *list) {
+  entry->prev = NULL;
+  entry->next = list->head;
+  if (list->head != NULL) {
+    list->head->prev = entry;
+  } else {
+    list->tail = entry;
+  }
+  list->head = entry;
+}
+
+// static
+void SessionTable::Remove(Entry *entry, EntryList *list) {
+  if (entry->prev != NULL) {
+    entry->prev->next = entry->next;
+  } else {
+    list->head = entry->next;
+  }
+  if (entry->next != NULL) {
+    entry->next->prev = entry->prev;
+  } else {
+    list->tail = entry->prev;
+  }
+  entry->prev = NULL;
+  entry->next = NULL;
+}
+
+SessionTable::EntryList *SessionTable::GetList(const Entry *entry) {
+  return entry->used ? &used_list_ : &unused_list_;
+}
+}  // namespace mozc
@@ -0,0 +1,144 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Table of the sessions held by SessionHandler.
+
+#ifndef MOZC_SESSION_SESSION_TABLE_H_
+#define MOZC_SESSION_SESSION_TABLE_H_
+
+#include <utility>
+#include <vector>
+
+#include "base/base.h"
+#include "session/common.h"
+
+namespace mozc {
+namespace session {
+class SessionInterface;
+}  // namespace session
+
+// The sessions are indexed by a hash table on their ids.  They are also
+// linked into two lists ordered by the last access: one for the sessions
+// which have never been used since created and one for the others.  So
+// insertion, lookup, eviction of the least recently used session and
+// finding the expired sessions take constant time per session, regardless
+// of the number of the sessions.
+//
+// This class is not thread-safe.
+class SessionTable {
+ public:
+  explicit SessionTable(size_t max_size);
+
+  // Deletes all the sessions.
+  ~SessionTable();
+
+  size_t size() const { return size_; }
+  size_t max_size() const { return max_size_; }
+  bool IsFull() const { return size_ >= max_size_; }
+
+  // Adds |session| with |id| and takes the ownership.  The session is
+  // regarded as unused until it is looked up.  Returns false without taking
+  // the ownership if |id| is already used or the table is full.
+  bool Insert(SessionID id, session::SessionInterface *session,
+              uint64 current_time);
+
+  // Returns the session of |id| or NULL.  The session is marked as the
+  // most recently used one at |current_time|.
+  session::SessionInterface *Lookup(SessionID id, uint64 current_time);
+
+  bool HasKey(SessionID id) const;
+
+  // Deletes the session of |id|.  Returns false if |id| is not found.
+  bool Erase(SessionID id);
+
+  // Deletes the least recently used session.  Returns its id, or 0 if the
+  // table is empty.
+  SessionID EraseLeastRecentlyUsed();
+
+  // Appends the ids of the sessions which have not been used for
+  // |create_timeout| seconds since created, or have not been used for
+  // |command_timeout| seconds since the last use.
+  void GetExpiredIds(uint64 current_time,
+                     uint64 create_timeout,
+                     uint64 command_timeout,
+                     vector<SessionID> *ids) const;
+
+  // Appends about |max_size| sessions.  Each call continues from where the
+  // previous call stopped, so that all the sessions are visited in turn
+  // with a bounded cost per call.
+  void GetNextSessions(
+      size_t max_size,
+      vector<pair<SessionID, session::SessionInterface *> > *sessions);
+
+  // Appends all the sessions.
+  void GetAllSessions(vector<session::SessionInterface *> *sessions) const;
+
+ private:
+  struct Entry {
+    SessionID id;
+    session::SessionInterface *session;
+    uint64 last_access_time;
+    // Serial number of the last access to order the accesses in the same
+    // second.
+    uint64 last_access_serial;
+    bool used;
+    Entry *hash_next;
+    Entry *prev;
+    Entry *next;
+  };
+
+  // Doubly-linked list of Entry.  The head is the most recently used one.
+  struct EntryList {
+    Entry *head;
+    Entry *tail;
+  };
+
+  size_t GetBucketIndex(SessionID id) const;
+  Entry *LookupEntry(SessionID id) const;
+  void EraseEntry(Entry *entry);
+  void Rehash(size_t bucket_size);
+  void Touch(Entry *entry, uint64 current_time);
+
+  static void PushHead(Entry *entry, EntryList *list);
+  static void Remove(Entry *entry, EntryList *list);
+  EntryList *GetList(const Entry *entry);
+
+  const size_t max_size_;
+  size_t size_;
+  uint64 access_serial_;
+  vector<Entry *> buckets_;
+  size_t next_bucket_;
+  EntryList unused_list_;
+  EntryList used_list_;
+
+  DISALLOW_COPY_AND_ASSIGN(SessionTable);
+};
+}  // namespace mozc
+#endif  // MOZC_SESSION_SESSION_TABLE_H_
@@ -0,0 +1,214 @@
+// Copyright 2010-2012, Google Inc.
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions are
+// met:
+//
+//     * Redistributions of source code must retain the above copyright
+// notice, this list of conditions and the following disclaimer.
+//     * Redistributions in binary form must reproduce the above
+// copyright notice, this list of conditions and the following disclaimer
+// in the documentation and/or other materials provided with the
+// distribution.
+//     * Neither the name of Google Inc. nor the names of its
+// contributors may be used to endorse or promote products derived from
+// this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+// "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+// LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+// OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+// LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+// DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+// THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "session/session_table.h"
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "base/base.h"
+#include "session/commands.pb.h"
+#include "session/session_interface.h"
+#include "testing/base/public/gunit.h"
+
+namespace mozc {
+namespace {
+
+class TestSession : public session::SessionInterface {
+ public:
+  explicit TestSession(int *num_deleted) : num_deleted_(num_deleted) {}
+  virtual ~TestSession() {
+    ++*num_deleted_;
+  }
+
+  bool SendKey(commands::Command *command) { return true; }
+  bool TestSendKey(commands::Command *command) { return true; }
+  bool SendCommand(commands::Command *command) { return true; }
+  void ReloadConfig() {}
+  void set_client_capability(const commands::Capability &capability) {}
+  void set_application_info(const commands::ApplicationInfo &info) {}
+  const commands::ApplicationInfo &application_info() const {
+    return application_info_;
+  }
+  uint64 create_session_time() const { return 0; }
+  uint64 last_command_time() const { return 0; }
+
+ private:
+  int *num_deleted_;
+  commands::ApplicationInfo application_info_;
+};
+
+TEST(SessionTableTest, InsertAndLookup) {
+  int num_deleted = 0;
+  {
+    SessionTable table(3);
+    EXPECT_EQ(0, table.size());
+    EXPECT_EQ(3, table.max_size());
+
+    session::SessionInterface *session1 = new TestSession(&num_deleted);
+    EXPECT_TRUE(table.Insert(1, session1, 100));
+    EXPECT_TRUE(table.HasKey(1));
+    EXPECT_FALSE(table.HasKey(2));
+    EXPECT_EQ(session1, table.Lookup(1, 100));
+    EXPECT_TRUE(table.Lookup(2, 100) == NULL);
+
+    // The same id cannot be inserted.
+    int num_duplicated_deleted = 0;
+    TestSession duplicated(&num_duplicated_deleted);
+    EXPECT_FALSE(table.Insert(1, &duplicated, 100));
+
+    EXPECT_TRUE(table.Insert(2, new TestSession(&num_deleted), 100));
+    EXPECT_TRUE(table.Insert(3, new TestSession(&num_deleted), 100));
+    EXPECT_TRUE(table.IsFull());
+    EXPECT_FALSE(table.Insert(4, &duplicated, 100));
+
+    EXPECT_TRUE(table.Erase(2));
+    EXPECT_FALSE(table.Erase(2));
+    EXPECT_EQ(1, num_deleted);
+    EXPECT_EQ(2, table.size());
+    EXPECT_FALSE(table.HasKey(2));
+  }
+  // The rest are deleted by the table.
+  EXPECT_EQ(3, num_deleted);
+}
+
+TEST(SessionTableTest, ManySessions) {
+  int num_deleted = 0;
+  const size_t kSize = 5000;
+  SessionTable table(kSize);
+  for (size_t i = 1; i <= kSize; ++i) {
+    // Session ids are random in SessionHandler, but sequential ids should
+    // work as well.
+    EXPECT_TRUE(table.Insert(i << 20, new TestSession(&num_deleted), 0));
+  }
+  EXPECT_EQ(kSize, table.size());
+  for (size_t i = 1; i <= kSize; ++i) {
+    EXPECT_TRUE(table.HasKey(i << 20));
+  }
+  for (size_t i = 1; i <= kSize; i += 2) {
+    EXPECT_TRUE(table.Erase(i << 20));
+  }
+  EXPECT_EQ(kSize / 2, table.size());
+  EXPECT_EQ(kSize / 2, num_deleted);
+}
+
+TEST(SessionTableTest, EraseLeastRecentlyUsed) {
+  int num_deleted = 0;
+  SessionTable table(10);
+  EXPECT_EQ(0, table.EraseLeastRecentlyUsed());
+
+  EXPECT_TRUE(table.Insert(1, new TestSession(&num_deleted), 100));
+  EXPECT_TRUE(table.Insert(2, new TestSession(&num_deleted), 100));
+  EXPECT_TRUE(table.Insert(3, new TestSession(&num_deleted), 100));
+
+  // The order in the same second is also kept.
+  table.Lookup(1, 100);
+  table.Lookup(2, 100);
+
+  EXPECT_EQ(3, table.EraseLeastRecentlyUsed());
+  EXPECT_EQ(1, table.EraseLeastRecentlyUsed());
+  table.Lookup(2, 101);
+  EXPECT_TRUE(table.Insert(4, new TestSession(&num_deleted), 102));
+  EXPECT_EQ(2, table.EraseLeastRecentlyUsed());
+  EXPECT_EQ(4, table.EraseLeastRecentlyUsed());
+  EXPECT_EQ(0, table.size());
+  EXPECT_EQ(4, num_deleted);
+}
+
+TEST(SessionTableTest, GetExpiredIds) {
+  int num_deleted = 0;
+  SessionTable table(10);
+  const uint64 kCreateTimeout = 10;
+  const uint64 kCommandTimeout = 100;
+
+  EXPECT_TRUE(table.Insert(1, new TestSession(&num_deleted), 1000));
+  EXPECT_TRUE(table.Insert(2, new TestSession(&num_deleted), 1005));
+  EXPECT_TRUE(table.Insert(3, new TestSession(&num_deleted), 1005));
+  table.Lookup(3, 1005);
+
+  vector<SessionID> ids;
+  table.GetExpiredIds(1009, kCreateTimeout, kCommandTimeout, &ids);
+  EXPECT_TRUE(ids.empty());
+
+  table.GetExpiredIds(1010, kCreateTimeout, kCommandTimeout, &ids);
+  ASSERT_EQ(1, ids.size());
+  EXPECT_EQ(1, ids[0]);
+
+  ids.clear();
+  table.GetExpiredIds(1015, kCreateTimeout, kCommandTimeout, &ids);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(1, ids[0]);
+  EXPECT_EQ(2, ids[1]);
+
+  // Used session expires with the command timeout.
+  ids.clear();
+  table.GetExpiredIds(1105, kCreateTimeout, kCommandTimeout, &ids);
+  EXPECT_EQ(3, ids.size());
+  EXPECT_EQ(3, ids[2]);
+
+  // Touched session is not expired.
+  table.Lookup(1, 1100);
+  ids.clear();
+  table.GetExpiredIds(1105, kCreateTimeout, kCommandTimeout, &ids);
+  ASSERT_EQ(2, ids.size());
+  EXPECT_EQ(2, ids[0]);
+  EXPECT_EQ(3, ids[1]);
+}
+
+TEST(SessionTableTest, GetNextSessions) {
+  int num_deleted = 0;
+  const size_t kSize = 100;
+  SessionTable table(kSize);
+  for (size_t i = 1; i <= kSize; ++i) {
+    EXPECT_TRUE(table.Insert(i, new TestSession(&num_deleted), 0));
+  }
+
+  // All the sessions are visited by repeated calls.
+  vector<SessionID> visited;
+  for (int trial = 0; trial < 100 && visited.size() < kSize; ++trial) {
+    vector<pair<SessionID, session::SessionInterface *> > sessions;
+    table.GetNextSessions(10, &sessions);
+    EXPECT_LE(10, sessions.size());
+    EXPECT_GT(20, sessions.size());
+    for (size_t i = 0; i < sessions.size(); ++i) {
+      visited.push_back(sessions[i].first);
+    }
+  }
+  sort(visited.begin(), visited.end());
+  visited.erase(unique(visited.begin(), visited.end()), visited.end());
+  EXPECT_EQ(kSize, visited.size());
+
+  vector<session::SessionInterface *> all_sessions;
+  table.GetAllSessions(&all_sessions);
+  EXPECT_EQ(kSize, all_sessions.size());
+}
+}  // namespace
+}  // namespace mozc
@@ -31,6 +31,7 @@
 #include <vector>
 #include "base/base.h"
 #include "base/singleton.h"
+#include "base/thread.h"
 #include "base/util.h"
 #include "composer/composer.h"
 #include "composer/table.h"
@@ -39,6 +40,7 @@
 #include "converter/converter_interface.h"
 #include "converter/converter_mock.h"
 #include "rewriter/transliteration_rewriter.h"
+#include "session/async_suggester.h"
 #include "session/commands.pb.h"
 #include "session/internal/ime_context.h"
 #include "session/internal/keymap.h"
@@ -3732,6 +3734,91 @@ TEST_F(SessionTest, Suggest) {
   EXPECT_EQ("MOCHA", command.output().candidates().candidate(0).value());
 }
 
+TEST_F(SessionTest, AsyncSuggestion) {
+  commands::Request request;
+  request.set_async_suggestion(true);
+  commands::RequestHandler::SetRequest(request);
+
+  Segments segments_mo;
+  {
+    segments_mo.set_request_type(Segments::SUGGESTION);
+    Segment *segment;
+    segment = segments_mo.add_segment();
+    segment->set_key("MO");
+    segment->add_candidate()->value = "MOCHA";
+    segment->add_candidate()->value = "MOZUKU";
+  }
+  convertermock_->SetStartSuggestionWithComposer(&segments_mo, true);
+
+  scoped_ptr<Session> session(new Session);
+  InitSessionToPrecomposition(session.get());
+  commands::Command command;
+  SendKey("M", session.get(), &command);
+
+  // The preedit is returned without waiting for the suggestion.
+  command.Clear();
+  SendKey("O", session.get(), &command);
+  EXPECT_TRUE(command.output().has_preedit());
+  EXPECT_FALSE(command.output().has_candidates());
+  ASSERT_TRUE(command.output().has_callback());
+  EXPECT_EQ(commands::SessionCommand::GET_ASYNC_SUGGESTION,
+            command.output().callback().session_command().type());
+
+  // The client polls until the suggestion is ready.
+  for (int i = 0; i < 1000; ++i) {
+    command.Clear();
+    command.mutable_input()->mutable_command()->set_type(
+        commands::SessionCommand::GET_ASYNC_SUGGESTION);
+    EXPECT_TRUE(session->SendCommand(&command));
+    if (!command.output().has_callback()) {
+      break;
+    }
+    Util::Sleep(1);
+  }
+  EXPECT_TRUE(command.output().consumed());
+  ASSERT_TRUE(command.output().has_candidates());
+  EXPECT_EQ(2, command.output().candidates().candidate_size());
+  EXPECT_EQ("MOCHA", command.output().candidates().candidate(0).value());
+
+  // Commands which modify the composition cancel the request.
+  command.Clear();
+  SendKey("Z", session.get(), &command);
+  EXPECT_FALSE(command.output().has_candidates());
+  command.Clear();
+  SendKey("Left", session.get(), &command);
+  command.Clear();
+  command.mutable_input()->mutable_command()->set_type(
+      commands::SessionCommand::GET_ASYNC_SUGGESTION);
+  EXPECT_TRUE(session->SendCommand(&command));
+  EXPECT_FALSE(command.output().has_callback());
+}
+
+TEST_F(SessionTest, SpeculativeConversionIsDiscardedByReloadConfig) {
+  commands::Request request;
+  request.set_async_suggestion(true);
+  request.set_speculative_conversion(true);
+  commands::RequestHandler::SetRequest(request);
+
+  Segments segments;
+  SetAiueo(&segments);
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  scoped_ptr<Session> session(new Session);
+  InitSessionToPrecomposition(session.get());
+  commands::Command command;
+  InsertCharacterChars("aiueo", session.get(), &command);
+  ASSERT_TRUE(session->async_suggester_.get() != NULL);
+  EXPECT_TRUE(session->async_suggester_->WaitForConversion(-1));
+  segments.mutable_segment(0)->mutable_candidate(0)->value = "AIUEO";
+  convertermock_->SetStartConversionForRequest(&segments, true);
+
+  session->ReloadConfig();
+  command.Clear();
+  EXPECT_TRUE(session->Convert(&command));
+  ASSERT_TRUE(command.output().has_preedit());
+  EXPECT_EQ("AIUEO", command.output().preedit().segment(0).value());
+}
+
 TEST_F(SessionTest, ExpandSuggestion) {
   scoped_ptr<Session> session(new Session);
   InitSessionToPrecomposition(session.get());
@@ -154,11 +154,13 @@
       'target_name': 'session_module_test',
       'type': 'executable',
       'sources': [
+        'async_suggester_test.cc',
         'ime_switch_util_test.cc',
         'key_event_util_test.cc',
         'key_parser_test.cc',
         'request_handler_test.cc',
         'session_observer_handler_test.cc',
+        'session_table_test.cc',
         'session_usage_observer_test.cc',
         'session_watch_dog_test.cc',
       ],
@@ -332,6 +334,23 @@
         'session_handler_test_util',
       ],
     },
+    {
+      'target_name': 'session_benchmark_main',
+      'type': 'executable',
+      'sources': [
+        'session_benchmark_main.cc',
+      ],
+      'dependencies': [
+        '../base/base.gyp:base',
+        '../ipc/ipc.gyp:ipc',
+        'session.gyp:random_keyevents_generator',
+        'session.gyp:session',
+        'session.gyp:session_handler',
+        'session.gyp:session_server',
+        'session_base.gyp:key_parser',
+        'session_base.gyp:session_protocol',
+      ],
+    },
 
     # Test cases meta target: this target is referred from gyp/tests.gyp
     {
@@ -29,9 +29,61 @@
 
 #include <string.h>
 #include <cmath>
+#include "base/prefetch.h"
 #include "storage/existence_filter.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define MOZC_EXISTENCE_FILTER_USE_SSE2
+#endif
+
 namespace mozc {
+namespace {
+
+// Multiplier of Fibonacci hashing. Used to derive the bit positions
+// in a block from the hash value for BLOCKED filter.
+const uint64 kBlockHashMultiplier = 0x9E3779B97F4A7C15ULL;
+
+// Size of the header of BLOCKED filter in the image including padding.
+const size_t kBlockedHeaderSize = ExistenceFilter::kImageAlignment;
+
+// Allocates |num_words| words aligned to ExistenceFilter::kImageAlignment.
+// |*raw| is set to the pointer to be deleted.
+uint32 *NewAlignedWords(size_t num_words, uint32 **raw) {
+  const size_t kAlignment = ExistenceFilter::kImageAlignment;
+  *raw = new uint32[num_words + kAlignment / sizeof(uint32) - 1];
+  const size_t misalignment = reinterpret_cast<size_t>(*raw) % kAlignment;
+  if (misalignment == 0) {
+    return *raw;
+  }
+  return *raw + (kAlignment - misalignment) / sizeof(uint32);
+}
+
+// Returns true if all the bits in 'mask' are set in 'block'.
+// Both arrays have 16 words (one 64-byte block).
+inline bool ContainsAllBits(const uint32 *block, const uint32 *mask) {
+#ifdef MOZC_EXISTENCE_FILTER_USE_SSE2
+  __m128i missing = _mm_setzero_si128();
+  for (int i = 0; i < 16; i += 4) {
+    const __m128i b =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(block + i));
+    const __m128i m =
+        _mm_loadu_si128(reinterpret_cast<const __m128i *>(mask + i));
+    // m & ~b
+    missing = _mm_or_si128(missing, _mm_andnot_si128(b, m));
+  }
+  return _mm_movemask_epi8(
+      _mm_cmpeq_epi8(missing, _mm_setzero_si128())) == 0xFFFF;
+#else
+  uint32 missing = 0;
+  for (int i = 0; i < 16; ++i) {
+    missing |= mask[i] & ~block[i];
+  }
+  return missing == 0;
+#endif  // MOZC_EXISTENCE_FILTER_USE_SSE2
+}
+}  // namespace
 
 class ExistenceFilter::BlockBitmap {
  public:
@@ -44,6 +96,11 @@ class ExistenceFilter::BlockBitmap {
   bool Get(uint32 index) const;
   void Set(uint32 index);
 
+  // Returns the word containing the bit at 'index'. Words in the same
+  // 256KB block are contiguous.
+  const uint32 *GetWords(uint32 index) const;
+  uint32 *GetMutableWords(uint32 index);
+
   // REQUIRES: "iter" is zero, or was set by a preceding call
   // to GetMutableFragment().
   //
@@ -67,8 +124,10 @@ class ExistenceFilter::BlockBitmap {
   static const int kBlockBytes = kBlockBits >> 3;
   static const int kBlockWords = kBlockBits >> 5;
 
-  // Array of blocks
+  // Array of blocks.  The blocks are aligned to kImageAlignment.
   uint32 **block_;
+  // Array of the allocated blocks to be deleted, or NULL if immutable.
+  uint32 **raw_block_;
   uint32 length_;
   uint32 num_blocks_;
   uint32 bytes_in_last_;
@@ -78,7 +137,7 @@ class ExistenceFilter::BlockBitmap {
 };
 
 ExistenceFilter::BlockBitmap::BlockBitmap(uint32 length, bool is_mutable)
-    : length_(length), is_mutable_(is_mutable) {
+    : raw_block_(NULL), length_(length), is_mutable_(is_mutable) {
   CHECK_GT(length, 0);
   const uint32 bits_in_last_block = (length & kBlockMask);
 
@@ -92,10 +151,14 @@ ExistenceFilter::BlockBitmap::BlockBitmap(uint32 length, bool is_mutable)
 
   block_ = new uint32*[num_blocks_];
   CHECK(block_);
+  if (is_mutable_) {
+    raw_block_ = new uint32*[num_blocks_];
+  }
 
   // Allocate full blocks
   for (size_t i = 0; i < num_blocks_ - 1; ++i) {
-    block_[i] = is_mutable_ ? new uint32[kBlockWords] : NULL;
+    block_[i] =
+        is_mutable_ ? NewAlignedWords(kBlockWords, &raw_block_[i]) : NULL;
   }
 
   // Allocate the last block
@@ -107,14 +170,17 @@ ExistenceFilter::BlockBitmap::BlockBitmap(uint32 length, bool is_mutable)
   CHECK_EQ(bytes_in_last_ % sizeof(uint32), 0);
 
   block_[num_blocks_-1] =
-      is_mutable_ ? new uint32[bytes_in_last_/sizeof(uint32)] : NULL;
+      is_mutable_ ? NewAlignedWords(bytes_in_last_/sizeof(uint32),
+                                    &raw_block_[num_blocks_-1])
+                  : NULL;
 }
 
 ExistenceFilter::BlockBitmap::~BlockBitmap() {
   if (is_mutable_) {
     for (int i = 0; i < num_blocks_; ++i) {
-      delete [] block_[i];
+      delete [] raw_block_[i];
     }
+    delete [] raw_block_;
   }
   delete [] block_;
 }
@@ -138,21 +204,37 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k)
     : vec_size_(m ? m : 1),
       is_power_of_two_((vec_size_ & (vec_size_ - 1)) == 0),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      version_(STANDARD),
+      num_blocks_(0) {
+  CHECK_LT(num_hashes_, 8);
+  rep_.reset(new BlockBitmap(vec_size_, true));
+  rep_->Clear();
+}
+
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Version version)
+    : vec_size_(RoundUpBits(m, version)),
+      is_power_of_two_((vec_size_ & (vec_size_ - 1)) == 0),
+      expected_nelts_(n),
+      num_hashes_(k),
+      version_(version),
+      num_blocks_(version == BLOCKED ? (vec_size_ >> kCacheBlockShift) : 0) {
   CHECK_LT(num_hashes_, 8);
-  rep_.reset(new BlockBitmap(m ? m : 1, true));
+  rep_.reset(new BlockBitmap(vec_size_, true));
   rep_->Clear();
 }
 
 // this is private constructor
-ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
+ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k, Version version,
                                  bool is_mutable)
-    : vec_size_(m ? m : 1),
+    : vec_size_(RoundUpBits(m, version)),
       is_power_of_two_((vec_size_ & (vec_size_ - 1)) == 0),
       expected_nelts_(n),
-      num_hashes_(k) {
+      num_hashes_(k),
+      version_(version),
+      num_blocks_(version == BLOCKED ? (vec_size_ >> kCacheBlockShift) : 0) {
   CHECK_LT(num_hashes_, 8);
-  rep_.reset(new BlockBitmap(m ? m : 1, is_mutable));
+  rep_.reset(new BlockBitmap(vec_size_, is_mutable));
   rep_->Clear();
 }
 
@@ -160,12 +242,38 @@ ExistenceFilter::ExistenceFilter(uint32 m, uint32 n, int k,
 ExistenceFilter *
 ExistenceFilter::CreateImmutableExietenceFilter(uint32 m,
                                                 uint32 n,
-                                                int k) {
-  return new ExistenceFilter(m, n, k, false);
+                                                int k,
+                                                Version version) {
+  return new ExistenceFilter(m, n, k, version, false);
+}
+
+// static
+uint32 ExistenceFilter::RoundUpBits(uint32 m, Version version) {
+  if (m == 0) {
+    m = 1;
+  }
+  if (version != BLOCKED) {
+    return m;
+  }
+  return ((m + kCacheBlockBits - 1) >> kCacheBlockShift) << kCacheBlockShift;
+}
+
+// static
+size_t ExistenceFilter::HeaderSizeInImage(Version version) {
+  if (version == BLOCKED) {
+    return kBlockedHeaderSize;
+  }
+  return sizeof(uint32) + sizeof(uint32) + sizeof(int);
 }
 
 ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
                                                 uint32 estimated_insertions) {
+  return CreateOptimal(size_in_bytes, estimated_insertions, STANDARD);
+}
+
+ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
+                                                uint32 estimated_insertions,
+                                                Version version) {
   CHECK_LT(size_in_bytes, (1 << 29))
                              << "Requested size is too big";
   CHECK_GT(estimated_insertions, 0);
@@ -183,7 +291,7 @@ ExistenceFilter* ExistenceFilter::CreateOptimal(size_t size_in_bytes,
 
   VLOG(1) << "optimal_k: " << optimal_k;
 
-  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k);
+  ExistenceFilter *filter = new ExistenceFilter(m, n, optimal_k, version);
   CHECK(filter);
   return filter;
 }
@@ -209,6 +317,19 @@ inline void ExistenceFilter::BlockBitmap::Set(uint32 index) {
   block_[bindex][windex] |= (static_cast<uint32>(1) << bitpos);
 }
 
+inline const uint32 *ExistenceFilter::BlockBitmap::GetWords(
+    uint32 index) const {
+  const uint32 bindex = index >> kBlockShift;
+  const uint32 windex = (index & kBlockMask) >> 5;
+  return block_[bindex] + windex;
+}
+
+inline uint32 *ExistenceFilter::BlockBitmap::GetMutableWords(uint32 index) {
+  const uint32 bindex = index >> kBlockShift;
+  const uint32 windex = (index & kBlockMask) >> 5;
+  return block_[bindex] + windex;
+}
+
 bool ExistenceFilter::BlockBitmap::GetMutableFragment(uint32 *iter,
                                                       char ***ptr,
                                                       size_t *size) {
@@ -235,7 +356,35 @@ uint64 ExistenceFilter::RotateLeft64(uint64 original, int num_bits) {
   return rotated_original;
 }
 
+uint32 ExistenceFilter::GetBlockIndex(uint64 hash) const {
+  DCHECK_GT(num_blocks_, 0);
+  // The upper 32 bits choose the block without modulo.
+  const uint32 block = static_cast<uint32>(
+      ((hash >> 32) * static_cast<uint64>(num_blocks_)) >> 32);
+  return block << kCacheBlockShift;
+}
+
+uint32 ExistenceFilter::GetBlockMask(uint64 hash,
+                                     uint32 mask[kCacheBlockWords]) const {
+  memset(mask, 0, sizeof(mask[0]) * kCacheBlockWords);
+  // The mixed lower bits choose 'k' bit positions (9 bits each) in
+  // the block.
+  uint64 bits = hash * kBlockHashMultiplier;
+  for (size_t i = 0; i < num_hashes_; ++i) {
+    const uint32 pos = static_cast<uint32>(bits) & (kCacheBlockBits - 1);
+    mask[pos >> 5] |= (static_cast<uint32>(1) << (pos & 31));
+    bits >>= kCacheBlockShift;
+  }
+  return GetBlockIndex(hash);
+}
+
 bool ExistenceFilter::Exists(uint64 hash) const {
+  if (version_ == BLOCKED) {
+    uint32 mask[kCacheBlockWords];
+    const uint32 index = GetBlockMask(hash, mask);
+    return ContainsAllBits(rep_->GetWords(index), mask);
+  }
+
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -246,7 +395,37 @@ bool ExistenceFilter::Exists(uint64 hash) const {
   return true;
 }
 
+void ExistenceFilter::BatchExists(const uint64 *hashes, size_t size,
+                                  bool *results) const {
+  if (version_ == BLOCKED) {
+    for (size_t i = 0; i < size; ++i) {
+      Prefetch(rep_->GetWords(GetBlockIndex(hashes[i])));
+    }
+  } else {
+    for (size_t i = 0; i < size; ++i) {
+      uint64 hash = hashes[i];
+      for (size_t j = 0; j < num_hashes_; ++j) {
+        hash = RotateLeft64(hash, 8);
+        Prefetch(rep_->GetWords(hash % vec_size_));
+      }
+    }
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    results[i] = Exists(hashes[i]);
+  }
+}
+
 void ExistenceFilter::Insert(uint64 hash) {
+  if (version_ == BLOCKED) {
+    uint32 mask[kCacheBlockWords];
+    uint32 *words = rep_->GetMutableWords(GetBlockMask(hash, mask));
+    for (size_t i = 0; i < kCacheBlockWords; ++i) {
+      words[i] |= mask[i];
+    }
+    return;
+  }
+
   for (size_t i = 0; i < num_hashes_; ++i) {
     hash = RotateLeft64(hash, 8);
     uint32 index = hash % vec_size_;
@@ -275,23 +454,28 @@ size_t ExistenceFilter::MinFilterSizeInBytesForErrorRate(float error_rate,
 // allocate 'buf' and write filter to the buf.
 // 'size' will hold the size of buf
 void ExistenceFilter::Write(char **buf, size_t *size) {
-  const int require_bytes = sizeof(Header) + Size();
+  const size_t header_bytes = HeaderSizeInImage(version_);
+  const int require_bytes = header_bytes + Size();
 
   *buf = new char[require_bytes];
   CHECK(*buf);
   *size = require_bytes;
+  memset(*buf, 0, header_bytes);
 
   char *buf_ptr = *buf;
 
   // write header
+  // The version is stored in the upper bits of 'k' for compatibility.
+  const int32 k = num_hashes_ | (static_cast<int32>(version_) << 16);
   memcpy(buf_ptr, &vec_size_, sizeof(vec_size_));
   buf_ptr += sizeof(vec_size_);
   memcpy(buf_ptr, &expected_nelts_, sizeof(expected_nelts_));
   buf_ptr += sizeof(expected_nelts_);
-  memcpy(buf_ptr, &num_hashes_, sizeof(num_hashes_));
-  buf_ptr += sizeof(num_hashes_);
+  memcpy(buf_ptr, &k, sizeof(k));
+  buf_ptr = *buf + header_bytes;
   LOG(INFO) << "Write header : vec_size" << vec_size_ << " expected_nelts "
-            << expected_nelts_ << " num_hashes " << num_hashes_;
+            << expected_nelts_ << " num_hashes " << num_hashes_
+            << " version " << version_;
 
   // write bitmap
   char **fragment_ptr = NULL;
@@ -315,18 +499,28 @@ bool ExistenceFilter::ReadHeader(const char *buf, Header* header) {
   buf += sizeof(header->n);
   memcpy(&(header->k), buf, sizeof(header->k));
   buf += sizeof(header->k);
+  const int version = (header->k >> 16);
+  header->k &= 0xFFFF;
   if (header->k >= 8 || header->k <= 0) {
     LOG(ERROR) << "Bad number of hashes (header->k)";
     return false;
   }
+  if (version != STANDARD && version != BLOCKED) {
+    LOG(ERROR) << "Unknown version: " << version;
+    return false;
+  }
+  header->version = static_cast<Version>(version);
+  if (header->version == BLOCKED &&
+      (header->m == 0 || header->m % kCacheBlockBits != 0)) {
+    LOG(ERROR) << "Bad size of blocked filter (header->m)";
+    return false;
+  }
   return true;
 }
 
 ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   Header header;
-  const uint32 header_bytes =
-      sizeof(header.m) + sizeof(header.n) + sizeof(header.k);
-  if (size < header_bytes) {
+  if (size < HeaderSizeInImage(STANDARD)) {
     LOG(ERROR) << "Not enough bufsize: could not read header";
     return NULL;
   }
@@ -335,13 +529,18 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
     LOG(ERROR) << "Invalid format: could not read header";
     return NULL;
   }
+  const size_t header_bytes = HeaderSizeInImage(header.version);
+  if (size < header_bytes) {
+    LOG(ERROR) << "Not enough bufsize: could not read header";
+    return NULL;
+  }
   buf += header_bytes;
 
   const uint32 filter_size = BitsToWords(header.m);
   const uint32 filter_bytes = filter_size * sizeof(uint32);
   VLOG(1) << "Reading bloom filter with size: " << filter_bytes << " bytes, "
           << "estimated insertions: " << header.n << " (k: " << header.k
-          << ")";
+          << ", version: " << header.version << ")";
 
 
   if (size < header_bytes + filter_bytes) {
@@ -352,7 +551,8 @@ ExistenceFilter* ExistenceFilter::Read(const char *buf, size_t size) {
   ExistenceFilter* filter =
       ExistenceFilter::CreateImmutableExietenceFilter(header.m,
                                                       header.n,
-                                                      header.k);
+                                                      header.k,
+                                                      header.version);
   char **ptr = NULL;
   size_t n = 0;
   size_t read = 0;
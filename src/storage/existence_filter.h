@@ -39,11 +39,27 @@ class ExistenceFilter {
   class BlockBitmap;
 
  public:
+  enum Version {
+    // 'k' bits of a value are spread over the whole bit vector.
+    STANDARD = 0,
+    // All 'k' bits of a value are in one 64-byte (cache line) block,
+    // so a lookup touches only one cache line.  The false positive rate
+    // is slightly higher than STANDARD for the same size.
+    BLOCKED = 1,
+  };
+
+  // Alignment of the blocks of BLOCKED filter in memory.  The image of
+  // BLOCKED filter should be aligned to this, because Read() uses the
+  // image in place.
+  static const size_t kImageAlignment = 64;
 
+  // The version is stored in the upper 16 bits of 'k' in the image so
+  // that images written before BLOCKED was introduced can still be read.
   struct Header {
     uint32 m;
     uint32 n;
     int k;
+    Version version;
   };
 
   // 'm' is the number of bits in the bit vector
@@ -52,9 +68,16 @@ class ExistenceFilter {
   // k must be less than 8
   ExistenceFilter(uint32 m, uint32 n, int k);
 
+  // For BLOCKED, 'm' is rounded up to a multiple of the block size.
+  ExistenceFilter(uint32 m, uint32 n, int k, Version version);
+
   static ExistenceFilter* CreateOptimal(size_t size_in_bytes,
                                         uint32 estimated_insertions);
 
+  static ExistenceFilter* CreateOptimal(size_t size_in_bytes,
+                                        uint32 estimated_insertions,
+                                        Version version);
+
   ~ExistenceFilter();
 
   void Clear();
@@ -67,9 +90,19 @@ class ExistenceFilter {
   // It may return some false positives
   bool Exists(uint64 hash) const;
 
+  // Checks |size| hash values at once. |results[i]| is set to
+  // Exists(|hashes[i]|). The words of all the values are prefetched
+  // before they are tested, so this is faster than calling Exists() for
+  // each value.
+  void BatchExists(const uint64 *hashes, size_t size, bool *results) const;
+
   // Returns the size (in bytes) of the bloom filter
   size_t Size() const;
 
+  Version version() const {
+    return version_;
+  }
+
   // Returns the minimum required size of the filter in bytes
   // under the given error rate and number of elements
   static size_t MinFilterSizeInBytesForErrorRate(float error_rate,
@@ -80,21 +113,42 @@ class ExistenceFilter {
   static bool ReadHeader(const char *buf, Header* header);
 
   // Read Existence filter from buf[]
+  // For BLOCKED, buf[] should be aligned to kImageAlignment.
   // Note that the returned ExsitenceFilter is immutable filter.
   // Any mutable operations will destroy buf[].
   static ExistenceFilter* Read(const char *buf, size_t size);
 
  private:
+  // Bits in one cache block of BLOCKED filter. 512 bits == 64 bytes.
+  static const int kCacheBlockShift = 9;
+  static const uint32 kCacheBlockBits = 1 << kCacheBlockShift;
+  static const uint32 kCacheBlockWords = kCacheBlockBits >> 5;
+
   // private constructor for ExistenceFilter::Read();
-  ExistenceFilter(uint32 m, uint32 n, int k, bool is_mutable);
+  ExistenceFilter(uint32 m, uint32 n, int k, Version version,
+                  bool is_mutable);
 
   static ExistenceFilter *CreateImmutableExietenceFilter(uint32 m,
                                                          uint32 n,
-                                                         int k);
+                                                         int k,
+                                                         Version version);
 
   // Rotate the value in 'original' by 'num_bits'
   static uint64 RotateLeft64(uint64 original, int num_bits);
 
+  // Returns the first bit index of the block for 'hash'. Used for BLOCKED.
+  uint32 GetBlockIndex(uint64 hash) const;
+
+  // Returns the first bit index of the block for 'hash' and fills the
+  // bits to be tested in the block into 'mask'. Used for BLOCKED.
+  uint32 GetBlockMask(uint64 hash, uint32 mask[kCacheBlockWords]) const;
+
+  // Returns the size of the header in the image. BLOCKED pads the header
+  // so that the blocks are aligned to 64 bytes relative to the image.
+  static size_t HeaderSizeInImage(Version version);
+
+  static uint32 RoundUpBits(uint32 m, Version version);
+
   static inline uint32 BitsToWords(uint32 bits) {
     uint32 words = (bits + 31) >> 5;
     if (bits > 0 && words == 0) {
@@ -108,6 +162,8 @@ class ExistenceFilter {
   const bool is_power_of_two_;  // true if vec_size_ is a power of two
   const uint32 expected_nelts_;  // expected number of inserts
   const int32 num_hashes_;  // number of hashes per lookup
+  const Version version_;
+  const uint32 num_blocks_;  // number of blocks for BLOCKED
 };
 }  // namespace mozc
 
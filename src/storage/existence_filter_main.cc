@@ -27,29 +27,82 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+
+// Compares false positive rate and lookup throughput of the
+// STANDARD and BLOCKED existence filters.
+//
+// existence_filter_main --num_elements=100000 --error_rate=0.00001
+
 #include <string>
 #include "base/base.h"
+#include "base/stopwatch.h"
 #include "base/util.h"
 #include "storage/existence_filter.h"
 
-int main(int argc, char **argv) {
-  InitGoogle(argv[0], &argc, &argv, false);
+DEFINE_int32(num_elements, 100000, "number of inserted elements");
+DEFINE_int32(num_lookups, 10000000, "number of lookups for benchmark");
+DEFINE_double(error_rate, 0.00001, "target error rate used for sizing");
 
-  int n = 500;
-  int m = mozc::ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01,
-                                                                  n);
-  mozc::ExistenceFilter *filter = mozc::ExistenceFilter::CreateOptimal(m, n);
+namespace {
+uint64 GetHash(int value) {
+  return mozc::Util::Fingerprint(reinterpret_cast<const char *>(&value),
+                                 sizeof(value));
+}
+
+void RunBenchmark(mozc::ExistenceFilter::Version version) {
+  const int n = FLAGS_num_elements;
+  const size_t num_bytes =
+      mozc::ExistenceFilter::MinFilterSizeInBytesForErrorRate(
+          FLAGS_error_rate, n);
+  scoped_ptr<mozc::ExistenceFilter> filter(
+      mozc::ExistenceFilter::CreateOptimal(num_bytes, n, version));
+
+  // Even values are inserted.
   for (int i = 0; i < n; ++i) {
-    uint64 val = i * 2;
-    filter->Insert(val);
+    filter->Insert(GetHash(i * 2));
+  }
+  for (int i = 0; i < n; ++i) {
+    CHECK(filter->Exists(GetHash(i * 2)));
   }
 
-  for (int i = 0; i < 2 * n; ++i) {
-    uint64 val = i;
-    if ((i % 2) == 0) {
-      CHECK(filter->Exists(val));
+  // Odd values are never inserted.
+  int false_positives = 0;
+  for (int i = 0; i < n; ++i) {
+    if (filter->Exists(GetHash(i * 2 + 1))) {
+      ++false_positives;
     }
   }
 
+  // Hashes are computed in advance not to measure Fingerprint.
+  vector<uint64> hashes(2 * n);
+  for (int i = 0; i < hashes.size(); ++i) {
+    hashes[i] = GetHash(i);
+  }
+  int found = 0;
+  mozc::Stopwatch stopwatch = mozc::Stopwatch::StartNew();
+  for (int i = 0; i < FLAGS_num_lookups; ++i) {
+    if (filter->Exists(hashes[i % hashes.size()])) {
+      ++found;
+    }
+  }
+  stopwatch.Stop();
+
+  cout << (version == mozc::ExistenceFilter::BLOCKED ?
+           "blocked" : "standard")
+       << "\tsize: " << filter->Size()
+       << "\tfalse_positive_rate: "
+       << static_cast<double>(false_positives) / n
+       << "\tns/lookup: "
+       << stopwatch.GetElapsedNanoseconds() / FLAGS_num_lookups
+       << "\t(found: " << found << ")" << endl;
+}
+}  // namespace
+
+int main(int argc, char **argv) {
+  InitGoogle(argv[0], &argc, &argv, false);
+
+  RunBenchmark(mozc::ExistenceFilter::STANDARD);
+  RunBenchmark(mozc::ExistenceFilter::BLOCKED);
+
   return 0;
 }
@@ -38,7 +38,7 @@
 
 namespace mozc {
 
-void CheckValues(ExistenceFilter* filter, int m, int n) {
+int CheckValues(ExistenceFilter* filter, int m, int n) {
   int false_positives = 0;
   for (int i = 0; i < 2 * n; ++i) {
     uint64 hash = Util::Fingerprint(reinterpret_cast<const char *>(&i),
@@ -55,11 +55,13 @@ void CheckValues(ExistenceFilter* filter, int m, int n) {
   }
 
   LOG(INFO) << "false_positives: " << false_positives;
+  return false_positives;
 }
 
-void RunTest(int m, int n) {
-  LOG(INFO) << "Test " << m << " " << n;
-  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n);
+void RunTest(int m, int n, ExistenceFilter::Version version) {
+  LOG(INFO) << "Test " << m << " " << n << " " << version;
+  ExistenceFilter *filter = ExistenceFilter::CreateOptimal(m, n, version);
+  EXPECT_EQ(version, filter->version());
 
   for (int i = 0; i < n; ++i) {
     int val = i * 2;
@@ -75,6 +77,8 @@ void RunTest(int m, int n) {
   filter->Write(&buf, &size);
   LOG(INFO) << "write size: " << size;
   ExistenceFilter *filter2 = ExistenceFilter::Read(buf, size);
+  ASSERT_TRUE(filter2 != NULL);
+  EXPECT_EQ(version, filter2->version());
   CheckValues(filter2, m, n);
   delete filter2;
   delete[] buf;
@@ -85,7 +89,84 @@ void RunTest(int m, int n) {
 TEST(ExistenceFilterTest, RunTest) {
   int n = 50000;
   int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
-  RunTest(m, n);
+  RunTest(m, n, ExistenceFilter::STANDARD);
+}
+
+TEST(ExistenceFilterTest, RunTestBlocked) {
+  int n = 50000;
+  int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, 50000);
+  RunTest(m, n, ExistenceFilter::BLOCKED);
+}
+
+TEST(ExistenceFilterTest, BlockedFalsePositiveRate) {
+  const int n = 50000;
+  const int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, n);
+  scoped_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(m, n, ExistenceFilter::BLOCKED));
+  for (int i = 0; i < n; ++i) {
+    const int val = i * 2;
+    filter->Insert(Util::Fingerprint(reinterpret_cast<const char *>(&val),
+                                     sizeof(val)));
+  }
+  // Blocked filter has a higher error rate than the standard one for
+  // the same size, but it should stay in the same order.
+  const int false_positives = CheckValues(filter.get(), m, n);
+  EXPECT_GT(n * 0.03, false_positives);
+}
+
+TEST(ExistenceFilterTest, BlockedSizeIsRoundedUp) {
+  // 1 byte is rounded up to one 64-byte block.
+  scoped_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(1, 1, ExistenceFilter::BLOCKED));
+  EXPECT_EQ(64, filter->Size());
+
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  // 64-byte header followed by one block.
+  EXPECT_EQ(128, size);
+
+  ExistenceFilter::Header header;
+  EXPECT_TRUE(ExistenceFilter::ReadHeader(buf, &header));
+  EXPECT_EQ(ExistenceFilter::BLOCKED, header.version);
+  EXPECT_EQ(512, header.m);
+  EXPECT_LT(0, header.k);
+  EXPECT_GT(8, header.k);
+  delete [] buf;
+}
+
+TEST(ExistenceFilterTest, StandardImageCompatibility) {
+  // The image of STANDARD filter has the same layout as the one
+  // written before the version was introduced: m, n and k followed
+  // by the bitmap.
+  scoped_ptr<ExistenceFilter> filter(ExistenceFilter::CreateOptimal(100, 10));
+  EXPECT_EQ(ExistenceFilter::STANDARD, filter->version());
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  EXPECT_EQ(12 + filter->Size(), size);
+  int k = 0;
+  memcpy(&k, buf + 8, sizeof(k));
+  EXPECT_GT(8, k);
+  EXPECT_LT(0, k);
+  delete [] buf;
+}
+
+TEST(ExistenceFilterTest, ReadBrokenHeader) {
+  scoped_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(100, 10, ExistenceFilter::BLOCKED));
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+
+  // Truncated padding.
+  EXPECT_TRUE(ExistenceFilter::Read(buf, 20) == NULL);
+
+  // Unknown version.
+  const int k = 3 | (2 << 16);
+  memcpy(buf + 8, &k, sizeof(k));
+  EXPECT_TRUE(ExistenceFilter::Read(buf, size) == NULL);
+  delete [] buf;
 }
 
 TEST(ExistenceFilterTest, MinFilterSizeEstimateTest) {
@@ -130,6 +211,63 @@ TEST(ExistenceFilterTest, ReadWriteTest) {
   delete [] buf;
 };
 
+TEST(ExistenceFilterTest, BlockedReadWriteTest) {
+  vector<string> words;
+  words.push_back("a");
+  words.push_back("b");
+  words.push_back("c");
+
+  scoped_ptr<ExistenceFilter> filter(
+      ExistenceFilter::CreateOptimal(1024, words.size(),
+                                     ExistenceFilter::BLOCKED));
+  for (int i = 0; i < words.size(); ++i) {
+    filter->Insert(Util::Fingerprint(words[i]));
+  }
+
+  char *buf = NULL;
+  size_t size = 0;
+  filter->Write(&buf, &size);
+  scoped_ptr<ExistenceFilter> filter_read(ExistenceFilter::Read(buf, size));
+  ASSERT_TRUE(filter_read.get() != NULL);
+  EXPECT_EQ(ExistenceFilter::BLOCKED, filter_read->version());
+  for (int i = 0; i < words.size(); ++i) {
+    EXPECT_TRUE(filter_read->Exists(Util::Fingerprint(words[i])));
+  }
+  EXPECT_FALSE(filter_read->Exists(Util::Fingerprint("not inserted")));
+
+  delete [] buf;
+}
+
+TEST(ExistenceFilterTest, BatchExists) {
+  const ExistenceFilter::Version kVersions[] = {
+    ExistenceFilter::STANDARD, ExistenceFilter::BLOCKED,
+  };
+  for (size_t v = 0; v < arraysize(kVersions); ++v) {
+    const int n = 1000;
+    const int m = ExistenceFilter::MinFilterSizeInBytesForErrorRate(0.01, n);
+    scoped_ptr<ExistenceFilter> filter(
+        ExistenceFilter::CreateOptimal(m, n, kVersions[v]));
+    vector<uint64> hashes;
+    for (int i = 0; i < 2 * n; ++i) {
+      const uint64 hash = Util::Fingerprint(reinterpret_cast<const char *>(&i),
+                                            sizeof(i));
+      if (i % 2 == 0) {
+        filter->Insert(hash);
+      }
+      hashes.push_back(hash);
+    }
+
+    scoped_array<bool> results(new bool[hashes.size()]);
+    filter->BatchExists(&hashes[0], hashes.size(), results.get());
+    for (size_t i = 0; i < hashes.size(); ++i) {
+      EXPECT_EQ(filter->Exists(hashes[i]), results[i]) << i;
+      if (i % 2 == 0) {
+        EXPECT_TRUE(results[i]) << i;
+      }
+    }
+  }
+}
+
 TEST(ExistenceFilterTest, InsertAndExistsTest) {
   vector<string> words;
   words.push_back("a");
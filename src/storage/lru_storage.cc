@@ -27,9 +27,10 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+
 #include <time.h>
+#include <stddef.h>
 #include <stdlib.h>
-#include <map>
 #include <set>
 #include <string>
 #include <vector>
@@ -38,12 +39,18 @@
 #include "base/file_stream.h"
 #include "base/util.h"
 #include "base/mmap.h"
+#include "base/prefetch.h"
 #include "storage/lru_storage.h"
 
 namespace {
 
 const size_t kMaxLRUSize   = 1000000;  // 1M
 const size_t kMaxValueSize = 1024;     // 1024 byte
+const size_t kFileHeaderSize = 12;     // value_size, size and seed
+const size_t kIndexHeaderSize = 48;
+
+const uint32 kIndexMagic = 0x4c525532;  // "LRU2"
+const uint32 kNoRecord = 0xFFFFFFFF;
 
 template <class T>
 inline void ReadValue(char **ptr, T *value) {
@@ -81,93 +88,55 @@ class CompareByTimeStamp {
     return GetTimeStamp(a) > GetTimeStamp(b);
   }
 };
-}
-
-namespace mozc {
-
-struct LRUList_Node {
-  LRUList_Node *next;
-  LRUList_Node *prev;
-  char *value;
-  LRUList_Node(): next(NULL), prev(NULL), value(NULL) {}
-};
-
-class LRUList {
- public:
-  explicit LRUList(size_t max_size)
-      : max_size_(max_size), size_(0),
-        last_(NULL), top_(NULL) {}
 
-  virtual ~LRUList() {
-    Clear();
+// The load factor of the open addressing table is kept under 0.5.
+size_t GetNumSlots(size_t size) {
+  size_t num_slots = 2;
+  while (num_slots < size * 2) {
+    num_slots *= 2;
   }
+  return num_slots;
+}
 
-  void Clear() {
-    LRUList_Node *node = top_;
-    while (node != NULL) {
-      LRUList_Node *next = node->next;
-      delete node;
-      node = next;
-    }
-    size_ = 0;
-    top_ = last_ = NULL;
-  }
-
-  LRUList_Node *Add(char *value) {
-    if (size_ < max_size_) {
-      LRUList_Node *node = new LRUList_Node;
-      node->value = value;
-      if (last_ == NULL) {
-        node->prev = NULL;
-        top_ = node;
-      } else {
-        last_->next = node;
-      }
-      node->next = NULL;
-      node->prev = last_;
-      last_ = node;
-      ++size_;
-      return node;
-    }
-    LOG(WARNING) << "LRUList is full";
-    return NULL;
-  }
+// The current index header and two checkpoints, followed by slots,
+// prev, next and checksums.
+size_t GetIndexSize(size_t size) {
+  return 3 * kIndexHeaderSize +
+      sizeof(uint32) * (GetNumSlots(size) + 3 * size);
+}
 
-  bool empty() const {
-    return (top_ == NULL);
-  }
+size_t GetRecordsSize(size_t value_size, size_t size) {
+  return (value_size + 12) * size;
+}
+}  // namespace
 
-  size_t size() const {
-    return size_;
-  }
+namespace mozc {
 
-  LRUList_Node *GetLastNode() {
-    return last_;
-  }
+struct LRUStorageIndexHeader {
+  uint32 magic;
+  uint32 generation;
+  uint32 num_slots;
+  uint32 used_size;
+  uint32 dirty;      // set by Write(), which doesn't update the index
+  uint32 top;        // newest record
+  uint32 last;       // oldest record
+  uint32 free_head;  // unused records, linked with next[]
+  uint32 index_checksum;  // of slots, prev, next and checksums
+  uint32 checksum;   // of the fields above.  Used only in checkpoints
+  uint32 reserved[2];
 
-  void MoveToTop(LRUList_Node *node) {
-    if (node->prev != NULL) {  // this is top
-      LRUList_Node *prev = node->prev;
-      LRUList_Node *next = node->next;
-      prev->next = next;
-      if (next == NULL) {
-        last_ = prev;
-      } else {
-        next->prev = prev;
-      }
-      node->next = top_;
-      top_->prev = node;
-      top_ = node;
-      top_->prev = NULL;
-    }
+  uint32 ComputeChecksum() const {
+    return Util::Fingerprint32(reinterpret_cast<const char *>(this),
+                               offsetof(LRUStorageIndexHeader, checksum));
   }
 
- private:
-  size_t max_size_;
-  size_t size_;
-  LRUList_Node *last_;
-  LRUList_Node *top_;
+  bool IsSameState(const LRUStorageIndexHeader &other) const {
+    return memcmp(this, &other,
+                  offsetof(LRUStorageIndexHeader, checksum)) == 0;
+  }
 };
+COMPILE_ASSERT(sizeof(LRUStorageIndexHeader) == kIndexHeaderSize,
+               index_header_size_mismatch);
 
 LRUStorage *LRUStorage::Create(const char *filename) {
   LRUStorage *n = new LRUStorage;
@@ -238,27 +207,26 @@ bool LRUStorage::CreateStorageFile(const char *filename,
               static_cast<std::streamsize>(ary.size() * sizeof(ary[0])));
   }
 
+  // Empty index.  It is built when the file is opened.
+  const vector<char> index(GetIndexSize(size), '\0');
+  ofs.write(&index[0], static_cast<std::streamsize>(index.size()));
+
   return true;
 }
 
 // Reopen file after initializing mapped page.
 bool LRUStorage::Clear() {
   // Don't need to clear the page if the lru list is empty
-  if (mmap_.get() == NULL || lru_list_.get() == NULL ||
-      lru_list_->size() == 0) {
+  if (mmap_.get() == NULL || index_ == NULL || index_->used_size == 0) {
     return true;
   }
-  const size_t offset =
-      sizeof(value_size_) + sizeof(size_) + sizeof(seed_);
-  if (offset >= mmap_->GetFileSize()) {   // should not happen
+  const size_t file_size = static_cast<size_t>(mmap_->GetFileSize());
+  if (kFileHeaderSize >= file_size) {   // should not happen
     return false;
   }
-  memset(mmap_->begin() + offset, '\0',
-         mmap_->GetFileSize() - offset);
-  lru_list_.reset(NULL);
-  map_.clear();
-  Open(mmap_->begin(), mmap_->GetFileSize());
-  return true;
+  memset(mmap_->begin() + kFileHeaderSize, '\0',
+         file_size - kFileHeaderSize);
+  return Open(mmap_->begin(), file_size);
 }
 
 bool LRUStorage::Merge(const char *filename) {
@@ -314,23 +282,45 @@ bool LRUStorage::Merge(const LRUStorage &storage) {
   const size_t old_size = static_cast<size_t>(end_ - begin_);
   const size_t new_size = min(buf.size(), old_size);
 
-  // TODO(taku): this part is not atomic.
-  // If the converter process is killed while memcpy or memset is running,
-  // the storage data will be broken.
-  memcpy(begin_, buf.data(), new_size);
-  if (new_size < old_size) {
-    memset(begin_ + new_size, '\0', old_size - new_size);
+  // Writes the merged records to a new file and replaces the current file
+  // with it, so that the current file is kept if the process is killed
+  // in the middle.
+  if (filename_.empty()) {
+    return false;
+  }
+  const string filename = filename_;
+  const string tmp_filename = filename + ".tmp";
+  {
+    if (!CreateStorageFile(tmp_filename.c_str(),
+                           value_size_, size_, seed_)) {
+      return false;
+    }
+    LRUStorage new_storage;
+    if (!new_storage.Open(tmp_filename.c_str())) {
+      return false;
+    }
+    memcpy(new_storage.begin_, buf.data(), new_size);
+    new_storage.RebuildIndex(false);
+    // |new_storage| is synced in Close().
   }
 
-  return Open(mmap_->begin(), mmap_->GetFileSize());
+  Close();
+  if (!Util::AtomicRename(tmp_filename, filename)) {
+    LOG(ERROR) << "AtomicRename failed: " << tmp_filename;
+    Open(filename.c_str());
+    return false;
+  }
+  return Open(filename.c_str());
 }
 
 LRUStorage::LRUStorage()
     : value_size_(0),
       size_(0),
       seed_(0),
-      last_item_(NULL),
-      begin_(NULL), end_(NULL) {}
+      begin_(NULL), end_(NULL),
+      index_(NULL), checkpoints_(NULL),
+      slots_(NULL), prev_(NULL), next_(NULL), checksums_(NULL),
+      synced_(false) {}
 
 LRUStorage::~LRUStorage() {
   Close();
@@ -382,6 +372,7 @@ bool LRUStorage::OpenOrCreate(const char *filename,
 }
 
 bool LRUStorage::Open(const char *filename) {
+  Close();
   mmap_.reset(new Mmap<char>);
 
   if (mmap_.get() == NULL) {
@@ -395,18 +386,46 @@ bool LRUStorage::Open(const char *filename) {
     return false;
   }
 
-  if (mmap_->GetFileSize() < 8) {
+  if (static_cast<size_t>(mmap_->GetFileSize()) < kFileHeaderSize) {
     LOG(ERROR) << "file size is too small";
     return false;
   }
 
+  // Files written before the index was introduced have no index part.
+  // Appends an empty index, which is built in Open() below.
+  uint32 value_size_uint32 = 0;
+  uint32 size_uint32 = 0;
+  memcpy(&value_size_uint32, mmap_->begin(), sizeof(value_size_uint32));
+  memcpy(&size_uint32, mmap_->begin() + 4, sizeof(size_uint32));
+  if (size_uint32 > 0 && size_uint32 <= kMaxLRUSize &&
+      value_size_uint32 <= kMaxValueSize &&
+      static_cast<size_t>(mmap_->GetFileSize()) ==
+      kFileHeaderSize + GetRecordsSize(value_size_uint32, size_uint32)) {
+    LOG(INFO) << "appending index to " << filename;
+    mmap_.reset(new Mmap<char>);
+    {
+      OutputFileStream ofs(filename, ios::binary|ios::out|ios::app);
+      if (!ofs) {
+        LOG(ERROR) << "cannot open " << filename;
+        return false;
+      }
+      const vector<char> index(GetIndexSize(size_uint32), '\0');
+      ofs.write(&index[0], static_cast<std::streamsize>(index.size()));
+    }
+    if (!mmap_->Open(filename, "r+")) {
+      LOG(ERROR) << "cannot open " << filename
+                 << " with read+write mode";
+      return false;
+    }
+  }
+
   filename_ = filename;
   return Open(mmap_->begin(), mmap_->GetFileSize());
 }
 
 bool LRUStorage::Open(char *ptr, size_t ptr_size) {
+  index_ = NULL;
   begin_ = ptr;
-  end_ = ptr + ptr_size;
 
   uint32 value_size_uint32 = 0;
   uint32 size_uint32 = 0;
@@ -433,42 +452,247 @@ bool LRUStorage::Open(char *ptr, size_t ptr_size) {
     return false;
   }
 
-  const size_t file_size = mmap_->GetFileSize() - 12;
-  if ((value_size_ + 12) * size_ != file_size) {
+  const size_t records_size = GetRecordsSize(value_size_, size_);
+  if (kFileHeaderSize + records_size + GetIndexSize(size_) != ptr_size) {
     LOG(ERROR) << "LRU file is broken";
     return false;
   }
 
-  vector<char *> ary;
-  char *begin = begin_;
-  char *end = end_;
-  while (begin < end) {
-    ary.push_back(begin);
-    begin += (value_size_ + 12);
+  end_ = begin_ + records_size;
+  index_ = reinterpret_cast<IndexHeader *>(end_);
+  checkpoints_ = index_ + 1;
+  slots_ = reinterpret_cast<uint32 *>(checkpoints_ + 2);
+  prev_ = slots_ + GetNumSlots(size_);
+  next_ = prev_ + size_;
+  checksums_ = next_ + size_;
+
+  const uint32 size = static_cast<uint32>(size_);
+  const IndexHeader *checkpoint = GetLatestCheckpoint();
+  if (checkpoint == NULL ||
+      !index_->IsSameState(*checkpoint) ||
+      index_->dirty != 0 ||
+      index_->num_slots != GetNumSlots(size_) ||
+      index_->used_size > size ||
+      (index_->top >= size && index_->top != kNoRecord) ||
+      (index_->last >= size && index_->last != kNoRecord) ||
+      (index_->free_head >= size && index_->free_head != kNoRecord) ||
+      checkpoint->index_checksum != ComputeIndexChecksum()) {
+    // The index has not been built yet, or was modified after the last
+    // Sync().  Checksums are available once the index has been built.
+    const bool verify_checksums =
+        (index_->magic == kIndexMagic || checkpoint != NULL);
+    RebuildIndex(verify_checksums);
+    if (!Sync()) {
+      LOG(WARNING) << "Sync failed";
+    }
+  } else {
+    synced_ = true;
   }
-  stable_sort(ary.begin(), ary.end(),
-              CompareByTimeStamp());
 
-  lru_list_.reset(new LRUList(size_));
-  map_.clear();
-  last_item_ = NULL;
-  for (size_t i = 0; i < ary.size(); ++i) {
-    if (GetTimeStamp(ary[i]) != 0) {
-      LRUList_Node *node = lru_list_->Add(ary[i]);
-      map_.insert(make_pair(GetFP(ary[i]), node));
-    } else if (last_item_ == NULL) {
-      last_item_ = ary[i];
+  return true;
+}
+
+void LRUStorage::RebuildIndex(bool verify_checksums) {
+  DCHECK(index_);
+  uint32 generation = max(index_->generation,
+                          max(checkpoints_[0].generation,
+                              checkpoints_[1].generation));
+  synced_ = false;
+  index_->magic = 0;
+  index_->num_slots = static_cast<uint32>(GetNumSlots(size_));
+  fill(slots_, slots_ + index_->num_slots, kNoRecord);
+  fill(prev_, prev_ + size_, kNoRecord);
+  fill(next_, next_ + size_, kNoRecord);
+  index_->used_size = 0;
+  index_->top = kNoRecord;
+  index_->last = kNoRecord;
+  index_->free_head = kNoRecord;
+
+  vector<const char *> ary;
+  size_t num_broken_records = 0;
+  for (uint32 id = 0; id < size_; ++id) {
+    char *record = GetRecord(id);
+    if (GetTimeStamp(record) != 0) {
+      if (!verify_checksums) {
+        UpdateRecordChecksum(id);
+      } else if (checksums_[id] != GetRecordChecksum(id)) {
+        memset(record, '\0', value_size_ + 12);
+        ++num_broken_records;
+      }
+    }
+    ary.push_back(record);
+  }
+  if (num_broken_records > 0) {
+    LOG(WARNING) << num_broken_records << " broken records are removed";
+  }
+  stable_sort(ary.begin(), ary.end(), CompareByTimeStamp());
+
+  // Unused records are kept in the order of the file.
+  for (size_t i = ary.size(); i > 0; --i) {
+    const char *record = ary[i - 1];
+    if (GetTimeStamp(record) != 0) {
+      break;
+    }
+    const uint32 id = static_cast<uint32>(
+        (record - begin_) / (value_size_ + 12));
+    next_[id] = index_->free_head;
+    index_->free_head = id;
+  }
+
+  // Pushes the records from old to new.  Records with the same fp are all
+  // linked to the list, but only the newest one is reachable from the
+  // table.  The others are evicted in due course.
+  for (size_t i = ary.size(); i > 0; --i) {
+    const char *record = ary[i - 1];
+    if (GetTimeStamp(record) == 0) {
+      continue;
+    }
+    const uint32 id = static_cast<uint32>(
+        (record - begin_) / (value_size_ + 12));
+    PushFront(id);
+    ++index_->used_size;
+    uint32 *slot = FindSlot(GetFP(record));
+    *slot = id;
+  }
+
+  index_->dirty = 0;
+  index_->generation = generation + 1;
+  index_->magic = kIndexMagic;
+}
+
+const LRUStorage::IndexHeader *LRUStorage::GetLatestCheckpoint() const {
+  const IndexHeader *latest = NULL;
+  for (int i = 0; i < 2; ++i) {
+    const IndexHeader &checkpoint = checkpoints_[i];
+    if (checkpoint.magic != kIndexMagic ||
+        checkpoint.checksum != checkpoint.ComputeChecksum()) {
+      continue;
     }
+    if (latest == NULL || checkpoint.generation > latest->generation) {
+      latest = &checkpoint;
+    }
+  }
+  return latest;
+}
+
+uint32 LRUStorage::ComputeIndexChecksum() const {
+  // slots, prev, next and checksums are contiguous.
+  const char *begin = reinterpret_cast<const char *>(slots_);
+  const char *end = reinterpret_cast<const char *>(checksums_ + size_);
+  return Util::Fingerprint32(begin, static_cast<size_t>(end - begin));
+}
+
+char *LRUStorage::GetRecord(uint32 id) const {
+  DCHECK_LT(id, size_);
+  return begin_ + id * (value_size_ + 12);
+}
+
+uint32 LRUStorage::GetRecordChecksum(uint32 id) const {
+  return Util::Fingerprint32(GetRecord(id), value_size_ + 12);
+}
+
+void LRUStorage::UpdateRecordChecksum(uint32 id) {
+  checksums_[id] = GetRecordChecksum(id);
+}
+
+uint32 *LRUStorage::FindSlot(uint64 fp) const {
+  const uint32 mask = index_->num_slots - 1;
+  uint32 i = static_cast<uint32>(fp) & mask;
+  while (slots_[i] != kNoRecord && GetFP(GetRecord(slots_[i])) != fp) {
+    i = (i + 1) & mask;
+  }
+  return slots_ + i;
+}
+
+void LRUStorage::EraseSlot(uint32 *slot) {
+  // Backward shift deletion: moves the following entries of the same
+  // cluster into the hole unless it passes over their home slots.
+  const uint32 mask = index_->num_slots - 1;
+  uint32 hole = static_cast<uint32>(slot - slots_);
+  for (uint32 i = (hole + 1) & mask; slots_[i] != kNoRecord;
+       i = (i + 1) & mask) {
+    const uint32 home =
+        static_cast<uint32>(GetFP(GetRecord(slots_[i]))) & mask;
+    // Distance from the home slot to the current slot and to the hole.
+    if (((i - home) & mask) >= ((i - hole) & mask)) {
+      slots_[hole] = slots_[i];
+      hole = i;
+    }
+  }
+  slots_[hole] = kNoRecord;
+}
+
+void LRUStorage::Unlink(uint32 id) {
+  const uint32 prev = prev_[id];
+  const uint32 next = next_[id];
+  if (prev == kNoRecord) {
+    index_->top = next;
+  } else {
+    next_[prev] = next;
+  }
+  if (next == kNoRecord) {
+    index_->last = prev;
+  } else {
+    prev_[next] = prev;
+  }
+  prev_[id] = next_[id] = kNoRecord;
+}
+
+void LRUStorage::PushFront(uint32 id) {
+  prev_[id] = kNoRecord;
+  next_[id] = index_->top;
+  if (index_->top == kNoRecord) {
+    index_->last = id;
+  } else {
+    prev_[index_->top] = id;
+  }
+  index_->top = id;
+}
+
+void LRUStorage::BeginUpdate() {
+  if (synced_) {
+    ++index_->generation;
+    synced_ = false;
+  }
+}
+
+bool LRUStorage::Sync() {
+  if (index_ == NULL || mmap_.get() == NULL) {
+    return false;
+  }
+  if (synced_) {
+    return true;
   }
 
+  // Flushes the records and the index before writing the checkpoint,
+  // so that the checkpoint never refers to data which are not on the disk.
+  if (!mmap_->Flush()) {
+    LOG(ERROR) << "cannot flush " << filename_;
+    return false;
+  }
+  index_->index_checksum = ComputeIndexChecksum();
+  IndexHeader *checkpoint = &checkpoints_[index_->generation % 2];
+  *checkpoint = *index_;
+  checkpoint->checksum = checkpoint->ComputeChecksum();
+  if (!mmap_->Flush()) {
+    LOG(ERROR) << "cannot flush " << filename_;
+    return false;
+  }
+
+  synced_ = true;
   return true;
 }
 
 void LRUStorage::Close() {
+  if (index_ != NULL) {
+    Sync();
+  }
   filename_.clear();
   mmap_.reset(NULL);
-  lru_list_.reset(NULL);
-  map_.clear();
+  begin_ = end_ = NULL;
+  index_ = checkpoints_ = NULL;
+  slots_ = prev_ = next_ = checksums_ = NULL;
+  synced_ = false;
 }
 
 const char* LRUStorage::Lookup(const string &key) const {
@@ -478,84 +702,127 @@ const char* LRUStorage::Lookup(const string &key) const {
 
 const char* LRUStorage::Lookup(const string &key,
                                uint32 *last_access_time) const {
+  if (index_ == NULL) {
+    return NULL;
+  }
   const uint64 fp = Util::FingerprintWithSeed(key.data(),
                                               key.size(),
                                               seed_);
-  map<uint64, LRUList_Node *>::const_iterator it = map_.find(fp);
-  if (it == map_.end()) {
+  const uint32 *slot = FindSlot(fp);
+  if (*slot == kNoRecord) {
     return NULL;
   }
-  *last_access_time = GetTimeStamp(it->second->value);
-  return GetValue(it->second->value);
+  const char *record = GetRecord(*slot);
+  *last_access_time = GetTimeStamp(record);
+  return GetValue(record);
+}
+
+void LRUStorage::BatchLookup(const uint64 *fps, size_t size,
+                             const char **values,
+                             uint32 *last_access_times) const {
+  if (index_ == NULL) {
+    fill(values, values + size, static_cast<const char *>(NULL));
+    fill(last_access_times, last_access_times + size, 0);
+    return;
+  }
+
+  const uint32 mask = index_->num_slots - 1;
+  for (size_t i = 0; i < size; ++i) {
+    Prefetch(slots_ + (static_cast<uint32>(fps[i]) & mask));
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    const uint32 id = *FindSlot(fps[i]);
+    if (id == kNoRecord) {
+      values[i] = NULL;
+    } else {
+      values[i] = GetRecord(id);
+      Prefetch(values[i]);
+    }
+  }
+
+  for (size_t i = 0; i < size; ++i) {
+    if (values[i] == NULL) {
+      last_access_times[i] = 0;
+    } else {
+      last_access_times[i] = GetTimeStamp(values[i]);
+      values[i] = GetValue(values[i]);
+    }
+  }
 }
 
 bool LRUStorage::GetAllValues(vector<string> *values) const {
-  if (lru_list_.get() == NULL) {
+  if (index_ == NULL) {
     return false;
   }
   DCHECK(values);
   values->clear();
-  for (const LRUList_Node *node = lru_list_->GetLastNode();
-       node != NULL;
-       node = node->prev) {
+  values->reserve(index_->used_size);
+  for (uint32 id = index_->top; id != kNoRecord; id = next_[id]) {
     // Default constructor of string is not applicable
     // because value's size() must return value_size_.
-    DCHECK(node->value);
-    values->push_back(string(GetValue(node->value), value_size_));
+    values->push_back(string(GetValue(GetRecord(id)), value_size_));
   }
-  reverse(values->begin(), values->end());
   return true;
 }
 
 bool LRUStorage::Touch(const string &key) {
-  if (lru_list_.get() == NULL) {
+  if (index_ == NULL) {
     return false;
   }
 
   const uint64 fp = Util::FingerprintWithSeed(key.data(),
                                               key.size(),
                                               seed_);
-  map<uint64, LRUList_Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value);
-    lru_list_->MoveToTop(it->second);
+  const uint32 id = *FindSlot(fp);
+  if (id != kNoRecord) {     // find in the cache
+    BeginUpdate();
+    Update(GetRecord(id));
+    UpdateRecordChecksum(id);
+    Unlink(id);
+    PushFront(id);
     return true;
   }
   return false;
 }
 
 bool LRUStorage::Insert(const string &key, const char *value) {
-  if (lru_list_.get() == NULL) {
+  return InsertFingerprint(
+      Util::FingerprintWithSeed(key.data(), key.size(), seed_), value);
+}
+
+bool LRUStorage::InsertFingerprint(uint64 fp, const char *value) {
+  if (index_ == NULL) {
     return false;
   }
 
-  const uint64 fp = Util::FingerprintWithSeed(key.data(),
-                                              key.size(),
-                                              seed_);
-  map<uint64, LRUList_Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
-  } else if (lru_list_->size() >= size_ ||
-             last_item_ == NULL) {  // not found, but cache is FULL
-    LRUList_Node *node = lru_list_->GetLastNode();
-    const uint64 old_fp = GetFP(node->value);  // remove oldest item
-    map<uint64, LRUList_Node *>::iterator old_it = map_.find(old_fp);
-    if (old_it != map_.end()) {
-      map_.erase(old_it);
-    }
-    lru_list_->MoveToTop(node);
-    Update(node->value, fp, value, value_size_);
-    map_.insert(make_pair(fp, node));
-  } else if (last_item_ < mmap_->end()) {  // not found, cahce is not FULL
-    LRUList_Node *node = lru_list_->Add(last_item_);
-    lru_list_->MoveToTop(node);
-    Update(node->value, fp, value, value_size_);
-    map_.insert(make_pair(fp, node));
-    last_item_ += (value_size_ + 12);
-    if (last_item_ >= mmap_->end()) {
-      last_item_ = NULL;
+  uint32 *slot = FindSlot(fp);
+  BeginUpdate();
+  if (*slot != kNoRecord) {     // find in the cache
+    Update(GetRecord(*slot), fp, value, value_size_);
+    UpdateRecordChecksum(*slot);
+    Unlink(*slot);
+    PushFront(*slot);
+  } else if (index_->free_head != kNoRecord) {  // cache is not FULL
+    const uint32 id = index_->free_head;
+    index_->free_head = next_[id];
+    PushFront(id);
+    ++index_->used_size;
+    Update(GetRecord(id), fp, value, value_size_);
+    UpdateRecordChecksum(id);
+    *slot = id;
+  } else if (index_->last != kNoRecord) {  // cache is FULL
+    const uint32 id = index_->last;  // remove oldest item
+    uint32 *old_slot = FindSlot(GetFP(GetRecord(id)));
+    if (*old_slot == id) {
+      EraseSlot(old_slot);
     }
+    Unlink(id);
+    PushFront(id);
+    Update(GetRecord(id), fp, value, value_size_);
+    UpdateRecordChecksum(id);
+    // The slot may have been moved by EraseSlot().
+    *FindSlot(fp) = id;
   } else {
     LOG(ERROR) << "insertion failed";
     return false;
@@ -565,17 +832,22 @@ bool LRUStorage::Insert(const string &key, const char *value) {
 }
 
 bool LRUStorage::TryInsert(const string &key, const char *value) {
-  if (lru_list_.get() == NULL) {
+  return TryInsertFingerprint(
+      Util::FingerprintWithSeed(key.data(), key.size(), seed_), value);
+}
+
+bool LRUStorage::TryInsertFingerprint(uint64 fp, const char *value) {
+  if (index_ == NULL) {
     return false;
   }
 
-  const uint64 fp = Util::FingerprintWithSeed(key.data(),
-                                              key.size(),
-                                              seed_);
-  map<uint64, LRUList_Node *>::iterator it = map_.find(fp);
-  if (it != map_.end()) {     // find in the cache
-    Update(it->second->value, fp, value, value_size_);
-    lru_list_->MoveToTop(it->second);
+  const uint32 id = *FindSlot(fp);
+  if (id != kNoRecord) {     // find in the cache
+    BeginUpdate();
+    Update(GetRecord(id), fp, value, value_size_);
+    UpdateRecordChecksum(id);
+    Unlink(id);
+    PushFront(id);
   }
 
   return true;
@@ -590,7 +862,7 @@ size_t LRUStorage::size() const {
 }
 
 size_t LRUStorage::used_size() const {
-  return lru_list_.get() == NULL ? 0 : lru_list_->size();
+  return index_ == NULL ? 0 : index_->used_size;
 }
 
 uint32 LRUStorage::seed() const {
@@ -607,6 +879,7 @@ void LRUStorage::Write(size_t i,
                        uint32 last_access_time) {
   DCHECK_GE(i, 0);
   DCHECK_LT(i, size_);
+  BeginUpdate();
   char *ptr = begin_ + (i * (value_size_ + 12));
   memcpy(ptr,     reinterpret_cast<const char *>(&fp), 8);
   memcpy(ptr + 8, reinterpret_cast<const char *>(&last_access_time), 4);
@@ -615,6 +888,9 @@ void LRUStorage::Write(size_t i,
   } else {
     LOG(ERROR) << "value size is not " << value_size_ << " byte.";
   }
+  UpdateRecordChecksum(static_cast<uint32>(i));
+  // Lets the next Open() rebuild the index.
+  index_->dirty = 1;
 }
 
 void LRUStorage::Read(size_t i,
@@ -30,7 +30,6 @@
 #ifndef MOZC_STORAGE_LRU_STORAGE_H_
 #define MOZC_STORAGE_LRU_STORAGE_H_
 
-#include <map>
 #include <string>
 #include "base/base.h"
 
@@ -38,14 +37,50 @@ namespace mozc {
 
 template <class T> class Mmap;
 
-class LRUList;
-struct LRUList_Node;
-
+// Defined in lru_storage.cc.
+struct LRUStorageIndexHeader;
+
+// File layout:
+//   uint32 value_size
+//   uint32 size
+//   uint32 seed
+//   Record[size]  each record is (uint64 fp, uint32 last_access_time,
+//                 char value[value_size])
+//   IndexHeader              current state of the index
+//   IndexHeader[2]           checkpoints written by Sync()
+//   uint32 slots[num_slots]  open addressing table from fp to record
+//   uint32 prev[size]        doubly linked LRU list of the records
+//   uint32 next[size]
+//   uint32 checksums[size]   checksums of the records
+//
+// The index part follows the records so that the records keep the layout
+// of the old files, which have no index.  Such files are extended on Open.
+// Since the index lives in the mapped file, Open doesn't have to scan the
+// records unless the index is missing or was left inconsistent.
+//
+// Crash consistency:
+// The mapped file is modified in place.  The updating methods never wait
+// for the disk.  Sync(), which the owner calls periodically, e.g., from
+// RewriterInterface::Sync(), and Close() flush the records and the index,
+// then write a checkpoint of the index header to one of the two
+// checkpoint slots alternately, with an incremented generation and the
+// checksum of the index arrays.  Open() trusts the index only when both
+// the header and the arrays match the latest valid checkpoint.
+// Otherwise, i.e., the process or the system went down after the last
+// Sync(), the index is rebuilt from the records, dropping the records
+// whose checksums don't match.  When the process is killed, a crash loses
+// at most the records being written.  When the system goes down, the
+// pages may reach the disk in any order, so the records updated after the
+// last Sync() may be lost, but not the whole file.  Merge() writes the
+// merged records to a new file and renames it to the original one.
 class LRUStorage {
  public:
   bool Open(const char *filename);
   void Close();
 
+  // Flushes the mapped file and writes a checkpoint.
+  bool Sync();
+
   // Try to open exisiting database
   // If the file is broken or cannot open, tries to recreate
   // new file
@@ -60,6 +95,16 @@ class LRUStorage {
 
   const char *Lookup(const string &key) const;
 
+  // Looks up |size| keys at once.  The keys are given as fingerprints,
+  // i.e., Util::FingerprintWithSeed(key, seed()).  |values[i]| is set to
+  // the value of |fps[i]|, or NULL if not found, and |last_access_times[i]|
+  // to its last access time.  The index and the records of all the keys
+  // are prefetched before they are read, so this is faster than calling
+  // Lookup() for each key.
+  void BatchLookup(const uint64 *fps, size_t size,
+                   const char **values,
+                   uint32 *last_access_times) const;
+
   // Returns all values.
   // The order is new to old (*values->begin() is the newest).
   bool GetAllValues(vector<string> *values) const;
@@ -84,6 +129,10 @@ class LRUStorage {
   bool TryInsert(const string &key,
                  const char *value);
 
+  // Same as Insert() and TryInsert(), but the key is given as fingerprint.
+  bool InsertFingerprint(uint64 fp, const char *value);
+  bool TryInsertFingerprint(uint64 fp, const char *value);
+
   size_t value_size() const;
   size_t size() const;
   size_t used_size() const;
@@ -92,7 +141,8 @@ class LRUStorage {
 
   // Write one entry at |i| th index.
   // i must be 0 <= i < size.
-  // This data will not update the index of the storage.
+  // This data will not update the index of the storage.  The index is
+  // rebuilt when the file is opened next time.
   void Write(size_t i,
              uint64 fp,
              const string &value,
@@ -124,18 +174,53 @@ class LRUStorage {
   virtual ~LRUStorage();
 
  private:
+  typedef LRUStorageIndexHeader IndexHeader;
+
   // load from memory buffer
   bool Open(char *ptr, size_t ptr_size);
 
+  // Rebuilds the index from the timestamps of the records.  If
+  // |verify_checksums| is true, records with wrong checksums are cleared.
+  // Otherwise the checksums are computed from the records.
+  void RebuildIndex(bool verify_checksums);
+
+  // Returns the latest checkpoint whose checksum is valid, or NULL.
+  const IndexHeader *GetLatestCheckpoint() const;
+
+  // Returns the checksum of slots, prev, next and checksums.
+  uint32 ComputeIndexChecksum() const;
+
+  char *GetRecord(uint32 id) const;
+  uint32 GetRecordChecksum(uint32 id) const;
+  void UpdateRecordChecksum(uint32 id);
+
+  // Returns the slot which holds |fp|, or the empty slot where |fp|
+  // should be inserted.
+  uint32 *FindSlot(uint64 fp) const;
+  void EraseSlot(uint32 *slot);
+
+  void Unlink(uint32 id);
+  void PushFront(uint32 id);
+
+  // Increments the generation of the index at the first update after
+  // Sync(), so that the index doesn't match the checkpoint until the next
+  // Sync().  The generation may reach the disk after the index arrays,
+  // which is detected by the checksum of the arrays.
+  void BeginUpdate();
+
   size_t value_size_;
   size_t size_;
   uint32 seed_;
-  char *last_item_;
   char *begin_;
   char *end_;
+  IndexHeader *index_;
+  IndexHeader *checkpoints_;
+  uint32 *slots_;
+  uint32 *prev_;
+  uint32 *next_;
+  uint32 *checksums_;
+  bool synced_;
   string filename_;
-  map<uint64, LRUList_Node *> map_;
-  scoped_ptr<LRUList> lru_list_;
   scoped_ptr<Mmap<char> > mmap_;
 };
 }
@@ -307,6 +307,282 @@ TEST_F(LRUStorageTest, Merge) {
   Util::Unlink(file2);
 }
 
+TEST_F(LRUStorageTest, ReopenTest) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 100, 0x76fef);
+  vector<string> expected;
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.Open(file.c_str()));
+    RunTest(&storage, 100);
+    EXPECT_EQ(100, storage.used_size());
+    EXPECT_TRUE(storage.Touch("not found") == false);
+    EXPECT_TRUE(storage.GetAllValues(&expected));
+  }
+
+  // The LRU order is restored from the index in the file.
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.Open(file.c_str()));
+    EXPECT_EQ(100, storage.used_size());
+    vector<string> values;
+    EXPECT_TRUE(storage.GetAllValues(&values));
+    EXPECT_EQ(expected, values);
+  }
+}
+
+TEST_F(LRUStorageTest, EvictionTest) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 3, 0x76fef);
+  LRUStorage storage;
+  EXPECT_TRUE(storage.Open(file.c_str()));
+
+  const uint32 v[] = {1, 2, 3, 4};
+  EXPECT_TRUE(storage.Insert("a", reinterpret_cast<const char *>(&v[0])));
+  EXPECT_TRUE(storage.Insert("b", reinterpret_cast<const char *>(&v[1])));
+  EXPECT_TRUE(storage.Insert("c", reinterpret_cast<const char *>(&v[2])));
+  EXPECT_EQ(3, storage.used_size());
+
+  // "a" becomes the newest one and "b" is evicted.
+  EXPECT_TRUE(storage.Touch("a"));
+  EXPECT_TRUE(storage.Insert("d", reinterpret_cast<const char *>(&v[3])));
+  EXPECT_EQ(3, storage.used_size());
+  EXPECT_TRUE(storage.Lookup("b") == NULL);
+  ASSERT_TRUE(storage.Lookup("a") != NULL);
+  EXPECT_EQ(1, *reinterpret_cast<const uint32 *>(storage.Lookup("a")));
+  ASSERT_TRUE(storage.Lookup("d") != NULL);
+  EXPECT_EQ(4, *reinterpret_cast<const uint32 *>(storage.Lookup("d")));
+
+  vector<string> values;
+  EXPECT_TRUE(storage.GetAllValues(&values));
+  ASSERT_EQ(3, values.size());
+  EXPECT_EQ(4, *reinterpret_cast<const uint32 *>(values[0].data()));
+  EXPECT_EQ(1, *reinterpret_cast<const uint32 *>(values[1].data()));
+  EXPECT_EQ(3, *reinterpret_cast<const uint32 *>(values[2].data()));
+
+  // TryInsert doesn't add new entries.
+  EXPECT_TRUE(storage.TryInsert("b", reinterpret_cast<const char *>(&v[1])));
+  EXPECT_TRUE(storage.Lookup("b") == NULL);
+
+  EXPECT_TRUE(storage.Clear());
+  EXPECT_EQ(0, storage.used_size());
+  EXPECT_TRUE(storage.Lookup("a") == NULL);
+  EXPECT_TRUE(storage.Insert("e", reinterpret_cast<const char *>(&v[0])));
+  EXPECT_TRUE(storage.Lookup("e") != NULL);
+}
+
+TEST_F(LRUStorageTest, BatchLookupTest) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 100, 0x76fef);
+  LRUStorage storage;
+  EXPECT_TRUE(storage.Open(file.c_str()));
+
+  vector<uint64> fps;
+  for (uint32 i = 0; i < 50; ++i) {
+    const string key = "key" + Util::SimpleItoa(i);
+    if (i % 2 == 0) {
+      EXPECT_TRUE(storage.Insert(key, reinterpret_cast<const char *>(&i)));
+    }
+    fps.push_back(Util::FingerprintWithSeed(key, storage.seed()));
+  }
+  // Fingerprint version is equivalent to the string version.
+  const uint32 v = 100;
+  EXPECT_TRUE(storage.InsertFingerprint(
+      Util::FingerprintWithSeed("key100", storage.seed()),
+      reinterpret_cast<const char *>(&v)));
+  EXPECT_TRUE(storage.Lookup("key100") != NULL);
+  fps.push_back(Util::FingerprintWithSeed("key100", storage.seed()));
+
+  vector<const char *> values(fps.size());
+  vector<uint32> last_access_times(fps.size());
+  storage.BatchLookup(&fps[0], fps.size(), &values[0], &last_access_times[0]);
+  for (uint32 i = 0; i < 50; ++i) {
+    const string key = "key" + Util::SimpleItoa(i);
+    uint32 last_access_time = 0;
+    EXPECT_EQ(storage.Lookup(key, &last_access_time), values[i]);
+    if (i % 2 == 0) {
+      ASSERT_TRUE(values[i] != NULL);
+      EXPECT_EQ(i, *reinterpret_cast<const uint32 *>(values[i]));
+      EXPECT_EQ(last_access_time, last_access_times[i]);
+    } else {
+      EXPECT_TRUE(values[i] == NULL);
+      EXPECT_EQ(0, last_access_times[i]);
+    }
+  }
+  ASSERT_TRUE(values[50] != NULL);
+  EXPECT_EQ(100, *reinterpret_cast<const uint32 *>(values[50]));
+}
+
+TEST_F(LRUStorageTest, IndexIsRebuiltAfterWrite) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 10, 0x76fef);
+  const uint64 fp = Util::FingerprintWithSeed("key", 3, 0x76fef);
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.Open(file.c_str()));
+    storage.Write(5, fp, "test", 10);
+  }
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.Open(file.c_str()));
+    EXPECT_EQ(1, storage.used_size());
+    uint32 last_access_time = 0;
+    const char *value = storage.Lookup("key", &last_access_time);
+    ASSERT_TRUE(value != NULL);
+    EXPECT_EQ("test", string(value, 4));
+    EXPECT_EQ(10, last_access_time);
+  }
+}
+
+TEST_F(LRUStorageTest, OpenFileWithoutIndex) {
+  const string file = GetTemporaryFilePath();
+  const uint64 fp = Util::FingerprintWithSeed("key", 3, 0x76fef);
+  {
+    // Header and two records written by the old version.
+    OutputFileStream ofs(file.c_str(), ios::binary|ios::out);
+    const uint32 header[] = {4, 2, 0x76fef};
+    ofs.write(reinterpret_cast<const char *>(header), sizeof(header));
+    const uint32 last_access_time = 10;
+    ofs.write(reinterpret_cast<const char *>(&fp), sizeof(fp));
+    ofs.write(reinterpret_cast<const char *>(&last_access_time),
+              sizeof(last_access_time));
+    ofs.write("test", 4);
+    const char empty[16] = {};
+    ofs.write(empty, sizeof(empty));
+  }
+
+  LRUStorage storage;
+  EXPECT_TRUE(storage.Open(file.c_str()));
+  EXPECT_EQ(2, storage.size());
+  EXPECT_EQ(1, storage.used_size());
+  const char *value = storage.Lookup("key");
+  ASSERT_TRUE(value != NULL);
+  EXPECT_EQ("test", string(value, 4));
+
+  const uint32 v = 1;
+  EXPECT_TRUE(storage.Insert("new", reinterpret_cast<const char *>(&v)));
+  EXPECT_EQ(2, storage.used_size());
+  EXPECT_TRUE(storage.Lookup("key") != NULL);
+  EXPECT_TRUE(storage.Lookup("new") != NULL);
+}
+
+namespace {
+// Copies the file as it is while it is opened, which is what is left
+// when the process is killed.
+void CopyFile(const string &from, const string &to) {
+  string content;
+  {
+    InputFileStream ifs(from.c_str(), ios::binary);
+    char buf[4096];
+    while (ifs.read(buf, sizeof(buf)) || ifs.gcount() > 0) {
+      content.append(buf, ifs.gcount());
+    }
+  }
+  OutputFileStream ofs(to.c_str(), ios::binary|ios::out);
+  ofs.write(content.data(), content.size());
+}
+}  // namespace
+
+TEST_F(LRUStorageTest, RecoverFromCrash) {
+  const string file = GetTemporaryFilePath();
+  const string crashed_file = GetTemporaryFilePath() + ".crashed";
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 10, 0x76fef);
+
+  LRUStorage storage;
+  EXPECT_TRUE(storage.Open(file.c_str()));
+  const uint32 v[] = {1, 2, 3, 4};
+  EXPECT_TRUE(storage.Insert("a", reinterpret_cast<const char *>(&v[0])));
+  EXPECT_TRUE(storage.Insert("b", reinterpret_cast<const char *>(&v[1])));
+  EXPECT_TRUE(storage.Insert("c", reinterpret_cast<const char *>(&v[2])));
+  EXPECT_TRUE(storage.Sync());
+  // Not synced.
+  EXPECT_TRUE(storage.Insert("d", reinterpret_cast<const char *>(&v[3])));
+
+  // Killed after "d" is written.
+  {
+    CopyFile(file, crashed_file);
+    LRUStorage crashed;
+    EXPECT_TRUE(crashed.Open(crashed_file.c_str()));
+    EXPECT_EQ(4, crashed.used_size());
+    EXPECT_TRUE(crashed.Lookup("a") != NULL);
+    EXPECT_TRUE(crashed.Lookup("d") != NULL);
+  }
+
+  // Killed while "d" is being written.  Only "d" is lost.
+  {
+    CopyFile(file, crashed_file);
+    const uint64 fp = Util::FingerprintWithSeed("d", storage.seed());
+    for (size_t i = 0; i < storage.size(); ++i) {
+      uint64 record_fp = 0;
+      string value;
+      uint32 last_access_time = 0;
+      storage.Read(i, &record_fp, &value, &last_access_time);
+      if (record_fp == fp) {
+        // Value of the record.
+        fstream fs(crashed_file.c_str(), ios::binary|ios::in|ios::out);
+        fs.seekp(12 + i * (12 + 4) + 12);
+        fs.write("x", 1);
+        break;
+      }
+    }
+    LRUStorage crashed;
+    EXPECT_TRUE(crashed.Open(crashed_file.c_str()));
+    EXPECT_EQ(3, crashed.used_size());
+    EXPECT_TRUE(crashed.Lookup("a") != NULL);
+    EXPECT_TRUE(crashed.Lookup("b") != NULL);
+    EXPECT_TRUE(crashed.Lookup("c") != NULL);
+    EXPECT_TRUE(crashed.Lookup("d") == NULL);
+  }
+
+  // Close() syncs the file.
+  storage.Close();
+  {
+    LRUStorage reopened;
+    EXPECT_TRUE(reopened.Open(file.c_str()));
+    EXPECT_EQ(4, reopened.used_size());
+    vector<string> values;
+    EXPECT_TRUE(reopened.GetAllValues(&values));
+    ASSERT_EQ(4, values.size());
+    EXPECT_EQ(4, *reinterpret_cast<const uint32 *>(values[0].data()));
+  }
+
+  Util::Unlink(crashed_file);
+}
+
+TEST_F(LRUStorageTest, RebuildCorruptedIndex) {
+  const string file = GetTemporaryFilePath();
+  LRUStorage::CreateStorageFile(file.c_str(), 4, 10, 0x76fef);
+  {
+    LRUStorage storage;
+    EXPECT_TRUE(storage.Open(file.c_str()));
+    const uint32 v[] = {1, 2, 3};
+    EXPECT_TRUE(storage.Insert("a", reinterpret_cast<const char *>(&v[0])));
+    EXPECT_TRUE(storage.Insert("b", reinterpret_cast<const char *>(&v[1])));
+    EXPECT_TRUE(storage.Insert("c", reinterpret_cast<const char *>(&v[2])));
+    // Close() writes a valid checkpoint.
+  }
+
+  // Fills the slots, prev and next with garbage, leaving the headers and
+  // the checkpoints intact.  The slots follow the file header (12 bytes),
+  // 10 records (16 bytes each) and 3 index headers (48 bytes each).
+  {
+    const string garbage(4 * (32 + 10 + 10), '\x7f');
+    fstream fs(file.c_str(), ios::binary|ios::in|ios::out);
+    fs.seekp(12 + 10 * 16 + 3 * 48);
+    fs.write(garbage.data(), garbage.size());
+  }
+
+  // The index is rebuilt from the records.
+  LRUStorage storage;
+  EXPECT_TRUE(storage.Open(file.c_str()));
+  EXPECT_EQ(3, storage.used_size());
+  EXPECT_EQ(3, *reinterpret_cast<const uint32 *>(storage.Lookup("c")));
+  EXPECT_TRUE(storage.Lookup("d") == NULL);
+  vector<string> values;
+  EXPECT_TRUE(storage.GetAllValues(&values));
+  EXPECT_EQ(3, values.size());
+}
+
 TEST_F(LRUStorageTest, InvalidFileOpenTest) {
   LRUStorage storage;
   EXPECT_FALSE(storage.Insert("test", NULL));